@@ -0,0 +1,36 @@
+#version 330 core
+
+#include "lib/defs.glslh"
+#include "interface/standard.glslh"
+
+// Applies several per-pixel filters in a single pass; see ppgraph.c.
+//
+// The program is generated at runtime: PP_FILTER_<name> is defined for every filter in the
+// chain, and PP_FILTER_CHAIN is the sequence of calls. Filters live in lib/filter/, and each one
+// uses its own range of uniform locations (tex is 0), so that any of them can be combined:
+//
+//      zbuf_fog    1-6
+//      tunnel      7-8
+
+#ifdef PP_FILTER_zbuf_fog
+#include "lib/filter/zbuf_fog.glslh"
+#endif
+
+#ifdef PP_FILTER_tunnel
+#include "lib/filter/tunnel.glslh"
+#endif
+
+#ifndef PP_FILTER_CHAIN
+#define PP_FILTER_CHAIN
+#endif
+
+// Between separate passes, the result is stored in a normalized framebuffer.
+vec4 pp_store(vec4 c) {
+	return clamp(c, 0.0, 1.0);
+}
+
+void main(void) {
+	vec4 pp_color = texture(tex, texCoord);
+	PP_FILTER_CHAIN
+	fragColor = pp_color;
+}
@@ -3,6 +3,6 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    vec4 texel = texture(tex, texCoord);
+    vec4 texel = sprite_texture(texCoord);
     fragColor = (texel.g * color + vec4(texel.b)) * (1 - customParams.r);
 }
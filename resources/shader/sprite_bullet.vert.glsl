@@ -6,11 +6,15 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    gl_Position = r_projectionMatrix * spriteVMTransform * vec4(vertPos, 0.0, 1.0);
-    vec2 tc = (spriteTexTransform * vec4(vertTexCoord, 0.0, 1.0)).xy;
+    gl_Position = r_projectionMatrix * sprite_vm_transform() * vec4(vertPos, 0.0, 1.0);
+    vec2 tc = sprite_tex_transform(vertTexCoord);
     texCoordRaw = tc;
-    texCoord = uv_to_region(spriteTexRegion, tc);
-    texRegion   = spriteTexRegion;
+    texCoord = uv_to_region(sprite_tex_region(), tc);
+    texRegion   = sprite_tex_region();
     customParams = spriteCustomParams;
-    color = spriteRGBA;
+    color = sprite_rgba();
+
+    #ifdef R_SPRITE_TEXTURE_ARRAYS
+    texLayer = spriteTexLayer;
+    #endif
 }
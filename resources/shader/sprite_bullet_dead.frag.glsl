@@ -3,7 +3,7 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    vec4 texel = texture(tex, texCoord);
+    vec4 texel = sprite_texture(texCoord);
     float oWhite = texel.b * (1 - clamp(2 * customParams.r,     0, 1));
     float oColor = texel.g * (1 - clamp(2 * customParams.r - 1, 0, 1));
     float o = clamp(oWhite + oColor, 0, 1);
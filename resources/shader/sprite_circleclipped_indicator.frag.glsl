@@ -8,7 +8,7 @@ UNIFORM(2) vec2 origin_ofs;
 
 void main(void) {
 	float fill = customParams.r;
-	vec4 texel = texture(tex, texCoord);
+	vec4 texel = sprite_texture(texCoord);
 	vec2 tc = flip_native_to_bottomleft(texCoordRaw) - vec2(0.5) + origin_ofs;
 
 	float x = atan(tc.x, tc.y) - pi * (2.0 * fill - 1.0);
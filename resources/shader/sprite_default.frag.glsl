@@ -3,5 +3,5 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    fragColor = color * texture(tex, texCoord);
+    fragColor = color * sprite_texture(texCoord);
 }
@@ -3,7 +3,7 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    vec4 texel = texture(tex, texCoord);
+    vec4 texel = sprite_texture(texCoord);
     fragColor.rgb = mix(color.rgb, vec3(0.0), texel.b) * texel.a;
     fragColor.rgb += customParams.rgb * texel.r * texel.a * customParams.a;
     // fragColor.rgb = mix(fragColor.rgb, customParams.rgb, customParams.a * texel.r * texel.a);
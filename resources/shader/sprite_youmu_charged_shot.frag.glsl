@@ -12,7 +12,7 @@ ported from:
 */
 
 void main(void) {
-    vec4 texel = texture(tex, texCoord);
+    vec4 texel = sprite_texture(texCoord);
     float charge = customParams.r;
 
     fragColor = vec4(0.0);
@@ -3,7 +3,7 @@
 #include "interface/sprite.glslh"
 
 void main(void) {
-    vec4 texel = texture(tex, texCoord);
+    vec4 texel = sprite_texture(texCoord);
 
     fragColor = vec4(0.0);
     fragColor.rgb += vec3(texel.r);
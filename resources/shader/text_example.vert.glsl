@@ -9,7 +9,7 @@ void main(void) {
     // Enlarge the quad to make some room for effects.
     float scale = 2;
     vec2 pos = vertPos * scale;
-    gl_Position = r_projectionMatrix * spriteVMTransform * vec4(pos, 0.0, 1.0);
+    gl_Position = r_projectionMatrix * sprite_vm_transform() * vec4(pos, 0.0, 1.0);
 
     // Adjust texture coordinates so that the glyph remains in the center, unaffected by the scaling factor.
     // Some extra code is required in the fragment shader to chop off the unwanted bits of the texture.
@@ -19,17 +19,17 @@ void main(void) {
     texCoord = tc;
 
     // Pass the normalized texture region, so that we can map texCoord to it later in the fragment shader.
-    texRegion = spriteTexRegion;
+    texRegion = sprite_tex_region();
 
     // Global overlay coordinates for this primitive.
-    texCoordOverlay = (spriteTexTransform * vec4(tc, 0.0, 1.0)).xy;
+    texCoordOverlay = sprite_tex_transform(tc);
 
     // Fragment shader needs to know the sprite dimensions so that it can denormalize texCoord for processing.
-    dimensions = spriteDimensions;
+    dimensions = sprite_dimensions();
 
     // Arbitrary parameters provided by the application. You can use this to pass e.g. times/frames.
     customParams = spriteCustomParams;
 
     // Should be obvious.
-    color = spriteRGBA;
+    color = sprite_rgba();
 }
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+#
+# Bakes the images in a directory into pixmaps that the game can upload as they are, and packs
+# them into an uncompressed zip archive, so that they can be read straight from a memory mapping.
+# See src/resource/texture_baked.h for the format.
+#
+
+import argparse
+import struct
+import zlib
+
+from pathlib import (
+    Path,
+)
+
+from zipfile import (
+    ZipFile,
+    ZipInfo,
+    ZIP_STORED,
+)
+
+from concurrent.futures import (
+    ThreadPoolExecutor,
+)
+
+from PIL import (
+    Image,
+)
+
+from taiseilib.common import (
+    add_common_args,
+    run_main,
+    write_depfile,
+)
+
+
+FORMAT_VERSION = 1
+MAGIC = b'TBPX'
+FLAG_PREMULTIPLIED = 1
+
+# See PIXMAP_MAKE_FORMAT in src/util/pixmap.h
+PIXMAP_FORMAT_RGB8 = (8 >> 3) | (3 << 8)
+PIXMAP_FORMAT_RGBA8 = (8 >> 3) | (4 << 8)
+PIXMAP_ORIGIN_BOTTOMLEFT = 1
+
+MAX_LEVELS = 16
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+image_exts = ['.png', '.webp']
+
+
+def is_16bit_png(data):
+    # PIL quietly reduces these to 8 bits per channel, which the game doesn't.
+    return data.startswith(PNG_SIGNATURE) and data[24] == 16
+
+
+def bake(src_path, compression):
+    data = src_path.read_bytes()
+
+    if is_16bit_png(data):
+        return None
+
+    img = Image.open(src_path)
+    img.load()
+
+    has_alpha = img.mode in ('RGBA', 'LA', 'PA') or (img.mode == 'P' and 'transparency' in img.info)
+
+    if has_alpha:
+        # 'RGBa' is RGBA with premultiplied alpha
+        img = img.convert('RGBA').convert('RGBa')
+        pixmap_format = PIXMAP_FORMAT_RGBA8
+    else:
+        img = img.convert('RGB')
+        pixmap_format = PIXMAP_FORMAT_RGB8
+
+    img = img.transpose(Image.FLIP_TOP_BOTTOM)
+    levels = [img]
+
+    while len(levels) < MAX_LEVELS and (img.width > 1 or img.height > 1):
+        img = img.resize((max(1, img.width // 2), max(1, img.height // 2)), Image.BOX)
+        levels.append(img)
+
+    out = bytearray()
+    out += MAGIC
+    out += struct.pack('<IIIHBBI',
+        FORMAT_VERSION,
+        len(data),
+        zlib.crc32(data) & 0xffffffff,
+        pixmap_format,
+        PIXMAP_ORIGIN_BOTTOMLEFT,
+        FLAG_PREMULTIPLIED,
+        len(levels),
+    )
+
+    for level in levels:
+        pixels = level.tobytes()
+        stored = pixels
+
+        if compression > 0:
+            compressed = zlib.compress(pixels, compression)
+
+            if len(compressed) < len(pixels):
+                stored = compressed
+
+        out += struct.pack('<III', level.width, level.height, len(stored))
+        out += stored
+
+    return bytes(out)
+
+
+def main(args):
+    parser = argparse.ArgumentParser(description='Bake textures into a package.', prog=args[0])
+
+    parser.add_argument('gfx_dir',
+        help='Directory with the source images',
+        type=Path,
+    )
+
+    parser.add_argument('output',
+        help='Path of the package to create',
+        type=Path,
+    )
+
+    parser.add_argument('--compression',
+        help='zlib compression level of the pixel data, 0 to store it as is, so that it can be read straight from the memory mapping (default: 0)',
+        type=int,
+        default=0,
+    )
+
+    add_common_args(parser, depfile=True)
+    args = parser.parse_args(args[1:])
+
+    gfx_dir = args.gfx_dir.resolve()
+    sources = sorted(p for p in gfx_dir.rglob('*') if p.suffix in image_exts)
+
+    with ThreadPoolExecutor() as ex:
+        baked = list(ex.map(lambda p: bake(p, args.compression), sources))
+
+    with ZipFile(str(args.output), 'w', ZIP_STORED) as zf:
+        handled_subdirs = set()
+
+        for src, data in zip(sources, baked):
+            if data is None:
+                print('Skipping {} (not supported)'.format(src))
+                continue
+
+            # res/gfx/foo.webp -> res/baked/gfx/foo.webp.bpx
+            name = 'baked/{}/{}.bpx'.format(gfx_dir.name, src.relative_to(gfx_dir).as_posix())
+            reldir = name.rpartition('/')[0]
+
+            while reldir and reldir not in handled_subdirs:
+                handled_subdirs.add(reldir)
+                zi = ZipInfo(reldir + '/')
+                zi.external_attr = 0o40755 << 16 # drwxr-xr-x
+                zf.writestr(zi, '')
+                reldir = reldir.rpartition('/')[0]
+
+            zf.writestr(ZipInfo(name), data)
+
+    if args.depfile is not None:
+        write_depfile(args.depfile, args.output, sources + [Path(__file__)])
+
+
+if __name__ == '__main__':
+    run_main(main)
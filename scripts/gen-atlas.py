@@ -81,7 +81,7 @@ def write_sprite_def(dst, texture, region, size, overrides=None):
     update_text_file(dst, text)
 
 
-def write_texture_def(dst, texture, texture_fmt, global_overrides=None, local_overrides=None):
+def write_texture_def(dst, texture, texture_fmt, global_overrides=None, local_overrides=None, array=None):
     dst.parent.mkdir(exist_ok=True, parents=True)
 
     text = (
@@ -89,6 +89,9 @@ def write_texture_def(dst, texture, texture_fmt, global_overrides=None, local_ov
         f'source = res/gfx/{texture}.{texture_fmt}\n'
     )
 
+    if array is not None:
+        text += f'array = {array}\n'
+
     if global_overrides is not None:
         text += f'\n# -- Pasted from the global override file --\n\n{global_overrides.strip()}\n'
 
@@ -142,7 +145,7 @@ def get_override_file_name(basename):
     return f'{basename}.spr'
 
 
-def gen_atlas(overrides, src, dst, binsize, atlasname, tex_format=texture_formats[0], border=1, force_single=False, crop=True, leanify=True):
+def gen_atlas(overrides, src, dst, binsize, atlasname, tex_format=texture_formats[0], border=1, force_single=False, crop=True, leanify=True, array=None):
     overrides = Path(overrides).resolve()
     src = Path(src).resolve()
     dst = Path(dst).resolve()
@@ -242,7 +245,7 @@ def gen_atlas(overrides, src, dst, binsize, atlasname, tex_format=texture_format
             print(dstfile)
 
             dstfile_meta = temp_dst / f'{textureid}.tex'
-            write_texture_def(dstfile_meta, textureid, tex_format, texture_global_overrides, texture_local_overrides)
+            write_texture_def(dstfile_meta, textureid, tex_format, texture_global_overrides, texture_local_overrides, array)
 
             actual_size = [0, 0]
 
@@ -431,6 +434,13 @@ def main(args):
         default=texture_formats[0],
     )
 
+    parser.add_argument('--array', '-a',
+        help='Name of the array texture the pages belong to (see TAISEI_ATLAS_ARRAYS); gen-atlases.py generates its definition',
+        metavar='NAME',
+        default=None,
+        type=str,
+    )
+
     args = parser.parse_args()
 
     if args.name is None:
@@ -446,7 +456,8 @@ def main(args):
         border=args.border,
         force_single=args.single,
         crop=args.crop,
-        leanify=args.leanify
+        leanify=args.leanify,
+        array=args.array,
     )
 
 
@@ -3,6 +3,7 @@
 from taiseilib.common import (
     ninja,
     run_main,
+    update_text_file,
     wait_for_futures,
 )
 
@@ -13,9 +14,27 @@ from concurrent.futures import (
 from pathlib import Path
 
 import os
+import re
 import sys
 
 
+def write_array_defs(gfx_dir):
+    arrays = {}
+    pattern = re.compile(r'^\s*array\s*=\s*(\S+)\s*$', re.MULTILINE)
+
+    for path in sorted(gfx_dir.glob('atlas_*.tex')):
+        m = pattern.search(path.read_text())
+
+        if m is not None:
+            arrays.setdefault(m.group(1), []).append(path.stem)
+
+    for name, pages in arrays.items():
+        update_text_file(gfx_dir / f'{name}.tex', (
+            '# Autogenerated by gen-atlases.py, do not modify\n\n'
+            f'layers = {" ".join(pages)}\n'
+        ))
+
+
 def main(args):
     try:
         src_dir = Path(os.environ['MESON_SOURCE_ROOT'])
@@ -32,6 +51,8 @@ def main(args):
 
         wait_for_futures(futures)
 
+    write_array_defs(src_dir / 'resources' / 'gfx')
+
 
 if __name__ == '__main__':
     run_main(main)
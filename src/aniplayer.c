@@ -31,6 +31,20 @@ void aniplayer_free(AniPlayer *plr) {
 	alist_free_all(&plr->queue);
 }
 
+void aniplayer_copy(AniPlayer *dst, const AniPlayer *src) {
+	memset(dst, 0, sizeof(AniPlayer));
+	dst->ani = src->ani;
+
+	for(AniQueueEntry *e = src->queue.first; e; e = e->next) {
+		AniQueueEntry *c = calloc(1, sizeof(AniQueueEntry));
+		c->sequence = e->sequence;
+		c->clock = e->clock;
+		c->duration = e->duration;
+		alist_append(&dst->queue, c);
+		dst->queuesize++;
+	}
+}
+
 // Deletes the queue. If hard is set, even the last element is removed leaving the player in an invalid state.
 static void aniplayer_reset(AniPlayer *plr, bool hard) {
 	if(plr->queuesize == 0)
@@ -91,6 +91,9 @@ struct AniPlayer{
 void aniplayer_create(AniPlayer *plr, Animation *ani, const char *startsequence) attr_nonnull(1, 2);
 void aniplayer_free(AniPlayer *plr);
 
+// Makes dst an independent copy of src, queue and all. dst must not hold a queue of its own.
+void aniplayer_copy(AniPlayer *dst, const AniPlayer *src) attr_nonnull(1, 2);
+
 // AniPlayer version of animation_get_frame.
 // CAUTION: the returned Sprite is only valid until the next call to animation/aniplayer_get_frame
 Sprite *aniplayer_get_frame(AniPlayer *plr) attr_nonnull(1);
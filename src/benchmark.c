@@ -0,0 +1,396 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "benchmark.h"
+#include "global.h"
+#include "replay.h"
+#include "stageobjects.h"
+#include "hirestime.h"
+#include "version.h"
+#include "util.h"
+#include "vfs/public.h"
+#include "stages/benchmark_scenes.h"
+
+#define BENCHMARK_SCENE_FRAMES (60 * FPS)
+#define BENCHMARK_SEED 0x7A15E1
+#define BENCHMARK_REPLAY_DIR "res/benchmark"
+#define BENCHMARK_NUM_POOLS (sizeof(StageObjectPools) / sizeof(ObjectPool*))
+
+/*
+ * Allocation counting.
+ *
+ * There is no allocator wrapper in the codebase, and most allocations worth knowing about happen
+ * in libraries anyway, so malloc and friends are replaced for the whole process. This is only
+ * possible with glibc, which exports the real implementations under other names. It also gets in
+ * the way of tools that intercept malloc themselves, such as valgrind, so it's only built with the
+ * benchmark_alloc_stats option. free() is left alone.
+ */
+
+#ifdef TAISEI_BUILDCONF_ALLOC_STATS
+
+#include <errno.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+// Not an SDL atomic: this must work before SDL is even loaded.
+static ulong num_allocs;
+
+void *malloc(size_t size) {
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) {
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+	if(alignment % sizeof(void*) || (alignment & (alignment - 1))) {
+		return EINVAL;
+	}
+
+	__atomic_fetch_add(&num_allocs, 1, __ATOMIC_RELAXED);
+	void *p = __libc_memalign(alignment, size);
+
+	if(!p) {
+		return ENOMEM;
+	}
+
+	*out = p;
+	return 0;
+}
+
+static inline ulong get_num_allocs(void) {
+	return __atomic_load_n(&num_allocs, __ATOMIC_RELAXED);
+}
+
+#define HAVE_ALLOC_STATS 1
+
+#else
+
+static inline ulong get_num_allocs(void) {
+	return 0;
+}
+
+#define HAVE_ALLOC_STATS 0
+
+#endif
+
+typedef struct BenchmarkPoolStats {
+	char tag[32];
+	size_t capacity;
+	size_t peak_usage;
+} BenchmarkPoolStats;
+
+typedef struct BenchmarkResult {
+	char *name;
+	const char *kind;
+	uint frames;
+	double time;
+	uint64_t ns_mean;
+	uint64_t ns_p50;
+	uint64_t ns_p90;
+	uint64_t ns_p99;
+	uint64_t ns_max;
+	double allocs_per_frame;
+	BenchmarkPoolStats pools[BENCHMARK_NUM_POOLS];
+} BenchmarkResult;
+
+typedef struct BenchmarkScene {
+	const char *name;
+	uint16_t stage_id;
+	CharacterID character;
+	ShotModeID shot;
+} BenchmarkScene;
+
+static const BenchmarkScene scenes[] = {
+	{ "bullets", STAGE_BENCHMARK_BULLETS, PLR_CHAR_MARISA, PLR_SHOT_MARISA_LASER },
+	{ "swarm",   STAGE_BENCHMARK_SWARM,   PLR_CHAR_REIMU,  PLR_SHOT_REIMU_SPIRIT },
+	{ "lasers",  STAGE_BENCHMARK_LASERS,  PLR_CHAR_YOUMU,  PLR_SHOT_YOUMU_MIRROR },
+};
+
+static struct {
+	uint64_t *frame_times;
+	uint num_frames;
+	uint frames_capacity;
+
+	hrtime_t frame_begin;
+	ulong frame_allocs_begin;
+	uint64_t total_allocs;
+
+	BenchmarkPoolStats pools[BENCHMARK_NUM_POOLS];
+} bench;
+
+void benchmark_logic_frame_begin(void) {
+	bench.frame_allocs_begin = get_num_allocs();
+	bench.frame_begin = time_get();
+}
+
+static void benchmark_sample_pools(void) {
+	ObjectPool **pools = &stage_object_pools.first;
+
+	for(uint i = 0; i < BENCHMARK_NUM_POOLS; ++i) {
+		ObjectPoolStats stats;
+		objpool_get_stats(pools[i], &stats);
+
+		BenchmarkPoolStats *b = bench.pools + i;
+		strlcpy(b->tag, stats.tag ? stats.tag : "", sizeof(b->tag));
+		b->capacity = imax(b->capacity, stats.capacity);
+		b->peak_usage = imax(b->peak_usage, stats.peak_usage);
+	}
+}
+
+void benchmark_logic_frame_end(void) {
+	hrtime_t time = time_get() - bench.frame_begin;
+	bench.total_allocs += get_num_allocs() - bench.frame_allocs_begin;
+
+	if(bench.num_frames == bench.frames_capacity) {
+		bench.frames_capacity = bench.frames_capacity ? bench.frames_capacity * 2 : BENCHMARK_SCENE_FRAMES;
+		bench.frame_times = realloc(bench.frame_times, sizeof(*bench.frame_times) * bench.frames_capacity);
+	}
+
+	bench.frame_times[bench.num_frames++] = time / (HRTIME_RESOLUTION / 1000000000);
+	benchmark_sample_pools();
+}
+
+static int cmp_frame_times(const void *a, const void *b) {
+	uint64_t ta = *(const uint64_t*)a;
+	uint64_t tb = *(const uint64_t*)b;
+	return (ta > tb) - (ta < tb);
+}
+
+static uint64_t percentile(const uint64_t *sorted, uint num, double p) {
+	return sorted[(uint)(p * (num - 1) + 0.5)];
+}
+
+static void benchmark_play(Replay *rpy, const char *name, const char *kind, BenchmarkResult *res) {
+	log_info("Benchmarking %s '%s'", kind, name);
+
+	bench.num_frames = 0;
+	bench.total_allocs = 0;
+	memset(bench.pools, 0, sizeof(bench.pools));
+
+	hrtime_t begin = time_get();
+	replay_play(rpy, 0);
+
+	*res = (BenchmarkResult) {
+		.name = strdup(name),
+		.kind = kind,
+		.frames = bench.num_frames,
+		.time = (time_get() - begin) / (double)HRTIME_RESOLUTION,
+		.allocs_per_frame = -1,
+	};
+
+	memcpy(res->pools, bench.pools, sizeof(res->pools));
+
+	if(bench.num_frames == 0) {
+		log_warn("No frames were simulated for %s '%s'", kind, name);
+		return;
+	}
+
+	if(HAVE_ALLOC_STATS) {
+		res->allocs_per_frame = bench.total_allocs / (double)bench.num_frames;
+	}
+
+	uint64_t total = 0;
+
+	for(uint i = 0; i < bench.num_frames; ++i) {
+		total += bench.frame_times[i];
+	}
+
+	qsort(bench.frame_times, bench.num_frames, sizeof(*bench.frame_times), cmp_frame_times);
+
+	res->ns_mean = total / bench.num_frames;
+	res->ns_p50 = percentile(bench.frame_times, bench.num_frames, 0.50);
+	res->ns_p90 = percentile(bench.frame_times, bench.num_frames, 0.90);
+	res->ns_p99 = percentile(bench.frame_times, bench.num_frames, 0.99);
+	res->ns_max = bench.frame_times[bench.num_frames - 1];
+}
+
+static void benchmark_scene(const BenchmarkScene *scene, BenchmarkResult *res) {
+	StageInfo *stage = stage_get(scene->stage_id);
+	assert(stage != NULL);
+
+	Player plr;
+	player_init(&plr);
+	plr.mode = plrmode_find(scene->character, scene->shot);
+	plr.power = PLR_MAX_POWER;
+	plr.inputflags = INFLAG_SHOT;
+
+	// The scenes never end on their own, so the replay does it.
+	Replay rpy;
+	replay_init(&rpy);
+	ReplayStage *rstg = replay_create_stage(&rpy, stage, BENCHMARK_SEED, stage->difficulty, &plr);
+	replay_stage_event(rstg, BENCHMARK_SCENE_FRAMES, EV_OVER, 0);
+
+	benchmark_play(&rpy, scene->name, "scene", res);
+	replay_destroy(&rpy);
+}
+
+static bool benchmark_replay(const char *filename, BenchmarkResult *res) {
+	char *path = strfmt(BENCHMARK_REPLAY_DIR "/%s", filename);
+	char *repr = vfs_repr(path, true);
+	SDL_RWops *file = vfs_open(path, VFS_MODE_READ);
+	bool ok = false;
+
+	if(!file) {
+		log_warn("VFS error: %s", vfs_get_error());
+	} else {
+		Replay rpy = { 0 };
+
+		if(replay_read(&rpy, file, REPLAY_READ_ALL, repr ? repr : path)) {
+			benchmark_play(&rpy, filename, "replay", res);
+			replay_destroy(&rpy);
+			ok = true;
+		}
+
+		SDL_RWclose(file);
+	}
+
+	free(repr);
+	free(path);
+	return ok;
+}
+
+static bool is_replay_file(const char *filename) {
+	return strendswith(filename, "." REPLAY_EXTENSION);
+}
+
+static void write_result(SDL_RWops *out, BenchmarkResult *res) {
+	SDL_RWprintf(out, "\n\t\t{\n\t\t\t\"name\": ");
+	SDL_RWwrite_json_string(out, res->name);
+	SDL_RWprintf(out, ",\n\t\t\t\"kind\": \"%s\",\n", res->kind);
+	SDL_RWprintf(out, "\t\t\t\"frames\": %u,\n", res->frames);
+	SDL_RWprintf(out, "\t\t\t\"time\": %.6f,\n", res->time);
+	SDL_RWprintf(out,
+		"\t\t\t\"logic_ns\": { \"mean\": %"PRIu64", \"p50\": %"PRIu64", \"p90\": %"PRIu64", \"p99\": %"PRIu64", \"max\": %"PRIu64" },\n",
+		res->ns_mean, res->ns_p50, res->ns_p90, res->ns_p99, res->ns_max
+	);
+
+	if(res->allocs_per_frame < 0) {
+		SDL_RWprintf(out, "\t\t\t\"allocs_per_frame\": null,\n");
+	} else {
+		SDL_RWprintf(out, "\t\t\t\"allocs_per_frame\": %.3f,\n", res->allocs_per_frame);
+	}
+
+	SDL_RWprintf(out, "\t\t\t\"objpools\": {");
+
+	for(uint i = 0; i < BENCHMARK_NUM_POOLS; ++i) {
+		SDL_RWprintf(out, "%s\n\t\t\t\t", i ? "," : "");
+		SDL_RWwrite_json_string(out, res->pools[i].tag);
+		SDL_RWprintf(out, ": { \"capacity\": %zu, \"peak_usage\": %zu }", res->pools[i].capacity, res->pools[i].peak_usage);
+	}
+
+	SDL_RWprintf(out, "\n\t\t\t}\n\t\t}");
+}
+
+static bool write_report(const char *output_path, BenchmarkResult *results, uint num_results) {
+	SDL_RWops *out = SDL_RWFromFile(output_path, "w");
+
+	if(!out) {
+		log_warn("Can't open %s for writing: %s", output_path, SDL_GetError());
+		return false;
+	}
+
+	SDL_RWprintf(out, "{\n\t\"version\": ");
+	SDL_RWwrite_json_string(out, TAISEI_VERSION_FULL);
+	SDL_RWprintf(out, ",\n\t\"build_type\": ");
+	SDL_RWwrite_json_string(out, TAISEI_VERSION_BUILD_TYPE);
+	SDL_RWprintf(out, ",\n\t\"results\": [");
+
+	for(uint i = 0; i < num_results; ++i) {
+		if(i > 0) {
+			SDL_RWprintf(out, ",");
+		}
+
+		write_result(out, results + i);
+	}
+
+	SDL_RWprintf(out, "\n\t]\n}\n");
+	SDL_RWclose(out);
+	return true;
+}
+
+static void print_result(BenchmarkResult *res) {
+	tsfprintf(stdout, "%-6s %-24s %6u frames  mean %7.3f ms  p50 %7.3f  p90 %7.3f  p99 %7.3f  max %7.3f",
+		res->kind, res->name, res->frames,
+		res->ns_mean * 1e-6, res->ns_p50 * 1e-6, res->ns_p90 * 1e-6, res->ns_p99 * 1e-6, res->ns_max * 1e-6
+	);
+
+	if(res->allocs_per_frame >= 0) {
+		tsfprintf(stdout, "  %.1f allocs/frame", res->allocs_per_frame);
+	}
+
+	tsfprintf(stdout, "\n");
+}
+
+int benchmark_run(const char *output_path) {
+	uint num_scenes = sizeof(scenes) / sizeof(*scenes);
+	size_t num_replays = 0;
+	char **replays = vfs_dir_list_sorted(BENCHMARK_REPLAY_DIR, &num_replays, vfs_dir_list_order_ascending, is_replay_file);
+
+	if(!replays) {
+		log_info("No " BENCHMARK_REPLAY_DIR " directory; only the built-in scenes will be run");
+		num_replays = 0;
+	}
+
+	BenchmarkResult *results = calloc(num_scenes + num_replays, sizeof(*results));
+	uint num_results = 0;
+	int status = 0;
+
+	for(uint i = 0; i < num_scenes; ++i) {
+		benchmark_scene(scenes + i, results + num_results);
+		print_result(results + num_results++);
+	}
+
+	for(size_t i = 0; i < num_replays; ++i) {
+		if(benchmark_replay(replays[i], results + num_results)) {
+			print_result(results + num_results++);
+		} else {
+			status = 1;
+		}
+	}
+
+	vfs_dir_list_free(replays, num_replays);
+
+	if(!write_report(output_path, results, num_results)) {
+		status = 1;
+	}
+
+	for(uint i = 0; i < num_results; ++i) {
+		free(results[i].name);
+	}
+
+	free(results);
+	free(bench.frame_times);
+	bench.frame_times = NULL;
+	bench.frames_capacity = 0;
+
+	return status;
+}
@@ -0,0 +1,32 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_benchmark_h
+#define IGUARD_benchmark_h
+
+#include "taisei.h"
+
+/*
+ * Headless game benchmark.
+ *
+ * Runs the synthetic scenes from stages/benchmark_scenes.c, followed by all replays found in
+ * res/benchmark/, as fast as possible and without rendering. Every run is deterministic: the
+ * scenes are played back as generated replays with a fixed seed. For each run, the time taken by
+ * every logic frame, the number of heap allocations made per frame (only in developer builds
+ * with glibc), and the peak usage of the stage object pools are recorded.
+ */
+
+// Runs the whole suite and writes a JSON report to [output_path] (a system path), as well as a
+// summary to stdout. Returns 0 on success, 1 if something could not be run or written.
+int benchmark_run(const char *output_path) attr_nonnull(1);
+
+// These are called by the stage loop in --benchmark mode.
+void benchmark_logic_frame_begin(void);
+void benchmark_logic_frame_end(void);
+
+#endif // IGUARD_benchmark_h
@@ -14,6 +14,7 @@
 #include "stagetext.h"
 #include "stagedraw.h"
 #include "entity.h"
+#include "profiler.h"
 
 static void ent_draw_boss(EntityInterface *ent);
 static DamageResult ent_damage_boss(EntityInterface *ent, const DamageInfo *dmg);
@@ -857,6 +858,8 @@ void boss_finish_current_attack(Boss *boss) {
 }
 
 void process_boss(Boss **pboss) {
+	PROFILE_SCOPE("process_boss");
+
 	Boss *boss = *pboss;
 
 	if(!boss) {
@@ -44,6 +44,9 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 	struct TsOption taisei_opts[] = {
 		{{"replay", required_argument, 0, 'r'}, "Play a replay from %s", "FILE"},
 		{{"verify-replay", required_argument, 0, 'R'}, "Play a replay from %s in headless mode, crash as soon as it desyncs", "FILE"},
+		{{"verify-replays", required_argument, 0, 'V'}, "Verify all replays in %s (a directory, or a file listing replays), several at once", "PATH"},
+		{{"jobs", required_argument, 0, 'j'}, "Verify up to %s replays at once (default: one per CPU core)", "NUM"},
+		{{"benchmark", required_argument, 0, 'b'}, "Run the benchmarks in headless mode and write the results to %s", "FILE"},
 #ifdef DEBUG
 		{{"play", no_argument, 0, 'p'}, "Play a specific stage", 0},
 		{{"sid", required_argument, 0, 'i'}, "Select stage by %s", "ID"},
@@ -51,6 +54,8 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		{{"shotmode", required_argument, 0, 's'}, "Select a shotmode (marisaA/youmuA/marisaB/youmuB)", "SMODE"},
 		{{"dumpstages", no_argument, 0, 'u'}, "Print a list of all stages in the game", 0},
 		{{"vfs-tree", required_argument, 0, 't'}, "Print the virtual filesystem tree starting from %s", "PATH"},
+		{{"bench-taskmgr", no_argument, 0, 'T'}, "Benchmark the task manager and exit", 0},
+		{{"bench-hashtable", no_argument, 0, 'H'}, "Check and benchmark the hashtable implementations and exit", 0},
 #endif
 		{{"frameskip", optional_argument, 0, 'f'}, "Disable FPS limiter, render only every %s frame", "FRAME"},
 		{{"credits", no_argument, 0, 'c'}, "Show the credits scene and exit"},
@@ -109,6 +114,22 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		case 'R':
 			a->type = CLI_VerifyReplay;
 			a->filename = strdup(optarg);
+			break;
+		case 'V':
+			a->type = CLI_VerifyReplays;
+			a->filename = strdup(optarg);
+			break;
+		case 'b':
+			a->type = CLI_Benchmark;
+			a->filename = strdup(optarg);
+			break;
+		case 'j':
+			a->jobs = strtol(optarg, &endptr, 10);
+
+			if(!*optarg || endptr == optarg || a->jobs < 0) {
+				log_fatal("Number of jobs '%s' is not a valid number", optarg);
+			}
+
 			break;
 		case 'p':
 			a->type = CLI_SelectStage;
@@ -158,6 +179,12 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 			a->type = CLI_DumpVFSTree,
 			a->filename = strdup(optarg ? optarg : "");
 			break;
+		case 'T':
+			a->type = CLI_BenchTaskManager;
+			break;
+		case 'H':
+			a->type = CLI_BenchHashtable;
+			break;
 		case 'c':
 			a->type = CLI_Credits;
 			break;
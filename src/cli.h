@@ -17,9 +17,13 @@ typedef enum {
 	CLI_RunNormally = 0,
 	CLI_PlayReplay,
 	CLI_VerifyReplay,
+	CLI_VerifyReplays,
+	CLI_Benchmark,
 	CLI_SelectStage,
 	CLI_DumpStages,
 	CLI_DumpVFSTree,
+	CLI_BenchTaskManager,
+	CLI_BenchHashtable,
 	CLI_Quit,
 	CLI_Credits,
 } CLIActionType;
@@ -31,6 +35,7 @@ struct CLIAction {
 	int stageid;
 	int diff;
 	int frameskip;
+	int jobs;
 	PlayerMode *plrmode;
 };
 
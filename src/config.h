@@ -59,6 +59,8 @@
 	CONFIGDEF_KEYBINDING(KEY_RESTART,           "key_restart",          SDL_SCANCODE_F2) \
 	CONFIGDEF_KEYBINDING(KEY_HITAREAS,          "key_hitareas",         SDL_SCANCODE_H) \
 	CONFIGDEF_KEYBINDING(KEY_TOGGLE_AUDIO,      "key_toggle_audio",     SDL_SCANCODE_M) \
+	CONFIGDEF_KEYBINDING(KEY_REPLAY_REWIND,     "key_replay_rewind",    SDL_SCANCODE_LEFTBRACKET) \
+	CONFIGDEF_KEYBINDING(KEY_REPLAY_FORWARD,    "key_replay_forward",   SDL_SCANCODE_RIGHTBRACKET) \
 
 
 #define GPKEYDEFS \
@@ -18,6 +18,8 @@
 #include "stageobjects.h"
 #include "util/glm.h"
 #include "entity.h"
+#include "enemygrid.h"
+#include "profiler.h"
 
 #ifdef create_enemy_p
 #undef create_enemy_p
@@ -93,6 +95,7 @@ Enemy *create_enemy_p(EnemyList *enemies, complex pos, float hp, EnemyVisualRule
 
 	fix_pos0_visual(e);
 	ent_register(&e->ent, ENT_ENEMY);
+	enemygrid_invalidate();
 
 	e->logic_rule(e, EVENT_BIRTH);
 	return e;
@@ -125,6 +128,7 @@ static void* _delete_enemy(ListAnchor *enemies, List* enemy, void *arg) {
 	e->logic_rule(e, EVENT_DEATH);
 	ent_unregister(&e->ent);
 	objpool_release(stage_object_pools.enemies, (ObjectInterface*)alist_unlink(enemies, enemy));
+	enemygrid_invalidate();
 
 	return NULL;
 }
@@ -336,6 +340,8 @@ static DamageResult ent_damage_enemy(EntityInterface *ienemy, const DamageInfo *
 }
 
 void process_enemies(EnemyList *enemies) {
+	PROFILE_SCOPE("process_enemies");
+
 	for(Enemy *enemy = enemies->first, *next; enemy; enemy = next) {
 		next = enemy->next;
 
@@ -347,6 +353,9 @@ void process_enemies(EnemyList *enemies) {
 
 		int action = enemy->logic_rule(enemy, global.frames - enemy->birthtime);
 
+		// The rule may have moved this or any other enemy.
+		enemygrid_invalidate();
+
 		if(enemy->hp > ENEMY_IMMUNE && enemy->alpha >= 1.0 && cabs(enemy->pos - global.plr.pos) < 7) {
 			ent_damage(&global.plr.ent, &(DamageInfo) { .type = DMG_ENEMY_COLLISION });
 		}
@@ -0,0 +1,292 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "enemygrid.h"
+#include "global.h"
+
+enum {
+	GRID_CELL_SIZE = 32,
+	GRID_COLS = (VIEWPORT_W + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE,
+	GRID_ROWS = (VIEWPORT_H + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE,
+	GRID_NUM_CELLS = GRID_COLS * GRID_ROWS,
+};
+
+typedef struct GridEntry {
+	Enemy *enemy;
+	uint ordinal;  // position in global.enemies at the time the grid was built
+} GridEntry;
+
+static struct {
+	// Entries are bucketed by cell; within a cell they are sorted by ordinal.
+	GridEntry *entries;
+	uint *entry_cells;
+	uint num_entries;
+	uint capacity;
+
+	// Entries of cell c are entries[cell_start[c]] .. entries[cell_start[c + 1] - 1]
+	uint cell_start[GRID_NUM_CELLS + 1];
+
+	GridEntry *results;
+	Enemy **result_ptrs;
+	uint results_capacity;
+
+	int frame;
+	bool valid;
+} grid;
+
+typedef struct CellRange {
+	int col0, col1;
+	int row0, row1;
+} CellRange;
+
+static inline int grid_coord(double v, int ncells) {
+	// NOTE: written this way to send NaNs to the first cell.
+	if(!(v >= 0)) {
+		return 0;
+	}
+
+	if(v >= ncells * GRID_CELL_SIZE) {
+		return ncells - 1;
+	}
+
+	return (int)(v / GRID_CELL_SIZE);
+}
+
+static inline uint grid_cell(complex pos) {
+	return grid_coord(cimag(pos), GRID_ROWS) * GRID_COLS + grid_coord(creal(pos), GRID_COLS);
+}
+
+static CellRange grid_range(complex origin, double radius) {
+	double x = creal(origin), y = cimag(origin);
+
+	return (CellRange) {
+		.col0 = grid_coord(x - radius, GRID_COLS),
+		.col1 = grid_coord(x + radius, GRID_COLS),
+		.row0 = grid_coord(y - radius, GRID_ROWS),
+		.row1 = grid_coord(y + radius, GRID_ROWS),
+	};
+}
+
+static void grid_reserve(uint num) {
+	if(grid.capacity >= num) {
+		return;
+	}
+
+	grid.capacity = topow2_u32(num);
+	grid.entries = realloc(grid.entries, sizeof(*grid.entries) * grid.capacity);
+	grid.entry_cells = realloc(grid.entry_cells, sizeof(*grid.entry_cells) * grid.capacity);
+}
+
+static void grid_reserve_results(uint num) {
+	if(grid.results_capacity >= num) {
+		return;
+	}
+
+	grid.results_capacity = topow2_u32(num);
+	grid.results = realloc(grid.results, sizeof(*grid.results) * grid.results_capacity);
+	grid.result_ptrs = realloc(grid.result_ptrs, sizeof(*grid.result_ptrs) * grid.results_capacity);
+}
+
+static void grid_rebuild(void) {
+	uint num = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next) {
+		++num;
+	}
+
+	grid_reserve(num);
+	memset(grid.cell_start, 0, sizeof(grid.cell_start));
+
+	// Counting sort: the list is walked in order, so each bucket ends up sorted by ordinal.
+	uint i = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next, ++i) {
+		uint cell = grid_cell(e->pos);
+		grid.entry_cells[i] = cell;
+		grid.cell_start[cell + 1]++;
+	}
+
+	for(uint c = 0; c < GRID_NUM_CELLS; ++c) {
+		grid.cell_start[c + 1] += grid.cell_start[c];
+	}
+
+	uint cursor[GRID_NUM_CELLS];
+	memcpy(cursor, grid.cell_start, sizeof(cursor));
+
+	i = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next, ++i) {
+		GridEntry *entry = grid.entries + cursor[grid.entry_cells[i]]++;
+		entry->enemy = e;
+		entry->ordinal = i;
+	}
+
+	grid.num_entries = num;
+	grid.frame = global.frames;
+	grid.valid = true;
+}
+
+static inline void grid_update(void) {
+	if(!grid.valid || grid.frame != global.frames) {
+		grid_rebuild();
+	}
+}
+
+void enemygrid_init(void) {
+	grid.valid = false;
+	grid.num_entries = 0;
+}
+
+void enemygrid_shutdown(void) {
+	free(grid.entries);
+	free(grid.entry_cells);
+	free(grid.results);
+	free(grid.result_ptrs);
+	memset(&grid, 0, sizeof(grid));
+}
+
+void enemygrid_invalidate(void) {
+	grid.valid = false;
+}
+
+Enemy *enemygrid_find_first(complex origin, double radius, EnemyGridPredicate predicate, void *arg) {
+	grid_update();
+
+	if(grid.num_entries == 0) {
+		return NULL;
+	}
+
+	CellRange r = grid_range(origin, radius);
+	GridEntry *best = NULL;
+
+	for(int row = r.row0; row <= r.row1; ++row) {
+		for(int col = r.col0; col <= r.col1; ++col) {
+			uint c = row * GRID_COLS + col;
+			GridEntry *end = grid.entries + grid.cell_start[c + 1];
+
+			for(GridEntry *entry = grid.entries + grid.cell_start[c]; entry < end; ++entry) {
+				if(best && entry->ordinal >= best->ordinal) {
+					break;
+				}
+
+				Enemy *e = entry->enemy;
+
+				if(cabs(e->pos - origin) < radius && (!predicate || predicate(e, arg))) {
+					best = entry;
+					break;
+				}
+			}
+		}
+	}
+
+	return best ? best->enemy : NULL;
+}
+
+Enemy *enemygrid_find_nearest(complex origin, double *inout_dist, EnemyGridPredicate predicate, void *arg) {
+	grid_update();
+
+	if(grid.num_entries == 0) {
+		return NULL;
+	}
+
+	int ocol = grid_coord(creal(origin), GRID_COLS);
+	int orow = grid_coord(cimag(origin), GRID_ROWS);
+	int max_ring = imax(imax(ocol, GRID_COLS - 1 - ocol), imax(orow, GRID_ROWS - 1 - orow));
+
+	GridEntry *best = NULL;
+	double best_dist = *inout_dist;
+
+	for(int ring = 0; ring <= max_ring; ++ring) {
+		// Anything in this ring or further out is more than (ring - 1) cells away from origin.
+		// The extra pixel of slack keeps this safe against rounding in cabs().
+		if(best_dist + 1 <= (ring - 1) * GRID_CELL_SIZE) {
+			break;
+		}
+
+		for(int row = orow - ring; row <= orow + ring; ++row) {
+			if(row < 0 || row >= GRID_ROWS) {
+				continue;
+			}
+
+			// Only the perimeter of the ring: every column on the top and bottom rows, just the two ends otherwise.
+			bool edge_row = (row == orow - ring || row == orow + ring);
+			int step = edge_row ? 1 : 2 * ring;
+
+			for(int col = ocol - ring; col <= ocol + ring; col += step) {
+				if(col < 0 || col >= GRID_COLS) {
+					continue;
+				}
+
+				uint c = row * GRID_COLS + col;
+				GridEntry *end = grid.entries + grid.cell_start[c + 1];
+
+				for(GridEntry *entry = grid.entries + grid.cell_start[c]; entry < end; ++entry) {
+					Enemy *e = entry->enemy;
+
+					if(predicate && !predicate(e, arg)) {
+						continue;
+					}
+
+					double dist = cabs(e->pos - origin);
+
+					if(dist < best_dist || (best && dist == best_dist && entry->ordinal < best->ordinal)) {
+						best_dist = dist;
+						best = entry;
+					}
+				}
+			}
+		}
+	}
+
+	if(best) {
+		*inout_dist = best_dist;
+		return best->enemy;
+	}
+
+	return NULL;
+}
+
+static int entry_cmp(const void *a, const void *b) {
+	const GridEntry *e1 = a;
+	const GridEntry *e2 = b;
+	return (e1->ordinal > e2->ordinal) - (e1->ordinal < e2->ordinal);
+}
+
+Enemy **enemygrid_collect(complex origin, double radius, uint *out_count) {
+	grid_update();
+
+	uint num = 0;
+	CellRange r = grid_range(origin, radius);
+
+	for(int row = r.row0; row <= r.row1 && grid.num_entries; ++row) {
+		for(int col = r.col0; col <= r.col1; ++col) {
+			uint c = row * GRID_COLS + col;
+			GridEntry *end = grid.entries + grid.cell_start[c + 1];
+
+			for(GridEntry *entry = grid.entries + grid.cell_start[c]; entry < end; ++entry) {
+				if(cabs(entry->enemy->pos - origin) < radius) {
+					grid_reserve_results(num + 1);
+					grid.results[num++] = *entry;
+				}
+			}
+		}
+	}
+
+	if(num > 1) {
+		qsort(grid.results, num, sizeof(*grid.results), entry_cmp);
+	}
+
+	for(uint i = 0; i < num; ++i) {
+		grid.result_ptrs[i] = grid.results[i].enemy;
+	}
+
+	*out_count = num;
+	return grid.result_ptrs;
+}
@@ -0,0 +1,48 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_enemygrid_h
+#define IGUARD_enemygrid_h
+
+#include "taisei.h"
+
+#include "enemy.h"
+
+/*
+ * Uniform-grid broadphase over global.enemies.
+ *
+ * The grid is rebuilt lazily: at most once per frame, plus once after every
+ * invalidation. Creating, deleting or processing enemies invalidates it
+ * automatically. Code that teleports an enemy from outside of that enemy's
+ * own logic rule must call enemygrid_invalidate() itself.
+ *
+ * All queries return enemies in the same order in which they appear in
+ * global.enemies, so that replacing a linear scan of the list with a grid
+ * query never changes the outcome (and thus never desyncs replays).
+ */
+
+typedef bool (*EnemyGridPredicate)(Enemy *e, void *arg);
+
+void enemygrid_init(void);
+void enemygrid_shutdown(void);
+void enemygrid_invalidate(void);
+
+// Returns the first enemy (in list order) such that cabs(e->pos - origin) < radius and
+// predicate(e, arg) is true, or NULL if there is no such enemy. Predicate may be NULL.
+Enemy *enemygrid_find_first(complex origin, double radius, EnemyGridPredicate predicate, void *arg);
+
+// Returns the enemy closest to origin for which predicate(e, arg) is true, but only
+// if it's strictly closer than *inout_dist, in which case *inout_dist is updated.
+// Ties are broken in favor of whatever comes first in the list. Predicate may be NULL.
+Enemy *enemygrid_find_nearest(complex origin, double *inout_dist, EnemyGridPredicate predicate, void *arg) attr_nonnull(2);
+
+// Collects all enemies for which cabs(e->pos - origin) < radius, in list order.
+// The returned array is owned by the grid and valid until the next query.
+Enemy **enemygrid_collect(complex origin, double radius, uint *out_count) attr_nonnull(3);
+
+#endif // IGUARD_enemygrid_h
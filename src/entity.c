@@ -12,6 +12,13 @@
 #include "util.h"
 #include "renderer/api.h"
 #include "global.h"
+#include "enemygrid.h"
+#include "profiler.h"
+
+enum {
+	// ent_area_damage() copies up to this many targets onto the stack, more go to the heap.
+	AREA_DAMAGE_STACK_TARGETS = 64,
+};
 
 typedef struct EntityDrawHook EntityDrawHook;
 typedef LIST_ANCHOR(EntityDrawHook) EntityDrawHookList;
@@ -22,12 +29,30 @@ struct EntityDrawHook {
 	void *arg;
 };
 
+// All entities with the same draw_layer, in spawn order. Unregistered entities leave holes
+// (NULL pointers) behind, which are squeezed out the next time the bucket is drawn.
+typedef struct EntityDrawBucket {
+	EntityInterface **ents;
+	uint num;
+	uint capacity;
+	uint num_removed;
+	uint32_t max_spawn_id;
+	drawlayer_t layer;
+} EntityDrawBucket;
+
 static struct {
 	EntityInterface **array;
 	uint num;
 	uint capacity;
 	uint32_t total_spawns;
 
+	// Sorted by layer. Buckets are never removed, there are only so many distinct layers.
+	struct {
+		EntityDrawBucket *array;
+		uint num;
+		uint capacity;
+	} buckets;
+
 	struct {
 		EntityDrawHookList pre_draw;
 		EntityDrawHookList post_draw;
@@ -59,6 +84,163 @@ static void call_hooks(EntityDrawHookList *list, EntityInterface *ent) {
 	}
 }
 
+static EntityDrawBucket *find_bucket(drawlayer_t layer, bool create) {
+	uint lo = 0, hi = entities.buckets.num;
+
+	while(lo < hi) {
+		uint mid = lo + (hi - lo) / 2;
+
+		if(entities.buckets.array[mid].layer < layer) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if(lo < entities.buckets.num && entities.buckets.array[lo].layer == layer) {
+		return entities.buckets.array + lo;
+	}
+
+	if(!create) {
+		return NULL;
+	}
+
+	if(entities.buckets.num == entities.buckets.capacity) {
+		entities.buckets.capacity = imax(16, entities.buckets.capacity * 2);
+		entities.buckets.array = realloc(entities.buckets.array, entities.buckets.capacity * sizeof(*entities.buckets.array));
+	}
+
+	EntityDrawBucket *b = entities.buckets.array + lo;
+	memmove(b + 1, b, (entities.buckets.num - lo) * sizeof(*b));
+	++entities.buckets.num;
+
+	memset(b, 0, sizeof(*b));
+	b->layer = layer;
+	return b;
+}
+
+static void bucket_compact(EntityDrawBucket *b) {
+	if(!b->num_removed) {
+		return;
+	}
+
+	uint num = 0;
+
+	for(uint i = 0; i < b->num; ++i) {
+		EntityInterface *ent = b->ents[i];
+
+		if(ent) {
+			ent->draw_bucket_slot = num;
+			b->ents[num++] = ent;
+		}
+	}
+
+	b->num = num;
+	b->num_removed = 0;
+}
+
+static void bucket_reserve(EntityDrawBucket *b) {
+	if(b->num < b->capacity) {
+		return;
+	}
+
+	// Nothing may be drawing the entities at all (e.g. in benchmark mode), so don't rely on
+	// ent_draw to clean up the holes.
+	if(b->num_removed >= b->num / 4) {
+		bucket_compact(b);
+
+		if(b->num < b->capacity) {
+			return;
+		}
+	}
+
+	b->capacity = imax(64, b->capacity * 2);
+	b->ents = realloc(b->ents, b->capacity * sizeof(*b->ents));
+}
+
+static void bucket_insert(EntityInterface *ent) {
+	EntityDrawBucket *b = find_bucket(ent->draw_layer, true);
+
+	bucket_reserve(b);
+	ent->draw_bucket_layer = ent->draw_layer;
+
+	if(ent->spawn_id > b->max_spawn_id) {
+		// Newest entity in this layer (always the case for freshly registered ones), so just append.
+		b->max_spawn_id = ent->spawn_id;
+		ent->draw_bucket_slot = b->num;
+		b->ents[b->num++] = ent;
+		return;
+	}
+
+	// An older entity moved into this layer; find its place.
+	bucket_compact(b);
+
+	uint lo = 0, hi = b->num;
+
+	while(lo < hi) {
+		uint mid = lo + (hi - lo) / 2;
+
+		if(b->ents[mid]->spawn_id < ent->spawn_id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	memmove(b->ents + lo + 1, b->ents + lo, (b->num - lo) * sizeof(*b->ents));
+	b->ents[lo] = ent;
+	++b->num;
+
+	for(uint i = lo; i < b->num; ++i) {
+		b->ents[i]->draw_bucket_slot = i;
+	}
+}
+
+static void bucket_remove(EntityInterface *ent) {
+	EntityDrawBucket *b = find_bucket(ent->draw_bucket_layer, false);
+	assert(b != NULL);
+	assert(ent->draw_bucket_slot < b->num);
+	assert(b->ents[ent->draw_bucket_slot] == ent);
+	b->ents[ent->draw_bucket_slot] = NULL;
+	++b->num_removed;
+}
+
+static int ent_spawn_cmp(const void *ptr1, const void *ptr2) {
+	const EntityInterface *ent1 = *(const EntityInterface**)ptr1;
+	const EntityInterface *ent2 = *(const EntityInterface**)ptr2;
+	return (ent1->spawn_id > ent2->spawn_id) - (ent1->spawn_id < ent2->spawn_id);
+}
+
+static void rebuild_buckets(void) {
+	for(uint i = 0; i < entities.buckets.num; ++i) {
+		EntityDrawBucket *b = entities.buckets.array + i;
+		b->num = b->num_removed = 0;
+		b->max_spawn_id = 0;
+	}
+
+	for(uint i = 0; i < entities.num; ++i) {
+		EntityInterface *ent = entities.array[i];
+		EntityDrawBucket *b = find_bucket(ent->draw_layer, true);
+
+		bucket_reserve(b);
+		b->ents[b->num++] = ent;
+		ent->draw_bucket_layer = ent->draw_layer;
+	}
+
+	for(uint i = 0; i < entities.buckets.num; ++i) {
+		EntityDrawBucket *b = entities.buckets.array + i;
+		qsort(b->ents, b->num, sizeof(*b->ents), ent_spawn_cmp);
+
+		for(uint j = 0; j < b->num; ++j) {
+			b->ents[j]->draw_bucket_slot = j;
+		}
+
+		if(b->num) {
+			b->max_spawn_id = b->ents[b->num - 1]->spawn_id;
+		}
+	}
+}
+
 #define FOR_EACH_ENT(ent) for(EntityInterface **_ent = entities.array, *ent = *entities.array; _ent < entities.array + entities.num; ent = *(++_ent))
 
 void ent_init(void) {
@@ -78,6 +260,12 @@ void ent_shutdown(void) {
 
 	free(entities.array);
 
+	for(uint i = 0; i < entities.buckets.num; ++i) {
+		free(entities.buckets.array[i].ents);
+	}
+
+	free(entities.buckets.array);
+
 	assert(entities.hooks.post_draw.first == NULL);
 	assert(entities.hooks.pre_draw.first == NULL);
 }
@@ -101,6 +289,7 @@ void ent_register(EntityInterface *ent, EntityType type) {
 	}
 
 	entities.array[ent->index] = ent;
+	bucket_insert(ent);
 
 	assert(ent->index < entities.num);
 	assert(entities.array[ent->index] == ent);
@@ -110,54 +299,115 @@ void ent_unregister(EntityInterface *ent) {
 	EntityInterface *sub = entities.array[--entities.num];
 	assert(ent->index <= entities.num);
 	assert(entities.array[ent->index] == ent);
+	bucket_remove(ent);
 	del_ref(ent);
 	entities.array[sub->index = ent->index] = sub;
 }
 
-static int ent_cmp(const void *ptr1, const void *ptr2) {
-	const EntityInterface *ent1 = *(const EntityInterface**)ptr1;
-	const EntityInterface *ent2 = *(const EntityInterface**)ptr2;
+size_t ent_snapshot_size(void) {
+	return sizeof(entities.num) + sizeof(entities.total_spawns) + entities.num * sizeof(*entities.array);
+}
+
+void ent_snapshot(void *buf) {
+	char *p = buf;
+	memcpy(p, &entities.num, sizeof(entities.num));
+	p += sizeof(entities.num);
+	memcpy(p, &entities.total_spawns, sizeof(entities.total_spawns));
+	p += sizeof(entities.total_spawns);
+	memcpy(p, entities.array, entities.num * sizeof(*entities.array));
+}
+
+void ent_restore(const void *buf) {
+	const char *p = buf;
+	memcpy(&entities.num, p, sizeof(entities.num));
+	p += sizeof(entities.num);
+	memcpy(&entities.total_spawns, p, sizeof(entities.total_spawns));
+	p += sizeof(entities.total_spawns);
+
+	if(entities.capacity < entities.num) {
+		entities.capacity = entities.num;
+		entities.array = realloc(entities.array, entities.capacity * sizeof(EntityInterface*));
+	}
 
-	int r = (ent1->draw_layer > ent2->draw_layer) - (ent1->draw_layer < ent2->draw_layer);
+	// The entities themselves (and their indices) are restored along with their pools.
+	memcpy(entities.array, p, entities.num * sizeof(*entities.array));
 
-	if(r == 0) {
-		// Same layer? Put whatever spawned later on top, then.
-		r = (ent1->spawn_id > ent2->spawn_id) - (ent1->spawn_id < ent2->spawn_id);
+	// The draw order isn't part of the snapshot, it's cheaper to just rebuild it on the rare
+	// occasion that one is restored.
+	rebuild_buckets();
+}
+
+typedef struct EntityDrawRun {
+	EntityDrawFunc draw_func;
+	EntityInterface *last;
+} EntityDrawRun;
+
+static void draw_entity(EntityDrawRun *run, EntityInterface *ent) {
+	if(ent->draw_func != run->draw_func) {
+		if(run->draw_func) {
+			r_state_pop();
+			call_hooks(&entities.hooks.post_draw, run->last);
+		}
+
+		call_hooks(&entities.hooks.pre_draw, ent);
+		r_state_push();
+		run->draw_func = ent->draw_func;
+	} else if(r_state_dirty()) {
+		// The previous entity has changed something; don't let it leak into this one.
+		r_state_pop();
+		r_state_push();
 	}
 
-	return r;
+	ent->draw_func(ent);
+	run->last = ent;
 }
 
 void ent_draw(EntityPredicate predicate) {
+	PROFILE_SCOPE("ent_draw");
+
 	call_hooks(&entities.hooks.pre_draw, NULL);
-	qsort(entities.array, entities.num, sizeof(EntityInterface*), ent_cmp);
-
-	if(predicate) {
-		FOR_EACH_ENT(ent) {
-			ent->index = _ent - entities.array;
-			assert(entities.array[ent->index] == ent);
-
-			if(ent->draw_func && predicate(ent)) {
-				call_hooks(&entities.hooks.pre_draw, ent);
-				r_state_push();
-				ent->draw_func(ent);
-				r_state_pop();
-				call_hooks(&entities.hooks.post_draw, ent);
-			}
+
+	// Entities are free to change their draw_layer at any time, so move those that did.
+	FOR_EACH_ENT(ent) {
+		if(ent->draw_layer != ent->draw_bucket_layer) {
+			bucket_remove(ent);
+			bucket_insert(ent);
 		}
-	} else {
-		FOR_EACH_ENT(ent) {
-			ent->index = _ent - entities.array;
-			assert(entities.array[ent->index] == ent);
-
-			if(ent->draw_func) {
-				call_hooks(&entities.hooks.pre_draw, ent);
-				r_state_push();
-				ent->draw_func(ent);
-				r_state_pop();
-				call_hooks(&entities.hooks.post_draw, ent);
+	}
+
+	EntityDrawRun run = { 0 };
+
+	for(uint i = 0; i < entities.buckets.num; ++i) {
+		EntityDrawBucket *b = entities.buckets.array + i;
+		bucket_compact(b);
+
+		// Sprites within a layer may be reordered, if the renderer is allowed to.
+		r_begin_deferred_sprites();
+
+		if(predicate) {
+			for(uint j = 0; j < b->num; ++j) {
+				EntityInterface *ent = b->ents[j];
+
+				if(ent->draw_func && predicate(ent)) {
+					draw_entity(&run, ent);
+				}
+			}
+		} else {
+			for(uint j = 0; j < b->num; ++j) {
+				EntityInterface *ent = b->ents[j];
+
+				if(ent->draw_func) {
+					draw_entity(&run, ent);
+				}
 			}
 		}
+
+		r_end_deferred_sprites();
+	}
+
+	if(run.draw_func) {
+		r_state_pop();
+		call_hooks(&entities.hooks.post_draw, run.last);
 	}
 
 	call_hooks(&entities.hooks.post_draw, NULL);
@@ -178,7 +428,26 @@ DamageResult ent_damage(EntityInterface *ent, const DamageInfo *damage) {
 }
 
 void ent_area_damage(complex origin, float radius, const DamageInfo *damage, EntityAreaDamageCallback callback, void *callback_arg) {
-	for(Enemy *e = global.enemies.first; e; e = e->next) {
+	uint num_targets;
+	Enemy **grid_targets = enemygrid_collect(origin, radius, &num_targets);
+
+	// Copy, because the callbacks may query the grid again. Bombs rarely hit more than a
+	// handful of enemies, but there's no upper bound, so big hits go to the heap.
+	Enemy *stack_targets[AREA_DAMAGE_STACK_TARGETS];
+	Enemy **targets = stack_targets;
+
+	if(num_targets > AREA_DAMAGE_STACK_TARGETS) {
+		targets = malloc(sizeof(*targets) * num_targets);
+	}
+
+	memcpy(targets, grid_targets, sizeof(*targets) * num_targets);
+
+	// NOTE: Enemies spawned by the callbacks (or by the damage) are not visited. Neither were
+	// they when this walked global.enemies directly, because new enemies go to the head of the
+	// list, behind the walk.
+	for(uint i = 0; i < num_targets; ++i) {
+		Enemy *e = targets[i];
+
 		if(
 			cabs(origin - e->pos) < radius &&
 			ent_damage(&e->ent, damage) == DMG_RESULT_OK &&
@@ -188,6 +457,10 @@ void ent_area_damage(complex origin, float radius, const DamageInfo *damage, Ent
 		}
 	}
 
+	if(targets != stack_targets) {
+		free(targets);
+	}
+
 	if(
 		global.boss != NULL &&
 		cabs(origin - global.boss->pos) < radius &&
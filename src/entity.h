@@ -70,6 +70,11 @@ typedef struct DamageInfo {
 	DamageType type;
 } DamageInfo;
 
+// Consecutive entities (in draw order) that share a draw function are drawn as one run: the
+// draw hooks are called once for the run, and the render state is only rolled back between two
+// entities if the first one actually changed it. A draw function may therefore rely on the
+// render state being the same for every entity it draws, but not on anything it set itself while
+// drawing a previous entity.
 typedef void (*EntityDrawFunc)(EntityInterface *ent);
 typedef bool (*EntityPredicate)(EntityInterface *ent);
 typedef DamageResult (*EntityDamageFunc)(EntityInterface *target, const DamageInfo *damage);
@@ -84,6 +89,9 @@ typedef void (*EntityAreaDamageCallback)(EntityInterface *ent, complex ent_origi
 	drawlayer_t draw_layer; \
 	uint32_t spawn_id; \
 	uint index; \
+	/* Where the entity is in the draw order; managed by entity.c */ \
+	drawlayer_t draw_bucket_layer; \
+	uint draw_bucket_slot; \
 }
 
 #define ENTITY_INTERFACE(typename) union { \
@@ -133,6 +141,12 @@ static inline attr_must_inline const char* ent_type_name(EntityType type) {
 
 void ent_init(void);
 void ent_shutdown(void);
+
+// Snapshots of the entity registry, see stagesnapshot.h
+size_t ent_snapshot_size(void);
+void ent_snapshot(void *buf);
+void ent_restore(const void *buf);
+
 void ent_register(EntityInterface *ent, EntityType type) attr_nonnull(1);
 void ent_unregister(EntityInterface *ent) attr_nonnull(1);
 void ent_draw(EntityPredicate predicate);
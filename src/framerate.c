@@ -71,7 +71,7 @@ void loop_at_fps(LogicFrameFunc logic_frame, RenderFrameFunc render_frame, void
 	bool compensate = env_get("TAISEI_FRAMELIMITER_COMPENSATE", 1);
 	bool uncapped_rendering_env = env_get("TAISEI_FRAMELIMITER_LOGIC_ONLY", 0);
 
-	if(global.is_replay_verification) {
+	if(global.is_headless) {
 		uncapped_rendering_env = false;
 	}
 
@@ -148,7 +148,7 @@ begin_frame:
 			break;
 		}
 
-		if((!uncapped_rendering && frame_num % get_effective_frameskip()) || global.is_replay_verification) {
+		if((!uncapped_rendering && frame_num % get_effective_frameskip()) || global.is_headless) {
 			rframe_action = RFRAME_DROP;
 		} else {
 			r_framebuffer_clear(NULL, CLEAR_ALL, RGBA(0, 0, 0, 1), 1);
@@ -57,6 +57,16 @@ static inline attr_must_inline hash_t htutil_hashfunc_uint64(uint64_t x) {
  */
 extern uint32_t (*htutil_hashfunc_string)(uint32_t crc, const char *str);
 
+/*
+ * htutil_benchmark
+ *
+ * Checks the lock-free hashtable mode against a reference under concurrent writes and
+ * lookups, then compares the performance of the chained and open addressing modes on some
+ * typical workloads, printing the results to stdout. Returns the process exit code, which
+ * is nonzero if the check failed.
+ */
+int htutil_benchmark(void);
+
 // Import public declarations for the predefined hashtable types.
 #define HT_DECL
 #include "hashtable_predefs.inc.h"
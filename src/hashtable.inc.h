@@ -204,6 +204,61 @@
 	// no default needed
 #endif
 
+/*
+ * HT_OPEN_ADDRESSING
+ *
+ * Optional.
+ *
+ * If defined, the hashtable stores its entries inline in a single flat array,
+ * using open addressing with Robin Hood probing, instead of allocating a separate
+ * list node for every entry. Lookups touch far fewer cache lines this way, and
+ * insertions don't hit the allocator, unless the table has to grow.
+ *
+ * The API is exactly the same in both modes. Note that values are moved around
+ * in memory when the table is modified, but since the API never hands out
+ * pointers into the table, this is invisible to the user.
+ *
+ * Example:
+ *
+ *        #define HT_OPEN_ADDRESSING
+ */
+#ifndef HT_OPEN_ADDRESSING
+	// no default needed
+#endif
+
+/*
+ * HT_LOCKFREE_READS
+ *
+ * Optional. Requires HT_OPEN_ADDRESSING and HT_THREAD_SAFE.
+ *
+ * If defined, ht_XXX_get() and ht_XXX_lookup() don't take the read lock. They
+ * read the table optimistically, and check a sequence counter bumped by writers
+ * to tell whether the result may be inconsistent; if so, they retry a couple of
+ * times, and then fall back to the lock. Readers thus never touch the mutex in
+ * the common case of a table that rarely changes.
+ *
+ * To keep concurrent readers from dereferencing freed memory, keys removed from
+ * the table and tables replaced by resizing are not freed immediately. Every
+ * lock-free read registers itself in the current epoch, and every write that
+ * finds no reads left in the previous epoch moves on to the next one. Whatever
+ * was retired two epochs ago is freed at that point, since no reader can still
+ * hold on to it. A steady stream of reads doesn't hold this up, because new
+ * reads always join the newest epoch. Anything left over is freed when the
+ * hashtable is destroyed.
+ *
+ * ht_XXX_lock(), the iterators and ht_XXX_foreach() still use the lock, and so
+ * still guarantee that the table stays unmodified while they are active.
+ *
+ * Example:
+ *
+ *        #define HT_LOCKFREE_READS
+ */
+#ifdef HT_LOCKFREE_READS
+	#if !defined(HT_OPEN_ADDRESSING) || !defined(HT_THREAD_SAFE)
+		#error HT_LOCKFREE_READS requires HT_OPEN_ADDRESSING and HT_THREAD_SAFE
+	#endif
+#endif
+
 /*
  * HT_DECL, HT_IMPL
  *
@@ -320,10 +375,17 @@ typedef void* (*HT_TYPE(foreach_callback))(HT_TYPE(const_key) key, HT_TYPE(value
  */
 typedef struct HT_TYPE(iter) HT_TYPE(iter);
 
+#ifdef HT_OPEN_ADDRESSING
+/*
+ * Forward declaration of the private table struct.
+ */
+typedef struct HT_TYPE(table) HT_TYPE(table);
+#else
 /*
  * Forward declaration of the private element struct.
  */
 typedef struct HT_TYPE(element) HT_TYPE(element);
+#endif
 
 /*
  * Definition for ht_XXX_key_list_t.
@@ -333,15 +395,34 @@ struct HT_TYPE(key_list) {
 	HT_TYPE(key) key;
 };
 
+#ifdef HT_LOCKFREE_READS
+/*
+ * Keys and tables waiting to be freed once no lock-free reader can see them.
+ */
+typedef struct HT_TYPE(garbage) {
+	HT_TYPE(key) *keys;
+	size_t num_keys;
+	size_t keys_capacity;
+	HT_TYPE(table) **tables;
+	size_t num_tables;
+	size_t tables_capacity;
+} HT_TYPE(garbage);
+#endif
+
 /*
  * Definition for ht_XXX_t.
  * All of these fields are to be considered private.
  */
 struct HT_BASETYPE {
+#ifdef HT_OPEN_ADDRESSING
+	HT_TYPE(table) *table;
+	size_t num_elements;
+#else
 	HT_TYPE(element) **table;
 	size_t num_elements;
 	size_t table_size;
 	size_t hash_mask;
+#endif
 
 #ifdef HT_THREAD_SAFE
 	struct {
@@ -349,8 +430,18 @@ struct HT_BASETYPE {
 		SDL_cond *cond;
 		uint readers;
 		bool writing;
+#ifdef HT_LOCKFREE_READS
+		SDL_atomic_t seq;
+		SDL_atomic_t epoch;
+		SDL_atomic_t epoch_readers[2];
+#endif
 	} sync;
 #endif
+
+#ifdef HT_LOCKFREE_READS
+	// Indexed by the parity of the epoch the garbage was retired in.
+	HT_TYPE(garbage) garbage[2];
+#endif
 };
 
 /*
@@ -364,7 +455,9 @@ struct HT_TYPE(iter) {
 
 	struct {
 		size_t bucketnum;
+#ifndef HT_OPEN_ADDRESSING
 		HT_TYPE(element) *elem;
+#endif
 	} private;
 };
 
@@ -606,12 +699,9 @@ HT_DECLARE_FUNC(void, iter_end, (HT_TYPE(iter) *iter))
 \*******************/
 #ifdef HT_IMPL
 
-struct HT_TYPE(element) {
-	LIST_INTERFACE(HT_TYPE(element));
-	HT_TYPE(key) key;
-	HT_TYPE(value) value;
-	hash_t hash;
-};
+#ifdef HT_LOCKFREE_READS
+HT_DECLARE_PRIV_FUNC(void, collect_garbage, (HT_BASETYPE *ht, uint epoch));
+#endif
 
 HT_DECLARE_PRIV_FUNC(void, begin_write, (HT_BASETYPE *ht)) {
 	#ifdef HT_THREAD_SAFE
@@ -624,9 +714,29 @@ HT_DECLARE_PRIV_FUNC(void, begin_write, (HT_BASETYPE *ht)) {
 	ht->sync.writing = true;
 	SDL_UnlockMutex(ht->sync.mutex);
 	#endif
+
+	#ifdef HT_LOCKFREE_READS
+	// Odd sequence number: a write is in progress, lock-free reads can't be trusted.
+	SDL_AtomicIncRef(&ht->sync.seq);
+	#endif
 }
 
 HT_DECLARE_PRIV_FUNC(void, end_write, (HT_BASETYPE *ht)) {
+	#ifdef HT_LOCKFREE_READS
+	SDL_AtomicIncRef(&ht->sync.seq);
+
+	// Everything retired in the previous epoch was made unreachable before this one
+	// began. Once the readers that entered back then are gone, nobody can still see
+	// it, so it can be freed, and the epoch advanced. Only writers change the epoch,
+	// and there is only ever one of them at a time.
+	uint epoch = SDL_AtomicGet(&ht->sync.epoch);
+
+	if(SDL_AtomicGet(ht->sync.epoch_readers + ((epoch - 1) & 1)) == 0) {
+		HT_PRIV_FUNC(collect_garbage)(ht, epoch - 1);
+		SDL_AtomicSet(&ht->sync.epoch, epoch + 1);
+	}
+	#endif
+
 	#ifdef HT_THREAD_SAFE
 	SDL_LockMutex(ht->sync.mutex);
 	ht->sync.writing = false;
@@ -670,6 +780,15 @@ HT_DECLARE_FUNC(void, unlock, (HT_BASETYPE *ht)) {
 }
 #endif // HT_THREAD_SAFE
 
+#ifndef HT_OPEN_ADDRESSING
+
+struct HT_TYPE(element) {
+	LIST_INTERFACE(HT_TYPE(element));
+	HT_TYPE(key) key;
+	HT_TYPE(value) value;
+	hash_t hash;
+};
+
 HT_DECLARE_FUNC(void, create, (HT_BASETYPE *ht)) {
 	size_t size = HT_MIN_SIZE;
 
@@ -1005,6 +1124,592 @@ HT_DECLARE_FUNC(void, iter_end, (HT_TYPE(iter) *iter)) {
 	HT_PRIV_FUNC(end_read)(iter->hashtable);
 }
 
+#else // HT_OPEN_ADDRESSING
+
+/*
+ * Open addressing with Robin Hood probing.
+ *
+ * Every slot stores its entry inline, along with the full hash and the entry's
+ * probe distance: 1 if it sits in its home slot, 2 if in the one after that, and
+ * so on. 0 marks an empty slot. An insertion takes over the slot of any entry
+ * that is closer to its home than the new one would be, and moves that entry on
+ * instead; this keeps the probe sequences short and even. It also means that a
+ * lookup can stop as soon as it meets an entry closer to its home than the key
+ * it's looking for would be. Removal shifts the following entries back by one
+ * slot, so no tombstones are needed.
+ */
+
+// Grow the table when it gets 3/4 full. Robin Hood probing keeps working at higher
+// load factors, but lookups that miss get noticeably slower past this point.
+#define HT_MAX_LOAD_NUM 3
+#define HT_MAX_LOAD_DEN 4
+
+// How many times a lock-free read is retried before falling back to the lock.
+#define HT_LOCKFREE_ATTEMPTS 2
+
+typedef struct HT_TYPE(slot) {
+	HT_TYPE(key) key;
+	HT_TYPE(value) value;
+	hash_t hash;
+	uint32_t dist;
+} HT_TYPE(slot);
+
+struct HT_TYPE(table) {
+	size_t hash_mask;
+	HT_TYPE(slot) slots[];
+};
+
+HT_DECLARE_PRIV_FUNC(HT_TYPE(table)*, alloc_table, (size_t size)) {
+	HT_TYPE(table) *t = calloc(1, sizeof(*t) + size * sizeof(*t->slots));
+	t->hash_mask = size - 1;
+	return t;
+}
+
+HT_DECLARE_PRIV_FUNC(size_t, table_size, (HT_TYPE(table) *t)) {
+	return t->hash_mask + 1;
+}
+
+#ifdef HT_LOCKFREE_READS
+
+HT_DECLARE_PRIV_FUNC(void, retire_key, (HT_BASETYPE *ht, HT_TYPE(key) key)) {
+	HT_TYPE(garbage) *g = ht->garbage + (SDL_AtomicGet(&ht->sync.epoch) & 1);
+
+	if(g->num_keys == g->keys_capacity) {
+		g->keys_capacity = g->keys_capacity ? g->keys_capacity * 2 : 16;
+		g->keys = realloc(g->keys, sizeof(*g->keys) * g->keys_capacity);
+	}
+
+	g->keys[g->num_keys++] = key;
+}
+
+HT_DECLARE_PRIV_FUNC(void, retire_table, (HT_BASETYPE *ht, HT_TYPE(table) *t)) {
+	HT_TYPE(garbage) *g = ht->garbage + (SDL_AtomicGet(&ht->sync.epoch) & 1);
+
+	if(g->num_tables == g->tables_capacity) {
+		g->tables_capacity = g->tables_capacity ? g->tables_capacity * 2 : 4;
+		g->tables = realloc(g->tables, sizeof(*g->tables) * g->tables_capacity);
+	}
+
+	g->tables[g->num_tables++] = t;
+}
+
+HT_DECLARE_PRIV_FUNC(void, collect_garbage, (HT_BASETYPE *ht, uint epoch)) {
+	HT_TYPE(garbage) *g = ht->garbage + (epoch & 1);
+
+	for(size_t i = 0; i < g->num_keys; ++i) {
+		HT_FUNC_FREE_KEY(g->keys[i]);
+	}
+
+	for(size_t i = 0; i < g->num_tables; ++i) {
+		free(g->tables[i]);
+	}
+
+	g->num_keys = 0;
+	g->num_tables = 0;
+}
+
+#else // HT_LOCKFREE_READS
+
+HT_DECLARE_PRIV_FUNC(void, retire_key, (HT_BASETYPE *ht, HT_TYPE(key) key)) {
+	HT_FUNC_FREE_KEY(key);
+}
+
+HT_DECLARE_PRIV_FUNC(void, retire_table, (HT_BASETYPE *ht, HT_TYPE(table) *t)) {
+	free(t);
+}
+
+#endif // HT_LOCKFREE_READS
+
+// In lock-free mode, a concurrent reader must never see a slot that claims to be
+// occupied, but still holds the key it had before it was ever used (typically NULL).
+// Slots that have been used and then emptied only get their dist cleared, so their
+// keys remain valid (if retired) pointers.
+HT_DECLARE_PRIV_FUNC(void, store_slot, (HT_TYPE(slot) *s, HT_TYPE(slot) entry)) {
+	#ifdef HT_LOCKFREE_READS
+	s->key = entry.key;
+	s->value = entry.value;
+	s->hash = entry.hash;
+	SDL_MemoryBarrierRelease();
+	s->dist = entry.dist;
+	#else
+	*s = entry;
+	#endif
+}
+
+HT_DECLARE_PRIV_FUNC(void, publish_table, (HT_BASETYPE *ht, HT_TYPE(table) *t)) {
+	#ifdef HT_LOCKFREE_READS
+	SDL_AtomicSetPtr((void**)&ht->table, t);
+	#else
+	ht->table = t;
+	#endif
+}
+
+HT_DECLARE_FUNC(void, create, (HT_BASETYPE *ht)) {
+	ht->table = HT_PRIV_FUNC(alloc_table)(HT_MIN_SIZE);
+	ht->num_elements = 0;
+
+	#ifdef HT_THREAD_SAFE
+	ht->sync.writing = false;
+	ht->sync.readers = 0;
+	ht->sync.mutex = SDL_CreateMutex();
+	ht->sync.cond = SDL_CreateCond();
+	#endif
+
+	#ifdef HT_LOCKFREE_READS
+	SDL_AtomicSet(&ht->sync.seq, 0);
+	SDL_AtomicSet(&ht->sync.epoch, 0);
+	SDL_AtomicSet(ht->sync.epoch_readers + 0, 0);
+	SDL_AtomicSet(ht->sync.epoch_readers + 1, 0);
+	memset(&ht->garbage, 0, sizeof(ht->garbage));
+	#endif
+}
+
+HT_DECLARE_FUNC(void, destroy, (HT_BASETYPE *ht)) {
+	HT_FUNC(unset_all)(ht);
+	#ifdef HT_THREAD_SAFE
+	SDL_DestroyCond(ht->sync.cond);
+	SDL_DestroyMutex(ht->sync.mutex);
+	#endif
+	#ifdef HT_LOCKFREE_READS
+	for(uint i = 0; i < 2; ++i) {
+		HT_PRIV_FUNC(collect_garbage)(ht, i);
+		free(ht->garbage[i].keys);
+		free(ht->garbage[i].tables);
+	}
+	#endif
+	free(ht->table);
+}
+
+HT_DECLARE_PRIV_FUNC(HT_TYPE(slot)*, find_slot, (HT_TYPE(table) *t, HT_TYPE(const_key) key, hash_t hash)) {
+	size_t mask = t->hash_mask;
+	size_t idx = hash & mask;
+
+	// NOTE: This also terminates on a table that is being modified concurrently
+	// (see HT_LOCKFREE_READS), since no probe distance can exceed the table size.
+	for(uint32_t dist = 1;; ++dist, idx = (idx + 1) & mask) {
+		HT_TYPE(slot) *s = t->slots + idx;
+
+		if(s->dist < dist) {
+			return NULL;
+		}
+
+		#ifdef HT_LOCKFREE_READS
+		SDL_MemoryBarrierAcquire();
+		#endif
+
+		if(hash == s->hash && HT_FUNC_KEYS_EQUAL(key, s->key)) {
+			return s;
+		}
+	}
+}
+
+#ifdef HT_LOCKFREE_READS
+// Returns false if the table was being modified during the read, in which case
+// *out_found and *out_value are meaningless.
+HT_DECLARE_PRIV_FUNC(bool, lookup_lockfree, (HT_BASETYPE *ht, HT_TYPE(const_key) key, hash_t hash, bool *out_found, HT_TYPE(value) *out_value)) {
+	bool consistent = false;
+	SDL_atomic_t *readers;
+
+	// Join the current epoch. If a writer moved on in the meantime, it may have
+	// already decided that the old epoch had no readers left, so try again.
+	for(;;) {
+		uint epoch = SDL_AtomicGet(&ht->sync.epoch);
+		readers = ht->sync.epoch_readers + (epoch & 1);
+		SDL_AtomicIncRef(readers);
+
+		if(SDL_AtomicGet(&ht->sync.epoch) == epoch) {
+			break;
+		}
+
+		(void)SDL_AtomicDecRef(readers);
+	}
+
+	for(int attempt = 0; attempt < HT_LOCKFREE_ATTEMPTS; ++attempt) {
+		int seq = SDL_AtomicGet(&ht->sync.seq);
+
+		if(seq & 1) {
+			break;
+		}
+
+		HT_TYPE(table) *t = SDL_AtomicGetPtr((void**)&ht->table);
+		HT_TYPE(slot) *s = HT_PRIV_FUNC(find_slot)(t, key, hash);
+
+		if((*out_found = (s != NULL))) {
+			*out_value = s->value;
+		}
+
+		SDL_MemoryBarrierAcquire();
+
+		if(SDL_AtomicGet(&ht->sync.seq) == seq) {
+			consistent = true;
+			break;
+		}
+	}
+
+	(void)SDL_AtomicDecRef(readers);
+	return consistent;
+}
+#endif // HT_LOCKFREE_READS
+
+HT_DECLARE_FUNC(HT_TYPE(value), get, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) fallback)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+	HT_TYPE(slot) *slot;
+	HT_TYPE(value) value = fallback;
+
+	#ifdef HT_LOCKFREE_READS
+	bool found;
+
+	if(HT_PRIV_FUNC(lookup_lockfree)(ht, key, hash, &found, &value)) {
+		return found ? value : fallback;
+	}
+	#endif
+
+	HT_PRIV_FUNC(begin_read)(ht);
+	slot = HT_PRIV_FUNC(find_slot)(ht->table, key, hash);
+	value = slot ? slot->value : fallback;
+	HT_PRIV_FUNC(end_read)(ht);
+
+	return value;
+}
+
+#ifdef HT_THREAD_SAFE
+HT_DECLARE_FUNC(HT_TYPE(value), get_unsafe, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) fallback)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+	HT_TYPE(slot) *slot = HT_PRIV_FUNC(find_slot)(ht->table, key, hash);
+	return slot ? slot->value : fallback;
+}
+#endif // HT_THREAD_SAFE
+
+HT_DECLARE_FUNC(bool, lookup, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) *out_value)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+	HT_TYPE(slot) *slot;
+	bool found = false;
+
+	#ifdef HT_LOCKFREE_READS
+	HT_TYPE(value) value;
+
+	if(HT_PRIV_FUNC(lookup_lockfree)(ht, key, hash, &found, &value)) {
+		if(found && out_value != NULL) {
+			*out_value = value;
+		}
+
+		return found;
+	}
+	#endif
+
+	HT_PRIV_FUNC(begin_read)(ht);
+	slot = HT_PRIV_FUNC(find_slot)(ht->table, key, hash);
+
+	if(slot != NULL) {
+		if(out_value != NULL) {
+			*out_value = slot->value;
+		}
+
+		found = true;
+	}
+
+	HT_PRIV_FUNC(end_read)(ht);
+
+	return found;
+}
+
+#ifdef HT_THREAD_SAFE
+HT_DECLARE_FUNC(bool, lookup_unsafe, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) *out_value)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+	HT_TYPE(slot) *slot = HT_PRIV_FUNC(find_slot)(ht->table, key, hash);
+
+	if(slot != NULL) {
+		if(out_value != NULL) {
+			*out_value = slot->value;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+#endif // HT_THREAD_SAFE
+
+HT_DECLARE_PRIV_FUNC(void, unset_all, (HT_BASETYPE *ht)) {
+	HT_TYPE(table) *t = ht->table;
+	size_t size = HT_PRIV_FUNC(table_size)(t);
+
+	for(size_t i = 0; i < size; ++i) {
+		if(t->slots[i].dist) {
+			HT_PRIV_FUNC(retire_key)(ht, t->slots[i].key);
+			t->slots[i].dist = 0;
+		}
+	}
+
+	ht->num_elements = 0;
+}
+
+HT_DECLARE_FUNC(void, unset_all, (HT_BASETYPE *ht)) {
+	HT_PRIV_FUNC(begin_write)(ht);
+	HT_PRIV_FUNC(unset_all)(ht);
+	HT_PRIV_FUNC(end_write)(ht);
+}
+
+HT_DECLARE_PRIV_FUNC(bool, unset, (HT_BASETYPE *ht, HT_TYPE(const_key) key, hash_t hash)) {
+	HT_TYPE(table) *t = ht->table;
+	HT_TYPE(slot) *slot = HT_PRIV_FUNC(find_slot)(t, key, hash);
+
+	if(slot == NULL) {
+		return false;
+	}
+
+	HT_PRIV_FUNC(retire_key)(ht, slot->key);
+
+	size_t mask = t->hash_mask;
+	size_t idx = slot - t->slots;
+
+	// Shift back the following entries, until one that is already in its home slot.
+	for(;;) {
+		size_t next = (idx + 1) & mask;
+
+		if(t->slots[next].dist <= 1) {
+			break;
+		}
+
+		HT_TYPE(slot) entry = t->slots[next];
+		--entry.dist;
+		HT_PRIV_FUNC(store_slot)(t->slots + idx, entry);
+		idx = next;
+	}
+
+	t->slots[idx].dist = 0;
+	--ht->num_elements;
+	return true;
+}
+
+HT_DECLARE_FUNC(bool, unset, (HT_BASETYPE *ht, HT_TYPE(const_key) key)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+
+	HT_PRIV_FUNC(begin_write)(ht);
+	bool success = HT_PRIV_FUNC(unset)(ht, key, hash);
+	HT_PRIV_FUNC(end_write)(ht);
+
+	return success;
+}
+
+HT_DECLARE_FUNC(void, unset_list, (HT_BASETYPE *ht, const HT_TYPE(key_list) *key_list)) {
+	HT_PRIV_FUNC(begin_write)(ht);
+
+	for(const HT_TYPE(key_list) *i = key_list; i; i = i->next) {
+		HT_PRIV_FUNC(unset)(ht, i->key, HT_FUNC_HASH_KEY(i->key));
+	}
+
+	HT_PRIV_FUNC(end_write)(ht);
+}
+
+// Places [entry] into the table, starting at slot [idx], where entry.dist must be correct.
+HT_DECLARE_PRIV_FUNC(void, insert_slot, (HT_TYPE(table) *t, size_t idx, HT_TYPE(slot) entry)) {
+	size_t mask = t->hash_mask;
+
+	for(;; ++entry.dist, idx = (idx + 1) & mask) {
+		HT_TYPE(slot) *s = t->slots + idx;
+
+		if(s->dist == 0) {
+			HT_PRIV_FUNC(store_slot)(s, entry);
+			return;
+		}
+
+		if(s->dist < entry.dist) {
+			HT_TYPE(slot) displaced = *s;
+			HT_PRIV_FUNC(store_slot)(s, entry);
+			entry = displaced;
+		}
+	}
+}
+
+HT_DECLARE_PRIV_FUNC(bool, set, (
+	HT_BASETYPE *ht,
+	hash_t hash,
+	HT_TYPE(const_key) key,
+	HT_TYPE(value) value,
+	HT_TYPE(value) (*transform_value)(HT_TYPE(value)),
+	bool allow_overwrite,
+	HT_TYPE(value) *out_value
+)) {
+	HT_TYPE(table) *t = ht->table;
+	size_t mask = t->hash_mask;
+	size_t idx = hash & mask;
+	uint32_t dist = 1;
+	HT_TYPE(slot) *s;
+
+	for(;; ++dist, idx = (idx + 1) & mask) {
+		s = t->slots + idx;
+
+		if(s->dist < dist) {
+			s = NULL;
+			break;
+		}
+
+		if(hash == s->hash && HT_FUNC_KEYS_EQUAL(key, s->key)) {
+			if(!allow_overwrite) {
+				if(out_value != NULL) {
+					*out_value = s->value;
+				}
+
+				return false;
+			}
+
+			break;
+		}
+	}
+
+	if(transform_value != NULL) {
+		value = transform_value(value);
+	}
+
+	if(out_value != NULL) {
+		*out_value = value;
+	}
+
+	if(s != NULL) {
+		s->value = value;
+		return false;
+	}
+
+	HT_TYPE(slot) entry = { .value = value, .hash = hash, .dist = dist };
+	HT_FUNC_COPY_KEY(&entry.key, key);
+	HT_PRIV_FUNC(insert_slot)(t, idx, entry);
+	++ht->num_elements;
+	return true;
+}
+
+HT_DECLARE_PRIV_FUNC(void, check_elem_count, (HT_BASETYPE *ht)) {
+	#ifdef DEBUG
+	size_t num_elements = 0;
+	size_t size = HT_PRIV_FUNC(table_size)(ht->table);
+	for(size_t i = 0; i < size; ++i) {
+		num_elements += (ht->table->slots[i].dist != 0);
+	}
+	assert(num_elements == ht->num_elements);
+	#endif // DEBUG
+}
+
+HT_DECLARE_PRIV_FUNC(void, resize, (HT_BASETYPE *ht, size_t new_size)) {
+	HT_TYPE(table) *old_table = ht->table;
+	size_t old_size = HT_PRIV_FUNC(table_size)(old_table);
+	assert(new_size != old_size);
+	HT_TYPE(table) *new_table = HT_PRIV_FUNC(alloc_table)(new_size);
+
+	HT_PRIV_FUNC(check_elem_count)(ht);
+
+	for(size_t i = 0; i < old_size; ++i) {
+		HT_TYPE(slot) entry = old_table->slots[i];
+
+		if(entry.dist) {
+			entry.dist = 1;
+			HT_PRIV_FUNC(insert_slot)(new_table, entry.hash & new_table->hash_mask, entry);
+		}
+	}
+
+	// The keys have been moved to the new table, not copied, so only the table itself goes.
+	HT_PRIV_FUNC(publish_table)(ht, new_table);
+	HT_PRIV_FUNC(retire_table)(ht, old_table);
+
+	log_debug(
+		"Resized hashtable at %p: %"PRIuMAX" -> %"PRIuMAX"",
+		(void*)ht, (uintmax_t)old_size, (uintmax_t)new_size
+	);
+
+	HT_PRIV_FUNC(check_elem_count)(ht);
+}
+
+HT_DECLARE_PRIV_FUNC(void, check_load, (HT_BASETYPE *ht)) {
+	size_t size = HT_PRIV_FUNC(table_size)(ht->table);
+
+	if(ht->num_elements * HT_MAX_LOAD_DEN >= size * HT_MAX_LOAD_NUM) {
+		HT_PRIV_FUNC(resize)(ht, size * 2);
+	}
+}
+
+HT_DECLARE_FUNC(bool, set, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) value)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+
+	HT_PRIV_FUNC(begin_write)(ht);
+	bool result = HT_PRIV_FUNC(set)(ht, hash, key, value, NULL, true, NULL);
+	HT_PRIV_FUNC(check_load)(ht);
+	HT_PRIV_FUNC(end_write)(ht);
+
+	return result;
+}
+
+HT_DECLARE_FUNC(bool, try_set, (HT_BASETYPE *ht, HT_TYPE(const_key) key, HT_TYPE(value) value, HT_TYPE(value) (*value_transform)(HT_TYPE(value)), HT_TYPE(value) *out_value)) {
+	hash_t hash = HT_FUNC_HASH_KEY(key);
+
+	HT_PRIV_FUNC(begin_write)(ht);
+	bool result = HT_PRIV_FUNC(set)(ht, hash, key, value, value_transform, false, out_value);
+	HT_PRIV_FUNC(check_load)(ht);
+	HT_PRIV_FUNC(end_write)(ht);
+
+	return result;
+}
+
+HT_DECLARE_FUNC(void*, foreach, (HT_BASETYPE *ht, HT_TYPE(foreach_callback) callback, void *arg)) {
+	void *ret = NULL;
+
+	HT_PRIV_FUNC(begin_read)(ht);
+
+	HT_TYPE(table) *t = ht->table;
+	size_t size = HT_PRIV_FUNC(table_size)(t);
+
+	for(size_t i = 0; i < size; ++i) {
+		if(t->slots[i].dist) {
+			ret = callback(t->slots[i].key, t->slots[i].value, arg);
+
+			if(ret != NULL) {
+				break;
+			}
+		}
+	}
+
+	HT_PRIV_FUNC(end_read)(ht);
+	return ret;
+}
+
+HT_DECLARE_PRIV_FUNC(void, iter_advance, (HT_BASETYPE *ht, HT_TYPE(iter) *iter)) {
+	HT_TYPE(table) *t = ht->table;
+	size_t size = HT_PRIV_FUNC(table_size)(t);
+
+	while(iter->private.bucketnum < size && !t->slots[iter->private.bucketnum].dist) {
+		++iter->private.bucketnum;
+	}
+
+	if(iter->private.bucketnum == size) {
+		iter->has_data = false;
+		return;
+	}
+
+	iter->key = t->slots[iter->private.bucketnum].key;
+	iter->value = t->slots[iter->private.bucketnum].value;
+}
+
+HT_DECLARE_FUNC(void, iter_begin, (HT_BASETYPE *ht, HT_TYPE(iter) *iter)) {
+	HT_PRIV_FUNC(begin_read)(ht);
+	memset(iter, 0, sizeof(*iter));
+	iter->hashtable = ht;
+	iter->has_data = true;
+	HT_PRIV_FUNC(iter_advance)(ht, iter);
+}
+
+HT_DECLARE_FUNC(void, iter_next, (HT_TYPE(iter) *iter)) {
+	if(!iter->has_data) {
+		return;
+	}
+
+	++iter->private.bucketnum;
+	HT_PRIV_FUNC(iter_advance)(iter->hashtable, iter);
+}
+
+HT_DECLARE_FUNC(void, iter_end, (HT_TYPE(iter) *iter)) {
+	HT_PRIV_FUNC(end_read)(iter->hashtable);
+}
+
+#endif // HT_OPEN_ADDRESSING
+
 #endif // HT_IMPL
 
 /***********\
@@ -1031,8 +1736,13 @@ HT_DECLARE_FUNC(void, iter_end, (HT_TYPE(iter) *iter)) {
 #undef HT_INLINE
 #undef HT_KEY_CONST
 #undef HT_KEY_TYPE
+#undef HT_LOCKFREE_ATTEMPTS
+#undef HT_LOCKFREE_READS
+#undef HT_MAX_LOAD_DEN
+#undef HT_MAX_LOAD_NUM
 #undef HT_MIN_SIZE
 #undef HT_NAME
+#undef HT_OPEN_ADDRESSING
 #undef HT_PRIV_FUNC
 #undef HT_PRIV_NAME
 #undef HT_SUFFIX
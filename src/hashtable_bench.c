@@ -0,0 +1,427 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "hashtable.h"
+#include "taskmanager.h"
+#include "util.h"
+
+// Compares the chained and the open addressing hashtable modes on workloads modeled after
+// the font glyph tables (ht_int2int_t) and the resource name tables (ht_str2ptr_ts_t).
+// Both modes are instantiated here explicitly, independently of the predefined types.
+
+#define HT_SUFFIX                      int2int_chained
+#define HT_KEY_TYPE                    int64_t
+#define HT_VALUE_TYPE                  int64_t
+#define HT_FUNC_HASH_KEY(key)          htutil_hashfunc_uint64((uint64_t)(key))
+#define HT_IMPL
+#include "hashtable.inc.h"
+
+#define HT_SUFFIX                      int2int_oa
+#define HT_KEY_TYPE                    int64_t
+#define HT_VALUE_TYPE                  int64_t
+#define HT_FUNC_HASH_KEY(key)          htutil_hashfunc_uint64((uint64_t)(key))
+#define HT_OPEN_ADDRESSING
+#define HT_IMPL
+#include "hashtable.inc.h"
+
+#define HT_SUFFIX                      str2ptr_ts_chained
+#define HT_KEY_TYPE                    char*
+#define HT_VALUE_TYPE                  void*
+#define HT_FUNC_FREE_KEY(key)          free(key)
+#define HT_FUNC_KEYS_EQUAL(key1, key2) (!strcmp(key1, key2))
+#define HT_FUNC_HASH_KEY(key)          htutil_hashfunc_string(0, key)
+#define HT_FUNC_COPY_KEY(dst, src)     (*(dst) = strdup(src))
+#define HT_KEY_CONST
+#define HT_VALUE_CONST
+#define HT_THREAD_SAFE
+#define HT_IMPL
+#include "hashtable.inc.h"
+
+#define HT_SUFFIX                      str2ptr_ts_oa
+#define HT_KEY_TYPE                    char*
+#define HT_VALUE_TYPE                  void*
+#define HT_FUNC_FREE_KEY(key)          free(key)
+#define HT_FUNC_KEYS_EQUAL(key1, key2) (!strcmp(key1, key2))
+#define HT_FUNC_HASH_KEY(key)          htutil_hashfunc_string(0, key)
+#define HT_FUNC_COPY_KEY(dst, src)     (*(dst) = strdup(src))
+#define HT_KEY_CONST
+#define HT_VALUE_CONST
+#define HT_THREAD_SAFE
+#define HT_OPEN_ADDRESSING
+#define HT_LOCKFREE_READS
+#define HT_IMPL
+#include "hashtable.inc.h"
+
+enum {
+	BENCH_FONT_LOOKUPS = 4000000,
+	BENCH_RES_NAMES = 600,
+	BENCH_RES_LOOKUPS = 2000000,
+	BENCH_RES_THREADS = 4,
+
+	CHECK_KEYS = 1024,
+	CHECK_STABLE_KEYS = 64,
+	CHECK_OPS = 400000,
+	CHECK_READERS = BENCH_RES_THREADS - 1,
+};
+
+static double bench_seconds(Uint64 begin) {
+	return (SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency();
+}
+
+static uint32_t bench_rand(uint32_t *state) {
+	// xorshift32; the game's RNG must not be touched here.
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static void bench_report(const char *name, const char *mode, uint ops, double seconds, int64_t checksum) {
+	tsfprintf(stdout, "%-22s %-8s %8.3f ms, %6.1f ns/op  (checksum %"PRIi64")\n",
+		name, mode, seconds * 1000, seconds * 1e9 / ops, checksum
+	);
+}
+
+/*
+ * Font glyph cache: codepoints are mapped to glyph offsets as they're first rendered, then
+ * looked up over and over for every string drawn. Mostly ASCII, some Latin-1 and the
+ * occasional CJK character; a few lookups miss.
+ */
+
+typedef struct FontBenchData {
+	int64_t *codepoints;
+	uint num_codepoints;
+	int64_t *text;
+} FontBenchData;
+
+static void font_bench_init(FontBenchData *d) {
+	d->codepoints = calloc(512, sizeof(*d->codepoints));
+
+	for(int64_t c = 0x20; c < 0x7F; ++c) {
+		d->codepoints[d->num_codepoints++] = c;
+	}
+
+	for(int64_t c = 0xA0; c < 0x180; ++c) {
+		d->codepoints[d->num_codepoints++] = c;
+	}
+
+	for(int64_t c = 0x3041; c < 0x3097; ++c) {
+		d->codepoints[d->num_codepoints++] = c;
+	}
+
+	uint32_t rand = 0x12345;
+	d->text = calloc(BENCH_FONT_LOOKUPS, sizeof(*d->text));
+
+	for(uint i = 0; i < BENCH_FONT_LOOKUPS; ++i) {
+		uint32_t r = bench_rand(&rand);
+
+		if(r % 100 == 0) {
+			d->text[i] = 0x4E00 + r % 0x5000;
+		} else if(r % 10 == 0) {
+			d->text[i] = d->codepoints[r % d->num_codepoints];
+		} else {
+			d->text[i] = 0x20 + r % 0x5F;
+		}
+	}
+}
+
+static void font_bench_free(FontBenchData *d) {
+	free(d->codepoints);
+	free(d->text);
+}
+
+#define FONT_BENCH(suffix) \
+	static void font_bench_##suffix(FontBenchData *d, const char *mode) { \
+		ht_##suffix##_t ht; \
+		ht_##suffix##_create(&ht); \
+		Uint64 begin = SDL_GetPerformanceCounter(); \
+		for(uint i = 0; i < d->num_codepoints; ++i) { \
+			ht_##suffix##_set(&ht, d->codepoints[i], i * 64); \
+		} \
+		double insert_time = bench_seconds(begin); \
+		int64_t sum = 0; \
+		begin = SDL_GetPerformanceCounter(); \
+		for(uint i = 0; i < BENCH_FONT_LOOKUPS; ++i) { \
+			sum += ht_##suffix##_get(&ht, d->text[i], -1); \
+		} \
+		double lookup_time = bench_seconds(begin); \
+		bench_report("font: insert", mode, d->num_codepoints, insert_time, d->num_codepoints); \
+		bench_report("font: lookup", mode, BENCH_FONT_LOOKUPS, lookup_time, sum); \
+		ht_##suffix##_destroy(&ht); \
+	}
+
+FONT_BENCH(int2int_chained)
+FONT_BENCH(int2int_oa)
+
+/*
+ * Resource cache: a few hundred names, looked up by the main thread every frame, and
+ * concurrently by the loader threads during preloads. Writes are rare.
+ */
+
+typedef struct ResBenchData {
+	char *names[BENCH_RES_NAMES];
+	uint lookups[BENCH_RES_LOOKUPS];
+} ResBenchData;
+
+static void res_bench_init(ResBenchData *d) {
+	static const char *const dirs[] = {
+		"proj", "part", "dialog", "stage1", "stage3", "stage6", "boss", "player", "menu",
+	};
+
+	for(uint i = 0; i < BENCH_RES_NAMES; ++i) {
+		d->names[i] = strfmt("%s/resource%u", dirs[i % (sizeof(dirs)/sizeof(*dirs))], i);
+	}
+
+	uint32_t rand = 0x54321;
+
+	for(uint i = 0; i < BENCH_RES_LOOKUPS; ++i) {
+		// Skewed towards the first names, like the few sprites used all the time.
+		uint32_t r = bench_rand(&rand);
+		d->lookups[i] = (r & 1) ? r % 32 : r % BENCH_RES_NAMES;
+	}
+}
+
+static void res_bench_free(ResBenchData *d) {
+	for(uint i = 0; i < BENCH_RES_NAMES; ++i) {
+		free(d->names[i]);
+	}
+}
+
+typedef struct ResBenchTask {
+	ResBenchData *data;
+	void *ht;
+	int64_t sum;
+} ResBenchTask;
+
+#define RES_BENCH(suffix) \
+	static void* res_bench_task_##suffix(void *arg) { \
+		ResBenchTask *t = arg; \
+		for(uint i = 0; i < BENCH_RES_LOOKUPS; ++i) { \
+			t->sum += (intptr_t)ht_##suffix##_get(t->ht, t->data->names[t->data->lookups[i]], NULL); \
+		} \
+		return NULL; \
+	} \
+	static void res_bench_##suffix(ResBenchData *d, TaskManager *mgr, const char *mode) { \
+		ht_##suffix##_t ht; \
+		ht_##suffix##_create(&ht); \
+		Uint64 begin = SDL_GetPerformanceCounter(); \
+		for(uint i = 0; i < BENCH_RES_NAMES; ++i) { \
+			ht_##suffix##_set(&ht, d->names[i], (void*)(intptr_t)(i + 1)); \
+		} \
+		bench_report("res: insert", mode, BENCH_RES_NAMES, bench_seconds(begin), BENCH_RES_NAMES); \
+		ResBenchTask tasks[BENCH_RES_THREADS] = { { d, &ht } }; \
+		begin = SDL_GetPerformanceCounter(); \
+		res_bench_task_##suffix(tasks); \
+		bench_report("res: lookup", mode, BENCH_RES_LOOKUPS, bench_seconds(begin), tasks[0].sum); \
+		Task *handles[BENCH_RES_THREADS]; \
+		for(uint i = 0; i < BENCH_RES_THREADS; ++i) { \
+			tasks[i] = (ResBenchTask) { d, &ht }; \
+		} \
+		begin = SDL_GetPerformanceCounter(); \
+		for(uint i = 0; i < BENCH_RES_THREADS; ++i) { \
+			handles[i] = taskmgr_submit(mgr, (TaskParams) { res_bench_task_##suffix, tasks + i }); \
+		} \
+		for(uint i = 0; i < BENCH_RES_THREADS; ++i) { \
+			task_finish(handles[i], NULL); \
+		} \
+		int64_t sum = 0; \
+		for(uint i = 0; i < BENCH_RES_THREADS; ++i) { \
+			sum += tasks[i].sum; \
+		} \
+		bench_report("res: parallel lookup", mode, BENCH_RES_LOOKUPS * BENCH_RES_THREADS, bench_seconds(begin), sum); \
+		ht_##suffix##_destroy(&ht); \
+	}
+
+RES_BENCH(str2ptr_ts_chained)
+RES_BENCH(str2ptr_ts_oa)
+
+/*
+ * Correctness check: one writer sets and unsets keys at random, checking every result
+ * against a plain array, while the other threads keep looking keys up. A value must always
+ * belong to the key it was found under, and the first CHECK_STABLE_KEYS keys are never
+ * removed, so they must always be found. Lots of keys get removed and the table resized
+ * along the way, so this also exercises the deferred freeing in HT_LOCKFREE_READS mode;
+ * build with -Db_sanitize=address to catch use-after-free.
+ */
+
+#define CHECK_VALUE(key_idx, version) ((void*)(((intptr_t)(version) << 16) | ((key_idx) + 1)))
+#define CHECK_VALUE_KEY(value)        ((int)((intptr_t)(value) & 0xFFFF) - 1)
+
+typedef struct CheckData {
+	ht_str2ptr_ts_oa_t ht;
+	char *names[CHECK_KEYS];
+	SDL_atomic_t done;
+	SDL_atomic_t errors;
+	uint32_t seed;
+} CheckData;
+
+typedef struct CheckReader {
+	CheckData *data;
+	uint32_t rand;
+	uint lookups;
+} CheckReader;
+
+static void *check_reader_task(void *arg) {
+	CheckReader *r = arg;
+	CheckData *d = r->data;
+
+	while(!SDL_AtomicGet(&d->done)) {
+		uint idx = bench_rand(&r->rand) % CHECK_KEYS;
+		void *value = ht_str2ptr_ts_oa_get(&d->ht, d->names[idx], NULL);
+		++r->lookups;
+
+		if(value == NULL ? idx < CHECK_STABLE_KEYS : CHECK_VALUE_KEY(value) != (int)idx) {
+			SDL_AtomicIncRef(&d->errors);
+		}
+	}
+
+	return NULL;
+}
+
+static uint check_writer(CheckData *d, void **ref) {
+	uint errors = 0;
+	uint32_t rand = d->seed;
+
+	for(uint op = 0; op < CHECK_OPS; ++op) {
+		uint32_t r = bench_rand(&rand);
+		uint idx = r % CHECK_KEYS;
+
+		if(idx >= CHECK_STABLE_KEYS && (r >> 16) % 3 == 0) {
+			ht_str2ptr_ts_oa_unset(&d->ht, d->names[idx]);
+			ref[idx] = NULL;
+		} else {
+			ref[idx] = CHECK_VALUE(idx, op);
+			ht_str2ptr_ts_oa_set(&d->ht, d->names[idx], ref[idx]);
+		}
+
+		if(ht_str2ptr_ts_oa_get(&d->ht, d->names[idx], NULL) != ref[idx]) {
+			++errors;
+		}
+
+		// Empty the table every now and then, so that it has to grow again.
+		if(op % (CHECK_OPS / 8) == CHECK_OPS / 8 - 1) {
+			for(uint i = CHECK_STABLE_KEYS; i < CHECK_KEYS; ++i) {
+				ht_str2ptr_ts_oa_unset(&d->ht, d->names[i]);
+				ref[i] = NULL;
+			}
+		}
+	}
+
+	uint num_expected = 0;
+
+	for(uint i = 0; i < CHECK_KEYS; ++i) {
+		if(ref[i] != NULL) {
+			++num_expected;
+		}
+
+		if(ht_str2ptr_ts_oa_get(&d->ht, d->names[i], NULL) != ref[i]) {
+			++errors;
+		}
+	}
+
+	uint num_found = 0;
+	ht_str2ptr_ts_oa_iter_t iter;
+	ht_str2ptr_ts_oa_iter_begin(&d->ht, &iter);
+
+	for(; iter.has_data; ht_str2ptr_ts_oa_iter_next(&iter)) {
+		++num_found;
+	}
+
+	ht_str2ptr_ts_oa_iter_end(&iter);
+
+	if(num_found != num_expected) {
+		++errors;
+	}
+
+	return errors;
+}
+
+static int check_concurrent(TaskManager *mgr) {
+	CheckData *d = calloc(1, sizeof(*d));
+	void **ref = calloc(CHECK_KEYS, sizeof(*ref));
+	ht_str2ptr_ts_oa_create(&d->ht);
+	d->seed = 0xC0FFEE;
+
+	for(uint i = 0; i < CHECK_KEYS; ++i) {
+		d->names[i] = strfmt("check/key%u", i);
+	}
+
+	for(uint i = 0; i < CHECK_STABLE_KEYS; ++i) {
+		ref[i] = CHECK_VALUE(i, 0);
+		ht_str2ptr_ts_oa_set(&d->ht, d->names[i], ref[i]);
+	}
+
+	CheckReader readers[CHECK_READERS];
+	Task *handles[CHECK_READERS];
+
+	for(uint i = 0; i < CHECK_READERS; ++i) {
+		readers[i] = (CheckReader) { .data = d, .rand = 0x1000 + i };
+		handles[i] = taskmgr_submit(mgr, (TaskParams) { check_reader_task, readers + i });
+	}
+
+	uint writer_errors = check_writer(d, ref);
+	SDL_AtomicSet(&d->done, 1);
+
+	uint lookups = 0;
+
+	for(uint i = 0; i < CHECK_READERS; ++i) {
+		task_finish(handles[i], NULL);
+		lookups += readers[i].lookups;
+	}
+
+	int reader_errors = SDL_AtomicGet(&d->errors);
+
+	tsfprintf(stdout, "check: %u writes, %u concurrent lookups: %u writer errors, %i reader errors\n",
+		CHECK_OPS, lookups, writer_errors, reader_errors
+	);
+
+	ht_str2ptr_ts_oa_destroy(&d->ht);
+
+	for(uint i = 0; i < CHECK_KEYS; ++i) {
+		free(d->names[i]);
+	}
+
+	free(ref);
+	free(d);
+
+	return writer_errors || reader_errors;
+}
+
+int htutil_benchmark(void) {
+	FontBenchData font = { 0 };
+	font_bench_init(&font);
+	font_bench_int2int_chained(&font, "chained");
+	font_bench_int2int_oa(&font, "open");
+	font_bench_free(&font);
+
+	TaskManager *mgr = taskmgr_create(BENCH_RES_THREADS, SDL_THREAD_PRIORITY_NORMAL, "bench");
+
+	if(mgr == NULL) {
+		log_warn("Failed to create a task manager with %u threads", BENCH_RES_THREADS);
+		return 1;
+	}
+
+	if(check_concurrent(mgr)) {
+		log_warn("The lock-free hashtable gave wrong results");
+		taskmgr_finish(mgr);
+		return 1;
+	}
+
+	ResBenchData *res = calloc(1, sizeof(*res));
+	res_bench_init(res);
+	res_bench_str2ptr_ts_chained(res, mgr, "chained");
+	res_bench_str2ptr_ts_oa(res, mgr, "open");
+	res_bench_free(res);
+	free(res);
+
+	taskmgr_finish(mgr);
+	return 0;
+}
@@ -79,9 +79,25 @@ void time_shutdown(void) {
 
 }
 
+static hrtime_t time_peek(void) {
+	// Doesn't touch any state, so that other threads can get a timestamp too (e.g. for the profiler).
+	// Frequency changes and backwards jumps are only handled on the main thread; in the rare case
+	// that one happens concurrently, the result is off for a moment, which is fine for measurements.
+	uint64_t cntr = SDL_GetPerformanceCounter();
+
+	if(fast_path_mul) {
+		return time_offset + (cntr - prev_hires_time) * fast_path_mul;
+	}
+
+	return time_offset + umuldiv64(cntr - prev_hires_time, HRTIME_RESOLUTION, prev_hires_freq);
+}
+
 hrtime_t time_get(void) {
 	if(use_hires) {
-		assert(is_main_thread());
+		if(!is_main_thread()) {
+			return time_peek();
+		}
+
 		time_update();
 		return time_current;
 	}
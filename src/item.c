@@ -13,6 +13,7 @@
 #include "list.h"
 #include "stageobjects.h"
 #include "objectpool_util.h"
+#include "stage.h"
 
 static Sprite* item_sprite(ItemType type) {
 	static const char *const map[] = {
@@ -100,36 +101,147 @@ void delete_items(void) {
 	}
 }
 
-static complex move_item(Item *i) {
+typedef struct ItemMotion {
+	complex pos;
+	complex pos0;
+	complex v;
+	int birthtime;
+} ItemMotion;
+
+// NOTE: this must not have any side effects, it may be called from the logic worker threads.
+static void calc_item_motion(const Item *i, int auto_collect, double half, complex plr_pos, ItemMotion *out) {
 	int t = global.frames - i->birthtime;
 	complex lim = 0 + 2.0*I;
 
-	complex oldpos = i->pos;
+	out->pos = i->pos;
+	out->pos0 = i->pos0;
+	out->v = i->v;
+	out->birthtime = i->birthtime;
 
-	if(i->auto_collect) {
-		i->pos -= (7+i->auto_collect)*cexp(I*carg(i->pos - global.plr.pos));
+	if(auto_collect) {
+		out->pos -= (7+auto_collect)*cexp(I*carg(out->pos - plr_pos));
 	} else {
-		i->pos = i->pos0 + log(t/5.0 + 1)*5*(i->v + lim) + lim*t;
+		out->pos = i->pos0 + log(t/5.0 + 1)*5*(i->v + lim) + lim*t;
 
-		complex v = i->pos - oldpos;
-		double half = item_sprite(i->type)->w/2.0;
+		complex v = out->pos - i->pos;
 		bool over = false;
 
-		if((over = creal(i->pos) > VIEWPORT_W-half) || creal(i->pos) < half) {
+		if((over = creal(out->pos) > VIEWPORT_W-half) || creal(out->pos) < half) {
 			complex normal = over ? -1 : 1;
 			v -= 2 * normal * (creal(normal)*creal(v));
 			v = 1.5*creal(v) - I*fabs(cimag(v));
 
-			i->pos = clamp(creal(i->pos), half, VIEWPORT_W-half) + I*cimag(i->pos);
-			i->v = v;
-			i->pos0 = i->pos;
-			i->birthtime = global.frames;
+			out->pos = clamp(creal(out->pos), half, VIEWPORT_W-half) + I*cimag(out->pos);
+			out->v = v;
+			out->pos0 = out->pos;
+			out->birthtime = global.frames;
 		}
 	}
+}
+
+static complex apply_item_motion(Item *i, const ItemMotion *m) {
+	complex oldpos = i->pos;
+
+	i->pos = m->pos;
+	i->pos0 = m->pos0;
+	i->v = m->v;
+	i->birthtime = m->birthtime;
 
 	return i->pos - oldpos;
 }
 
+static double item_half_width(ItemType type) {
+	return item_sprite(type)->w/2.0;
+}
+
+static complex move_item(Item *i) {
+	ItemMotion m;
+	calc_item_motion(i, i->auto_collect, i->auto_collect ? 0 : item_half_width(i->type), global.plr.pos, &m);
+	return apply_item_motion(i, &m);
+}
+
+/*
+ * Item motion is precomputed on the logic worker threads before the main loop in process_items.
+ * The main loop is what actually decides each item's type and auto_collect state for the frame,
+ * so the precomputation has to guess them. It's only used if the guess was right; otherwise the
+ * motion is recomputed on the spot. Items spawned during the loop are never precomputed.
+ */
+
+enum {
+	ITEM_MOTION_GRAIN = 64,
+};
+
+typedef struct ItemMotionSpeculation {
+	Item *item;
+	ItemType type;
+	int auto_collect;
+	ItemMotion motion;
+} ItemMotionSpeculation;
+
+static struct {
+	ItemMotionSpeculation *specs;
+	uint num;
+	uint capacity;
+
+	complex plr_pos;
+	float collect_radius;
+	bool collect_all;
+	double half_widths[Life + 1];
+} item_motion;
+
+static void speculate_item_motion(uint begin, uint end, void *arg) {
+	for(uint idx = begin; idx < end; ++idx) {
+		ItemMotionSpeculation *s = item_motion.specs + idx;
+		Item *i = s->item;
+
+		if(
+			(s->type == Power && global.plr.power >= PLR_MAX_POWER) ||
+			(global.stage->type == STAGE_SPELL && (s->type == Life || s->type == Bomb))
+		) {
+			s->type = Point;
+		}
+
+		if(item_motion.collect_all || cabs(item_motion.plr_pos - i->pos) < item_motion.collect_radius) {
+			s->auto_collect = 1;
+		}
+
+		calc_item_motion(i, s->auto_collect, item_motion.half_widths[s->type], item_motion.plr_pos, &s->motion);
+	}
+}
+
+static void speculate_items(float collect_radius, bool collect_all) {
+	uint num = 0;
+
+	for(Item *i = global.items.first; i; i = i->next) {
+		if(num == item_motion.capacity) {
+			item_motion.capacity = item_motion.capacity ? item_motion.capacity * 2 : 64;
+			item_motion.specs = realloc(item_motion.specs, sizeof(*item_motion.specs) * item_motion.capacity);
+		}
+
+		ItemMotionSpeculation *s = item_motion.specs + num++;
+		s->item = i;
+		s->type = i->type;
+		s->auto_collect = i->auto_collect;
+	}
+
+	item_motion.num = num;
+
+	if(num == 0) {
+		return;
+	}
+
+	// get_sprite is not safe to call from the workers.
+	for(ItemType t = BPoint; t <= Life; ++t) {
+		item_motion.half_widths[t] = item_half_width(t);
+	}
+
+	item_motion.plr_pos = global.plr.pos;
+	item_motion.collect_radius = collect_radius;
+	item_motion.collect_all = collect_all;
+
+	stage_parallel_for(num, ITEM_MOTION_GRAIN, speculate_item_motion, NULL);
+}
+
 static bool item_out_of_bounds(Item *item) {
 	double margin = max(item_sprite(item->type)->w, item_sprite(item->type)->h);
 
@@ -145,6 +257,13 @@ void process_items(void) {
 	float r = player_property(&global.plr, PLR_PROP_COLLECT_RADIUS);
 	bool plr_alive = player_is_alive(&global.plr);
 	bool plr_bombing = player_is_bomb_active(&global.plr);
+	uint spec_idx = 0;
+
+	if(plr_alive) {
+		speculate_items(r, plr_bombing || cimag(global.plr.pos) < player_property(&global.plr, PLR_PROP_POC));
+	} else {
+		item_motion.num = 0;
+	}
 
 	while(item != NULL) {
 		if((item->type == Power && global.plr.power >= PLR_MAX_POWER) ||
@@ -169,7 +288,19 @@ void process_items(void) {
 			item->v = -10*I + 5*nfrand();
 		}
 
-		complex deltapos = move_item(item);
+		complex deltapos;
+		ItemMotionSpeculation *spec = NULL;
+
+		if(spec_idx < item_motion.num) {
+			spec = item_motion.specs + spec_idx++;
+			assert(spec->item == item);
+		}
+
+		if(spec && spec->type == item->type && spec->auto_collect == item->auto_collect) {
+			deltapos = apply_item_motion(item, &spec->motion);
+		} else {
+			deltapos = move_item(item);
+		}
 
 		int v = collision_item(item);
 		if(v == 1) {
@@ -13,16 +13,62 @@
 #include "list.h"
 #include "stageobjects.h"
 #include "stagedraw.h"
+#include "stageglow.h"
 #include "renderer/api.h"
 #include "resource/model.h"
+#include "profiler.h"
+
+// The built-in position rules, and the shaders that implement them on the GPU.
+static const struct {
+	LaserPosRule rule;
+	const char *shader;
+} builtin_rules[] = {
+	{ las_linear,         "lasers/linear" },
+	{ las_accel,          "lasers/accelerated" },
+	{ las_sine,           "lasers/sine" },
+	{ las_weird_sine,     "lasers/weird_sine" },
+	{ las_sine_expanding, "lasers/sine_expanding" },
+	{ las_turning,        "lasers/turning" },
+	{ las_circle,         "lasers/circle" },
+};
+
+#define NUM_BUILTIN_RULES (sizeof(builtin_rules)/sizeof(*builtin_rules))
+
+// Uniforms of a laser shader, looked up once rather than by name on every draw.
+typedef struct LaserUniforms {
+	ShaderProgram *shader;
+	Uniform *tex;
+	Uniform *origin;
+	Uniform *args;
+	Uniform *timeshift;
+	Uniform *width;
+	Uniform *width_exponent;
+	Uniform *span;
+} LaserUniforms;
 
 static struct {
 	VertexArray *varr;
 	VertexBuffer *vbuf;
+	uint base_instance; // where the next generic laser goes in vbuf
 	ShaderProgram *shader_generic;
+	ShaderProgram *builtin_shaders[NUM_BUILTIN_RULES];
+	Texture *curve_tex;
+
+	LaserUniforms uniforms_generic;
+	LaserUniforms uniforms_builtin[NUM_BUILTIN_RULES];
+	LaserUniforms uniforms_custom; // for the last shader set by a stage
 	Model quad_generic;
 	Framebuffer *saved_fb;
 	Framebuffer *render_fb;
+
+	// Collision curve samples of all lasers, reset every frame. See laser_curve_points.
+	struct {
+		complex *points;
+		uint num;
+		uint capacity;
+		uint generation;
+		int frame;
+	} curve_cache;
 } lasers;
 
 typedef struct LaserInstancedAttribs {
@@ -33,13 +79,46 @@ typedef struct LaserInstancedAttribs {
 static void lasers_ent_predraw_hook(EntityInterface *ent, void *arg);
 static void lasers_ent_postdraw_hook(EntityInterface *ent, void *arg);
 
+static void laser_uniforms_resolve(LaserUniforms *u, ShaderProgram *shader) {
+	memset(u, 0, sizeof(*u));
+	u->shader = shader;
+
+	if(shader == NULL) {
+		return;
+	}
+
+	u->tex = r_shader_uniform(shader, "tex");
+	u->origin = r_shader_uniform(shader, "origin");
+	u->args = r_shader_uniform(shader, "args[0]");
+	u->timeshift = r_shader_uniform(shader, "timeshift");
+	u->width = r_shader_uniform(shader, "width");
+	u->width_exponent = r_shader_uniform(shader, "width_exponent");
+	u->span = r_shader_uniform(shader, "span");
+}
+
+static LaserUniforms* laser_uniforms(ShaderProgram *shader) {
+	for(uint i = 0; i < NUM_BUILTIN_RULES; ++i) {
+		if(lasers.uniforms_builtin[i].shader == shader) {
+			return lasers.uniforms_builtin + i;
+		}
+	}
+
+	if(lasers.uniforms_custom.shader != shader) {
+		laser_uniforms_resolve(&lasers.uniforms_custom, shader);
+	}
+
+	return &lasers.uniforms_custom;
+}
+
 void lasers_preload(void) {
 	preload_resources(RES_SHADER_PROGRAM, RESF_DEFAULT,
-		"blur25",
-		"blur5",
 		"laser_generic",
 	NULL);
 
+	for(uint i = 0; i < NUM_BUILTIN_RULES; ++i) {
+		preload_resource(RES_SHADER_PROGRAM, builtin_rules[i].shader, RESF_OPTIONAL);
+	}
+
 	size_t sz_vert = sizeof(GenericModelVertex);
 	size_t sz_attr = sizeof(LaserInstancedAttribs);
 
@@ -60,7 +139,7 @@ void lasers_preload(void) {
 	#undef VERTEX_OFS
 	#undef INSTANCE_OFS
 
-	lasers.vbuf = r_vertex_buffer_create(sizeof(LaserInstancedAttribs) * 4096, NULL);
+	lasers.vbuf = r_vertex_buffer_create_streaming(sizeof(LaserInstancedAttribs) * 4096);
 	r_vertex_buffer_set_debug_label(lasers.vbuf, "Lasers vertex buffer");
 
 	lasers.varr = r_vertex_array_create();
@@ -90,6 +169,13 @@ void lasers_preload(void) {
 	lasers.quad_generic.vertex_array = lasers.varr;
 
 	lasers.shader_generic = r_shader_get("laser_generic");
+	lasers.curve_tex = get_tex("part/lasercurve");
+	laser_uniforms_resolve(&lasers.uniforms_generic, lasers.shader_generic);
+
+	for(uint i = 0; i < NUM_BUILTIN_RULES; ++i) {
+		lasers.builtin_shaders[i] = r_shader_get_optional(builtin_rules[i].shader);
+		laser_uniforms_resolve(lasers.uniforms_builtin + i, lasers.builtin_shaders[i]);
+	}
 }
 
 void lasers_free(void) {
@@ -97,6 +183,23 @@ void lasers_free(void) {
 	r_vertex_buffer_destroy(lasers.vbuf);
 	ent_unhook_pre_draw(lasers_ent_predraw_hook);
 	ent_unhook_post_draw(lasers_ent_postdraw_hook);
+
+	memset(lasers.builtin_shaders, 0, sizeof(lasers.builtin_shaders));
+	memset(lasers.uniforms_builtin, 0, sizeof(lasers.uniforms_builtin));
+	memset(&lasers.uniforms_generic, 0, sizeof(lasers.uniforms_generic));
+	memset(&lasers.uniforms_custom, 0, sizeof(lasers.uniforms_custom));
+	free(lasers.curve_cache.points);
+	memset(&lasers.curve_cache, 0, sizeof(lasers.curve_cache));
+}
+
+ShaderProgram *laser_rule_shader(LaserPosRule rule) {
+	for(uint i = 0; i < NUM_BUILTIN_RULES; ++i) {
+		if(builtin_rules[i].rule == rule) {
+			return lasers.builtin_shaders[i];
+		}
+	}
+
+	return NULL;
 }
 
 static void ent_draw_laser(EntityInterface *ent);
@@ -126,6 +229,7 @@ Laser *create_laser(complex pos, float time, float deathtime, const Color *color
 	l->timeshift = 0;
 	l->dead = false;
 	l->unclearable = false;
+	l->curve_cache.generation = 0;
 
 	l->ent.draw_layer = LAYER_LASER_HIGH;
 	l->ent.draw_func = ent_draw_laser;
@@ -136,6 +240,11 @@ Laser *create_laser(complex pos, float time, float deathtime, const Color *color
 
 	l->prule(l, EVENT_BIRTH);
 
+	if(l->shader == NULL) {
+		// Stages may still override this with a shader of their own.
+		l->shader = laser_rule_shader(prule);
+	}
+
 	return l;
 }
 
@@ -183,15 +292,17 @@ static void draw_laser_curve_specialized(Laser *l) {
 		return;
 	}
 
+	LaserUniforms *u = laser_uniforms(l->shader);
+
 	r_shader_ptr(l->shader);
 	r_color(&l->color);
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_vec2_complex("origin", l->pos);
-	r_uniform_vec2_array_complex("args[0]", 0, 4, l->args);
-	r_uniform_float("timeshift", timeshift);
-	r_uniform_float("width", l->width);
-	r_uniform_float("width_exponent", l->width_exponent);
-	r_uniform_int("span", instances);
+	r_uniform_sampler(u->tex, lasers.curve_tex);
+	r_uniform_vec2_complex(u->origin, l->pos);
+	r_uniform_vec2_array_complex(u->args, 0, 4, l->args);
+	r_uniform_float(u->timeshift, timeshift);
+	r_uniform_float(u->width, l->width);
+	r_uniform_float(u->width_exponent, l->width_exponent);
+	r_uniform_int(u->span, instances);
 	r_draw_quad_instanced(instances);
 }
 
@@ -203,16 +314,28 @@ static void draw_laser_curve_generic(Laser *l) {
 		return;
 	}
 
+	LaserUniforms *u = &lasers.uniforms_generic;
+
 	r_shader_ptr(lasers.shader_generic);
 	r_color(&l->color);
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_float("timeshift", timeshift);
-	r_uniform_float("width", l->width);
-	r_uniform_float("width_exponent", l->width_exponent);
-	r_uniform_int("span", instances);
+	r_uniform_sampler(u->tex, lasers.curve_tex);
+	r_uniform_float(u->timeshift, timeshift);
+	r_uniform_float(u->width, l->width);
+	r_uniform_float(u->width_exponent, l->width_exponent);
+	r_uniform_int(u->span, instances);
 
 	SDL_RWops *stream = r_vertex_buffer_get_stream(lasers.vbuf);
-	r_vertex_buffer_invalidate(lasers.vbuf);
+
+	// Every invalidation fences the data written so far, so lasers are appended to the buffer
+	// until it's full, like sprites are. Without base instances, every draw has to start at the
+	// beginning of the buffer, though.
+	if(
+		!r_supports(RFEAT_DRAW_INSTANCED_BASE_INSTANCE) ||
+		SDL_RWsize(stream) - SDL_RWtell(stream) < sizeof(LaserInstancedAttribs) * instances
+	) {
+		r_vertex_buffer_invalidate(lasers.vbuf);
+		lasers.base_instance = 0;
+	}
 
 	for(uint i = 0; i < instances; ++i) {
 		complex pos = l->prule(l, i * 0.5 + timeshift);
@@ -226,7 +349,8 @@ static void draw_laser_curve_generic(Laser *l) {
 		SDL_RWwrite(stream, &attr, sizeof(attr), 1);
 	}
 
-	r_draw_model_ptr(&lasers.quad_generic, instances, 0);
+	r_draw_model_ptr(&lasers.quad_generic, instances, lasers.base_instance);
+	lasers.base_instance += instances;
 }
 
 static void ent_draw_laser(EntityInterface *ent) {
@@ -259,48 +383,27 @@ static void lasers_ent_predraw_hook(EntityInterface *ent, void *arg) {
 			return;
 		}
 
-		FBPair *fbpair = stage_get_fbpair(FBPAIR_FG_AUX);
+		PROFILE_SCOPE("lasers_glow");
 
 		r_framebuffer(lasers.saved_fb);
 		r_state_push();
+		stage_glow_set_source(lasers.render_fb);
+
+		Framebuffer *glow;
 
 		if(pp_quality > 1) {
 			// Ambient glow pass (large kernel)
-			r_framebuffer(fbpair->back);
-			r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 0), 1);
-			r_shader("blur25");
-			r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
-			r_uniform_vec2("blur_direction", 1, 0);
-			draw_framebuffer_tex(lasers.render_fb, VIEWPORT_W, VIEWPORT_H);
-			fbpair_swap(fbpair);
+			glow = stage_glow_blur(0, GLOW_KERNEL_25, 1);
 			r_framebuffer(lasers.saved_fb);
-			r_uniform_vec2("blur_direction", 0, 1);
-			draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
-		}
-
-		// Smoothed laser curves pass (small kernel)
-		r_framebuffer(fbpair->back);
-		r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 0), 1);
-		r_shader("blur5");
-		r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
-		r_uniform_vec2("blur_direction", 1, 0);
-		draw_framebuffer_tex(lasers.render_fb, VIEWPORT_W, VIEWPORT_H);
-		fbpair_swap(fbpair);
-		r_uniform_vec2("blur_direction", 0, 1);
-
-		if(pp_quality < 2) {
-			// Since the aux framebuffers are smaller in this case, it's actually
-			// a bit faster to finish the blur pass there, and then blend it onto
-			// the main Framebuffer.
-			r_framebuffer(fbpair->back);
-			r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 0), 1);
-			draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
-			fbpair_swap(fbpair);
 			r_shader_standard();
+			draw_framebuffer_tex(glow, VIEWPORT_W, VIEWPORT_H);
 		}
 
+		// Smoothed laser curves pass (small kernel)
+		glow = stage_glow_blur(0, GLOW_KERNEL_5, 1);
 		r_framebuffer(lasers.saved_fb);
-		draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
+		r_shader_standard();
+		draw_framebuffer_tex(glow, VIEWPORT_W, VIEWPORT_H);
 
 		r_state_pop();
 		lasers.saved_fb = NULL;
@@ -346,6 +449,8 @@ bool clear_laser(LaserList *laserlist, Laser *l, bool force, bool now) {
 static bool collision_laser_curve(Laser *l);
 
 void process_lasers(void) {
+	PROFILE_SCOPE("process_lasers");
+
 	Laser *laser = global.lasers.first, *del = NULL;
 
 	while(laser != NULL) {
@@ -365,7 +470,7 @@ void process_lasers(void) {
 
 				if(kill_now) {
 					PARTICLE(
-						.sprite = "flare",
+						.sprite_ptr = get_sprite_interned("part/flare"),
 						.pos = p,
 						.timeout = 20,
 						.draw_rule = GrowFade
@@ -393,6 +498,86 @@ void process_lasers(void) {
 	}
 }
 
+/*
+ * Samples the curve of [l] at t_begin, t_begin + collision_step, ... up to (and including) t_stop,
+ * plus one extra point at t_stop itself, exactly like the loops below step through it. The
+ * returned pointer is only valid until the next call.
+ *
+ * For the built-in rules, which only depend on pos and args, the samples are reused until the end
+ * of the frame, unless any of those change. Custom rules may depend on anything, so their curves
+ * are sampled every time.
+ */
+static const complex *laser_curve_points(Laser *l, float t_begin, float t_stop) {
+	if(lasers.curve_cache.frame != global.frames || lasers.curve_cache.generation == 0) {
+		lasers.curve_cache.frame = global.frames;
+		lasers.curve_cache.num = 0;
+
+		if(++lasers.curve_cache.generation == 0) {
+			++lasers.curve_cache.generation;
+		}
+	}
+
+	bool cacheable = false;
+
+	for(uint i = 0; i < NUM_BUILTIN_RULES; ++i) {
+		if(builtin_rules[i].rule == l->prule) {
+			cacheable = true;
+			break;
+		}
+	}
+
+	if(
+		cacheable &&
+		l->curve_cache.generation == lasers.curve_cache.generation &&
+		l->curve_cache.t_begin == t_begin &&
+		l->curve_cache.t_stop == t_stop &&
+		l->curve_cache.step == l->collision_step &&
+		l->curve_cache.pos == l->pos &&
+		!memcmp(l->curve_cache.args, l->args, sizeof(l->args))
+	) {
+		return lasers.curve_cache.points + l->curve_cache.offset;
+	}
+
+	uint num = 2;
+
+	for(float t = t_begin + l->collision_step; t <= t_stop; t += l->collision_step) {
+		++num;
+	}
+
+	if(lasers.curve_cache.num + num > lasers.curve_cache.capacity) {
+		lasers.curve_cache.capacity = topow2_u32(lasers.curve_cache.num + num);
+		lasers.curve_cache.points = realloc(lasers.curve_cache.points, lasers.curve_cache.capacity * sizeof(*lasers.curve_cache.points));
+	}
+
+	complex *points = lasers.curve_cache.points + lasers.curve_cache.num;
+	uint i = 0;
+
+	points[i++] = l->prule(l, t_begin);
+
+	for(float t = t_begin + l->collision_step; t <= t_stop; t += l->collision_step) {
+		points[i++] = l->prule(l, t);
+	}
+
+	points[i++] = l->prule(l, t_stop);
+	assert(i == num);
+
+	if(!cacheable) {
+		// Overwritten by the next call.
+		return points;
+	}
+
+	l->curve_cache.pos = l->pos;
+	memcpy(l->curve_cache.args, l->args, sizeof(l->args));
+	l->curve_cache.offset = lasers.curve_cache.num;
+	l->curve_cache.generation = lasers.curve_cache.generation;
+	l->curve_cache.t_begin = t_begin;
+	l->curve_cache.t_stop = t_stop;
+	l->curve_cache.step = l->collision_step;
+	lasers.curve_cache.num += num;
+
+	return points;
+}
+
 static bool collision_laser_curve(Laser *l) {
 	if(l->width <= 3.0) {
 		return false;
@@ -407,7 +592,8 @@ static bool collision_laser_curve(Laser *l) {
 		t = 0;
 	}
 
-	LineSegment segment = { .a = l->prule(l,t) };
+	const complex *points = laser_curve_points(l, t, min(t_end, t_death));
+	LineSegment segment = { .a = *points++ };
 	Circle collision_area = { .origin = global.plr.pos };
 
 	for(t += l->collision_step; t <= min(t_end,t_death); t += l->collision_step) {
@@ -416,7 +602,7 @@ static bool collision_laser_curve(Laser *l) {
 		float widthfac = -0.75 / pow(tail, 2) * (t1 - tail) * (t1 + tail);
 		widthfac = max(0.25, pow(widthfac, l->width_exponent));
 
-		segment.b = l->prule(l, t);
+		segment.b = *points++;
 		collision_area.radius = widthfac * l->width * 0.5 + 1;
 
 		if(lineseg_circle_intersect(segment, collision_area) >= 0) {
@@ -436,7 +622,7 @@ static bool collision_laser_curve(Laser *l) {
 		segment.a = segment.b;
 	}
 
-	segment.b = l->prule(l, min(t_end, t_death));
+	segment.b = *points;
 	collision_area.radius = l->width * 0.5; // WTF: what is this sorcery?
 
 	return lineseg_circle_intersect(segment, collision_area) >= 0;
@@ -453,7 +639,8 @@ bool laser_intersects_circle(Laser *l, Circle circle) {
 		t = 0;
 	}
 
-	LineSegment segment = { .a = l->prule(l, t) };
+	const complex *points = laser_curve_points(l, t, min(t_end, t_death));
+	LineSegment segment = { .a = *points++ };
 	double orig_radius = circle.radius;
 
 	for(t += l->collision_step; t <= min(t_end, t_death); t += l->collision_step) {
@@ -462,7 +649,7 @@ bool laser_intersects_circle(Laser *l, Circle circle) {
 		float widthfac = -0.75 / pow(tail, 2) * (t1 - tail) * (t1 + tail);
 		widthfac = max(0.25, pow(widthfac, l->width_exponent));
 
-		segment.b = l->prule(l, t);
+		segment.b = *points++;
 		circle.radius = orig_radius + widthfac * l->width * 0.5 + 1;
 
 		if(lineseg_circle_intersect(segment, circle) >= 0) {
@@ -472,7 +659,7 @@ bool laser_intersects_circle(Laser *l, Circle circle) {
 		segment.a = segment.b;
 	}
 
-	segment.b = l->prule(l, min(t_end, t_death));
+	segment.b = *points;
 	circle.radius = orig_radius + l->width * 0.5; // WTF: what is this sorcery?
 
 	return lineseg_circle_intersect(segment, circle) >= 0;
@@ -480,7 +667,6 @@ bool laser_intersects_circle(Laser *l, Circle circle) {
 
 complex las_linear(Laser *l, float t) {
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/linear");
 		l->collision_step = max(3,l->timespan/10);
 		return 0;
 	}
@@ -490,7 +676,6 @@ complex las_linear(Laser *l, float t) {
 
 complex las_accel(Laser *l, float t) {
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/accelerated");
 		return 0;
 	}
 
@@ -502,7 +687,6 @@ complex las_weird_sine(Laser *l, float t) {             // [0] = velocity; [1] =
 	// do we even still need this?
 
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/weird_sine");
 		return 0;
 	}
 
@@ -514,7 +698,6 @@ complex las_sine(Laser *l, float t) {               // [0] = velocity; [1] = sin
 	// this is actually shaped like a sine wave
 
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/sine");
 		return 0;
 	}
 
@@ -533,7 +716,6 @@ complex las_sine_expanding(Laser *l, float t) { // [0] = velocity; [1] = sine am
 	// XXX: this is also a "weird" one
 
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/sine_expanding");
 		return 0;
 	}
 
@@ -551,7 +733,6 @@ complex las_sine_expanding(Laser *l, float t) { // [0] = velocity; [1] = sine am
 
 complex las_turning(Laser *l, float t) { // [0] = vel0; [1] = vel1; [2] r: turn begin time, i: turn end time
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/turning");
 		return 0;
 	}
 
@@ -571,7 +752,6 @@ complex las_turning(Laser *l, float t) { // [0] = vel0; [1] = vel1; [2] r: turn
 
 complex las_circle(Laser *l, float t) {
 	if(t == EVENT_BIRTH) {
-		l->shader = r_shader_get_optional("lasers/circle");
 		return 0;
 	}
 
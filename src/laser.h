@@ -43,6 +43,18 @@ struct Laser {
 
 	float collision_step;
 
+	// Curve samples used for collision checks, shared by everything that tests against this laser
+	// in the same frame, as long as its shape doesn't change. Managed by laser.c.
+	struct {
+		complex pos;
+		complex args[4];
+		uint offset;
+		uint generation;
+		float t_begin;
+		float t_stop;
+		float step;
+	} curve_cache;
+
 	LaserPosRule prule;
 	LaserLogicRule lrule;
 
@@ -77,6 +89,9 @@ complex las_sine_expanding(Laser *l, float t);
 complex las_turning(Laser *l, float t);
 complex las_circle(Laser *l, float t);
 
+// Returns the shader that evaluates [rule] on the GPU, if it's one of the las_* rules above.
+ShaderProgram *laser_rule_shader(LaserPosRule rule);
+
 float laser_charge(Laser *l, int t, float charge, float width);
 void static_laser(Laser *l, int t);
 
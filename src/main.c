@@ -26,13 +26,17 @@
 #include "credits.h"
 #include "renderer/api.h"
 #include "taskmanager.h"
+#include "replay_verify.h"
+#include "profiler.h"
+#include "benchmark.h"
 
 static void taisei_shutdown(void) {
 	log_info("Shutting down");
 
 	taskmgr_global_shutdown();
+	profiler_shutdown();
 
-	if(!global.is_replay_verification) {
+	if(!global.is_headless) {
 		config_save();
 		progress_save();
 	}
@@ -139,6 +143,7 @@ int main(int argc, char **argv) {
 	Replay replay = {0};
 	int replay_idx = 0;
 	bool headless = false;
+	char *benchmark_output = NULL;
 
 	htutil_init();
 	init_log();
@@ -177,6 +182,11 @@ int main(int argc, char **argv) {
 		if(a.type == CLI_VerifyReplay) {
 			headless = true;
 		}
+	} else if(a.type == CLI_Benchmark) {
+		stage_init_benchmark_array();
+		headless = true;
+		benchmark_output = a.filename;
+		a.filename = NULL;
 	} else if(a.type == CLI_DumpVFSTree) {
 		vfs_setup(true);
 
@@ -197,6 +207,16 @@ int main(int argc, char **argv) {
 		vfs_shutdown();
 		free_cli_action(&a);
 		return 0;
+	} else if(a.type == CLI_VerifyReplays) {
+		int result = replay_verify_batch(argv[0], a.filename, a.jobs);
+		free_cli_action(&a);
+		return result;
+	} else if(a.type == CLI_BenchTaskManager) {
+		free_cli_action(&a);
+		return taskmgr_benchmark();
+	} else if(a.type == CLI_BenchHashtable) {
+		free_cli_action(&a);
+		return htutil_benchmark();
 	}
 
 	free_cli_action(&a);
@@ -207,8 +227,12 @@ int main(int argc, char **argv) {
 		env_set("SDL_AUDIODRIVER", "dummy", true);
 		env_set("SDL_VIDEODRIVER", "dummy", true);
 		env_set("TAISEI_RENDERER", "null", true);
-		env_set("TAISEI_NOPRELOAD", true, false);
-		env_set("TAISEI_PRELOAD_REQUIRED", false, false);
+
+		// Loading stalls would skew the benchmark results, so it preloads as usual.
+		if(a.type != CLI_Benchmark) {
+			env_set("TAISEI_NOPRELOAD", true, false);
+			env_set("TAISEI_PRELOAD_REQUIRED", false, false);
+		}
 	} else {
 		init_log_file();
 	}
@@ -222,6 +246,7 @@ int main(int argc, char **argv) {
 	init_sdl();
 	taskmgr_global_init();
 	time_init();
+	profiler_init();
 	init_global(&a);
 	events_init();
 	video_init();
@@ -243,7 +268,21 @@ int main(int argc, char **argv) {
 
 	atexit(taisei_shutdown);
 
-	if(a.type == CLI_PlayReplay || a.type == CLI_VerifyReplay) {
+	if(a.type == CLI_VerifyReplay) {
+		replay_verify_begin();
+		replay_play(&replay, replay_idx);
+		replay_verify_end();
+		replay_destroy(&replay);
+		return 0;
+	}
+
+	if(a.type == CLI_Benchmark) {
+		int result = benchmark_run(benchmark_output);
+		free(benchmark_output);
+		return result;
+	}
+
+	if(a.type == CLI_PlayReplay) {
 		replay_play(&replay, replay_idx);
 		replay_destroy(&replay);
 		return 0;
@@ -644,6 +644,16 @@ static void options_sub_controls(MenuData *parent, void *arg) {
 		bind_keybinding(CONFIG_KEY_RESTART)
 	);
 
+	add_menu_separator(m);
+
+	add_menu_entry(m, "Rewind the replay", do_nothing,
+		bind_keybinding(CONFIG_KEY_REPLAY_REWIND)
+	);
+
+	add_menu_entry(m, "Fast-forward the replay", do_nothing,
+		bind_keybinding(CONFIG_KEY_REPLAY_FORWARD)
+	);
+
 #ifdef DEBUG
 	add_menu_separator(m);
 
@@ -163,6 +163,58 @@ size_t objpool_object_size(ObjectPool *pool) {
 	return pool->size_of_object;
 }
 
+typedef struct ObjectPoolSnapshotHeader {
+	size_t usage;
+	size_t peak_usage;
+	size_t num_extents;
+	ObjectInterface *free_objects;
+} ObjectPoolSnapshotHeader;
+
+size_t objpool_snapshot_size(ObjectPool *pool) {
+	return sizeof(ObjectPoolSnapshotHeader) + pool->max_objects * pool->size_of_object * (1 + pool->num_extents);
+}
+
+void objpool_snapshot(ObjectPool *pool, void *buf) {
+	ObjectPoolSnapshotHeader *hdr = buf;
+	hdr->usage = pool->usage;
+	hdr->peak_usage = pool->peak_usage;
+	hdr->num_extents = pool->num_extents;
+	hdr->free_objects = pool->free_objects;
+
+	size_t subpool_size = pool->max_objects * pool->size_of_object;
+	char *data = (char*)(hdr + 1);
+
+	memcpy(data, pool->objects, subpool_size);
+
+	for(size_t i = 0; i < pool->num_extents; ++i) {
+		memcpy(data + (i + 1) * subpool_size, pool->extents[i], subpool_size);
+	}
+}
+
+void objpool_restore(ObjectPool *pool, const void *buf) {
+	const ObjectPoolSnapshotHeader *hdr = buf;
+	assert(hdr->num_extents <= pool->num_extents);
+
+	pool->usage = hdr->usage;
+	pool->peak_usage = hdr->peak_usage;
+	pool->free_objects = hdr->free_objects;
+
+	size_t subpool_size = pool->max_objects * pool->size_of_object;
+	const char *data = (const char*)(hdr + 1);
+
+	memcpy(pool->objects, data, subpool_size);
+
+	for(size_t i = 0; i < hdr->num_extents; ++i) {
+		memcpy(pool->extents[i], data + (i + 1) * subpool_size, subpool_size);
+	}
+
+	// Extents added after the snapshot was taken had nothing in use back then.
+	for(size_t i = hdr->num_extents; i < pool->num_extents; ++i) {
+		memset(pool->extents[i], 0, subpool_size);
+		objpool_register_objects(pool, pool->extents[i]);
+	}
+}
+
 void objpool_get_stats(ObjectPool *pool, ObjectPoolStats *stats) {
 	stats->tag = pool->tag;
 	stats->capacity = pool->max_objects * (1 + pool->num_extents);
@@ -76,4 +76,12 @@ void objpool_get_stats(ObjectPool *pool, ObjectPoolStats *stats);
 void objpool_memtest(ObjectPool *pool, ObjectInterface *object);
 size_t objpool_object_size(ObjectPool *pool);
 
+// Snapshots capture the complete state of a pool, objects included. Restoring one puts every object
+// back at its original address, so pointers between pooled objects remain valid. The pool may have
+// grown since the snapshot was taken, but it must be the same pool.
+// objpool_snapshot_size returns 0 if snapshots are not supported.
+size_t objpool_snapshot_size(ObjectPool *pool);
+void objpool_snapshot(ObjectPool *pool, void *buf);
+void objpool_restore(ObjectPool *pool, const void *buf);
+
 #endif // IGUARD_objectpool_h
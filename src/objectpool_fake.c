@@ -46,3 +46,16 @@ void objpool_memtest(ObjectPool *pool, ObjectInterface *object) {
 size_t objpool_object_size(ObjectPool *pool) {
 	return pool->size_of_object;
 }
+
+size_t objpool_snapshot_size(ObjectPool *pool) {
+	// Objects are scattered all over the heap, so there's nothing to snapshot.
+	return 0;
+}
+
+void objpool_snapshot(ObjectPool *pool, void *buf) {
+	UNREACHABLE;
+}
+
+void objpool_restore(ObjectPool *pool, const void *buf) {
+	UNREACHABLE;
+}
@@ -17,6 +17,7 @@
 #include "stagetext.h"
 #include "stagedraw.h"
 #include "entity.h"
+#include "enemygrid.h"
 
 void player_init(Player *plr) {
 	memset(plr, 0, sizeof(Player));
@@ -1080,6 +1081,10 @@ void player_preload(void) {
 
 // FIXME: where should this be?
 
+static bool homing_target_filter(Enemy *e, void *arg) {
+	return e->hp != ENEMY_IMMUNE;
+}
+
 complex plrutil_homing_target(complex org, complex fallback) {
 	double mindst = INFINITY;
 	complex target = fallback;
@@ -1089,17 +1094,10 @@ complex plrutil_homing_target(complex org, complex fallback) {
 		mindst = cabs(target - org);
 	}
 
-	for(Enemy *e = global.enemies.first; e; e = e->next) {
-		if(e->hp == ENEMY_IMMUNE) {
-			continue;
-		}
+	Enemy *e = enemygrid_find_nearest(org, &mindst, homing_target_filter, NULL);
 
-		double dst = cabs(e->pos - org);
-
-		if(dst < mindst) {
-			mindst = dst;
-			target = e->pos;
-		}
+	if(e) {
+		target = e->pos;
 	}
 
 	return target;
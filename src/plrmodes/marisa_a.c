@@ -13,6 +13,7 @@
 #include "marisa.h"
 #include "renderer/api.h"
 #include "stagedraw.h"
+#include "stagesnapshot.h"
 
 // args are pain
 static Enemy *laser_renderer;
@@ -574,6 +575,7 @@ static void marisa_laser_power(Player *plr, short npow) {
 static void marisa_laser_init(Player *plr) {
 	laser_renderer = create_enemy_p(&plr->slaves, 0, ENEMY_IMMUNE, marisa_laser_renderer_visual, marisa_laser_renderer, 0, 0, 0, 0);
 	laser_renderer->ent.draw_layer = LAYER_PLAYER_SHOT;
+	stage_snapshot_track(&laser_renderer, sizeof(laser_renderer));
 	marisa_laser_respawn_slaves(plr, plr->power);
 }
 
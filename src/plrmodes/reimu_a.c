@@ -11,6 +11,7 @@
 #include "global.h"
 #include "plrmodes.h"
 #include "reimu.h"
+#include "stagesnapshot.h"
 
 // FIXME: We probably need a better way to store shot-specific state.
 //        See also MarisaA.
@@ -608,6 +609,7 @@ static void reimu_spirit_respawn_slaves(Player *plr, short npow, complex param)
 static void reimu_spirit_init(Player *plr) {
 	memset(&reimu_spirit_state, 0, sizeof(reimu_spirit_state));
 	reimu_spirit_state.prev_inputflags = plr->inputflags;
+	stage_snapshot_track(&reimu_spirit_state, sizeof(reimu_spirit_state));
 	reimu_spirit_respawn_slaves(plr, plr->power, 0);
 	reimu_common_bomb_buffer_init();
 }
@@ -12,6 +12,7 @@
 #include "plrmodes.h"
 #include "reimu.h"
 #include "stagedraw.h"
+#include "stagesnapshot.h"
 
 #define GAP_LENGTH 128
 #define GAP_WIDTH 16
@@ -571,6 +572,7 @@ static void reimu_dream_init(Player *plr) {
 
 	gap_renderer= create_enemy_p(&plr->slaves, 0, ENEMY_IMMUNE, reimu_dream_gap_renderer_visual, reimu_dream_gap_renderer, 0, 0, 0, 0);
 	gap_renderer->ent.draw_layer = LAYER_PLAYER_FOCUS;
+	stage_snapshot_track(&gap_renderer, sizeof(gap_renderer));
 
 	int idx = 0;
 	FOR_EACH_GAP(gap) {
@@ -0,0 +1,456 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "ppgraph.h"
+#include "resource/resource.h"
+#include "resource/shader_object.h"
+#include "list.h"
+#include "util.h"
+#include "profiler.h"
+
+#define FUSED_SHADER_PATH SHOBJ_PATH_PREFIX "pp_fused.frag.glsl"
+
+struct PPFusedProgram {
+	LIST_INTERFACE(PPFusedProgram);
+	char *key;
+	ShaderObject *frag;
+	ShaderProgram *prog; // NULL if it couldn't be built
+};
+
+// What a rule pass did, or would do; see ppgraph_eval_rule.
+typedef struct PPRuleResult {
+	const char *filter_name;
+	PPFilterSetupFunc filter_setup;
+	bool skipped;
+} PPRuleResult;
+
+// State of the pass that's being run.
+static struct {
+	PPGraph *graph;
+	double width, height;
+	PPRuleResult result;
+} pprun;
+
+void ppgraph_init(PPGraph *g) {
+	memset(g, 0, sizeof(*g));
+}
+
+void ppgraph_destroy(PPGraph *g) {
+	for(PPFusedProgram *f = g->fused, *next; f; f = next) {
+		next = f->next;
+
+		if(f->prog) {
+			r_shader_program_destroy(f->prog);
+		}
+
+		if(f->frag) {
+			r_shader_object_destroy(f->frag);
+		}
+
+		free(f->key);
+		free(list_unlink(&g->fused, f));
+	}
+
+	memset(g, 0, sizeof(*g));
+}
+
+void ppgraph_invalidate(PPGraph *g) {
+	g->have_output = false;
+}
+
+bool ppgraph_begin(PPGraph *g, uint64_t version) {
+	if(version != PPGRAPH_ALWAYS && g->have_output && g->version == version) {
+		return false;
+	}
+
+	g->num_passes = 0;
+	g->version = version;
+	g->have_output = false;
+	return true;
+}
+
+static PPPass* ppgraph_add_pass(PPGraph *g, PPPassType type) {
+	if(g->num_passes == PPGRAPH_MAX_PASSES) {
+		log_fatal("Too many postprocessing passes");
+	}
+
+	PPPass *p = g->passes + g->num_passes++;
+	memset(p, 0, sizeof(*p));
+	p->type = type;
+	return p;
+}
+
+void ppgraph_add_source(PPGraph *g, PPGraphPassFunc func) {
+	ppgraph_add_pass(g, PP_PASS_SOURCE)->func = func;
+}
+
+void ppgraph_add_rule(PPGraph *g, PPGraphPassFunc func) {
+	ppgraph_add_pass(g, PP_PASS_RULE)->func = func;
+}
+
+void ppgraph_add_rules(PPGraph *g, PPGraphPassFunc *funcs) {
+	if(!funcs) {
+		return;
+	}
+
+	for(PPGraphPassFunc *f = funcs; *f; ++f) {
+		ppgraph_add_rule(g, *f);
+	}
+}
+
+void ppgraph_add_depth_pass(PPGraph *g, PPGraphPassFunc func) {
+	ppgraph_add_pass(g, PP_PASS_DEPTH)->func = func;
+}
+
+void ppgraph_add_overlay(PPGraph *g, PPGraphPassFunc func) {
+	ppgraph_add_pass(g, PP_PASS_OVERLAY)->func = func;
+}
+
+void ppgraph_add_postprocess(PPGraph *g, PostprocessShader *pp, PostprocessPrepareFuncPtr prepare) {
+	if(!pp) {
+		return;
+	}
+
+	PPPass *p = ppgraph_add_pass(g, PP_PASS_POSTPROCESS);
+	p->pp = pp;
+	p->prepare = prepare;
+}
+
+static const char* ppgraph_known_filter(PPGraph *g, PPGraphPassFunc func) {
+	for(uint i = 0; i < g->num_filters; ++i) {
+		if(g->filters[i].func == func) {
+			return g->filters[i].name;
+		}
+	}
+
+	return NULL;
+}
+
+static void ppgraph_learn_filter(PPGraph *g, PPGraphPassFunc func, const char *name) {
+	for(uint i = 0; i < g->num_filters; ++i) {
+		if(g->filters[i].func == func) {
+			if(name) {
+				g->filters[i].name = name;
+			} else {
+				g->filters[i] = g->filters[--g->num_filters];
+			}
+
+			return;
+		}
+	}
+
+	if(name && g->num_filters < PPGRAPH_MAX_PASSES) {
+		g->filters[g->num_filters].func = func;
+		g->filters[g->num_filters].name = name;
+		++g->num_filters;
+	}
+}
+
+static ShaderProgram* ppgraph_build_fused(PPGraph *g, uint num_filters, const char *names[num_filters], const char *key) {
+	GLSLMacro macros[num_filters + 2];
+	char *strings[num_filters + 1];
+	char *chain = NULL;
+
+	for(uint i = 0; i < num_filters; ++i) {
+		macros[i].name = strings[i] = strjoin("PP_FILTER_", names[i], NULL);
+		macros[i].value = "1";
+
+		char *step = strfmt("pp_color = pp_store(filter_%s(pp_color)); ", names[i]);
+		strappend(&chain, step);
+		free(step);
+	}
+
+	macros[num_filters].name = "PP_FILTER_CHAIN";
+	macros[num_filters].value = strings[num_filters] = chain;
+	macros[num_filters + 1].name = NULL;
+
+	ShaderSource src;
+	ShaderObject *objs[2] = { NULL };
+	ShaderProgram *prog = NULL;
+
+	// Loaded like the other shader objects, so that it matches standard.vert.
+	bool loaded = shader_object_load_glsl(FUSED_SHADER_PATH, SHADER_STAGE_FRAGMENT, macros, &src);
+
+	for(uint i = 0; i <= num_filters; ++i) {
+		free(strings[i]);
+	}
+
+	if(loaded) {
+		objs[0] = get_resource_data(RES_SHADER_OBJECT, "standard.vert", RESF_DEFAULT);
+		objs[1] = r_shader_object_compile(&src);
+		free(src.content);
+	}
+
+	if(objs[0] && objs[1]) {
+		prog = r_shader_program_link(2, objs);
+	}
+
+	if(prog) {
+		char label[128];
+		snprintf(label, sizeof(label), "Fused postprocess (%s)", key);
+		r_shader_program_set_debug_label(prog, label);
+		log_debug("Merged filters: %s", key);
+	} else {
+		log_warn("Couldn't merge filters %s, they will be applied one by one", key);
+	}
+
+	PPFusedProgram *f = calloc(1, sizeof(*f));
+	f->key = strdup(key);
+	f->frag = objs[1];
+	f->prog = prog;
+	list_push(&g->fused, f);
+
+	return prog;
+}
+
+static ShaderProgram* ppgraph_get_fused(PPGraph *g, uint num_filters, const char *names[num_filters]) {
+	char *key = NULL;
+
+	for(uint i = 0; i < num_filters; ++i) {
+		if(i > 0) {
+			strappend(&key, "+");
+		}
+
+		strappend(&key, (char*)names[i]);
+	}
+
+	ShaderProgram *prog = NULL;
+	bool found = false;
+
+	for(PPFusedProgram *f = g->fused; f; f = f->next) {
+		if(!strcmp(f->key, key)) {
+			prog = f->prog;
+			found = true;
+			break;
+		}
+	}
+
+	if(!found) {
+		prog = ppgraph_build_fused(g, num_filters, names, key);
+	}
+
+	free(key);
+	return prog;
+}
+
+// Calls the function of a rule pass. Filters and skips are only recorded, to be applied by
+// ppgraph_finish_rule or merged with other filters; a rule that does something else draws right
+// away.
+static PPRuleResult ppgraph_eval_rule(PPGraph *g, PPPass *p, FBPair *fbos) {
+	pprun.result = (PPRuleResult) { NULL };
+
+	r_framebuffer(fbos->back);
+	p->func(fbos->front);
+	ppgraph_learn_filter(g, p->func, pprun.result.skipped ? NULL : pprun.result.filter_name);
+
+	return pprun.result;
+}
+
+static void ppgraph_apply_filter(const char *name, PPFilterSetupFunc setup, Framebuffer *fb) {
+	r_shader(name);
+	setup(fb);
+	draw_framebuffer_tex(fb, pprun.width, pprun.height);
+	r_shader_standard();
+}
+
+// Finishes a pass that has already been evaluated, on its own.
+static void ppgraph_finish_rule(PPRuleResult *r, FBPair *fbos) {
+	if(r->skipped) {
+		return;
+	}
+
+	if(r->filter_name) {
+		r_framebuffer(fbos->back);
+		ppgraph_apply_filter(r->filter_name, r->filter_setup, fbos->front);
+	}
+
+	fbpair_swap(fbos);
+}
+
+static void ppgraph_run_rule(PPGraph *g, PPPass *p, FBPair *fbos) {
+	PROFILE_SCOPE("shader rule");
+	PPRuleResult r = ppgraph_eval_rule(g, p, fbos);
+	ppgraph_finish_rule(&r, fbos);
+}
+
+// Tries to run [num] adjacent filter passes as one. Returns false if they can't be merged;
+// nothing has been drawn then. If some of them no longer behave like filters, they are run one by
+// one instead, and every pass is still evaluated only once.
+static bool ppgraph_run_fused(PPGraph *g, PPPass *passes, uint num, FBPair *fbos, double width, double height) {
+	const char *names[num];
+
+	for(uint i = 0; i < num; ++i) {
+		names[i] = ppgraph_known_filter(g, passes[i].func);
+	}
+
+	ShaderProgram *prog = ppgraph_get_fused(g, num, names);
+
+	if(!prog) {
+		return false;
+	}
+
+	PROFILE_SCOPE("fused shader rules");
+
+	PPRuleResult results[num];
+	uint num_evaluated = 0;
+	bool ok = true;
+
+	while(num_evaluated < num && ok) {
+		PPRuleResult *r = results + num_evaluated;
+		*r = ppgraph_eval_rule(g, passes + num_evaluated, fbos);
+		ok = !r->skipped && r->filter_name && !strcmp(r->filter_name, names[num_evaluated]);
+		++num_evaluated;
+	}
+
+	if(!ok) {
+		PPRuleResult *last = results + num_evaluated - 1;
+
+		if(!last->skipped && !last->filter_name) {
+			// It drew by itself, from the image before the filters that precede it. Those are
+			// lost for this frame only, since it isn't considered a filter anymore.
+			fbpair_swap(fbos);
+		} else {
+			for(uint i = 0; i < num_evaluated; ++i) {
+				ppgraph_finish_rule(results + i, fbos);
+			}
+		}
+
+		for(uint i = num_evaluated; i < num; ++i) {
+			ppgraph_run_rule(g, passes + i, fbos);
+		}
+
+		return true;
+	}
+
+	r_framebuffer(fbos->back);
+	r_shader_ptr(prog);
+
+	for(uint i = 0; i < num; ++i) {
+		results[i].filter_setup(fbos->front);
+	}
+
+	draw_framebuffer_tex(fbos->front, width, height);
+	fbpair_swap(fbos);
+	r_shader_standard();
+	return true;
+}
+
+static void ppgraph_run_postprocess(PPPass *p, FBPair *fbos, double width, double height) {
+	ShaderProgram *shader_saved = r_shader_current();
+	BlendMode blend_saved = r_blend_current();
+
+	r_blend(BLEND_NONE);
+
+	for(PostprocessShader *pps = p->pp; pps; pps = pps->next) {
+		ShaderProgram *s = pps->shader;
+		profiler_zone_begin_detail("postprocess pass", r_shader_program_get_debug_label(s));
+
+		r_framebuffer(fbos->back);
+		r_shader_ptr(s);
+
+		if(p->prepare) {
+			p->prepare(fbos->back, s);
+		}
+
+		// NOTE: The backend compares these with the values it last uploaded, so setting them
+		// again every frame costs no GL calls. Not setting them would be wrong, since the same
+		// program can be used with other values elsewhere.
+		for(PostprocessShaderUniform *u = pps->uniforms; u; u = u->next) {
+			r_uniform_ptr_unsafe(u->uniform, 0, u->elements, u->values);
+		}
+
+		draw_framebuffer_tex(fbos->front, width, height);
+		fbpair_swap(fbos);
+		profiler_zone_end();
+	}
+
+	r_shader_ptr(shader_saved);
+	r_blend(blend_saved);
+}
+
+void ppgraph_run(PPGraph *g, FBPair *fbos, double width, double height) {
+	assert(pprun.graph == NULL);
+	pprun.graph = g;
+	pprun.width = width;
+	pprun.height = height;
+
+	for(uint i = 0; i < g->num_passes;) {
+		PPPass *p = g->passes + i;
+
+		switch(p->type) {
+			case PP_PASS_SOURCE:
+				r_framebuffer(fbos->back);
+				p->func(fbos->front);
+				fbpair_swap(fbos);
+				++i;
+				break;
+
+			case PP_PASS_DEPTH:
+				r_framebuffer(fbos->back);
+				p->func(fbos->front);
+				++i;
+				break;
+
+			case PP_PASS_OVERLAY:
+				r_framebuffer(fbos->front);
+				p->func(fbos->front);
+				++i;
+				break;
+
+			case PP_PASS_POSTPROCESS:
+				ppgraph_run_postprocess(p, fbos, width, height);
+				++i;
+				break;
+
+			case PP_PASS_RULE: {
+				uint num = 0;
+
+				while(
+					i + num < g->num_passes &&
+					p[num].type == PP_PASS_RULE &&
+					ppgraph_known_filter(g, p[num].func)
+				) {
+					++num;
+				}
+
+				if(num > 1 && ppgraph_run_fused(g, p, num, fbos, width, height)) {
+					i += num;
+					break;
+				}
+
+				// Either not a filter, or it has to be applied on its own.
+				num = imax(1, num);
+
+				for(uint j = 0; j < num; ++j) {
+					ppgraph_run_rule(g, p + j, fbos);
+				}
+
+				i += num;
+				break;
+			}
+
+			default: UNREACHABLE;
+		}
+	}
+
+	g->have_output = true;
+	pprun.graph = NULL;
+}
+
+void ppgraph_skip_pass(void) {
+	assert(pprun.graph != NULL);
+	pprun.result.skipped = true;
+}
+
+void ppgraph_filter(Framebuffer *fb, const char *name, PPFilterSetupFunc setup) {
+	assert(pprun.graph != NULL);
+	pprun.result.filter_name = name;
+	pprun.result.filter_setup = setup;
+}
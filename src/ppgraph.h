@@ -0,0 +1,126 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_ppgraph_h
+#define IGUARD_ppgraph_h
+
+#include "taisei.h"
+
+#include "resource/postprocess.h"
+#include "util/graphics.h"
+
+/*
+ * Postprocessing graph.
+ *
+ * Describes a chain of full-screen passes over an FBPair, and does the ping-pong between its two
+ * framebuffers. The chain is described anew every frame (ppgraph_begin, ppgraph_add_*, then
+ * ppgraph_run), and the graph uses what it has seen on previous frames to do less work:
+ *
+ *   - If the input version passed to ppgraph_begin is the same as last time, the output of the
+ *     previous run is still in the front buffer, and nothing has to be drawn at all.
+ *
+ *   - Passes that would only copy their input can call ppgraph_skip_pass instead of drawing.
+ *
+ *   - Overlay passes draw on top of the current image in place, instead of copying it first.
+ *
+ *   - Passes that apply a per-pixel filter (see ppgraph_filter) are merged with adjacent ones into
+ *     a single pass. The shader for it is generated from res/shader/pp_fused.frag.glsl, which
+ *     lists the filters that can be merged.
+ *
+ * Pass functions have the same signature as ShaderRule. They are called with the current image,
+ * and with the framebuffer to draw into already bound, unless noted otherwise.
+ */
+
+#define PPGRAPH_MAX_PASSES 16
+
+// Input version that never matches, for images that are redrawn every frame anyway.
+#define PPGRAPH_ALWAYS UINT64_MAX
+
+typedef void (*PPGraphPassFunc)(Framebuffer *fb);
+typedef void (*PPFilterSetupFunc)(Framebuffer *fb);
+
+typedef enum PPPassType {
+	PP_PASS_SOURCE,
+	PP_PASS_RULE,
+	PP_PASS_DEPTH,
+	PP_PASS_OVERLAY,
+	PP_PASS_POSTPROCESS,
+} PPPassType;
+
+typedef struct PPPass {
+	PPPassType type;
+	PPGraphPassFunc func;
+	PostprocessShader *pp;
+	PostprocessPrepareFuncPtr prepare;
+} PPPass;
+
+typedef struct PPFusedProgram PPFusedProgram;
+
+typedef struct PPGraph {
+	PPPass passes[PPGRAPH_MAX_PASSES];
+	uint num_passes;
+
+	uint64_t version;
+	bool have_output;
+
+	// Passes that called ppgraph_filter the last time they ran.
+	struct {
+		PPGraphPassFunc func;
+		const char *name;
+	} filters[PPGRAPH_MAX_PASSES];
+	uint num_filters;
+
+	PPFusedProgram *fused;
+} PPGraph;
+
+void ppgraph_init(PPGraph *g) attr_nonnull(1);
+void ppgraph_destroy(PPGraph *g) attr_nonnull(1);
+
+// Forgets the previous output, e.g. because the framebuffers were resized.
+void ppgraph_invalidate(PPGraph *g) attr_nonnull(1);
+
+// Starts describing the chain for this frame. Returns false if [version] is the same as that of
+// the previous run, in which case its output can be used as is, and the chain needn't be run.
+bool ppgraph_begin(PPGraph *g, uint64_t version) attr_nonnull(1);
+
+// Draws a new image from scratch.
+void ppgraph_add_source(PPGraph *g, PPGraphPassFunc func) attr_nonnull(1, 2);
+
+// Draws a new image based on the current one.
+void ppgraph_add_rule(PPGraph *g, PPGraphPassFunc func) attr_nonnull(1, 2);
+void ppgraph_add_rules(PPGraph *g, PPGraphPassFunc *funcs) attr_nonnull(1);
+
+// Only writes depth; the color of the current image stays where it is.
+void ppgraph_add_depth_pass(PPGraph *g, PPGraphPassFunc func) attr_nonnull(1, 2);
+
+// Draws on top of the current image. [fb] is the bound framebuffer here, so don't sample it.
+void ppgraph_add_overlay(PPGraph *g, PPGraphPassFunc func) attr_nonnull(1, 2);
+
+// Runs every shader of a postprocessing pipeline as a rule. [prepare] may set uniforms that
+// change every frame; it must not touch the ones defined in the pipeline file.
+void ppgraph_add_postprocess(PPGraph *g, PostprocessShader *pp, PostprocessPrepareFuncPtr prepare) attr_nonnull(1);
+
+// Runs the chain; the result ends up in the front buffer of [fbos].
+void ppgraph_run(PPGraph *g, FBPair *fbos, double width, double height) attr_nonnull(1, 2);
+
+/*
+ * These may only be called from rule passes.
+ */
+
+// Leaves the current image as it is, as if the pass had copied it.
+void ppgraph_skip_pass(void);
+
+// Applies a per-pixel filter to [fb] once the rule returns. It's defined as filter_<name> in
+// res/shader/lib/filter/<name>.glslh, which is also wrapped in a standalone shader program of
+// the same name. [setup] sets the uniforms of the filter on the bound program, and may be called
+// after the rule has returned. [name] must be a string literal.
+//
+// A rule that calls this should do nothing else, so that it can be merged with its neighbours.
+void ppgraph_filter(Framebuffer *fb, const char *name, PPFilterSetupFunc setup) attr_nonnull(1, 2, 3);
+
+#endif // IGUARD_ppgraph_h
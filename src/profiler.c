@@ -0,0 +1,281 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "profiler.h"
+#include "hirestime.h"
+#include "util.h"
+#include "vfs/public.h"
+
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_DETAIL_SIZE 32
+
+typedef struct ProfilerEvent {
+	const char *name;
+	hrtime_t begin;
+	hrtime_t end;
+	char detail[PROFILER_DETAIL_SIZE];
+} ProfilerEvent;
+
+typedef struct ProfilerThread ProfilerThread;
+
+struct ProfilerThread {
+	ProfilerThread *next;
+	SDL_threadID tid;
+	bool is_main;
+
+	// Only touched by the owning thread.
+	struct {
+		const char *name;
+		hrtime_t begin;
+		char detail[PROFILER_DETAIL_SIZE];
+	} stack[PROFILER_MAX_DEPTH];
+	uint depth;
+
+	// Total number of events ever written; the ring holds the last [capacity] of them.
+	// Written by the owning thread only, read by the dumper.
+	SDL_atomic_t num_written;
+	ProfilerEvent events[];
+};
+
+static struct {
+	bool enabled;
+	uint capacity;
+	SDL_TLSID tls;
+	SDL_mutex *threads_mutex;
+	ProfilerThread *threads;
+	hrtime_t start_time;
+} profiler;
+
+void profiler_init(void) {
+	profiler.enabled = env_get("TAISEI_PROFILE", false);
+
+	if(!profiler.enabled) {
+		return;
+	}
+
+	// Round up to a power of two, so that indices can just be masked.
+	uint requested = imax(1024, env_get("TAISEI_PROFILE_EVENTS", 1 << 18));
+	profiler.capacity = topow2_u32(requested);
+
+	profiler.tls = SDL_TLSCreate();
+	profiler.threads_mutex = SDL_CreateMutex();
+
+	if(!profiler.tls || !profiler.threads_mutex) {
+		log_warn("Profiler initialization failed: %s", SDL_GetError());
+		profiler.enabled = false;
+		return;
+	}
+
+	profiler.start_time = time_get();
+	log_info("Profiling enabled, keeping up to %u events per thread", profiler.capacity);
+}
+
+static ProfilerThread* profiler_get_thread(void) {
+	ProfilerThread *thr = SDL_TLSGet(profiler.tls);
+
+	if(thr != NULL) {
+		return thr;
+	}
+
+	// Never freed until shutdown, even if the thread exits, so that its events still get dumped.
+	thr = calloc(1, sizeof(*thr) + profiler.capacity * sizeof(*thr->events));
+	thr->tid = SDL_ThreadID();
+	thr->is_main = is_main_thread();
+	SDL_TLSSet(profiler.tls, thr, NULL);
+
+	SDL_LockMutex(profiler.threads_mutex);
+	thr->next = profiler.threads;
+	profiler.threads = thr;
+	SDL_UnlockMutex(profiler.threads_mutex);
+
+	return thr;
+}
+
+static void profiler_push(const char *name, const char *detail) {
+	ProfilerThread *thr = profiler_get_thread();
+
+	if(thr->depth < PROFILER_MAX_DEPTH) {
+		thr->stack[thr->depth].name = name;
+
+		if(detail) {
+			strlcpy(thr->stack[thr->depth].detail, detail, PROFILER_DETAIL_SIZE);
+		} else {
+			*thr->stack[thr->depth].detail = 0;
+		}
+
+		// Take the time last, so that the bookkeeping above isn't attributed to the zone.
+		thr->stack[thr->depth].begin = time_get();
+	}
+
+	// Zones deeper than the limit aren't recorded, but still have to be counted, so that
+	// their ends match up.
+	++thr->depth;
+}
+
+void profiler_zone_begin(const char *name) {
+	if(profiler.enabled) {
+		profiler_push(name, NULL);
+	}
+}
+
+void profiler_zone_begin_detail(const char *name, const char *detail) {
+	if(profiler.enabled) {
+		profiler_push(name, detail);
+	}
+}
+
+void profiler_zone_end(void) {
+	if(!profiler.enabled) {
+		return;
+	}
+
+	hrtime_t end = time_get();
+	ProfilerThread *thr = profiler_get_thread();
+
+	if(thr->depth == 0) {
+		log_warn("Profiler zone ended without having begun");
+		return;
+	}
+
+	if(--thr->depth >= PROFILER_MAX_DEPTH) {
+		return;
+	}
+
+	uint idx = (uint)SDL_AtomicGet(&thr->num_written);
+	ProfilerEvent *e = thr->events + (idx & (profiler.capacity - 1));
+
+	e->name = thr->stack[thr->depth].name;
+	e->begin = thr->stack[thr->depth].begin;
+	e->end = end;
+	memcpy(e->detail, thr->stack[thr->depth].detail, PROFILER_DETAIL_SIZE);
+
+	// Publishes the event to the dumper.
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&thr->num_written, (int)(idx + 1));
+}
+
+static double to_usec(hrtime_t t) {
+	return t / (double)(HRTIME_RESOLUTION / 1000000);
+}
+
+static uint dump_thread(SDL_RWops *out, ProfilerThread *thr, uint thread_num, bool *first) {
+	uint mask = profiler.capacity - 1;
+	uint end = (uint)SDL_AtomicGet(&thr->num_written);
+	uint begin = end > profiler.capacity ? end - profiler.capacity : 0;
+
+	SDL_MemoryBarrierAcquire();
+
+	// Copy first, then check what the thread has overwritten in the meantime, if anything.
+	// Normally all other threads are idle by the time this runs, but not necessarily.
+	uint count = end - begin;
+	ProfilerEvent *events = calloc(imax(1, count), sizeof(*events));
+
+	for(uint i = 0; i < count; ++i) {
+		events[i] = thr->events[(begin + i) & mask];
+	}
+
+	SDL_MemoryBarrierAcquire();
+	uint now = (uint)SDL_AtomicGet(&thr->num_written);
+	uint first_valid = now > profiler.capacity ? now - profiler.capacity : 0;
+	uint skip = first_valid > begin ? imin(count, first_valid - begin) : 0;
+
+	SDL_RWprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+		*first ? "" : ",", thread_num
+	);
+	*first = false;
+
+	if(thr->is_main) {
+		SDL_RWwrite_json_string(out, "main");
+	} else {
+		char name[32];
+		snprintf(name, sizeof(name), "thread %lu", (ulong)thr->tid);
+		SDL_RWwrite_json_string(out, name);
+	}
+
+	SDL_RWprintf(out, "}}");
+
+	for(uint i = skip; i < count; ++i) {
+		ProfilerEvent *e = events + i;
+		SDL_RWprintf(out, ",\n{\"name\":");
+		SDL_RWwrite_json_string(out, e->name);
+		SDL_RWprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+			thread_num,
+			to_usec(e->begin - profiler.start_time),
+			to_usec(e->end - e->begin)
+		);
+
+		if(*e->detail) {
+			SDL_RWprintf(out, ",\"args\":{\"detail\":");
+			SDL_RWwrite_json_string(out, e->detail);
+			SDL_RWprintf(out, "}");
+		}
+
+		SDL_RWprintf(out, "}");
+	}
+
+	free(events);
+	return count - skip;
+}
+
+static void profiler_dump(void) {
+	SystemTime systime;
+	char timestamp[FILENAME_TIMESTAMP_MIN_BUF_SIZE];
+	get_system_time(&systime);
+	filename_timestamp(timestamp, sizeof(timestamp), systime);
+
+	char *path = strfmt("storage/trace_%s.json", timestamp);
+	SDL_RWops *out = vfs_open(path, VFS_MODE_WRITE);
+
+	if(!out) {
+		log_warn("Failed to open %s for writing: %s", path, vfs_get_error());
+		free(path);
+		return;
+	}
+
+	SDL_RWprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	bool first = true;
+	uint num_events = 0;
+	uint thread_num = 0;
+
+	SDL_LockMutex(profiler.threads_mutex);
+
+	for(ProfilerThread *thr = profiler.threads; thr; thr = thr->next) {
+		num_events += dump_thread(out, thr, ++thread_num, &first);
+	}
+
+	SDL_UnlockMutex(profiler.threads_mutex);
+
+	SDL_RWprintf(out, "\n]}\n");
+	SDL_RWclose(out);
+
+	char *syspath = vfs_repr(path, true);
+	log_info("Wrote %u profiler events from %u threads to %s", num_events, thread_num, syspath ? syspath : path);
+	free(syspath);
+	free(path);
+}
+
+void profiler_shutdown(void) {
+	if(!profiler.enabled) {
+		return;
+	}
+
+	profiler_dump();
+	profiler.enabled = false;
+
+	for(ProfilerThread *thr = profiler.threads, *next; thr; thr = next) {
+		next = thr->next;
+		free(thr);
+	}
+
+	profiler.threads = NULL;
+	SDL_DestroyMutex(profiler.threads_mutex);
+	profiler.threads_mutex = NULL;
+}
@@ -0,0 +1,61 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_profiler_h
+#define IGUARD_profiler_h
+
+#include "taisei.h"
+
+/*
+ * A simple hierarchical CPU profiler.
+ *
+ * Code marks interesting sections as zones, which may nest. When profiling is enabled (see
+ * TAISEI_PROFILE in ENVIRON.rst), every finished zone is recorded into a ring buffer owned by the
+ * thread it ran on, so recording never takes a lock. The most recent events of all threads are
+ * written to storage/ in the Chrome trace event format on shutdown; load the file in
+ * chrome://tracing or https://ui.perfetto.dev to look at it.
+ *
+ * Note that the zones around rendering code only measure how long it takes to submit the work,
+ * not how long the GPU takes to do it.
+ */
+
+void profiler_init(void);
+void profiler_shutdown(void);
+
+// Zone names must be string literals, or otherwise live until shutdown.
+void profiler_zone_begin(const char *name) attr_nonnull(1);
+
+// Same as above, but also attaches a short, arbitrary string to the zone (e.g. a resource name).
+// The string is copied, and may be truncated.
+void profiler_zone_begin_detail(const char *name, const char *detail) attr_nonnull(1, 2);
+
+// Ends the innermost zone of the calling thread.
+void profiler_zone_end(void);
+
+/*
+ * PROFILE_SCOPE(name)
+ *
+ * Begins a zone that ends automatically when the enclosing scope is left, however that happens.
+ * Without GNU extensions, it does nothing.
+ */
+#ifdef USE_GNU_EXTENSIONS
+	static inline void _profiler_scope_cleanup(attr_unused int *scope) {
+		profiler_zone_end();
+	}
+
+	#define _PROFILE_SCOPE_VAR2(line) _profile_scope_##line
+	#define _PROFILE_SCOPE_VAR(line) _PROFILE_SCOPE_VAR2(line)
+
+	#define PROFILE_SCOPE(name) \
+		__attribute__((cleanup(_profiler_scope_cleanup))) attr_unused int _PROFILE_SCOPE_VAR(__LINE__) = \
+			(profiler_zone_begin(name), 0)
+#else
+	#define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+#endif // IGUARD_profiler_h
@@ -14,6 +14,9 @@
 #include "global.h"
 #include "list.h"
 #include "stageobjects.h"
+#include "enemygrid.h"
+#include "projectile_batch.h"
+#include "profiler.h"
 
 ht_ptr2int_t shader_sublayer_map;
 
@@ -334,7 +337,15 @@ void delete_projectiles(ProjectileList *projlist) {
 	alist_foreach(projlist, _delete_projectile, NULL);
 }
 
-void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
+static bool enemy_is_not_immune(Enemy *e, void *arg) {
+	return e->hp != ENEMY_IMMUNE;
+}
+
+static bool projectile_in_viewport_hinted(Projectile *p, const bool *hint) {
+	return hint ? *hint : projectile_in_viewport(p);
+}
+
+static void calc_projectile_collision_hinted(Projectile *p, ProjCollisionResult *out_col, const bool *in_viewport_hint) {
 	assert(out_col != NULL);
 
 	out_col->type = PCOL_NONE;
@@ -384,14 +395,14 @@ void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
 			}
 		}
 	} else if(p->type == PlrProj) {
-		for(Enemy *e = global.enemies.first; e; e = e->next) {
-			if(e->hp != ENEMY_IMMUNE && cabs(e->pos - p->pos) < 30) {
-				out_col->type = PCOL_ENTITY;
-				out_col->entity = &e->ent;
-				out_col->fatal = true;
+		Enemy *e = enemygrid_find_first(p->pos, 30, enemy_is_not_immune, NULL);
 
-				return;
-			}
+		if(e) {
+			out_col->type = PCOL_ENTITY;
+			out_col->entity = &e->ent;
+			out_col->fatal = true;
+
+			return;
 		}
 
 		if(global.boss && cabs(global.boss->pos - p->pos) < 42) {
@@ -403,12 +414,16 @@ void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
 		}
 	}
 
-	if(out_col->type == PCOL_NONE && !projectile_in_viewport(p)) {
+	if(out_col->type == PCOL_NONE && !projectile_in_viewport_hinted(p, in_viewport_hint)) {
 		out_col->type = PCOL_VOID;
 		out_col->fatal = true;
 	}
 }
 
+void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
+	calc_projectile_collision_hinted(p, out_col, NULL);
+}
+
 void apply_projectile_collision(ProjectileList *projlist, Projectile *p, ProjCollisionResult *col) {
 	switch(col->type) {
 		case PCOL_NONE:
@@ -525,16 +540,64 @@ bool clear_projectile(ProjectileList *projlist, Projectile *proj, bool force, bo
 	return true;
 }
 
+static ProjBatch proj_batch;
+
+static void gather_projectile_batch(ProjBatch *batch, Projectile *first) {
+	projbatch_reset(batch);
+
+	for(Projectile *p = first; p; p = p->next) {
+		int t = global.frames - p->birthtime;
+		ProjBuiltinRule kind = projbatch_classify(p, t);
+
+		if(kind == PROJ_RULE_CUSTOM || !projbatch_add(batch, p, kind, t)) {
+			break;
+		}
+	}
+
+	projbatch_run(batch);
+}
+
 void process_projectiles(ProjectileList *projlist, bool collision) {
+	PROFILE_SCOPE("process_projectiles");
+
 	ProjCollisionResult col = { 0 };
+	ProjBatch *batch = &proj_batch;
 
 	char killed = 0;
 	int action;
 
+	projbatch_reset(batch);
+
 	for(Projectile *proj = projlist->first, *next; proj; proj = next) {
 		next = proj->next;
-		proj->prevpos = proj->pos;
-		action = proj_call_rule(proj, global.frames - proj->birthtime);
+
+		// Projectiles with built-in rules are advanced in bulk, a run at a time.
+		// Only the rule evaluation is batched; everything below still happens per-projectile,
+		// in list order. Runs never span a custom rule, which might look at or modify
+		// other projectiles.
+		if(batch->cursor == batch->num) {
+			gather_projectile_batch(batch, proj);
+		}
+
+		bool in_viewport;
+		const bool *in_viewport_hint = NULL;
+
+		if(batch->cursor < batch->num) {
+			uint idx = batch->cursor++;
+			assert(batch->objs[idx] == proj);
+			action = ACTION_NONE;
+
+			if(batch->times[idx] == 0) {
+				spawn_bullet_spawning_effect(proj);
+			}
+
+			if(projbatch_in_viewport(batch, idx, &in_viewport)) {
+				in_viewport_hint = &in_viewport;
+			}
+		} else {
+			proj->prevpos = proj->pos;
+			action = proj_call_rule(proj, global.frames - proj->birthtime);
+		}
 
 		if(proj->graze_counter && proj->graze_counter_reset_timer - global.frames <= -90) {
 			proj->graze_counter--;
@@ -547,7 +610,7 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 		}
 
 		if(collision) {
-			calc_projectile_collision(proj, &col);
+			calc_projectile_collision_hinted(proj, &col, in_viewport_hint);
 
 			if(col.fatal && col.type != PCOL_VOID) {
 				spawn_projectile_collision_effect(proj);
@@ -555,7 +618,7 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 		} else {
 			memset(&col, 0, sizeof(col));
 
-			if(!projectile_in_viewport(proj)) {
+			if(!projectile_in_viewport_hinted(proj, in_viewport_hint)) {
 				col.fatal = true;
 			}
 		}
@@ -737,8 +800,8 @@ static Projectile* spawn_projectile_highlight_effect_internal(Projectile *p, boo
 		sy = pow(p->sprite->h, 0.7);
 
 		PARTICLE(
-			.sprite = "stardust_green",
-			.shader = "sprite_bullet",
+			.sprite_ptr = get_sprite_interned("part/stardust_green"),
+			.shader_ptr = r_shader_interned("sprite_bullet"),
 			.size = p->size * 4.5,
 			.layer = LAYER_PARTICLE_HIGH | 0x40,
 			.draw_rule = ScaleSquaredFade,
@@ -756,9 +819,9 @@ static Projectile* spawn_projectile_highlight_effect_internal(Projectile *p, boo
 	clr.a = 0.2;
 
 	return PARTICLE(
-		.sprite = "bullet_cloud",
+		.sprite_ptr = get_sprite_interned("part/bullet_cloud"),
 		.size = p->size * 4.5,
-		.shader = "sprite_bullet",
+		.shader_ptr = r_shader_interned("sprite_bullet"),
 		.layer = LAYER_PARTICLE_HIGH | 0x80,
 		.draw_rule = bullet_highlight_draw,
 		.args = { 0.125 * (sx + I * sy), frand() * M_PI * 2 },
@@ -792,7 +855,7 @@ static void projectile_clear_effect_draw(Projectile *p, int t) {
 	float f = 1 - (1 - timefactor) * (1 - plrfactor);
 
 	Sprite spr = *p->sprite;
-	Sprite *ispr = get_sprite("item/bullet_point");
+	Sprite *ispr = get_sprite_interned("item/bullet_point");
 	spr.w = f * ispr->w + (1 - f) * spr.w;
 	spr.h = f * ispr->h + (1 - f) * spr.h;
 
@@ -841,7 +904,7 @@ Projectile* spawn_projectile_clear_effect(Projectile *proj) {
 
 	if(proj->shader == defaults_proj.shader_ptr) {
 		// HACK
-		shader = r_shader_get("sprite_bullet_dead");
+		shader = r_shader_interned("sprite_bullet_dead");
 		layer |= 0x1;
 	}
 
@@ -1016,7 +1079,7 @@ void petal_explosion(int n, complex pos) {
 		float t = frand();
 
 		PARTICLE(
-			.sprite = "petal",
+			.sprite_ptr = get_sprite_interned("part/petal"),
 			.pos = pos,
 			.color = RGBA(sin(5*t) * t, cos(5*t) * t, 0.5 * t, 0),
 			.rule = asymptotic,
@@ -0,0 +1,176 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "projectile_batch.h"
+#include "stage.h"
+
+enum {
+	// Minimum amount of projectiles per thread in the parallel passes
+	PROJ_BATCH_GRAIN = 256,
+};
+
+// NOTE: the kernels below must stay in sync with linear(), accelerated() and asymptotic()
+// in projectile.c. Keep the expressions in the same form (complex arithmetic and all),
+// otherwise the compiler may round differently and replays will desync.
+
+static void kernel_linear(ProjBatchLane *restrict l, uint begin, uint end) {
+	for(uint i = begin; i < end; ++i) {
+		l->angle[i] = carg(l->args0[i]);
+	}
+
+	for(uint i = begin; i < end; ++i) {
+		l->pos[i] = l->pos0[i] + l->args0[i]*l->t[i];
+	}
+}
+
+static void kernel_accelerated(ProjBatchLane *restrict l, uint begin, uint end) {
+	for(uint i = begin; i < end; ++i) {
+		l->angle[i] = carg(l->args0[i]);
+	}
+
+	for(uint i = begin; i < end; ++i) {
+		l->pos[i] += l->args0[i];
+		l->args0[i] += l->args1[i];
+	}
+}
+
+static void kernel_asymptotic(ProjBatchLane *restrict l, uint begin, uint end) {
+	for(uint i = begin; i < end; ++i) {
+		l->angle[i] = carg(l->args0[i]);
+	}
+
+	for(uint i = begin; i < end; ++i) {
+		l->args1[i] *= 0.8;
+		l->pos[i] += l->args0[i]*(l->args1[i] + 1);
+	}
+}
+
+static void (*const kernels[NUM_PROJ_BUILTIN_RULES])(ProjBatchLane *restrict l, uint begin, uint end) = {
+	[PROJ_RULE_LINEAR] = kernel_linear,
+	[PROJ_RULE_ACCELERATED] = kernel_accelerated,
+	[PROJ_RULE_ASYMPTOTIC] = kernel_asymptotic,
+};
+
+ProjBuiltinRule projbatch_classify(Projectile *p, int t) {
+	if(t < 0 || (p->timeout > 0 && t >= p->timeout)) {
+		// Events and timeouts are handled by proj_call_rule.
+		return PROJ_RULE_CUSTOM;
+	}
+
+	if(p->rule == linear) {
+		return PROJ_RULE_LINEAR;
+	}
+
+	if(p->rule == accelerated) {
+		return PROJ_RULE_ACCELERATED;
+	}
+
+	if(p->rule == asymptotic) {
+		return PROJ_RULE_ASYMPTOTIC;
+	}
+
+	return PROJ_RULE_CUSTOM;
+}
+
+void projbatch_reset(ProjBatch *batch) {
+	for(uint i = 0; i < NUM_PROJ_BUILTIN_RULES; ++i) {
+		batch->lanes[i].num = 0;
+	}
+
+	batch->num = 0;
+	batch->cursor = 0;
+}
+
+bool projbatch_add(ProjBatch *batch, Projectile *p, ProjBuiltinRule kind, int t) {
+	assert((uint)kind < NUM_PROJ_BUILTIN_RULES);
+
+	if(batch->num == PROJ_BATCH_SIZE) {
+		return false;
+	}
+
+	ProjBatchLane *l = batch->lanes + kind;
+	uint i = l->num++;
+
+	l->objs[i] = p;
+	l->pos[i] = p->pos;
+	l->pos0[i] = p->pos0;
+	l->args0[i] = p->args[0];
+	l->args1[i] = p->args[1];
+	l->t[i] = t;
+
+	batch->times[batch->num] = t;
+	batch->objs[batch->num++] = p;
+
+	return true;
+}
+
+typedef struct LaneJob {
+	ProjBatchLane *lane;
+	ProjBuiltinRule kind;
+} LaneJob;
+
+static void run_lane(uint begin, uint end, void *arg) {
+	LaneJob *job = arg;
+	ProjBatchLane *l = job->lane;
+
+	kernels[job->kind](l, begin, end);
+
+	for(uint i = begin; i < end; ++i) {
+		Projectile *p = l->objs[i];
+		p->prevpos = p->pos;
+		p->pos = l->pos[i];
+		p->args[0] = l->args0[i];
+		p->args[1] = l->args1[i];
+		p->angle = l->angle[i];
+	}
+}
+
+static void cull_batch(uint begin, uint end, void *arg) {
+	ProjBatch *batch = arg;
+
+	for(uint i = begin; i < end; ++i) {
+		Projectile *p = batch->objs[i];
+		batch->viewport_types[i] = p->type;
+		batch->viewport_pos[i] = p->pos;
+		batch->in_viewport[i] = projectile_in_viewport(p);
+	}
+}
+
+void projbatch_run(ProjBatch *batch) {
+	// Everything here only touches the batched projectiles themselves, so it's safe to
+	// spread over the logic worker threads. The results don't depend on how the work is split.
+
+	for(uint k = 0; k < NUM_PROJ_BUILTIN_RULES; ++k) {
+		LaneJob job = { batch->lanes + k, k };
+
+		if(job.lane->num > 0) {
+			stage_parallel_for(job.lane->num, PROJ_BATCH_GRAIN, run_lane, &job);
+		}
+	}
+
+	if(batch->num > 0) {
+		stage_parallel_for(batch->num, PROJ_BATCH_GRAIN, cull_batch, batch);
+	}
+}
+
+bool projbatch_in_viewport(ProjBatch *batch, uint idx, bool *out_in_viewport) {
+	assert(idx < batch->num);
+	Projectile *p = batch->objs[idx];
+
+	// Something may have touched the projectile since the batch ran, e.g. a bullet clear
+	// caused by an earlier collision. The test depends on the type, since particles are sized
+	// differently from bullets.
+	if(p->type != batch->viewport_types[idx] || p->pos != batch->viewport_pos[idx]) {
+		return false;
+	}
+
+	*out_in_viewport = batch->in_viewport[idx];
+	return true;
+}
@@ -0,0 +1,80 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_projectile_batch_h
+#define IGUARD_projectile_batch_h
+
+#include "taisei.h"
+
+#include "projectile.h"
+
+/*
+ * Structure-of-arrays staging area for projectiles driven by the built-in
+ * rules (linear, accelerated, asymptotic).
+ *
+ * process_projectiles gathers runs of consecutive projectiles that use these
+ * rules, advances the whole run with one tight loop per rule, and writes the
+ * results back. The viewport culling test is precomputed for the run as well.
+ * These passes are free of side effects and are spread over the logic worker
+ * threads (see stage_parallel_for).
+ *
+ * Everything else (collision, effects, deletion) is still done per-projectile
+ * and in list order on the main thread. The kernels evaluate exactly the same
+ * expressions as the rule functions, so the results are bit-identical.
+ */
+
+enum {
+	PROJ_BATCH_SIZE = 1024,
+};
+
+typedef enum ProjBuiltinRule {
+	PROJ_RULE_LINEAR,
+	PROJ_RULE_ACCELERATED,
+	PROJ_RULE_ASYMPTOTIC,
+	NUM_PROJ_BUILTIN_RULES,
+
+	PROJ_RULE_CUSTOM = NUM_PROJ_BUILTIN_RULES,
+} ProjBuiltinRule;
+
+// One lane per built-in rule
+typedef struct ProjBatchLane {
+	Projectile *objs[PROJ_BATCH_SIZE];
+	alignas(64) complex pos[PROJ_BATCH_SIZE];
+	alignas(64) complex pos0[PROJ_BATCH_SIZE];
+	alignas(64) complex args0[PROJ_BATCH_SIZE];
+	alignas(64) complex args1[PROJ_BATCH_SIZE];
+	alignas(64) float angle[PROJ_BATCH_SIZE];
+	alignas(64) int t[PROJ_BATCH_SIZE];
+	uint num;
+} ProjBatchLane;
+
+typedef struct ProjBatch {
+	ProjBatchLane lanes[NUM_PROJ_BUILTIN_RULES];
+
+	// All gathered projectiles, in list order
+	Projectile *objs[PROJ_BATCH_SIZE];
+	int times[PROJ_BATCH_SIZE];
+	bool in_viewport[PROJ_BATCH_SIZE];
+	ProjType viewport_types[PROJ_BATCH_SIZE];
+	complex viewport_pos[PROJ_BATCH_SIZE];
+	uint num;
+
+	// Index of the next projectile in objs to be consumed by process_projectiles
+	uint cursor;
+} ProjBatch;
+
+ProjBuiltinRule projbatch_classify(Projectile *p, int t);
+void projbatch_reset(ProjBatch *batch) attr_nonnull(1);
+bool projbatch_add(ProjBatch *batch, Projectile *p, ProjBuiltinRule kind, int t) attr_nonnull(1, 2);
+void projbatch_run(ProjBatch *batch) attr_nonnull(1);
+
+// Retrieves the result of the viewport test performed by projbatch_run for the idx-th projectile
+// in the batch. Returns false if that result is no longer valid, and the test must be redone.
+bool projbatch_in_viewport(ProjBatch *batch, uint idx, bool *out_in_viewport) attr_nonnull(1, 3);
+
+#endif // IGUARD_projectile_batch_h
@@ -13,6 +13,7 @@
 #include "common/matstack.h"
 #include "common/sprite_batch.h"
 #include "common/models.h"
+#include "common/shader_cache.h"
 #include "common/state.h"
 #include "util/glm.h"
 #include "util/graphics.h"
@@ -29,6 +30,7 @@ static struct {
 } R;
 
 void r_init(void) {
+	shader_cache_init();
 	_r_backend_init();
 }
 
@@ -73,6 +75,7 @@ void r_shutdown(void) {
 	_r_sprite_batch_shutdown();
 	_r_models_shutdown();
 	B.shutdown();
+	shader_cache_shutdown();
 }
 
 void r_shader_standard(void) {
@@ -392,6 +395,10 @@ uint r_texture_get_height(Texture *tex, uint mipmap) {
 	return h;
 }
 
+uint r_texture_get_layers(Texture *tex) {
+	return B.texture_get_layers(tex);
+}
+
 void r_texture_get_params(Texture *tex, TextureParams *params) {
 	B.texture_get_params(tex, params);
 }
@@ -420,6 +427,10 @@ void r_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const Pixm
 	B.texture_fill_region(tex, mipmap, x, y, image_data);
 }
 
+void r_texture_fill_layer(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image_data) {
+	B.texture_fill_layer(tex, mipmap, layer, x, y, image_data);
+}
+
 void r_texture_invalidate(Texture *tex) {
 	B.texture_invalidate(tex);
 }
@@ -491,6 +502,10 @@ VertexBuffer* r_vertex_buffer_create(size_t capacity, void *data) {
 	return B.vertex_buffer_create(capacity, data);
 }
 
+VertexBuffer* r_vertex_buffer_create_streaming(size_t capacity) {
+	return B.vertex_buffer_create_streaming(capacity);
+}
+
 const char* r_vertex_buffer_get_debug_label(VertexBuffer *vbuf) {
 	return B.vertex_buffer_get_debug_label(vbuf);
 }
@@ -597,6 +612,10 @@ bool r_screenshot(Pixmap *out) {
 	return B.screenshot(out);
 }
 
+void r_frame_stats(RendererStats *stats) {
+	B.frame_stats(stats);
+}
+
 // uniforms garbage; hope your compiler is smart enough to inline most of this
 
 #define ASSERT_UTYPE(uniform, type) do { if(uniform) assert(r_uniform_type(uniform) == type); } while(0)
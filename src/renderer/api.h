@@ -38,6 +38,8 @@ typedef enum RendererFeature {
 	RFEAT_DEPTH_TEXTURE,
 	RFEAT_FRAMEBUFFER_MULTIPLE_OUTPUTS,
 	RFEAT_TEXTURE_BOTTOMLEFT_ORIGIN,
+	RFEAT_UNIFORM_BUFFERS,
+	RFEAT_TEXTURE_ARRAYS,
 
 	NUM_RFEATS,
 } RendererFeature;
@@ -122,6 +124,11 @@ enum {
 typedef struct TextureParams {
 	uint width;
 	uint height;
+
+	// Number of layers of a 2D array texture; 0 for an ordinary 2D texture.
+	// Array textures require RFEAT_TEXTURE_ARRAYS, and can't be attached to framebuffers.
+	uint layers;
+
 	TextureType type;
 
 	struct {
@@ -349,6 +356,15 @@ typedef enum VsyncMode {
 	VSYNC_ADAPTIVE,
 } VsyncMode;
 
+// Number of driver calls of each kind made during a frame.
+typedef struct RendererStats {
+	uint draw_calls;
+	uint shader_switches;
+	uint uniform_uploads;
+	uint buffer_uploads;
+	uint texture_binds;
+} RendererStats;
+
 typedef union ShaderCustomParams {
 	float vector[4];
 	Color color;
@@ -619,6 +635,7 @@ Texture* r_texture_create(const TextureParams *params) attr_nonnull(1);
 void r_texture_get_size(Texture *tex, uint mipmap, uint *width, uint *height) attr_nonnull(1);
 uint r_texture_get_width(Texture *tex, uint mipmap) attr_nonnull(1);
 uint r_texture_get_height(Texture *tex, uint mipmap) attr_nonnull(1);
+uint r_texture_get_layers(Texture *tex) attr_nonnull(1);
 void r_texture_get_params(Texture *tex, TextureParams *params) attr_nonnull(1, 2);
 const char* r_texture_get_debug_label(Texture *tex) attr_nonnull(1);
 void r_texture_set_debug_label(Texture *tex, const char *label) attr_nonnull(1);
@@ -626,6 +643,7 @@ void r_texture_set_filter(Texture *tex, TextureFilterMode fmin, TextureFilterMod
 void r_texture_set_wrap(Texture *tex, TextureWrapMode ws, TextureWrapMode wt) attr_nonnull(1);
 void r_texture_fill(Texture *tex, uint mipmap, const Pixmap *image_data) attr_nonnull(1, 3);
 void r_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const Pixmap *image_data) attr_nonnull(1, 5);
+void r_texture_fill_layer(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image_data) attr_nonnull(1, 6);
 void r_texture_invalidate(Texture *tex) attr_nonnull(1);
 void r_texture_clear(Texture *tex, const Color *clr) attr_nonnull(1, 2);
 void r_texture_destroy(Texture *tex) attr_nonnull(1);
@@ -646,6 +664,7 @@ void r_framebuffer(Framebuffer *fb);
 Framebuffer* r_framebuffer_current(void);
 
 VertexBuffer* r_vertex_buffer_create(size_t capacity, void *data);
+VertexBuffer* r_vertex_buffer_create_streaming(size_t capacity);
 const char* r_vertex_buffer_get_debug_label(VertexBuffer *vbuf) attr_nonnull(1);
 void r_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char* label) attr_nonnull(1);
 void r_vertex_buffer_destroy(VertexBuffer *vbuf) attr_nonnull(1);
@@ -680,6 +699,9 @@ void r_swap(SDL_Window *window);
 
 bool r_screenshot(Pixmap *dest) attr_nodiscard attr_nonnull(1);
 
+// Gets the stats of the last complete frame, i.e. the one before the last r_swap.
+void r_frame_stats(RendererStats *stats) attr_nonnull(1);
+
 void r_mat_mode(MatrixMode mode);
 MatrixMode r_mat_mode_current(void);
 void r_mat_push(void);
@@ -704,6 +726,9 @@ VertexArray* r_vertex_array_static_models(void) attr_returns_nonnull;
 void r_state_push(void);
 void r_state_pop(void);
 
+// Returns true if any of the state saved by the last r_state_push() has been changed since.
+bool r_state_dirty(void);
+
 void r_draw_quad(void);
 void r_draw_quad_instanced(uint instances);
 void r_draw_model_ptr(Model *model, uint instances, uint base_instance) attr_nonnull(1);
@@ -711,6 +736,12 @@ void r_draw_sprite(const SpriteParams *params) attr_nonnull(1);
 
 void r_flush_sprites(void);
 
+// Sprites drawn between these two calls may be drawn in a different order, to reduce the number
+// of draw calls, if that can't make a visible difference. Does nothing unless enabled with
+// TAISEI_SPRITE_REORDER. May not be nested.
+void r_begin_deferred_sprites(void);
+void r_end_deferred_sprites(void);
+
 BlendMode r_blend_compose(
 	BlendFactor src_color, BlendFactor dst_color, BlendOp color_op,
 	BlendFactor src_alpha, BlendFactor dst_alpha, BlendOp alpha_op
@@ -759,6 +790,11 @@ ShaderProgram* r_shader_get_optional(const char *name) {
 	return prog;
 }
 
+// Like r_shader_get and r_shader_get_optional, but the name is only looked up once per call site.
+// See RES_INTERNED.
+#define r_shader_interned(name) ((ShaderProgram*)RES_INTERNED(RES_SHADER_PROGRAM, name, RESF_DEFAULT))
+#define r_shader_interned_optional(name) ((ShaderProgram*)RES_INTERNED(RES_SHADER_PROGRAM, name, RESF_OPTIONAL))
+
 static inline attr_must_inline
 Texture* r_texture_get(const char *name) {
 	return get_resource_data(RES_TEXTURE, name, RESF_DEFAULT | RESF_UNSAFE);
@@ -62,6 +62,7 @@ typedef struct RendererFuncs {
 	Texture* (*texture_create)(const TextureParams *params);
 	void (*texture_get_params)(Texture *tex, TextureParams *params);
 	void (*texture_get_size)(Texture *tex, uint mipmap, uint *width, uint *height);
+	uint (*texture_get_layers)(Texture *tex);
 	const char* (*texture_get_debug_label)(Texture *tex);
 	void (*texture_set_debug_label)(Texture *tex, const char *label);
 	void (*texture_set_filter)(Texture *tex, TextureFilterMode fmin, TextureFilterMode fmag);
@@ -70,6 +71,7 @@ typedef struct RendererFuncs {
 	void (*texture_invalidate)(Texture *tex);
 	void (*texture_fill)(Texture *tex, uint mipmap, const Pixmap *image_data);
 	void (*texture_fill_region)(Texture *tex, uint mipmap, uint x, uint y, const Pixmap *image_data);
+	void (*texture_fill_layer)(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image_data);
 	void (*texture_clear)(Texture *tex, const Color *clr);
 
 	Framebuffer* (*framebuffer_create)(void);
@@ -87,6 +89,7 @@ typedef struct RendererFuncs {
 	Framebuffer* (*framebuffer_current)(void);
 
 	VertexBuffer* (*vertex_buffer_create)(size_t capacity, void *data);
+	VertexBuffer* (*vertex_buffer_create_streaming)(size_t capacity);
 	const char* (*vertex_buffer_get_debug_label)(VertexBuffer *vbuf);
 	void (*vertex_buffer_set_debug_label)(VertexBuffer *vbuf, const char *label);
 	void (*vertex_buffer_destroy)(VertexBuffer *vbuf);
@@ -118,6 +121,8 @@ typedef struct RendererFuncs {
 	void (*swap)(SDL_Window *window);
 
 	bool (*screenshot)(Pixmap *dst);
+
+	void (*frame_stats)(RendererStats *stats);
 } RendererFuncs;
 
 typedef struct RendererBackend {
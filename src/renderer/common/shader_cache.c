@@ -0,0 +1,238 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "shader_cache.h"
+#include "util.h"
+#include "version.h"
+#include "taskmanager.h"
+#include "vfs/public.h"
+
+#define SHADER_CACHE_DIR "storage/shadercache"
+#define SHADER_CACHE_MAGIC "TSSC"
+#define SHADER_CACHE_FORMAT 1
+
+// Anything larger than this is assumed to be garbage.
+#define SHADER_CACHE_MAX_ENTRY_SIZE (16 << 20)
+
+// FNV-1a
+#define SHADER_CACHE_KEY_BASIS 0xcbf29ce484222325ull
+#define SHADER_CACHE_KEY_PRIME 0x100000001b3ull
+
+typedef struct ShaderCacheWriteTask {
+	ShaderCacheKey key;
+	size_t size;
+	char data[];
+} ShaderCacheWriteTask;
+
+static struct {
+	bool enabled;
+
+	SDL_SpinLock stats_lock;
+	struct {
+		uint hits;
+		uint misses;
+		hrtime_t read_time;
+		hrtime_t miss_cost;
+	} stats;
+} cache;
+
+void shader_cache_init(void) {
+	cache.enabled = env_get("TAISEI_SHADER_CACHE", true);
+
+	if(cache.enabled && !vfs_mkdir(SHADER_CACHE_DIR)) {
+		log_warn("Couldn't create %s, the shader cache is disabled: %s", SHADER_CACHE_DIR, vfs_get_error());
+		cache.enabled = false;
+	}
+}
+
+void shader_cache_shutdown(void) {
+	if(cache.enabled && (cache.stats.hits || cache.stats.misses)) {
+		log_info(
+			"%u hits in %fs; %u misses, which took %fs",
+			cache.stats.hits, cache.stats.read_time / (double)HRTIME_RESOLUTION,
+			cache.stats.misses, cache.stats.miss_cost / (double)HRTIME_RESOLUTION
+		);
+	}
+
+	memset(&cache, 0, sizeof(cache));
+}
+
+bool shader_cache_enabled(void) {
+	return cache.enabled;
+}
+
+ShaderCacheKey shader_cache_key_add(ShaderCacheKey key, size_t size, const void *data) {
+	const uint8_t *p = data;
+
+	for(size_t i = 0; i < size; ++i) {
+		key = (key ^ p[i]) * SHADER_CACHE_KEY_PRIME;
+	}
+
+	return key;
+}
+
+ShaderCacheKey shader_cache_key_add_str(ShaderCacheKey key, const char *str) {
+	// Include the terminator, so that consecutive strings can't run into each other.
+	return shader_cache_key_add(key, strlen(str) + 1, str);
+}
+
+ShaderCacheKey shader_cache_key(const char *kind) {
+	ShaderCacheKey key = SHADER_CACHE_KEY_BASIS;
+	key = shader_cache_key_add_str(key, TAISEI_VERSION_FULL);
+	key = shader_cache_key_add_str(key, kind);
+	return key;
+}
+
+ShaderCacheKey shader_cache_key_add_lang(ShaderCacheKey key, const ShaderLangInfo *lang) {
+	// Not hashed as a whole because of the padding.
+	uint32_t fields[3] = { lang->lang };
+
+	switch(lang->lang) {
+		case SHLANG_GLSL:
+			fields[1] = lang->glsl.version.version;
+			fields[2] = lang->glsl.version.profile;
+			break;
+
+		case SHLANG_SPIRV:
+			fields[1] = lang->spirv.target;
+			break;
+
+		default: UNREACHABLE;
+	}
+
+	return shader_cache_key_add(key, sizeof(fields), fields);
+}
+
+ShaderCacheKey shader_cache_key_add_source(ShaderCacheKey key, const ShaderSource *src) {
+	uint32_t stage = src->stage;
+	key = shader_cache_key_add(key, sizeof(stage), &stage);
+	key = shader_cache_key_add_lang(key, &src->lang);
+	key = shader_cache_key_add(key, src->content_size, src->content);
+	return key;
+}
+
+static void shader_cache_path(ShaderCacheKey key, char *buf, size_t bufsize) {
+	snprintf(buf, bufsize, SHADER_CACHE_DIR "/%016"PRIx64".bin", key);
+}
+
+bool shader_cache_read(ShaderCacheKey key, size_t *out_size, void **out_data) {
+	if(!cache.enabled) {
+		return false;
+	}
+
+	hrtime_t time_begin = time_get();
+	char path[64];
+	shader_cache_path(key, path, sizeof(path));
+
+	SDL_RWops *rw = vfs_open(path, VFS_MODE_READ);
+	char *data = NULL;
+	uint64_t size = 0;
+
+	if(rw) {
+		char magic[4];
+
+		if(
+			SDL_RWread(rw, magic, sizeof(magic), 1) == 1 &&
+			!memcmp(magic, SHADER_CACHE_MAGIC, sizeof(magic)) &&
+			SDL_ReadLE32(rw) == SHADER_CACHE_FORMAT &&
+			SDL_ReadLE64(rw) == key &&
+			(size = SDL_ReadLE64(rw)) <= SHADER_CACHE_MAX_ENTRY_SIZE
+		) {
+			data = malloc(size + 1);
+
+			if(SDL_RWread(rw, data, 1, size) == size) {
+				data[size] = 0;
+			} else {
+				free(data);
+				data = NULL;
+			}
+		}
+
+		if(!data) {
+			log_warn("%s: invalid cache entry, ignoring", path);
+		}
+
+		SDL_RWclose(rw);
+	}
+
+	SDL_AtomicLock(&cache.stats_lock);
+
+	if(data) {
+		cache.stats.hits++;
+		cache.stats.read_time += time_get() - time_begin;
+	} else {
+		cache.stats.misses++;
+	}
+
+	SDL_AtomicUnlock(&cache.stats_lock);
+
+	if(!data) {
+		return false;
+	}
+
+	*out_size = size;
+	*out_data = data;
+	return true;
+}
+
+bool shader_cache_contains(ShaderCacheKey key) {
+	if(!cache.enabled) {
+		return false;
+	}
+
+	char path[64];
+	shader_cache_path(key, path, sizeof(path));
+	return vfs_query(path).exists;
+}
+
+static void* shader_cache_write_task(void *arg) {
+	ShaderCacheWriteTask *w = arg;
+	char path[64];
+	shader_cache_path(w->key, path, sizeof(path));
+
+	SDL_RWops *rw = vfs_open(path, VFS_MODE_WRITE);
+
+	if(!rw) {
+		log_warn("VFS error: %s", vfs_get_error());
+		return NULL;
+	}
+
+	// An entry that's cut short will fail the size check on read.
+	SDL_RWwrite(rw, SHADER_CACHE_MAGIC, 4, 1);
+	SDL_WriteLE32(rw, SHADER_CACHE_FORMAT);
+	SDL_WriteLE64(rw, w->key);
+	SDL_WriteLE64(rw, w->size);
+	SDL_RWwrite(rw, w->data, 1, w->size);
+	SDL_RWclose(rw);
+
+	log_debug("Wrote %s (%zu bytes)", path, w->size);
+	return NULL;
+}
+
+void shader_cache_write(ShaderCacheKey key, size_t size, const void *data, hrtime_t cost) {
+	if(!cache.enabled) {
+		return;
+	}
+
+	SDL_AtomicLock(&cache.stats_lock);
+	cache.stats.miss_cost += cost;
+	SDL_AtomicUnlock(&cache.stats_lock);
+
+	ShaderCacheWriteTask *w = malloc(sizeof(*w) + size);
+	w->key = key;
+	w->size = size;
+	memcpy(w->data, data, size);
+
+	task_detach(taskmgr_global_submit((TaskParams) {
+		.callback = shader_cache_write_task,
+		.userdata = w,
+		.userdata_free_callback = free,
+	}));
+}
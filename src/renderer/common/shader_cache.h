@@ -0,0 +1,53 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_renderer_common_shader_cache_h
+#define IGUARD_renderer_common_shader_cache_h
+
+#include "taisei.h"
+
+#include "shader.h"
+#include "hirestime.h"
+
+/*
+ * Persistent cache for the results of expensive shader processing, such as sources translated
+ * through SPIR-V, or program binaries retrieved from the driver.
+ *
+ * Entries live in storage/shadercache, and are named after a hash of everything that went into
+ * producing them, so they never have to be invalidated explicitly. They're written in the
+ * background. Hit and miss counts, along with the time spent on each, are logged on shutdown;
+ * run once with TAISEI_SHADER_CACHE=0 to compare.
+ */
+
+typedef uint64_t ShaderCacheKey;
+
+void shader_cache_init(void);
+void shader_cache_shutdown(void);
+bool shader_cache_enabled(void);
+
+// Starts a new key. [kind] tells apart the different things stored in the cache.
+// The game version is always part of the key.
+ShaderCacheKey shader_cache_key(const char *kind) attr_nonnull(1);
+
+ShaderCacheKey shader_cache_key_add(ShaderCacheKey key, size_t size, const void *data);
+ShaderCacheKey shader_cache_key_add_str(ShaderCacheKey key, const char *str) attr_nonnull(2);
+ShaderCacheKey shader_cache_key_add_lang(ShaderCacheKey key, const ShaderLangInfo *lang) attr_nonnull(2);
+ShaderCacheKey shader_cache_key_add_source(ShaderCacheKey key, const ShaderSource *src) attr_nonnull(2);
+
+// Returns false on a miss. On a hit, *out_data must be freed by the caller. It's always followed
+// by a zero byte that isn't counted in *out_size.
+bool shader_cache_read(ShaderCacheKey key, size_t *out_size, void **out_data) attr_nonnull(2, 3);
+
+// Checks whether there is an entry for [key], without reading it. Not counted as a hit or miss.
+bool shader_cache_contains(ShaderCacheKey key);
+
+// Stores an entry in the background; [data] is copied. [cost] is the time it took to produce
+// the data, which a hit saves.
+void shader_cache_write(ShaderCacheKey key, size_t size, const void *data, hrtime_t cost) attr_nonnull(3);
+
+#endif // IGUARD_renderer_common_shader_cache_h
@@ -13,26 +13,131 @@
 #include "util/glm.h"
 #include "resource/sprite.h"
 #include "resource/model.h"
+#include "resource/texture.h"
+#include "profiler.h"
 
-typedef struct SpriteAttribs {
-	mat4 transform;
-	mat4 tex_transform;
-	float rgba[4];
-	FloatRect texrect;
-	float sprite_size[2];
+/*
+ * Most sprites are drawn with a transform that only translates, rotates around the Z axis and
+ * scales, and without a texture matrix. Those are sent in the compact format, and the vertex
+ * shader rebuilds the matrix from its components (see interface/sprite.glslh). Everything else
+ * (3D transforms, shearing, texture matrices, colors outside of [0, 1]) goes through the full
+ * format, which has the compact fields with a zero scale, followed by the complete matrices.
+ *
+ * The two formats live in separate vertex buffers, and switching between them forces a flush.
+ *
+ * Sprites whose texture is an array (see TAISEI_ATLAS_ARRAYS) are drawn with their layer as an
+ * attribute, and sampled from the tex_array uniform instead of tex. Both stay bound, so sprites
+ * from different atlas pages, as well as array and non-array sprites, can share a batch.
+ */
+
+typedef struct SpriteInstanceAttribs {
+	float pos_rot[4];    // translation, rotation around Z in radians
+	float scale[2];      // sprite size times scale; zero in the full format
+	float sprite_size[2]; // must follow scale; the shader reads both as one vec4
 	float custom[4];
+	uint16_t texrect[4]; // normalized x0, y0, x1, y1
+	uint8_t rgba[4];     // normalized
+	int16_t tex_layer;   // -1 if the texture isn't an array
+	int16_t padding;
 
 	// offset of this == size without padding.
 	char end_of_fields;
-} SpriteAttribs;
+} SpriteInstanceAttribs;
 
-#define SIZEOF_SPRITE_ATTRIBS (offsetof(SpriteAttribs, end_of_fields))
+typedef struct SpriteFullInstanceAttribs {
+	SpriteInstanceAttribs base;
+	float transform[4][4];
+	float tex_transform[2][3]; // the first two rows of the texture matrix, sans the Z column
+	float rgba[4];
 
-static struct SpriteBatchState {
+	// offset of this == size without padding.
+	char end_of_fields;
+} SpriteFullInstanceAttribs;
+
+#define SIZEOF_SPRITE_ATTRIBS (offsetof(SpriteInstanceAttribs, end_of_fields))
+#define SIZEOF_SPRITE_FULL_ATTRIBS (offsetof(SpriteFullInstanceAttribs, end_of_fields))
+
+// Maximum squared length of the shear component of a transform (relative to the scale) that may
+// be dropped when converting it into the compact format.
+#define SPRITE_SHEAR_EPSILON 1e-8f
+
+static const mat4 identity_matrix = {
+	{ 1, 0, 0, 0 },
+	{ 0, 1, 0, 0 },
+	{ 0, 0, 1, 0 },
+	{ 0, 0, 0, 1 },
+};
+
+typedef enum SpriteFormat {
+	SPRITE_FORMAT_COMPACT,
+	SPRITE_FORMAT_FULL,
+	NUM_SPRITE_FORMATS,
+} SpriteFormat;
+
+/*
+ * In deferred mode (see r_begin_deferred_sprites), sprites aren't written out right away. Each one
+ * is recorded along with the state it's drawn with (the SpriteBatchKey), and assigned to a batch:
+ * normally the most recent batch with the same key, unless that would move the sprite in front of
+ * a sprite from another batch that it might overlap (going by view space bounding boxes), and the
+ * order of the two matters for blending. The batches are drawn when the deferred sprites are
+ * flushed, each in a single instanced draw call.
+ *
+ * Anything that isn't part of the key (framebuffer, depth and cull state, projection) still forces
+ * a flush, as does any other draw call, and setting a uniform of a shader that deferred sprites
+ * are drawn with (see _r_sprite_batch_uniform_changed).
+ */
+
+// How many of the most recent batches to consider when looking for one a sprite can be added to.
+#define SPRITE_DEFER_MAX_LOOKBACK 32
+
+typedef struct SpriteBatchKey {
+	// At most one of these is set; the other is left as it is.
+	Texture *primary_texture;
+	Texture *array_texture;
+	Texture *aux_textures[R_NUM_SPRITE_AUX_TEXTURES];
+	ShaderProgram *shader;
+	BlendMode blend;
+	SpriteFormat format;
+} SpriteBatchKey;
+
+typedef struct DeferredSprite {
+	SpriteFullInstanceAttribs attribs;
+	uint batch;
+} DeferredSprite;
+
+typedef struct DeferredBatch {
+	SpriteBatchKey key;
+	float bbox[4]; // x0, y0, x1, y1 in view space, of all sprites in the batch
+	uint num_sprites;
+} DeferredBatch;
+
+typedef struct SpriteDeferQueue {
+	DeferredSprite *sprites;
+	uint *order;
+	uint num_sprites;
+	uint sprites_capacity;
+	DeferredBatch *batches;
+	uint num_batches;
+	uint batches_capacity;
+	Texture *aux_textures[R_NUM_SPRITE_AUX_TEXTURES]; // as inherited by the next sprite
+	SpriteBatchKey last_key;
+	bool enabled;
+	bool active;
+} SpriteDeferQueue;
+
+typedef struct SpriteStream {
 	VertexArray *varr;
 	VertexBuffer *vbuf;
+	size_t instance_size;
 	uint base_instance;
+	Model quad;
+} SpriteStream;
+
+static struct SpriteBatchState {
+	SpriteStream streams[NUM_SPRITE_FORMATS];
+	SpriteFormat format;
 	Texture *primary_texture;
+	Texture *array_texture;
 	Texture *aux_textures[R_NUM_SPRITE_AUX_TEXTURES];
 	ShaderProgram *shader;
 	BlendMode blend;
@@ -45,16 +150,59 @@ static struct SpriteBatchState {
 	uint depth_write_enabled : 1;
 	uint num_pending;
 
-	Model quad;
+	SpriteDeferQueue deferred;
+
+	// Bound in place of a missing texture, when array textures are in use.
+	struct {
+		Texture *tex;
+		Texture *array;
+	} dummy;
 
 	struct {
 		uint flushes;
+		uint texture_breaks;
 		uint sprites;
+		uint full_sprites;
 		uint best_batch;
 		uint worst_batch;
+		uint deferred_sprites;
+		uint reordered_sprites;
+		uint deferred_batches;
+		uint unsorted_batches;
 	} frame_stats;
 } _r_sprite_batch;
 
+static void _r_sprite_batch_init_stream(
+	SpriteStream *stream,
+	const char *label,
+	size_t instance_size,
+	uint capacity,
+	size_t nattribs,
+	VertexAttribFormat attribs[nattribs]
+) {
+	char buf[64];
+
+	stream->instance_size = instance_size;
+
+	stream->vbuf = r_vertex_buffer_create_streaming(instance_size * capacity);
+	snprintf(buf, sizeof(buf), "Sprite batch vertex buffer (%s)", label);
+	r_vertex_buffer_set_debug_label(stream->vbuf, buf);
+	r_vertex_buffer_invalidate(stream->vbuf);
+
+	stream->varr = r_vertex_array_create();
+	snprintf(buf, sizeof(buf), "Sprite batch vertex array (%s)", label);
+	r_vertex_array_set_debug_label(stream->varr, buf);
+	r_vertex_array_layout(stream->varr, nattribs, attribs);
+	r_vertex_array_attach_vertex_buffer(stream->varr, r_vertex_buffer_static_models(), 0);
+	r_vertex_array_attach_vertex_buffer(stream->varr, stream->vbuf, 1);
+
+	stream->quad.indexed = false;
+	stream->quad.num_vertices = 4;
+	stream->quad.offset = 0;
+	stream->quad.primitive = PRIM_TRIANGLE_STRIP;
+	stream->quad.vertex_array = stream->varr;
+}
+
 void _r_sprite_batch_init(void) {
 	#ifdef DEBUG
 	preload_resource(RES_FONT, "monotiny", RESF_PERMANENT);
@@ -62,33 +210,52 @@ void _r_sprite_batch_init(void) {
 
 	size_t sz_vert = sizeof(GenericModelVertex);
 	size_t sz_attr = SIZEOF_SPRITE_ATTRIBS;
+	size_t sz_full = SIZEOF_SPRITE_FULL_ATTRIBS;
 
 	#define VERTEX_OFS(attr)   offsetof(GenericModelVertex,  attr)
-	#define INSTANCE_OFS(attr) offsetof(SpriteAttribs, attr)
+	#define INSTANCE_OFS(attr) offsetof(SpriteInstanceAttribs, attr)
+	#define FULL_OFS(attr)     offsetof(SpriteFullInstanceAttribs, attr)
 
-	VertexAttribFormat fmt[] = {
+	VertexAttribFormat fmt_compact[] = {
 		// Per-vertex attributes (for the static models buffer, bound at 0)
-		{ { 3, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(position),           0 },
-		{ { 3, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(normal),             0 },
-		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(uv),                 0 },
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(position),         0 },
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(normal),           0 },
+		{ { 2, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(uv),               0 },
 
 		// Per-instance attributes (for our own sprites buffer, bound at 1)
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(transform[0]),     1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(transform[1]),     1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(transform[2]),     1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(transform[3]),     1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(tex_transform[0]), 1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(tex_transform[1]), 1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(tex_transform[2]), 1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(tex_transform[3]), 1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(rgba),             1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(texrect),          1 },
-		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(sprite_size),      1 },
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(custom),           1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_attr, INSTANCE_OFS(pos_rot),        1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_attr, INSTANCE_OFS(scale),          1 },
+		{ { 1, VA_SHORT,  VA_CONVERT_FLOAT,            1 }, sz_attr, INSTANCE_OFS(tex_layer),      1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_attr, INSTANCE_OFS(custom),         1 },
+		{ { 4, VA_USHORT, VA_CONVERT_FLOAT_NORMALIZED, 1 }, sz_attr, INSTANCE_OFS(texrect),        1 },
+		{ { 4, VA_UBYTE,  VA_CONVERT_FLOAT_NORMALIZED, 1 }, sz_attr, INSTANCE_OFS(rgba),           1 },
+	};
+
+	VertexAttribFormat fmt_full[] = {
+		// Per-vertex attributes (for the static models buffer, bound at 0)
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(position),         0 },
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(normal),           0 },
+		{ { 2, VA_FLOAT,  VA_CONVERT_FLOAT,            0 }, sz_vert, VERTEX_OFS(uv),               0 },
+
+		// Per-instance attributes (for our own sprites buffer, bound at 1)
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(base.pos_rot),       1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(base.scale),         1 },
+		{ { 1, VA_SHORT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(base.tex_layer),     1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(base.custom),        1 },
+		{ { 4, VA_USHORT, VA_CONVERT_FLOAT_NORMALIZED, 1 }, sz_full, FULL_OFS(base.texrect),       1 },
+		{ { 4, VA_UBYTE,  VA_CONVERT_FLOAT_NORMALIZED, 1 }, sz_full, FULL_OFS(base.rgba),          1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(transform[0]),       1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(transform[1]),       1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(transform[2]),       1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(transform[3]),       1 },
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(tex_transform[0]),   1 },
+		{ { 3, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(tex_transform[1]),   1 },
+		{ { 4, VA_FLOAT,  VA_CONVERT_FLOAT,            1 }, sz_full, FULL_OFS(rgba),               1 },
 	};
 
 	#undef VERTEX_OFS
 	#undef INSTANCE_OFS
+	#undef FULL_OFS
 
 	uint capacity;
 
@@ -98,33 +265,69 @@ void _r_sprite_batch_init(void) {
 		capacity = 1 << 11;
 	}
 
-	_r_sprite_batch.vbuf = r_vertex_buffer_create(sz_attr * capacity, NULL);
-	r_vertex_buffer_set_debug_label(_r_sprite_batch.vbuf, "Sprite batch vertex buffer");
-	r_vertex_buffer_invalidate(_r_sprite_batch.vbuf);
+	_r_sprite_batch_init_stream(
+		_r_sprite_batch.streams + SPRITE_FORMAT_COMPACT, "compact",
+		sz_attr, capacity, sizeof(fmt_compact)/sizeof(*fmt_compact), fmt_compact
+	);
 
-	_r_sprite_batch.varr = r_vertex_array_create();
-	r_vertex_array_set_debug_label(_r_sprite_batch.varr, "Sprite batch vertex array");
-	r_vertex_array_layout(_r_sprite_batch.varr, sizeof(fmt)/sizeof(*fmt), fmt);
-	r_vertex_array_attach_vertex_buffer(_r_sprite_batch.varr, r_vertex_buffer_static_models(), 0);
-	r_vertex_array_attach_vertex_buffer(_r_sprite_batch.varr, _r_sprite_batch.vbuf, 1);
+	_r_sprite_batch_init_stream(
+		_r_sprite_batch.streams + SPRITE_FORMAT_FULL, "full",
+		sz_full, capacity, sizeof(fmt_full)/sizeof(*fmt_full), fmt_full
+	);
 
-	_r_sprite_batch.quad.indexed = false;
-	_r_sprite_batch.quad.num_vertices = 4;
-	_r_sprite_batch.quad.offset = 0;
-	_r_sprite_batch.quad.primitive = PRIM_TRIANGLE_STRIP;
-	_r_sprite_batch.quad.vertex_array = _r_sprite_batch.varr;
+	_r_sprite_batch.deferred.enabled = env_get("TAISEI_SPRITE_REORDER", false);
+
+	if(texture_atlas_arrays_enabled()) {
+		// Samplers of different types must not refer to the same texture unit, so tex and
+		// tex_array always need something bound, even if only one of them is used.
+		TextureParams p = {
+			.type = TEX_TYPE_RGBA_8,
+			.width = 1,
+			.height = 1,
+			.filter = { TEX_FILTER_NEAREST, TEX_FILTER_NEAREST },
+			.wrap = { TEX_WRAP_CLAMP, TEX_WRAP_CLAMP },
+			.mipmaps = 1,
+		};
+
+		_r_sprite_batch.dummy.tex = r_texture_create(&p);
+		r_texture_set_debug_label(_r_sprite_batch.dummy.tex, "Sprite batch dummy texture");
+		r_texture_clear(_r_sprite_batch.dummy.tex, RGBA(0, 0, 0, 0));
+
+		p.layers = 1;
+		_r_sprite_batch.dummy.array = r_texture_create(&p);
+		r_texture_set_debug_label(_r_sprite_batch.dummy.array, "Sprite batch dummy array texture");
+	}
 }
 
 void _r_sprite_batch_shutdown(void) {
-	r_vertex_array_destroy(_r_sprite_batch.varr);
-	r_vertex_buffer_destroy(_r_sprite_batch.vbuf);
+	for(uint i = 0; i < NUM_SPRITE_FORMATS; ++i) {
+		r_vertex_array_destroy(_r_sprite_batch.streams[i].varr);
+		r_vertex_buffer_destroy(_r_sprite_batch.streams[i].vbuf);
+	}
+
+	free(_r_sprite_batch.deferred.sprites);
+	free(_r_sprite_batch.deferred.order);
+	free(_r_sprite_batch.deferred.batches);
+
+	if(_r_sprite_batch.dummy.tex) {
+		r_texture_destroy(_r_sprite_batch.dummy.tex);
+		r_texture_destroy(_r_sprite_batch.dummy.array);
+	}
 }
 
+static void _r_sprite_batch_submit_deferred(void);
+
 void r_flush_sprites(void) {
+	if(_r_sprite_batch.deferred.num_sprites) {
+		_r_sprite_batch_submit_deferred();
+	}
+
 	if(_r_sprite_batch.num_pending == 0) {
 		return;
 	}
 
+	PROFILE_SCOPE("r_flush_sprites");
+
 	uint pending = _r_sprite_batch.num_pending;
 
 	// needs to be done early to thwart recursive callss
@@ -151,7 +354,16 @@ void r_flush_sprites(void) {
 	glm_mat4_copy(_r_sprite_batch.projection, *r_mat_current_ptr(MM_PROJECTION));
 
 	r_shader_ptr(_r_sprite_batch.shader);
-	r_uniform_sampler("tex", _r_sprite_batch.primary_texture);
+
+	if(_r_sprite_batch.dummy.tex) {
+		Texture *tex = _r_sprite_batch.primary_texture;
+		Texture *array = _r_sprite_batch.array_texture;
+		r_uniform_sampler("tex", tex ? tex : _r_sprite_batch.dummy.tex);
+		r_uniform_sampler("tex_array", array ? array : _r_sprite_batch.dummy.array);
+	} else {
+		r_uniform_sampler("tex", _r_sprite_batch.primary_texture);
+	}
+
 	r_uniform_sampler_array("tex_aux[0]", 0, R_NUM_SPRITE_AUX_TEXTURES, _r_sprite_batch.aux_textures);
 	r_framebuffer(_r_sprite_batch.framebuffer);
 	r_blend(_r_sprite_batch.blend);
@@ -161,87 +373,434 @@ void r_flush_sprites(void) {
 	r_depth_func(_r_sprite_batch.depth_func);
 	r_cull(_r_sprite_batch.cull_mode);
 
+	SpriteStream *sstream = _r_sprite_batch.streams + _r_sprite_batch.format;
+
 	if(r_supports(RFEAT_DRAW_INSTANCED_BASE_INSTANCE)) {
-		r_draw_model_ptr(&_r_sprite_batch.quad, pending, _r_sprite_batch.base_instance);
-		_r_sprite_batch.base_instance += pending;
+		r_draw_model_ptr(&sstream->quad, pending, sstream->base_instance);
+		sstream->base_instance += pending;
 
-		SDL_RWops *stream = r_vertex_buffer_get_stream(_r_sprite_batch.vbuf);
+		SDL_RWops *stream = r_vertex_buffer_get_stream(sstream->vbuf);
 		size_t remaining = SDL_RWsize(stream) - SDL_RWtell(stream);
 
-		if(remaining < SIZEOF_SPRITE_ATTRIBS) {
-			// log_debug("Invalidating after %u sprites", _r_sprite_batch.base_instance);
-			r_vertex_buffer_invalidate(_r_sprite_batch.vbuf);
-			_r_sprite_batch.base_instance = 0;
+		if(remaining < sstream->instance_size) {
+			// log_debug("Invalidating after %u sprites", sstream->base_instance);
+			r_vertex_buffer_invalidate(sstream->vbuf);
+			sstream->base_instance = 0;
 		}
 	} else {
-		r_draw_model_ptr(&_r_sprite_batch.quad, pending, 0);
-		r_vertex_buffer_invalidate(_r_sprite_batch.vbuf);
+		r_draw_model_ptr(&sstream->quad, pending, 0);
+		r_vertex_buffer_invalidate(sstream->vbuf);
 	}
 
 	r_mat_pop();
 	r_state_pop();
 }
 
-static void _r_sprite_batch_add(Sprite *spr, const SpriteParams *params, SDL_RWops *stream) {
-	SpriteAttribs alignas(32) attribs;
-	r_mat_current(MM_MODELVIEW, attribs.transform);
-	r_mat_current(MM_TEXTURE, attribs.tex_transform);
+static bool _r_sprite_batch_decompose_transform(mat4 m, SpriteInstanceAttribs *attribs) {
+	// Sprite vertices have Z = 0, so the third column doesn't matter; everything else must be
+	// a plain 2D transform (plus a Z translation).
+	if(m[0][2] != 0 || m[1][2] != 0 || m[0][3] != 0 || m[1][3] != 0 || m[3][3] != 1) {
+		return false;
+	}
+
+	float sx = hypotf(m[0][0], m[0][1]);
+
+	if(!(sx > 0)) {
+		return false;
+	}
+
+	float c = m[0][0] / sx;
+	float s = m[0][1] / sx;
+
+	// Project the Y axis onto the X axis rotated by 90°; whatever is left over is shear.
+	float sy = c * m[1][1] - s * m[1][0];
+	float shear_x = m[1][0] + s * sy;
+	float shear_y = m[1][1] - c * sy;
+
+	if(sy == 0 || shear_x * shear_x + shear_y * shear_y > SPRITE_SHEAR_EPSILON * sy * sy) {
+		return false;
+	}
+
+	attribs->pos_rot[0] = m[3][0];
+	attribs->pos_rot[1] = m[3][1];
+	attribs->pos_rot[2] = m[3][2];
+	attribs->pos_rot[3] = atan2f(s, c);
+	attribs->scale[0] = sx;
+	attribs->scale[1] = sy;
+
+	return true;
+}
+
+static void _r_sprite_batch_bbox(mat4 m, float bbox[4]) {
+	if(m[0][3] != 0 || m[1][3] != 0 || m[3][3] != 1) {
+		bbox[0] = bbox[1] = -INFINITY;
+		bbox[2] = bbox[3] = INFINITY;
+		return;
+	}
+
+	// The quad spans [-0.5, 0.5] on both axes, at Z = 0.
+	float hw = 0.5f * (fabsf(m[0][0]) + fabsf(m[1][0]));
+	float hh = 0.5f * (fabsf(m[0][1]) + fabsf(m[1][1]));
+
+	bbox[0] = m[3][0] - hw;
+	bbox[1] = m[3][1] - hh;
+	bbox[2] = m[3][0] + hw;
+	bbox[3] = m[3][1] + hh;
+}
+
+// [bbox] is optional; if given, receives the view space bounding box of the sprite.
+static SpriteFormat _r_sprite_batch_pack(Sprite *spr, const SpriteParams *params, SpriteFullInstanceAttribs *attribs, float *bbox) {
+	mat4 transform CGLM_ALIGN(32);
+	r_mat_current(MM_MODELVIEW, transform);
 
 	float scale_x = params->scale.x ? params->scale.x : 1;
 	float scale_y = params->scale.y ? params->scale.y : scale_x;
 
 	if(params->pos.x || params->pos.y) {
-		glm_translate(attribs.transform, (vec3) { params->pos.x, params->pos.y });
+		glm_translate(transform, (vec3) { params->pos.x, params->pos.y });
 	}
 
 	if(params->rotation.angle) {
 		float *rvec = (float*)params->rotation.vector;
 
 		if(rvec[0] == 0 && rvec[1] == 0 && rvec[2] == 0) {
-			glm_rotate(attribs.transform, params->rotation.angle, (vec3) { 0, 0, 1 });
+			glm_rotate(transform, params->rotation.angle, (vec3) { 0, 0, 1 });
 		} else {
-			glm_rotate(attribs.transform, params->rotation.angle, rvec);
+			glm_rotate(transform, params->rotation.angle, rvec);
 		}
 	}
 
-	glm_scale(attribs.transform, (vec3) { scale_x * spr->w, scale_y * spr->h, 1 });
+	glm_scale(transform, (vec3) { scale_x * spr->w, scale_y * spr->h, 1 });
+
+	if(bbox != NULL) {
+		_r_sprite_batch_bbox(transform, bbox);
+	}
+
+	SpriteInstanceAttribs *base = &attribs->base;
+	SpriteFormat format = SPRITE_FORMAT_COMPACT;
 
 	if(params->color == NULL) {
 		// XXX: should we use r_color_current here?
-		attribs.rgba[0] = attribs.rgba[1] = attribs.rgba[2] = attribs.rgba[3] = 1;
+		attribs->rgba[0] = attribs->rgba[1] = attribs->rgba[2] = attribs->rgba[3] = 1;
 	} else {
-		memcpy(attribs.rgba, params->color, sizeof(attribs.rgba));
+		memcpy(attribs->rgba, params->color, sizeof(attribs->rgba));
+	}
+
+	for(uint i = 0; i < 4; ++i) {
+		float c = attribs->rgba[i];
+
+		if(c < 0 || c > 1) {
+			format = SPRITE_FORMAT_FULL;
+			c = clamp(c, 0, 1);
+		}
+
+		base->rgba[i] = (uint8_t)(c * UINT8_MAX + 0.5f);
 	}
 
 	uint tw, th;
 	r_texture_get_size(spr->tex, 0, &tw, &th);
 
-	attribs.texrect.x = spr->tex_area.x / tw;
-	attribs.texrect.y = spr->tex_area.y / th;
-	attribs.texrect.w = spr->tex_area.w / tw;
-	attribs.texrect.h = spr->tex_area.h / th;
+	FloatRect texrect = {
+		.x = spr->tex_area.x / tw,
+		.y = spr->tex_area.y / th,
+		.w = spr->tex_area.w / tw,
+		.h = spr->tex_area.h / th,
+	};
 
 	if(params->flip.x) {
-		attribs.texrect.x += attribs.texrect.w;
-		attribs.texrect.w *= -1;
+		texrect.x += texrect.w;
+		texrect.w *= -1;
 	}
 
 	if(params->flip.y) {
-		attribs.texrect.y += attribs.texrect.h;
-		attribs.texrect.h *= -1;
+		texrect.y += texrect.h;
+		texrect.h *= -1;
+	}
+
+	float corners[4] = { texrect.x, texrect.y, texrect.x + texrect.w, texrect.y + texrect.h };
+
+	for(uint i = 0; i < 4; ++i) {
+		base->texrect[i] = (uint16_t)(clamp(corners[i], 0, 1) * UINT16_MAX + 0.5f);
 	}
 
-	attribs.sprite_size[0] = spr->w;
-	attribs.sprite_size[1] = spr->h;
+	base->tex_layer = r_texture_get_layers(spr->tex) ? spr->tex_layer : -1;
+	base->padding = 0;
+
+	base->sprite_size[0] = spr->w;
+	base->sprite_size[1] = spr->h;
 
 	if(params->shader_params != NULL) {
-		memcpy(attribs.custom, params->shader_params, sizeof(attribs.custom));
+		memcpy(base->custom, params->shader_params, sizeof(base->custom));
 	} else {
-		memset(attribs.custom, 0, sizeof(attribs.custom));
+		memset(base->custom, 0, sizeof(base->custom));
+	}
+
+	mat4 *tex_transform = r_mat_current_ptr(MM_TEXTURE);
+
+	if(memcmp(*tex_transform, identity_matrix, sizeof(mat4))) {
+		format = SPRITE_FORMAT_FULL;
+	}
+
+	if(format == SPRITE_FORMAT_COMPACT && _r_sprite_batch_decompose_transform(transform, base)) {
+		return SPRITE_FORMAT_COMPACT;
+	}
+
+	memset(base->pos_rot, 0, sizeof(base->pos_rot));
+	memset(base->scale, 0, sizeof(base->scale));
+	memcpy(attribs->transform, transform, sizeof(attribs->transform));
+
+	for(uint row = 0; row < 2; ++row) {
+		attribs->tex_transform[row][0] = (*tex_transform)[0][row];
+		attribs->tex_transform[row][1] = (*tex_transform)[1][row];
+		attribs->tex_transform[row][2] = (*tex_transform)[3][row];
 	}
 
-	SDL_RWwrite(stream, &attribs, SIZEOF_SPRITE_ATTRIBS, 1);
+	return SPRITE_FORMAT_FULL;
+}
+
+static void _r_sprite_batch_texture_break(void) {
+	if(_r_sprite_batch.num_pending) {
+		_r_sprite_batch.frame_stats.texture_breaks++;
+	}
+
+	r_flush_sprites();
+}
+
+static void _r_sprite_batch_set_key(const SpriteBatchKey *key) {
+	if(key->primary_texture != NULL && key->primary_texture != _r_sprite_batch.primary_texture) {
+		_r_sprite_batch_texture_break();
+		_r_sprite_batch.primary_texture = key->primary_texture;
+	}
+
+	if(key->array_texture != NULL && key->array_texture != _r_sprite_batch.array_texture) {
+		_r_sprite_batch_texture_break();
+		_r_sprite_batch.array_texture = key->array_texture;
+	}
+
+	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
+		Texture *aux_tex = key->aux_textures[i];
+
+		if(aux_tex != NULL && aux_tex != _r_sprite_batch.aux_textures[i]) {
+			_r_sprite_batch_texture_break();
+			_r_sprite_batch.aux_textures[i] = aux_tex;
+		}
+	}
+
+	if(key->shader != _r_sprite_batch.shader) {
+		r_flush_sprites();
+		_r_sprite_batch.shader = key->shader;
+	}
+
+	if(key->blend != _r_sprite_batch.blend) {
+		r_flush_sprites();
+		_r_sprite_batch.blend = key->blend;
+	}
+
+	if(key->format != _r_sprite_batch.format) {
+		r_flush_sprites();
+		_r_sprite_batch.format = key->format;
+	}
+}
+
+static void _r_sprite_batch_append(const SpriteFullInstanceAttribs *attribs) {
+	SpriteStream *sstream = _r_sprite_batch.streams + _r_sprite_batch.format;
+	SDL_RWops *stream = r_vertex_buffer_get_stream(sstream->vbuf);
+	size_t remaining = SDL_RWsize(stream) - SDL_RWtell(stream);
+
+	if(remaining < sstream->instance_size) {
+		if(!r_supports(RFEAT_DRAW_INSTANCED_BASE_INSTANCE)) {
+			log_warn("Vertex buffer exhausted (%zu needed for next sprite, %zu remaining), flush forced", sstream->instance_size, remaining);
+		}
+
+		r_flush_sprites();
+	}
+
+	_r_sprite_batch.num_pending++;
 	_r_sprite_batch.frame_stats.sprites++;
+
+	if(_r_sprite_batch.format == SPRITE_FORMAT_FULL) {
+		_r_sprite_batch.frame_stats.full_sprites++;
+		SDL_RWwrite(stream, attribs, SIZEOF_SPRITE_FULL_ATTRIBS, 1);
+	} else {
+		SDL_RWwrite(stream, &attribs->base, SIZEOF_SPRITE_ATTRIBS, 1);
+	}
+}
+
+static bool _r_sprite_batch_blend_is_commutative(BlendMode mode) {
+	UnpackedBlendMode ub;
+	r_blend_unpack(mode, &ub);
+
+	UnpackedBlendModePart *parts[] = { &ub.color, &ub.alpha };
+
+	for(uint i = 0; i < sizeof(parts)/sizeof(*parts); ++i) {
+		UnpackedBlendModePart *p = parts[i];
+
+		if(p->op == BLENDOP_MIN || p->op == BLENDOP_MAX) {
+			continue;
+		}
+
+		// dst + src * f or dst - src * f, where f doesn't depend on dst.
+		if(
+			(p->op != BLENDOP_ADD && p->op != BLENDOP_REV_SUB) ||
+			p->dst != BLENDFACTOR_ONE ||
+			p->src == BLENDFACTOR_DST_COLOR ||
+			p->src == BLENDFACTOR_INV_DST_COLOR ||
+			p->src == BLENDFACTOR_DST_ALPHA ||
+			p->src == BLENDFACTOR_INV_DST_ALPHA
+		) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool _r_sprite_batch_can_reorder(const SpriteBatchKey *key, const DeferredBatch *batch, const float bbox[4]) {
+	if(
+		bbox[0] >= batch->bbox[2] || batch->bbox[0] >= bbox[2] ||
+		bbox[1] >= batch->bbox[3] || batch->bbox[1] >= bbox[3]
+	) {
+		return true;
+	}
+
+	return key->blend == batch->key.blend && _r_sprite_batch_blend_is_commutative(key->blend);
+}
+
+static bool _r_sprite_batch_projection_is_flat(void) {
+	// View space X and Y must map to screen space independently of Z, or the bounding boxes
+	// can't be compared.
+	mat4 *p = &_r_sprite_batch.projection;
+	return
+		(*p)[0][3] == 0 && (*p)[1][3] == 0 && (*p)[2][3] == 0 && (*p)[3][3] == 1 &&
+		(*p)[2][0] == 0 && (*p)[2][1] == 0;
+}
+
+static void _r_sprite_batch_defer(const SpriteBatchKey *key, const SpriteFullInstanceAttribs *attribs, float bbox[4]) {
+	SpriteDeferQueue *d = &_r_sprite_batch.deferred;
+
+	if(!_r_sprite_batch_projection_is_flat()) {
+		bbox[0] = bbox[1] = -INFINITY;
+		bbox[2] = bbox[3] = INFINITY;
+	}
+
+	if(d->num_sprites == 0 || memcmp(key, &d->last_key, sizeof(*key))) {
+		_r_sprite_batch.frame_stats.unsorted_batches++;
+		d->last_key = *key;
+	}
+
+	uint lookback_end = d->num_batches > SPRITE_DEFER_MAX_LOOKBACK ? d->num_batches - SPRITE_DEFER_MAX_LOOKBACK : 0;
+	uint batch_idx = d->num_batches;
+
+	for(uint i = d->num_batches; i-- > lookback_end;) {
+		DeferredBatch *b = d->batches + i;
+
+		if(!memcmp(&b->key, key, sizeof(*key))) {
+			batch_idx = i;
+			break;
+		}
+
+		if(!_r_sprite_batch_can_reorder(key, b, bbox)) {
+			break;
+		}
+	}
+
+	if(batch_idx == d->num_batches) {
+		if(d->num_batches == d->batches_capacity) {
+			d->batches_capacity = imax(64, d->batches_capacity * 2);
+			d->batches = realloc(d->batches, d->batches_capacity * sizeof(*d->batches));
+		}
+
+		DeferredBatch *b = d->batches + d->num_batches++;
+		b->key = *key;
+		memcpy(b->bbox, bbox, sizeof(b->bbox));
+		b->num_sprites = 0;
+	} else {
+		DeferredBatch *b = d->batches + batch_idx;
+		b->bbox[0] = fminf(b->bbox[0], bbox[0]);
+		b->bbox[1] = fminf(b->bbox[1], bbox[1]);
+		b->bbox[2] = fmaxf(b->bbox[2], bbox[2]);
+		b->bbox[3] = fmaxf(b->bbox[3], bbox[3]);
+
+		if(batch_idx != d->num_batches - 1) {
+			_r_sprite_batch.frame_stats.reordered_sprites++;
+		}
+	}
+
+	if(d->num_sprites == d->sprites_capacity) {
+		d->sprites_capacity = imax(256, d->sprites_capacity * 2);
+		d->sprites = realloc(d->sprites, d->sprites_capacity * sizeof(*d->sprites));
+		d->order = realloc(d->order, d->sprites_capacity * sizeof(*d->order));
+	}
+
+	DeferredSprite *ds = d->sprites + d->num_sprites++;
+	ds->batch = batch_idx;
+
+	if(key->format == SPRITE_FORMAT_FULL) {
+		memcpy(&ds->attribs, attribs, sizeof(ds->attribs));
+	} else {
+		memcpy(&ds->attribs.base, &attribs->base, sizeof(ds->attribs.base));
+	}
+
+	d->batches[batch_idx].num_sprites++;
+	_r_sprite_batch.frame_stats.deferred_sprites++;
+}
+
+static void _r_sprite_batch_submit_deferred(void) {
+	SpriteDeferQueue *d = &_r_sprite_batch.deferred;
+	uint num_sprites = d->num_sprites;
+	uint num_batches = d->num_batches;
+
+	// Reset early, since the flushes below end up calling r_flush_sprites again.
+	d->num_sprites = 0;
+	d->num_batches = 0;
+
+	PROFILE_SCOPE("submit deferred sprites");
+
+	// Stable counting sort by batch; turn the sprite counts into offsets first.
+	uint ofs = 0;
+
+	for(uint i = 0; i < num_batches; ++i) {
+		uint n = d->batches[i].num_sprites;
+		d->batches[i].num_sprites = ofs;
+		ofs += n;
+	}
+
+	for(uint i = 0; i < num_sprites; ++i) {
+		d->order[d->batches[d->sprites[i].batch].num_sprites++] = i;
+	}
+
+	// Now each batch's num_sprites points to the end of its range.
+	uint *pidx = d->order;
+
+	for(uint i = 0; i < num_batches; ++i) {
+		_r_sprite_batch_set_key(&d->batches[i].key);
+
+		for(uint *end = d->order + d->batches[i].num_sprites; pidx < end; ++pidx) {
+			_r_sprite_batch_append(&d->sprites[*pidx].attribs);
+		}
+	}
+
+	_r_sprite_batch.frame_stats.deferred_batches += num_batches;
+}
+
+void r_begin_deferred_sprites(void) {
+	if(!_r_sprite_batch.deferred.enabled) {
+		return;
+	}
+
+	assert(!_r_sprite_batch.deferred.active);
+	r_flush_sprites();
+	_r_sprite_batch.deferred.active = true;
+	memcpy(_r_sprite_batch.deferred.aux_textures, _r_sprite_batch.aux_textures, sizeof(_r_sprite_batch.aux_textures));
+}
+
+void r_end_deferred_sprites(void) {
+	if(!_r_sprite_batch.deferred.active) {
+		return;
+	}
+
+	r_flush_sprites();
+	_r_sprite_batch.deferred.active = false;
 }
 
 void r_draw_sprite(const SpriteParams *params) {
@@ -255,20 +814,17 @@ void r_draw_sprite(const SpriteParams *params) {
 		spr = get_sprite(params->sprite);
 	}
 
-	if(spr->tex != _r_sprite_batch.primary_texture) {
-		r_flush_sprites();
-		_r_sprite_batch.primary_texture = spr->tex;
-	}
-
-	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
-		Texture *aux_tex = params->aux_textures[i];
+	SpriteBatchKey key;
+	memset(&key, 0, sizeof(key));
 
-		if(aux_tex != NULL && aux_tex != _r_sprite_batch.aux_textures[i]) {
-			r_flush_sprites();
-			_r_sprite_batch.aux_textures[i] = aux_tex;
-		}
+	if(r_texture_get_layers(spr->tex)) {
+		key.array_texture = spr->tex;
+	} else {
+		key.primary_texture = spr->tex;
 	}
 
+	memcpy(key.aux_textures, params->aux_textures, sizeof(key.aux_textures));
+
 	ShaderProgram *prog = params->shader_ptr;
 
 	if(prog == NULL) {
@@ -280,10 +836,12 @@ void r_draw_sprite(const SpriteParams *params) {
 	}
 
 	assert(prog != NULL);
+	key.shader = prog;
 
-	if(prog != _r_sprite_batch.shader) {
-		r_flush_sprites();
-		_r_sprite_batch.shader = prog;
+	key.blend = params->blend;
+
+	if(key.blend == 0) {
+		key.blend = r_blend_current();
 	}
 
 	Framebuffer *fb = r_framebuffer_current();
@@ -293,17 +851,6 @@ void r_draw_sprite(const SpriteParams *params) {
 		_r_sprite_batch.framebuffer = fb;
 	}
 
-	BlendMode blend = params->blend;
-
-	if(blend == 0) {
-		blend = r_blend_current();
-	}
-
-	if(blend != _r_sprite_batch.blend) {
-		r_flush_sprites();
-		_r_sprite_batch.blend = blend;
-	}
-
 	bool depth_test_enabled = r_capability_current(RCAP_DEPTH_TEST);
 	bool depth_write_enabled = r_capability_current(RCAP_DEPTH_WRITE);
 	bool cull_enabled = r_capability_current(RCAP_CULL_FACE);
@@ -342,19 +889,28 @@ void r_draw_sprite(const SpriteParams *params) {
 		glm_mat4_copy(*current_projection, _r_sprite_batch.projection);
 	}
 
-	SDL_RWops *stream = r_vertex_buffer_get_stream(_r_sprite_batch.vbuf);
-	size_t remaining = SDL_RWsize(stream) - SDL_RWtell(stream);
+	SpriteFullInstanceAttribs attribs;
 
-	if(remaining < SIZEOF_SPRITE_ATTRIBS) {
-		if(!r_supports(RFEAT_DRAW_INSTANCED_BASE_INSTANCE)) {
-			log_warn("Vertex buffer exhausted (%zu needed for next sprite, %zu remaining), flush forced", SIZEOF_SPRITE_ATTRIBS, remaining);
+	if(_r_sprite_batch.deferred.active) {
+		float bbox[4];
+		key.format = _r_sprite_batch_pack(spr, params, &attribs, bbox);
+
+		// Sprites that don't specify aux textures inherit the previous ones.
+		for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
+			if(key.aux_textures[i] == NULL) {
+				key.aux_textures[i] = _r_sprite_batch.deferred.aux_textures[i];
+			} else {
+				_r_sprite_batch.deferred.aux_textures[i] = key.aux_textures[i];
+			}
 		}
 
-		r_flush_sprites();
+		_r_sprite_batch_defer(&key, &attribs, bbox);
+		return;
 	}
 
-	_r_sprite_batch.num_pending++;
-	_r_sprite_batch_add(spr, params, stream);
+	key.format = _r_sprite_batch_pack(spr, params, &attribs, NULL);
+	_r_sprite_batch_set_key(&key);
+	_r_sprite_batch_append(&attribs);
 }
 
 #include "resource/font.h"
@@ -368,9 +924,11 @@ void _r_sprite_batch_end_frame(void) {
 	r_flush_sprites();
 
 	static char buf[512];
-	snprintf(buf, sizeof(buf), "%6i sprites %6i flushes %9.02f spr/flush %6i best %6i worst",
+	snprintf(buf, sizeof(buf), "%6i sprites (%6i full) %6i flushes (%6i texture) %9.02f spr/flush %6i best %6i worst",
 		_r_sprite_batch.frame_stats.sprites,
+		_r_sprite_batch.frame_stats.full_sprites,
 		_r_sprite_batch.frame_stats.flushes,
+		_r_sprite_batch.frame_stats.texture_breaks,
 		_r_sprite_batch.frame_stats.sprites / (double)_r_sprite_batch.frame_stats.flushes,
 		_r_sprite_batch.frame_stats.best_batch,
 		_r_sprite_batch.frame_stats.worst_batch
@@ -384,16 +942,53 @@ void _r_sprite_batch_end_frame(void) {
 		.shader = "text_default",
 	});
 
+	if(_r_sprite_batch.deferred.enabled) {
+		snprintf(buf, sizeof(buf), "%6i deferred (%6i reordered) %6i batches (%6i unsorted)",
+			_r_sprite_batch.frame_stats.deferred_sprites,
+			_r_sprite_batch.frame_stats.reordered_sprites,
+			_r_sprite_batch.frame_stats.deferred_batches,
+			_r_sprite_batch.frame_stats.unsorted_batches
+		);
+
+		text_draw(buf, &(TextParams) {
+			.pos = { 0, 2 * font_get_lineskip(font) },
+			.font_ptr = font,
+			.color = RGB(1, 1, 1),
+			.shader = "text_default",
+		});
+	}
+
 	memset(&_r_sprite_batch.frame_stats, 0, sizeof(_r_sprite_batch.frame_stats));
 
 #endif
 }
 
+void _r_sprite_batch_uniform_changed(ShaderProgram *prog) {
+	// Sprites deferred so far must be drawn with the old values. Merging them with later sprites
+	// of the same shader would draw them all with the new ones.
+	SpriteDeferQueue *d = &_r_sprite_batch.deferred;
+
+	for(uint i = 0; i < d->num_batches; ++i) {
+		if(d->batches[i].key.shader == prog) {
+			r_flush_sprites();
+			return;
+		}
+	}
+}
+
 void _r_sprite_batch_texture_deleted(Texture *tex) {
+	if(_r_sprite_batch.deferred.num_sprites) {
+		r_flush_sprites();
+	}
+
 	if(_r_sprite_batch.primary_texture == tex) {
 		_r_sprite_batch.primary_texture = NULL;
 	}
 
+	if(_r_sprite_batch.array_texture == tex) {
+		_r_sprite_batch.array_texture = NULL;
+	}
+
 	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
 		if(_r_sprite_batch.aux_textures[i] == tex) {
 			_r_sprite_batch.aux_textures[i] = NULL;
@@ -17,5 +17,6 @@ void _r_sprite_batch_init(void);
 void _r_sprite_batch_shutdown(void);
 void _r_sprite_batch_end_frame(void);
 void _r_sprite_batch_texture_deleted(Texture *tex);
+void _r_sprite_batch_uniform_changed(ShaderProgram *prog);
 
 #endif // IGUARD_renderer_common_sprite_batch_h
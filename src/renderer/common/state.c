@@ -100,6 +100,10 @@ void r_state_pop(void) {
 	}
 }
 
+bool r_state_dirty(void) {
+	return _r_state.head && S.dirty_bits;
+}
+
 void _r_state_touch_capabilities(void) {
 	TAINT(RSTATE_CAPABILITIES, {
 		S.capabilities = B.capabilities_current();
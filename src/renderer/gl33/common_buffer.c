@@ -13,6 +13,195 @@
 
 #define STREAM_CBUF(rw) ((CommonBuffer*)rw)
 
+/*
+ * Streaming buffers
+ *
+ * A streaming buffer is backed by a ring of GL33_STREAM_SEGMENTS times its nominal size. The
+ * stream writes into a window of the nominal size somewhere in that ring, straight into mapped
+ * memory. Invalidating the buffer doesn't orphan it; it just moves the window past whatever was
+ * written so far, and fences the old data. Vertex arrays point their attributes at the current
+ * window (see gl33_buffer_stream_origin), so users of the buffer don't need to know about any
+ * of this. Uniform buffers are bound with an offset into the window instead.
+ *
+ * If ARB_buffer_storage is available, the whole ring is mapped persistently. Otherwise, the
+ * window is mapped without synchronization on the first write, and unmapped before drawing.
+ * The fences make sure that nothing still in use by the GPU is ever overwritten.
+ */
+
+#define GL33_STREAM_SEGMENTS 3
+#define GL33_STREAM_MAX_FENCES 256
+#define GL33_STREAM_ALIGNMENT 64
+
+typedef struct StreamFence {
+	GLsync sync;
+	size_t begin;
+	size_t end;
+} StreamFence;
+
+struct StreamRing {
+	char *mapping;
+	size_t map_begin;
+	size_t origin;
+	size_t total_size;
+	size_t high_water;
+	size_t alignment; // of the window's origin
+	bool persistent;
+
+	StreamFence fences[GL33_STREAM_MAX_FENCES];
+	uint first_fence;
+	uint num_fences;
+};
+
+// Returns the address of [offset] into the current window.
+static char* gl33_stream_map(CommonBuffer *cbuf, size_t offset) {
+	StreamRing *ring = cbuf->ring;
+
+	if(ring->mapping == NULL) {
+		// Everything in the window past the current offset is guaranteed to be unused by the GPU.
+		ring->map_begin = ring->origin + cbuf->offset;
+
+		GL33_BUFFER_TEMP_BIND(cbuf, {
+			ring->mapping = glMapBufferRange(
+				gl33_bindidx_to_glenum(cbuf->bindidx),
+				ring->map_begin,
+				ring->origin + cbuf->size - ring->map_begin,
+				GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+			);
+		});
+
+		if(ring->mapping == NULL) {
+			log_fatal("glMapBufferRange() failed for %s", cbuf->debug_label);
+		}
+	}
+
+	// The mapping may start past the origin, so don't form a pointer to the origin itself.
+	assert(ring->origin + offset >= ring->map_begin);
+	return ring->mapping + (ring->origin + offset - ring->map_begin);
+}
+
+static void gl33_stream_unmap(CommonBuffer *cbuf) {
+	StreamRing *ring = cbuf->ring;
+
+	if(ring->persistent || ring->mapping == NULL) {
+		return;
+	}
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		GLenum target = gl33_bindidx_to_glenum(cbuf->bindidx);
+
+		if(cbuf->cache.update_begin < cbuf->cache.update_end) {
+			glFlushMappedBufferRange(
+				target,
+				ring->origin + cbuf->cache.update_begin - ring->map_begin,
+				cbuf->cache.update_end - cbuf->cache.update_begin
+			);
+		}
+
+		glUnmapBuffer(target);
+	});
+
+	ring->mapping = NULL;
+	gl33_stats.buffer_uploads++;
+}
+
+static void gl33_stream_wait_oldest_fence(StreamRing *ring) {
+	assert(ring->num_fences > 0);
+	StreamFence *f = ring->fences + ring->first_fence;
+
+	for(;;) {
+		GLenum result = glClientWaitSync(f->sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+		if(result == GL_TIMEOUT_EXPIRED) {
+			continue;
+		}
+
+		if(result == GL_WAIT_FAILED) {
+			log_warn("glClientWaitSync() failed");
+		}
+
+		break;
+	}
+
+	glDeleteSync(f->sync);
+	ring->first_fence = (ring->first_fence + 1) % GL33_STREAM_MAX_FENCES;
+	--ring->num_fences;
+}
+
+static void gl33_stream_retire_fences(StreamRing *ring, size_t begin, size_t end) {
+	// Drop whatever the GPU is already done with, without waiting.
+	while(ring->num_fences > 0) {
+		StreamFence *f = ring->fences + ring->first_fence;
+
+		if(glClientWaitSync(f->sync, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+
+		gl33_stream_wait_oldest_fence(ring);
+	}
+
+	// Now wait until nothing overlaps the region we're about to write into.
+	// Fences are retired in order, so waiting on the oldest one always makes progress.
+	for(;;) {
+		bool overlap = false;
+
+		for(uint i = 0; i < ring->num_fences; ++i) {
+			StreamFence *f = ring->fences + (ring->first_fence + i) % GL33_STREAM_MAX_FENCES;
+
+			if(f->begin < end && begin < f->end) {
+				overlap = true;
+				break;
+			}
+		}
+
+		if(!overlap) {
+			break;
+		}
+
+		gl33_stream_wait_oldest_fence(ring);
+	}
+}
+
+static void gl33_stream_advance(CommonBuffer *cbuf) {
+	StreamRing *ring = cbuf->ring;
+
+	gl33_stream_unmap(cbuf);
+
+	if(ring->high_water > 0) {
+		size_t begin = ring->origin;
+
+		if(ring->num_fences == GL33_STREAM_MAX_FENCES) {
+			// A fence is only signaled once everything before it is done, so the new one can stand
+			// in for the newest one as well, if their ranges are adjacent. Only wait otherwise.
+			StreamFence *last = ring->fences + (ring->first_fence + ring->num_fences - 1) % GL33_STREAM_MAX_FENCES;
+
+			if(last->end <= ring->origin) {
+				begin = last->begin;
+				glDeleteSync(last->sync);
+				--ring->num_fences;
+			} else {
+				gl33_stream_wait_oldest_fence(ring);
+			}
+		}
+
+		StreamFence *f = ring->fences + (ring->first_fence + ring->num_fences++) % GL33_STREAM_MAX_FENCES;
+		f->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		f->begin = begin;
+		f->end = ring->origin + ring->high_water;
+
+		size_t origin = ring->origin + ring->high_water;
+		origin = ((origin + ring->alignment - 1) / ring->alignment) * ring->alignment;
+
+		if(origin + cbuf->size > ring->total_size) {
+			origin = 0;
+		}
+
+		ring->origin = origin;
+		ring->high_water = 0;
+	}
+
+	gl33_stream_retire_fences(ring, ring->origin, ring->origin + cbuf->size);
+}
+
 static int64_t gl33_buffer_stream_seek(SDL_RWops *rw, int64_t offset, int whence) {
 	CommonBuffer *cbuf = STREAM_CBUF(rw);
 
@@ -47,10 +236,19 @@ static size_t gl33_buffer_stream_write(SDL_RWops *rw, const void *data, size_t s
 	assert(cbuf->offset + total_size <= cbuf->size);
 
 	if(total_size > 0) {
-		memcpy(cbuf->cache.buffer + cbuf->offset, data, total_size);
+		if(cbuf->ring) {
+			memcpy(gl33_stream_map(cbuf, cbuf->offset), data, total_size);
+		} else {
+			memcpy(cbuf->cache.buffer + cbuf->offset, data, total_size);
+		}
+
 		cbuf->cache.update_begin = min(cbuf->offset, cbuf->cache.update_begin);
 		cbuf->cache.update_end = max(cbuf->offset + total_size, cbuf->cache.update_end);
 		cbuf->offset += total_size;
+
+		if(cbuf->ring) {
+			cbuf->ring->high_water = max(cbuf->ring->high_water, cbuf->offset);
+		}
 	}
 
 	return num;
@@ -70,20 +268,14 @@ SDL_RWops* gl33_buffer_get_stream(CommonBuffer *cbuf) {
 	return &cbuf->stream;
 }
 
-CommonBuffer* gl33_buffer_create(uint bindidx, size_t capacity, GLenum usage_hint, void *data) {
+static CommonBuffer* gl33_buffer_alloc(uint bindidx, size_t capacity) {
 	CommonBuffer *cbuf = calloc(1, sizeof(CommonBuffer));
-	cbuf->size = capacity = topow2(capacity);
-	cbuf->cache.buffer = calloc(1, capacity);
+	cbuf->size = capacity;
 	cbuf->cache.update_begin = capacity;
 	cbuf->bindidx = bindidx;
 
 	glGenBuffers(1, &cbuf->gl_handle);
 
-	GL33_BUFFER_TEMP_BIND(cbuf, {
-		assert(glIsBuffer(cbuf->gl_handle));
-		glBufferData(gl33_bindidx_to_glenum(bindidx), capacity, data, usage_hint);
-	});
-
 	cbuf->stream.type = SDL_RWOPS_UNKNOWN;
 	cbuf->stream.close = gl33_buffer_stream_close;
 	cbuf->stream.read = gl33_buffer_stream_read;
@@ -94,7 +286,81 @@ CommonBuffer* gl33_buffer_create(uint bindidx, size_t capacity, GLenum usage_hin
 	return cbuf;
 }
 
+CommonBuffer* gl33_buffer_create(uint bindidx, size_t capacity, GLenum usage_hint, void *data) {
+	CommonBuffer *cbuf = gl33_buffer_alloc(bindidx, capacity = topow2(capacity));
+	cbuf->cache.buffer = calloc(1, capacity);
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		assert(glIsBuffer(cbuf->gl_handle));
+		glBufferData(gl33_bindidx_to_glenum(bindidx), capacity, data, usage_hint);
+	});
+
+	return cbuf;
+}
+
+CommonBuffer* gl33_buffer_create_streaming(uint bindidx, size_t capacity) {
+	if(!(GL_ATLEAST(3, 2) || GLES_ATLEAST(3, 0))) {
+		// No fences or glMapBufferRange; fall back to orphaning.
+		return gl33_buffer_create(bindidx, capacity, GL_DYNAMIC_DRAW, NULL);
+	}
+
+	CommonBuffer *cbuf = gl33_buffer_alloc(bindidx, capacity = topow2(capacity));
+	StreamRing *ring = cbuf->ring = calloc(1, sizeof(*ring));
+	ring->total_size = capacity * GL33_STREAM_SEGMENTS;
+	ring->alignment = GL33_STREAM_ALIGNMENT;
+
+	if(bindidx == GL33_BUFFER_BINDING_UNIFORM) {
+		// Uniform blocks are bound at offsets into the window, which must be aligned like this.
+		GLint ubo_alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ubo_alignment);
+		ring->alignment = max(ring->alignment, (size_t)ubo_alignment);
+	}
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		assert(glIsBuffer(cbuf->gl_handle));
+		GLenum target = gl33_bindidx_to_glenum(bindidx);
+
+		if(glext.buffer_storage) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(target, ring->total_size, NULL, flags);
+			ring->mapping = glMapBufferRange(target, 0, ring->total_size, flags);
+			ring->persistent = ring->mapping != NULL;
+		}
+
+		if(!ring->persistent) {
+			if(glext.buffer_storage) {
+				// The storage is immutable now, so we need a new buffer object.
+				log_warn("Persistent mapping failed, falling back to unsynchronized mapping");
+				glDeleteBuffers(1, &cbuf->gl_handle);
+				glGenBuffers(1, &cbuf->gl_handle);
+				gl33_bind_buffer(bindidx, cbuf->gl_handle);
+				gl33_sync_buffer(bindidx);
+			}
+
+			glBufferData(target, ring->total_size, NULL, GL_STREAM_DRAW);
+		}
+	});
+
+	return cbuf;
+}
+
 void gl33_buffer_destroy(CommonBuffer *cbuf) {
+	if(cbuf->ring) {
+		StreamRing *ring = cbuf->ring;
+
+		for(uint i = 0; i < ring->num_fences; ++i) {
+			glDeleteSync(ring->fences[(ring->first_fence + i) % GL33_STREAM_MAX_FENCES].sync);
+		}
+
+		if(ring->mapping) {
+			GL33_BUFFER_TEMP_BIND(cbuf, {
+				glUnmapBuffer(gl33_bindidx_to_glenum(cbuf->bindidx));
+			});
+		}
+
+		free(ring);
+	}
+
 	free(cbuf->cache.buffer);
 	gl33_buffer_deleted(cbuf);
 	glDeleteBuffers(1, &cbuf->gl_handle);
@@ -102,17 +368,36 @@ void gl33_buffer_destroy(CommonBuffer *cbuf) {
 }
 
 void gl33_buffer_invalidate(CommonBuffer *cbuf) {
-	GL33_BUFFER_TEMP_BIND(cbuf, {
-		glBufferData(gl33_bindidx_to_glenum(cbuf->bindidx), cbuf->size, NULL, GL_DYNAMIC_DRAW);
-	});
+	if(cbuf->ring) {
+		gl33_stream_advance(cbuf);
+		cbuf->cache.update_begin = cbuf->size;
+		cbuf->cache.update_end = 0;
+	} else {
+		GL33_BUFFER_TEMP_BIND(cbuf, {
+			glBufferData(gl33_bindidx_to_glenum(cbuf->bindidx), cbuf->size, NULL, GL_DYNAMIC_DRAW);
+		});
+	}
+
 	cbuf->offset = 0;
 }
 
+size_t gl33_buffer_stream_origin(CommonBuffer *cbuf) {
+	return cbuf->ring ? cbuf->ring->origin : 0;
+}
+
 void gl33_buffer_flush(CommonBuffer *cbuf) {
 	if(cbuf->cache.update_begin >= cbuf->cache.update_end) {
 		return;
 	}
 
+	if(cbuf->ring) {
+		// The persistent mapping is coherent, so there's nothing to do in that case.
+		gl33_stream_unmap(cbuf);
+		cbuf->cache.update_begin = cbuf->size;
+		cbuf->cache.update_end = 0;
+		return;
+	}
+
 	size_t update_size = cbuf->cache.update_end - cbuf->cache.update_begin;
 	assert(update_size > 0);
 
@@ -125,6 +410,8 @@ void gl33_buffer_flush(CommonBuffer *cbuf) {
 		);
 	});
 
+	gl33_stats.buffer_uploads++;
+
 	cbuf->cache.update_begin = cbuf->size;
 	cbuf->cache.update_end = 0;
 }
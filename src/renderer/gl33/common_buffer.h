@@ -14,6 +14,8 @@
 #include "opengl.h"
 #include "../api.h"
 
+typedef struct StreamRing StreamRing;
+
 typedef struct CommonBuffer {
 	union {
 		SDL_RWops stream;
@@ -26,6 +28,9 @@ typedef struct CommonBuffer {
 				size_t update_end;
 			} cache;
 
+			// Only set for streaming buffers, if the driver supports them.
+			StreamRing *ring;
+
 			size_t offset;
 			size_t size;
 			GLuint gl_handle;
@@ -41,10 +46,12 @@ static_assert(
 );
 
 CommonBuffer* gl33_buffer_create(uint bindidx, size_t capacity, GLenum usage_hint, void *data);
+CommonBuffer* gl33_buffer_create_streaming(uint bindidx, size_t capacity);
 void gl33_buffer_destroy(CommonBuffer *cbuf);
 void gl33_buffer_invalidate(CommonBuffer *cbuf);
 SDL_RWops* gl33_buffer_get_stream(CommonBuffer *cbuf);
 void gl33_buffer_flush(CommonBuffer *cbuf);
+size_t gl33_buffer_stream_origin(CommonBuffer *cbuf);
 
 #define GL33_BUFFER_TEMP_BIND(cbuf, code) do { \
 	CommonBuffer *_tempbind_cbuf = (cbuf); \
@@ -45,6 +45,7 @@ attr_unused static inline char* attachment_str(FramebufferAttachment a) {
 void gl33_framebuffer_attach(Framebuffer *framebuffer, Texture *tex, uint mipmap, FramebufferAttachment attachment) {
 	assert(attachment >= 0 && attachment < FRAMEBUFFER_MAX_ATTACHMENTS);
 	assert(!tex || mipmap < tex->params.mipmaps);
+	assert(!tex || tex->params.layers == 0);
 
 	GLuint gl_tex = tex ? tex->gl_handle : 0;
 	Framebuffer *prev_fb = r_framebuffer_current();
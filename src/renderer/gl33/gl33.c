@@ -33,6 +33,7 @@ typedef struct TextureUnit {
 
 	struct {
 		GLuint gl_handle;
+		GLenum gl_target;
 		Texture *active;
 		Texture *pending;
 		bool locked;
@@ -110,15 +111,26 @@ static struct {
 
 	SDL_GLContext *gl_context;
 
+	// Streams RenderContextBlocks, if uniform buffers are supported. Every change of the state
+	// is written to a new slot, and the binding is moved to it.
+	struct {
+		CommonBuffer *ubo;
+		RenderContextBlock block; // the one that's bound
+		size_t stride;
+	} render_context;
+
+	RendererStats last_frame_stats;
+
 	#ifdef GL33_DRAW_STATS
 	struct {
 		hrtime_t last_draw;
 		hrtime_t draw_time;
-		uint draw_calls;
 	} stats;
 	#endif
 } R;
 
+RendererStats gl33_stats;
+
 /*
  * Internal functions
  */
@@ -168,9 +180,10 @@ static inline GLenum r_cull_to_gl_cull(CullFaceMode mode) {
 }
 
 static inline void gl33_stats_pre_draw(void) {
+	gl33_stats.draw_calls++;
+
 	#ifdef GL33_DRAW_STATS
 	R.stats.last_draw = time_get();
-	R.stats.draw_calls++;
 	#endif
 }
 
@@ -182,9 +195,12 @@ static inline void gl33_stats_post_draw(void) {
 
 static inline void gl33_stats_post_frame(void) {
 	#ifdef GL33_DRAW_STATS
-	log_debug("%.20gs spent in %u draw calls", (double)R.stats.draw_time, R.stats.draw_calls);
+	log_debug("%.20gs spent in %u draw calls", (double)R.stats.draw_time, gl33_stats.draw_calls);
 	memset(&R.stats, 0, sizeof(R.stats));
 	#endif
+
+	R.last_frame_stats = gl33_stats;
+	memset(&gl33_stats, 0, sizeof(gl33_stats));
 }
 
 static void gl33_init_texunits(void) {
@@ -223,6 +239,54 @@ static void gl33_init_texunits(void) {
 	log_info("Using %i texturing units (%i available)", R.texunits.limit, texunits_available);
 }
 
+static void gl33_write_render_context(const RenderContextBlock *block) {
+	CommonBuffer *ubo = R.render_context.ubo;
+	size_t stride = R.render_context.stride;
+	size_t offset = ((ubo->offset + stride - 1) / stride) * stride;
+
+	if(offset + sizeof(*block) > ubo->size) {
+		// Moves on to a fresh window of the ring; the old one stays intact until the GPU is done.
+		gl33_buffer_invalidate(ubo);
+		offset = 0;
+	}
+
+	SDL_RWops *stream = gl33_buffer_get_stream(ubo);
+	SDL_RWseek(stream, offset, RW_SEEK_SET);
+	SDL_RWwrite(stream, block, sizeof(*block), 1);
+	gl33_buffer_flush(ubo);
+
+	// This also binds the buffer to the generic binding point, so keep the cache in sync.
+	gl33_bind_buffer(GL33_BUFFER_BINDING_UNIFORM, ubo->gl_handle);
+	gl33_sync_buffer(GL33_BUFFER_BINDING_UNIFORM);
+	glBindBufferRange(
+		GL_UNIFORM_BUFFER,
+		GL33_UBO_BINDING_RENDER_CONTEXT,
+		ubo->gl_handle,
+		gl33_buffer_stream_origin(ubo) + offset,
+		sizeof(*block)
+	);
+
+	R.render_context.block = *block;
+}
+
+static void gl33_init_render_context_ubo(void) {
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	size_t stride = sizeof(RenderContextBlock);
+	alignment = imax(1, alignment);
+	stride = ((stride + alignment - 1) / alignment) * alignment;
+
+	// Room for a few hundred state changes before the window has to move.
+	CommonBuffer *ubo = gl33_buffer_create_streaming(GL33_BUFFER_BINDING_UNIFORM, stride * 256);
+	glcommon_set_debug_label(ubo->debug_label, "UBO", GL_BUFFER, ubo->gl_handle, "Render context UBO");
+
+	R.render_context.ubo = ubo;
+	R.render_context.stride = stride;
+
+	gl33_write_render_context(&(RenderContextBlock) { 0 });
+}
+
 static void gl33_init_context(SDL_Window *window) {
 	R.gl_context = SDL_GL_CreateContext(window);
 
@@ -272,6 +336,15 @@ static void gl33_init_context(SDL_Window *window) {
 	if(glext.clear_texture) {
 		_r_backend.funcs.texture_clear = gl44_texture_clear;
 	}
+
+	if(glext.uniform_buffer_object) {
+		R.features |= r_feature_bit(RFEAT_UNIFORM_BUFFERS);
+		gl33_init_render_context_ubo();
+	}
+
+	if(glext.texture_array) {
+		R.features |= r_feature_bit(RFEAT_TEXTURE_ARRAYS);
+	}
 }
 
 static void gl33_apply_capability(RendererCapability cap, bool value) {
@@ -309,13 +382,37 @@ static void gl33_sync_viewport(void) {
 	}
 }
 
+static void gl33_sync_render_context(void) {
+	ShaderProgram *prog = R.progs.active;
+
+	if(!prog->uses_render_context_block) {
+		r_uniform_mat4(prog->magic_uniforms[UMAGIC_MATRIX_MV], *_r_matrices.modelview.head);
+		r_uniform_mat4(prog->magic_uniforms[UMAGIC_MATRIX_PROJ], *_r_matrices.projection.head);
+		r_uniform_mat4(prog->magic_uniforms[UMAGIC_MATRIX_TEX], *_r_matrices.texture.head);
+		r_uniform_vec4_rgba(prog->magic_uniforms[UMAGIC_COLOR], &R.color);
+		return;
+	}
+
+	RenderContextBlock block;
+	memcpy(block.modelview, *_r_matrices.modelview.head, sizeof(block.modelview));
+	memcpy(block.projection, *_r_matrices.projection.head, sizeof(block.projection));
+	memcpy(block.texture, *_r_matrices.texture.head, sizeof(block.texture));
+	block.color[0] = R.color.r;
+	block.color[1] = R.color.g;
+	block.color[2] = R.color.b;
+	block.color[3] = R.color.a;
+
+	// The block is shared by all programs, so this only writes anything when the state changes,
+	// not whenever a different program is used.
+	if(memcmp(&R.render_context.block, &block, sizeof(block))) {
+		gl33_write_render_context(&block);
+	}
+}
+
 static void gl33_sync_state(void) {
 	gl33_sync_capabilities();
 	gl33_sync_shader();
-	r_uniform_mat4("r_modelViewMatrix", *_r_matrices.modelview.head);
-	r_uniform_mat4("r_projectionMatrix", *_r_matrices.projection.head);
-	r_uniform_mat4("r_textureMatrix", *_r_matrices.texture.head);
-	r_uniform_vec4_rgba("r_color", &R.color);
+	gl33_sync_render_context();
 	gl33_sync_uniforms(R.progs.active);
 	gl33_sync_texunits(true);
 	gl33_sync_framebuffer();
@@ -482,15 +579,24 @@ void gl33_sync_texunit(TextureUnit *unit, bool prepare_rendering, bool ensure_ac
 	if(tex == NULL) {
 		if(unit->tex2d.gl_handle != 0) {
 			gl33_activate_texunit(unit);
-			glBindTexture(GL_TEXTURE_2D, 0);
+			glBindTexture(unit->tex2d.gl_target, 0);
+			gl33_stats.texture_binds++;
 			unit->tex2d.gl_handle = 0;
 			unit->tex2d.active = NULL;
 			gl33_relocate_texuint(unit);
 		}
 	} else if(unit->tex2d.gl_handle != tex->gl_handle) {
 		gl33_activate_texunit(unit);
-		glBindTexture(GL_TEXTURE_2D, tex->gl_handle);
+
+		if(unit->tex2d.gl_handle != 0 && unit->tex2d.gl_target != tex->gl_target) {
+			// Don't leave the previous texture bound to the other target of this unit.
+			glBindTexture(unit->tex2d.gl_target, 0);
+		}
+
+		glBindTexture(tex->gl_target, tex->gl_handle);
+		gl33_stats.texture_binds++;
 		unit->tex2d.gl_handle = tex->gl_handle;
+		unit->tex2d.gl_target = tex->gl_target;
 
 		if(unit->tex2d.active == NULL) {
 			unit->tex2d.active = tex;
@@ -526,6 +632,7 @@ GLenum gl33_bindidx_to_glenum(BufferBindingIndex bindidx) {
 		[GL33_BUFFER_BINDING_ARRAY] = GL_ARRAY_BUFFER,
 		[GL33_BUFFER_BINDING_COPY_WRITE] = GL_COPY_WRITE_BUFFER,
 		[GL33_BUFFER_BINDING_PIXEL_UNPACK] = GL_PIXEL_UNPACK_BUFFER,
+		[GL33_BUFFER_BINDING_UNIFORM] = GL_UNIFORM_BUFFER,
 	};
 
 	static_assert(sizeof(map) == sizeof(GLenum) * GL33_NUM_BUFFER_BINDINGS, "Fix the lookup table");
@@ -594,6 +701,7 @@ void gl33_sync_framebuffer(void) {
 void gl33_sync_shader(void) {
 	if(R.progs.pending && R.progs.gl_prog != R.progs.pending->gl_handle) {
 		glUseProgram(R.progs.pending->gl_handle);
+		gl33_stats.shader_switches++;
 		R.progs.gl_prog = R.progs.pending->gl_handle;
 		R.progs.active = R.progs.pending;
 	}
@@ -784,6 +892,11 @@ static void gl33_post_init(void) {
 }
 
 static void gl33_shutdown(void) {
+	if(R.render_context.ubo) {
+		gl33_buffer_destroy(R.render_context.ubo);
+		R.render_context.ubo = NULL;
+	}
+
 	glcommon_unload_library();
 	SDL_GL_DeleteContext(R.gl_context);
 }
@@ -967,6 +1080,10 @@ static void gl33_swap(SDL_Window *window) {
 	gl33_stats_post_frame();
 }
 
+static void gl33_frame_stats(RendererStats *stats) {
+	*stats = R.last_frame_stats;
+}
+
 static void gl33_blend(BlendMode mode) {
 	R.blend.mode.pending = mode;
 }
@@ -1038,6 +1155,7 @@ RendererBackend _r_backend_gl33 = {
 		.uniform_type = gl33_uniform_type,
 		.texture_create = gl33_texture_create,
 		.texture_get_size = gl33_texture_get_size,
+		.texture_get_layers = gl33_texture_get_layers,
 		.texture_get_params = gl33_texture_get_params,
 		.texture_get_debug_label = gl33_texture_get_debug_label,
 		.texture_set_debug_label = gl33_texture_set_debug_label,
@@ -1047,6 +1165,7 @@ RendererBackend _r_backend_gl33 = {
 		.texture_invalidate = gl33_texture_invalidate,
 		.texture_fill = gl33_texture_fill,
 		.texture_fill_region = gl33_texture_fill_region,
+		.texture_fill_layer = gl33_texture_fill_layer,
 		.texture_clear = gl33_texture_clear,
 		.framebuffer_create = gl33_framebuffer_create,
 		.framebuffer_destroy = gl33_framebuffer_destroy,
@@ -1061,6 +1180,7 @@ RendererBackend _r_backend_gl33 = {
 		.framebuffer_current = gl33_framebuffer_current,
 		.framebuffer_clear = gl33_framebuffer_clear,
 		.vertex_buffer_create = gl33_vertex_buffer_create,
+		.vertex_buffer_create_streaming = gl33_vertex_buffer_create_streaming,
 		.vertex_buffer_set_debug_label = gl33_vertex_buffer_set_debug_label,
 		.vertex_buffer_get_debug_label = gl33_vertex_buffer_get_debug_label,
 		.vertex_buffer_destroy = gl33_vertex_buffer_destroy,
@@ -1087,6 +1207,7 @@ RendererBackend _r_backend_gl33 = {
 		.vsync_current = gl33_vsync_current,
 		.swap = gl33_swap,
 		.screenshot = gl33_screenshot,
+		.frame_stats = gl33_frame_stats,
 	},
 	.custom = &(GLBackendData) {
 		.vtable = {
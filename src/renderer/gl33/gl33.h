@@ -23,10 +23,19 @@ typedef enum BufferBindingIndex {
 	GL33_BUFFER_BINDING_ARRAY,
 	GL33_BUFFER_BINDING_COPY_WRITE,
 	GL33_BUFFER_BINDING_PIXEL_UNPACK,
+	GL33_BUFFER_BINDING_UNIFORM,
 
 	GL33_NUM_BUFFER_BINDINGS
 } BufferBindingIndex;
 
+// Uniform block binding points
+enum {
+	GL33_UBO_BINDING_RENDER_CONTEXT,
+};
+
+// Driver calls made so far in the current frame.
+extern RendererStats gl33_stats;
+
 // Internal helper functions
 
 GLenum gl33_prim_to_gl_prim(Primitive prim);
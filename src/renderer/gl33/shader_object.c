@@ -58,25 +58,12 @@ static void print_info_log(GLuint shader) {
 	}
 }
 
-ShaderObject* gl33_shader_object_compile(ShaderSource *source) {
-	assert(r_shader_language_supported(&source->lang, NULL));
-
-	GLuint gl_handle = glCreateShader(
-		source->stage == SHADER_STAGE_VERTEX
-			? GL_VERTEX_SHADER
-			: GL_FRAGMENT_SHADER
-	);
+bool gl33_program_binary_cache_enabled(void) {
+	return glext.get_program_binary && shader_cache_enabled();
+}
 
+static bool compile_shader(GLuint gl_handle) {
 	GLint status;
-
-	// log_debug("Source code for %s:\n%s", path, source->content);
-
-	glShaderSource(
-		gl_handle, 1,
-		(const GLchar*[]) { source->content },
-		(GLint[])         { source->content_size - 1 }
-	);
-
 	glCompileShader(gl_handle);
 
 #ifdef DEBUG
@@ -95,20 +82,78 @@ ShaderObject* gl33_shader_object_compile(ShaderSource *source) {
 	glGetShaderiv(gl_handle, GL_COMPILE_STATUS, &status);
 	print_info_log(gl_handle);
 
-	ShaderObject *shobj = NULL;
+	return status;
+}
+
+// An empty cache entry recording that a program binary built from this source has been cached.
+// Such sources are known to compile, and will most likely not have to.
+static ShaderCacheKey binary_cached_marker_key(ShaderCacheKey source_key) {
+	ShaderCacheKey key = shader_cache_key("gl_shader_object_binary_cached");
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_VENDOR));
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_RENDERER));
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_VERSION));
+	return shader_cache_key_add(key, sizeof(source_key), &source_key);
+}
+
+ShaderObject* gl33_shader_object_compile(ShaderSource *source) {
+	assert(r_shader_language_supported(&source->lang, NULL));
+
+	GLuint gl_handle = glCreateShader(
+		source->stage == SHADER_STAGE_VERTEX
+			? GL_VERTEX_SHADER
+			: GL_FRAGMENT_SHADER
+	);
+
+	// log_debug("Source code for %s:\n%s", path, source->content);
+
+	glShaderSource(
+		gl_handle, 1,
+		(const GLchar*[]) { source->content },
+		(GLint[])         { source->content_size - 1 }
+	);
 
-	if(status) {
-		shobj = calloc(1, sizeof(*shobj));
-		shobj->gl_handle = gl_handle;
-		shobj->stage = source->stage;
-		snprintf(shobj->debug_label, sizeof(shobj->debug_label), "Shader object #%i", gl_handle);
-	} else {
+	ShaderCacheKey source_key = 0;
+	bool defer = false;
+
+	if(gl33_program_binary_cache_enabled()) {
+		source_key = shader_cache_key_add_source(shader_cache_key("gl_shader_object"), source);
+		defer = shader_cache_contains(binary_cached_marker_key(source_key));
+	}
+
+	// Anything not known to compile is compiled right away, so that errors show up here.
+	if(!defer && !compile_shader(gl_handle)) {
 		glDeleteShader(gl_handle);
+		return NULL;
 	}
 
+	ShaderObject *shobj = calloc(1, sizeof(*shobj));
+	shobj->gl_handle = gl_handle;
+	shobj->stage = source->stage;
+	shobj->compiled = !defer;
+	shobj->source_key = source_key;
+	snprintf(shobj->debug_label, sizeof(shobj->debug_label), "Shader object #%i", gl_handle);
+
 	return shobj;
 }
 
+bool gl33_shader_object_ensure_compiled(ShaderObject *shobj) {
+	if(!shobj->compiled) {
+		if(!compile_shader(shobj->gl_handle)) {
+			log_warn("%s: compilation failed", shobj->debug_label);
+			return false;
+		}
+
+		shobj->compiled = true;
+	}
+
+	return true;
+}
+
+void gl33_shader_object_mark_binary_cached(ShaderObject *shobj) {
+	assert(gl33_program_binary_cache_enabled());
+	shader_cache_write(binary_cached_marker_key(shobj->source_key), 0, "", 0);
+}
+
 void gl33_shader_object_destroy(ShaderObject *shobj) {
 	glDeleteShader(shobj->gl_handle);
 	free(shobj);
@@ -13,16 +13,28 @@
 
 #include "resource/shader_object.h"
 #include "opengl.h"
+#include "../common/shader_cache.h"
 
 struct ShaderObject {
 	GLuint gl_handle;
 	ShaderStage stage;
+
+	// Identifies the source for the program binary cache. If that's in use, and this source has
+	// gone into a cached program binary before, compilation is put off until the object is
+	// actually needed to link a program that isn't cached.
+	ShaderCacheKey source_key;
+	bool compiled;
+
 	char debug_label[R_DEBUG_LABEL_SIZE];
 };
 
 bool gl33_shader_language_supported(const ShaderLangInfo *lang, ShaderLangInfo *out_alternative);
 
+bool gl33_program_binary_cache_enabled(void);
+
 ShaderObject* gl33_shader_object_compile(ShaderSource *source);
+bool gl33_shader_object_ensure_compiled(ShaderObject *shobj);
+void gl33_shader_object_mark_binary_cached(ShaderObject *shobj);
 void gl33_shader_object_destroy(ShaderObject *shobj);
 void gl33_shader_object_set_debug_label(ShaderObject *shobj, const char *label);
 const char* gl33_shader_object_get_debug_label(ShaderObject *shobj);
@@ -12,6 +12,7 @@
 #include "shader_program.h"
 #include "shader_object.h"
 #include "../glcommon/debug.h"
+#include "../common/sprite_batch.h"
 #include "../api.h"
 
 static Uniform *sampler_uniforms;
@@ -158,12 +159,14 @@ typedef struct MagicalUniform {
 } MagicalUniform;
 
 static MagicalUniform magical_unfiroms[] = {
-	{ "r_modelViewMatrix",  "mat4", UNIFORM_MAT4 },
-	{ "r_projectionMatrix", "mat4", UNIFORM_MAT4 },
-	{ "r_textureMatrix",    "mat4", UNIFORM_MAT4 },
-	{ "r_color",            "vec4", UNIFORM_VEC4 },
+	[UMAGIC_MATRIX_MV]   = { "r_modelViewMatrix",  "mat4", UNIFORM_MAT4 },
+	[UMAGIC_MATRIX_PROJ] = { "r_projectionMatrix", "mat4", UNIFORM_MAT4 },
+	[UMAGIC_MATRIX_TEX]  = { "r_textureMatrix",    "mat4", UNIFORM_MAT4 },
+	[UMAGIC_COLOR]       = { "r_color",            "vec4", UNIFORM_VEC4 },
 };
 
+static_assert(sizeof(magical_unfiroms)/sizeof(MagicalUniform) == NUM_MAGIC_UNIFORMS, "Fix the magical uniforms table");
+
 static void gl33_update_uniform(Uniform *uniform, uint offset, uint count, const void *data) {
 	// these are validated properly in gl33_uniform
 	assert(offset < uniform->array_size);
@@ -199,6 +202,7 @@ static void gl33_commit_uniform(Uniform *uniform) {
 
 	if(memcmp(uniform->cache.commited + update_ofs, uniform->cache.pending + update_ofs, update_sz)) {
 		memcpy(uniform->cache.commited + update_ofs, uniform->cache.pending + update_ofs, update_sz);
+		gl33_stats.uniform_uploads++;
 
 		type_to_accessors[uniform->type].setter(
 			uniform,
@@ -212,9 +216,7 @@ static void gl33_commit_uniform(Uniform *uniform) {
 	uniform->cache.update_last_idx = 0;
 }
 
-static void* gl33_sync_uniform(const char *key, void *value, void *arg) {
-	Uniform *uniform = value;
-
+static void gl33_sync_uniform(Uniform *uniform) {
 	// special case: for sampler uniforms, we have to construct the actual data from the texture pointers array.
 	if(uniform->type == UNIFORM_SAMPLER) {
 		for(uint i = 0; i < uniform->array_size; ++i) {
@@ -230,11 +232,12 @@ static void* gl33_sync_uniform(const char *key, void *value, void *arg) {
 	}
 
 	gl33_commit_uniform(uniform);
-	return NULL;
 }
 
 void gl33_sync_uniforms(ShaderProgram *prog) {
-	ht_foreach(&prog->uniforms, gl33_sync_uniform, NULL);
+	for(uint i = 0; i < prog->num_uniforms; ++i) {
+		gl33_sync_uniform(prog->uniform_list[i]);
+	}
 }
 
 void gl33_uniform(Uniform *uniform, uint offset, uint count, const void *data) {
@@ -256,8 +259,17 @@ void gl33_uniform(Uniform *uniform, uint offset, uint count, const void *data) {
 	// special case: for sampler uniforms, data is an array of Texture pointers that we'll have to bind later.
 	if(uniform->type == UNIFORM_SAMPLER) {
 		Texture **textures = (Texture**)data;
+
+		if(memcmp(uniform->textures + offset, textures, sizeof(Texture*) * count)) {
+			_r_sprite_batch_uniform_changed(uniform->prog);
+		}
+
 		memcpy(uniform->textures + offset, textures, sizeof(Texture*) * count);
 	} else {
+		if(memcmp(uniform->cache.pending + offset, data, count * uniform->elem_size)) {
+			_r_sprite_batch_uniform_changed(uniform->prog);
+		}
+
 		gl33_update_uniform(uniform, offset, count, data);
 	}
 }
@@ -300,6 +312,7 @@ static bool cache_uniforms(ShaderProgram *prog) {
 			case GL_INT_VEC3:   uni.type = UNIFORM_IVEC3;   break;
 			case GL_INT_VEC4:   uni.type = UNIFORM_IVEC4;   break;
 			case GL_SAMPLER_2D: uni.type = UNIFORM_SAMPLER; break;
+			case GL_SAMPLER_2D_ARRAY: uni.type = UNIFORM_SAMPLER; break;
 			case GL_FLOAT_MAT3: uni.type = UNIFORM_MAT3;    break;
 			case GL_FLOAT_MAT4: uni.type = UNIFORM_MAT4;    break;
 
@@ -342,12 +355,41 @@ static bool cache_uniforms(ShaderProgram *prog) {
 		}
 
 		ht_set(&prog->uniforms, name, new_uni);
+		prog->uniform_list = realloc(prog->uniform_list, sizeof(*prog->uniform_list) * (prog->num_uniforms + 1));
+		prog->uniform_list[prog->num_uniforms++] = new_uni;
 		log_debug("%s = %i [array elements: %i; size: %zi bytes]", name, loc, uni.array_size, uni.array_size * uni.elem_size);
 	}
 
 	return true;
 }
 
+static bool cache_render_context(ShaderProgram *prog) {
+	if(glext.uniform_buffer_object) {
+		GLuint idx = glGetUniformBlockIndex(prog->gl_handle, "RenderContext");
+
+		if(idx != GL_INVALID_INDEX) {
+			GLint size = 0;
+			glGetActiveUniformBlockiv(prog->gl_handle, idx, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+
+			if(size != sizeof(RenderContextBlock)) {
+				log_warn("Uniform block 'RenderContext' is %i bytes large, expected %zu", size, sizeof(RenderContextBlock));
+				return false;
+			}
+
+			glUniformBlockBinding(prog->gl_handle, idx, GL33_UBO_BINDING_RENDER_CONTEXT);
+			prog->uses_render_context_block = true;
+			return true;
+		}
+	}
+
+	// Resolved here, so that they needn't be looked up by name before every draw.
+	for(uint i = 0; i < NUM_MAGIC_UNIFORMS; ++i) {
+		prog->magic_uniforms[i] = ht_get(&prog->uniforms, magical_unfiroms[i].name, NULL);
+	}
+
+	return true;
+}
+
 void gl33_unref_texture_from_samplers(Texture *tex) {
 	for(Uniform *u = sampler_uniforms; u; u = u->next) {
 		assert(u->type == UNIFORM_SAMPLER);
@@ -396,33 +438,133 @@ void gl33_shader_program_destroy(ShaderProgram *prog) {
 	glDeleteProgram(prog->gl_handle);
 	ht_foreach(&prog->uniforms, free_uniform, NULL);
 	ht_destroy(&prog->uniforms);
+	free(prog->uniform_list);
 	free(prog);
 }
 
+static ShaderCacheKey program_binary_key(uint num_objects, ShaderObject *shobjs[num_objects]) {
+	// Binaries are only valid for the driver that produced them.
+	ShaderCacheKey key = shader_cache_key("gl_program");
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_VENDOR));
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_RENDERER));
+	key = shader_cache_key_add_str(key, (const char*)glGetString(GL_VERSION));
+
+	for(uint i = 0; i < num_objects; ++i) {
+		key = shader_cache_key_add(key, sizeof(shobjs[i]->source_key), &shobjs[i]->source_key);
+	}
+
+	return key;
+}
+
+static bool load_program_binary(GLuint gl_handle, ShaderCacheKey key) {
+	size_t size;
+	void *data;
+
+	if(!shader_cache_read(key, &size, &data)) {
+		return false;
+	}
+
+	// The entry starts with the binary format.
+	bool ok = false;
+
+	if(size > sizeof(GLenum)) {
+		GLenum format;
+		memcpy(&format, data, sizeof(format));
+		glProgramBinary(gl_handle, format, (char*)data + sizeof(format), size - sizeof(format));
+
+		GLint link_status;
+		glGetProgramiv(gl_handle, GL_LINK_STATUS, &link_status);
+		ok = link_status;
+	}
+
+	if(!ok) {
+		// E.g. after a driver update that didn't change the version string.
+		log_debug("Cached program binary rejected by the driver, linking from source");
+	}
+
+	free(data);
+	return ok;
+}
+
+static void save_program_binary(GLuint gl_handle, ShaderCacheKey key, hrtime_t cost, uint num_objects, ShaderObject *shobjs[num_objects]) {
+	GLint length = 0;
+	glGetProgramiv(gl_handle, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if(length < 1) {
+		return;
+	}
+
+	GLenum format;
+	char *data = malloc(sizeof(format) + length);
+	glGetProgramBinary(gl_handle, length, &length, &format, data + sizeof(format));
+	memcpy(data, &format, sizeof(format));
+
+	if(length > 0) {
+		shader_cache_write(key, sizeof(format) + length, data, cost);
+
+		// From now on, these objects may put off compiling until they're actually needed.
+		for(uint i = 0; i < num_objects; ++i) {
+			gl33_shader_object_mark_binary_cached(shobjs[i]);
+		}
+	}
+
+	free(data);
+}
+
+static bool link_program(GLuint gl_handle, uint num_objects, ShaderObject *shobjs[num_objects]) {
+	for(uint i = 0; i < num_objects; ++i) {
+		if(!gl33_shader_object_ensure_compiled(shobjs[i])) {
+			return false;
+		}
+
+		glAttachShader(gl_handle, shobjs[i]->gl_handle);
+	}
+
+	glLinkProgram(gl_handle);
+	print_info_log(gl_handle);
+
+	GLint link_status;
+	glGetProgramiv(gl_handle, GL_LINK_STATUS, &link_status);
+	return link_status;
+}
+
 ShaderProgram* gl33_shader_program_link(uint num_objects, ShaderObject *shobjs[num_objects]) {
 	ShaderProgram *prog = calloc(1, sizeof(*prog));
 
 	prog->gl_handle = glCreateProgram();
 	snprintf(prog->debug_label, sizeof(prog->debug_label), "Shader program #%i", prog->gl_handle);
 
-	for(int i = 0; i < num_objects; ++i) {
-		glAttachShader(prog->gl_handle, shobjs[i]->gl_handle);
+	bool use_binary_cache = gl33_program_binary_cache_enabled();
+	bool linked = false;
+	ShaderCacheKey binary_key = 0;
+
+	if(use_binary_cache) {
+		binary_key = program_binary_key(num_objects, shobjs);
+		linked = load_program_binary(prog->gl_handle, binary_key);
 	}
 
-	glLinkProgram(prog->gl_handle);
-	print_info_log(prog->gl_handle);
+	if(!linked) {
+		hrtime_t time_begin = time_get();
 
-	GLint link_status;
-	glGetProgramiv(prog->gl_handle, GL_LINK_STATUS, &link_status);
+		if(use_binary_cache) {
+			glProgramParameteri(prog->gl_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		linked = link_program(prog->gl_handle, num_objects, shobjs);
+
+		if(linked && use_binary_cache) {
+			save_program_binary(prog->gl_handle, binary_key, time_get() - time_begin, num_objects, shobjs);
+		}
+	}
 
-	if(!link_status) {
+	if(!linked) {
 		log_warn("Failed to link the shader program");
 		glDeleteProgram(prog->gl_handle);
 		free(prog);
 		return NULL;
 	}
 
-	if(!cache_uniforms(prog)) {
+	if(!cache_uniforms(prog) || !cache_render_context(prog)) {
 		gl33_shader_program_destroy(prog);
 		return NULL;
 	}
@@ -17,9 +17,38 @@
 #include "opengl.h"
 #include "resource/shader_program.h"
 
+// Uniforms that are set by the renderer itself before every draw.
+typedef enum MagicUniformIndex {
+	UMAGIC_MATRIX_MV,
+	UMAGIC_MATRIX_PROJ,
+	UMAGIC_MATRIX_TEX,
+	UMAGIC_COLOR,
+
+	NUM_MAGIC_UNIFORMS,
+} MagicUniformIndex;
+
+// The same uniforms as a std140 block; see RenderContext in res/shader/lib/render_context.glslh.
+typedef struct RenderContextBlock {
+	mat4_noalign modelview;
+	mat4_noalign projection;
+	mat4_noalign texture;
+	vec4_noalign color;
+} RenderContextBlock;
+
+static_assert(sizeof(RenderContextBlock) == 208, "RenderContextBlock must match the std140 layout");
+
 struct ShaderProgram {
 	GLuint gl_handle;
 	ht_str2ptr_t uniforms;
+
+	// Same as above, for iterating over them when syncing.
+	Uniform **uniform_list;
+	uint num_uniforms;
+
+	// NULL if the program doesn't use them, or gets them from the RenderContext block.
+	Uniform *magic_uniforms[NUM_MAGIC_UNIFORMS];
+	bool uses_render_context_block;
+
 	char debug_label[R_DEBUG_LABEL_SIZE];
 };
 
@@ -117,6 +117,40 @@ void gl33_texture_get_size(Texture *tex, uint mipmap, uint *width, uint *height)
 	}
 }
 
+static void gl33_texture_alloc_storage(Texture *tex) {
+	for(uint i = 0; i < tex->params.mipmaps; ++i) {
+		uint width, height;
+		gl33_texture_get_size(tex, i, &width, &height);
+
+		if(tex->params.layers) {
+			glTexImage3D(
+				GL_TEXTURE_2D_ARRAY,
+				i,
+				tex->type_info->internal_fmt,
+				width,
+				height,
+				tex->params.layers,
+				0,
+				tex->type_info->primary_external_format.gl_fmt,
+				tex->type_info->primary_external_format.gl_type,
+				NULL
+			);
+		} else {
+			glTexImage2D(
+				GL_TEXTURE_2D,
+				i,
+				tex->type_info->internal_fmt,
+				width,
+				height,
+				0,
+				tex->type_info->primary_external_format.gl_fmt,
+				tex->type_info->primary_external_format.gl_type,
+				NULL
+			);
+		}
+	}
+}
+
 static GLTextureFormatTuple* prepare_pixmap(Texture *tex, const Pixmap *px_in, Pixmap *px_out) {
 	GLTextureFormatTuple *fmt = glcommon_find_best_pixformat(tex->params.type, px_in->format);
 	pixmap_convert_alloc(px_in, px_out, fmt->px_fmt);
@@ -127,6 +161,7 @@ static GLTextureFormatTuple* prepare_pixmap(Texture *tex, const Pixmap *px_in, P
 static void gl33_texture_set(Texture *tex, uint mipmap, const Pixmap *image) {
 	assert(mipmap < tex->params.mipmaps);
 	assert(image != NULL);
+	assert(tex->params.layers == 0);
 
 	Pixmap pix;
 	GLTextureFormatTuple *fmt = prepare_pixmap(tex, image, &pix);
@@ -192,22 +227,29 @@ Texture* gl33_texture_create(const TextureParams *params) {
 		p->anisotropy = TEX_ANISOTROPY_DEFAULT;
 	}
 
+	if(p->layers) {
+		assert(r_supports(RFEAT_TEXTURE_ARRAYS));
+		tex->gl_target = GL_TEXTURE_2D_ARRAY;
+	} else {
+		tex->gl_target = GL_TEXTURE_2D;
+	}
+
 	glGenTextures(1, &tex->gl_handle);
 	snprintf(tex->debug_label, sizeof(tex->debug_label), "Texture #%i", tex->gl_handle);
 	gl33_bind_texture(tex, false);
 	gl33_sync_texunit(tex->binding_unit, false, true);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, r_wrap_to_gl_wrap(p->wrap.s));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, r_wrap_to_gl_wrap(p->wrap.t));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, r_filter_to_gl_filter(p->filter.min));
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, r_filter_to_gl_filter(p->filter.mag));
+	glTexParameteri(tex->gl_target, GL_TEXTURE_WRAP_S, r_wrap_to_gl_wrap(p->wrap.s));
+	glTexParameteri(tex->gl_target, GL_TEXTURE_WRAP_T, r_wrap_to_gl_wrap(p->wrap.t));
+	glTexParameteri(tex->gl_target, GL_TEXTURE_MIN_FILTER, r_filter_to_gl_filter(p->filter.min));
+	glTexParameteri(tex->gl_target, GL_TEXTURE_MAG_FILTER, r_filter_to_gl_filter(p->filter.mag));
 
 	if(!glext.version.is_es || GLES_ATLEAST(3, 0)) {
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, p->mipmaps - 1);
+		glTexParameteri(tex->gl_target, GL_TEXTURE_MAX_LEVEL, p->mipmaps - 1);
 	}
 
 	if(glext.texture_filter_anisotropic) {
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, p->anisotropy);
+		glTexParameteri(tex->gl_target, GL_TEXTURE_MAX_ANISOTROPY, p->anisotropy);
 	}
 
 	tex->type_info = GLVT.texture_type_info(p->type);
@@ -216,26 +258,14 @@ Texture* gl33_texture_create(const TextureParams *params) {
 		glGenBuffers(1, &tex->pbo);
 	}
 
-	for(uint i = 0; i < p->mipmaps; ++i) {
-		uint width, height;
-		gl33_texture_get_size(tex, i, &width, &height);
-
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			i,
-			tex->type_info->internal_fmt,
-			width,
-			height,
-			0,
-			tex->type_info->primary_external_format.gl_fmt,
-			tex->type_info->primary_external_format.gl_type,
-			NULL
-		);
-	}
-
+	gl33_texture_alloc_storage(tex);
 	return tex;
 }
 
+uint gl33_texture_get_layers(Texture *tex) {
+	return tex->params.layers;
+}
+
 void gl33_texture_get_params(Texture *tex, TextureParams *params) {
 	memcpy(params, &tex->params, sizeof(*params));
 }
@@ -245,14 +275,14 @@ void gl33_texture_set_filter(Texture *tex, TextureFilterMode fmin, TextureFilter
 		gl33_bind_texture(tex, false);
 		gl33_sync_texunit(tex->binding_unit, false, true);
 		tex->params.filter.min = fmin;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, r_filter_to_gl_filter(fmin));
+		glTexParameteri(tex->gl_target, GL_TEXTURE_MIN_FILTER, r_filter_to_gl_filter(fmin));
 	}
 
 	if(tex->params.filter.mag != fmag) {
 		gl33_bind_texture(tex, false);
 		gl33_sync_texunit(tex->binding_unit, false, true);
 		tex->params.filter.mag = fmag;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, r_filter_to_gl_filter(fmag));
+		glTexParameteri(tex->gl_target, GL_TEXTURE_MAG_FILTER, r_filter_to_gl_filter(fmag));
 	}
 }
 
@@ -261,37 +291,21 @@ void gl33_texture_set_wrap(Texture *tex, TextureWrapMode ws, TextureWrapMode wt)
 		gl33_bind_texture(tex, false);
 		gl33_sync_texunit(tex->binding_unit, false, true);
 		tex->params.wrap.s = ws;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, r_wrap_to_gl_wrap(ws));
+		glTexParameteri(tex->gl_target, GL_TEXTURE_WRAP_S, r_wrap_to_gl_wrap(ws));
 	}
 
 	if(tex->params.wrap.t != wt) {
 		gl33_bind_texture(tex, false);
 		gl33_sync_texunit(tex->binding_unit, false, true);
 		tex->params.wrap.t = wt;
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, r_wrap_to_gl_wrap(wt));
+		glTexParameteri(tex->gl_target, GL_TEXTURE_WRAP_T, r_wrap_to_gl_wrap(wt));
 	}
 }
 
 void gl33_texture_invalidate(Texture *tex) {
 	gl33_bind_texture(tex, false);
 	gl33_sync_texunit(tex->binding_unit, false, true);
-
-	for(uint i = 0; i < tex->params.mipmaps; ++i) {
-		uint width, height;
-		gl33_texture_get_size(tex, i, &width, &height);
-
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			i,
-			tex->type_info->internal_fmt,
-			width,
-			height,
-			0,
-			tex->type_info->primary_external_format.gl_fmt,
-			tex->type_info->primary_external_format.gl_type,
-			NULL
-		);
-	}
+	gl33_texture_alloc_storage(tex);
 }
 
 void gl33_texture_fill(Texture *tex, uint mipmap, const Pixmap *image) {
@@ -301,6 +315,7 @@ void gl33_texture_fill(Texture *tex, uint mipmap, const Pixmap *image) {
 
 void gl33_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const Pixmap *image) {
 	assert(mipmap == 0 || tex->params.mipmap_mode != TEX_MIPMAP_AUTO);
+	assert(tex->params.layers == 0);
 
 	gl33_bind_texture(tex, false);
 	gl33_sync_texunit(tex->binding_unit, false, true);
@@ -320,6 +335,35 @@ void gl33_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const P
 	tex->mipmaps_outdated = true;
 }
 
+void gl33_texture_fill_layer(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image) {
+	assert(mipmap == 0 || tex->params.mipmap_mode != TEX_MIPMAP_AUTO);
+
+	if(!tex->params.layers) {
+		assert(layer == 0);
+		gl33_texture_fill_region(tex, mipmap, x, y, image);
+		return;
+	}
+
+	assert(layer < tex->params.layers);
+
+	gl33_bind_texture(tex, false);
+	gl33_sync_texunit(tex->binding_unit, false, true);
+
+	Pixmap pix;
+	GLTextureFormatTuple *fmt = prepare_pixmap(tex, image, &pix);
+
+	glTexSubImage3D(
+		GL_TEXTURE_2D_ARRAY, mipmap,
+		x, y, layer, pix.width, pix.height, 1,
+		fmt->gl_fmt,
+		fmt->gl_type,
+		pix.data.untyped
+	);
+
+	free(pix.data.untyped);
+	tex->mipmaps_outdated = true;
+}
+
 void gl44_texture_clear(Texture *tex, const Color *clr) {
 	for(int i = 0; i < tex->params.mipmaps; ++i) {
 		glClearTexImage(tex->gl_handle, i, GL_RGBA, GL_FLOAT, &clr->r);
@@ -327,6 +371,8 @@ void gl44_texture_clear(Texture *tex, const Color *clr) {
 }
 
 void gl33_texture_clear(Texture *tex, const Color *clr) {
+	assert(tex->params.layers == 0);
+
 	// TODO: maybe find a more efficient method
 	Framebuffer *temp_fb = r_framebuffer_create();
 	r_framebuffer_attach(temp_fb, tex, 0, FRAMEBUFFER_ATTACH_COLOR0);
@@ -356,7 +402,7 @@ void gl33_texture_prepare(Texture *tex) {
 
 		gl33_bind_texture(tex, false);
 		gl33_sync_texunit(tex->binding_unit, false, true);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glGenerateMipmap(tex->gl_target);
 		tex->mipmaps_outdated = false;
 	}
 }
@@ -21,6 +21,7 @@ typedef struct Texture {
 	GLTextureTypeInfo *type_info;
 	TextureUnit *binding_unit;
 	GLuint gl_handle;
+	GLenum gl_target; // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
 	GLuint pbo;
 	TextureParams params;
 	bool mipmaps_outdated;
@@ -29,6 +30,7 @@ typedef struct Texture {
 
 Texture* gl33_texture_create(const TextureParams *params);
 void gl33_texture_get_size(Texture *tex, uint mipmap, uint *width, uint *height);
+uint gl33_texture_get_layers(Texture *tex);
 void gl33_texture_get_params(Texture *tex, TextureParams *params);
 const char* gl33_texture_get_debug_label(Texture *tex);
 void gl33_texture_set_debug_label(Texture *tex, const char *label);
@@ -37,6 +39,7 @@ void gl33_texture_set_wrap(Texture *tex, TextureWrapMode ws, TextureWrapMode wt)
 void gl33_texture_invalidate(Texture *tex);
 void gl33_texture_fill(Texture *tex, uint mipmap, const Pixmap *image);
 void gl33_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const Pixmap *image);
+void gl33_texture_fill_layer(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image);
 void gl33_texture_prepare(Texture *tex);
 void gl33_texture_taint(Texture *tex);
 void gl44_texture_clear(Texture *tex, const Color *clr);
@@ -41,6 +41,7 @@ void gl33_vertex_array_destroy(VertexArray *varr) {
 	gl33_vertex_array_deleted(varr);
 	glDeleteVertexArrays(1, &varr->gl_handle);
 	free(varr->attachments);
+	free(varr->attachment_origins);
 	free(varr->attribute_layout);
 	free(varr);
 }
@@ -91,7 +92,7 @@ static void gl33_vertex_array_update_layout(VertexArray *varr) {
 					va_type_to_gl_type[a->spec.type],
 					a->spec.coversion == VA_CONVERT_FLOAT_NORMALIZED,
 					a->stride,
-					(void*)a->offset
+					(void*)(a->offset + varr->attachment_origins[a->attachment])
 				);
 
 				break;
@@ -102,7 +103,7 @@ static void gl33_vertex_array_update_layout(VertexArray *varr) {
 					a->spec.elements,
 					va_type_to_gl_type[a->spec.type],
 					a->stride,
-					(void*)a->offset
+					(void*)(a->offset + varr->attachment_origins[a->attachment])
 				);
 
 				break;
@@ -135,10 +136,18 @@ void gl33_vertex_array_attach_vertex_buffer(VertexArray *varr, VertexBuffer *vbu
 	// TODO: more efficient way of handling this?
 	if(attachment >= varr->num_attachments) {
 		varr->attachments = realloc(varr->attachments, (attachment + 1) * sizeof(VertexBuffer*));
+		varr->attachment_origins = realloc(varr->attachment_origins, (attachment + 1) * sizeof(size_t));
+
+		for(uint i = varr->num_attachments; i < attachment; ++i) {
+			varr->attachments[i] = NULL;
+			varr->attachment_origins[i] = 0;
+		}
+
 		varr->num_attachments = attachment + 1;
 	}
 
 	varr->attachments[attachment] = vbuf;
+	varr->attachment_origins[attachment] = gl33_buffer_stream_origin(&vbuf->cbuf);
 	varr->layout_dirty_bits |= (1u << attachment);
 }
 
@@ -178,6 +187,27 @@ void gl33_vertex_array_set_debug_label(VertexArray *varr, const char *label) {
 }
 
 void gl33_vertex_array_flush_buffers(VertexArray *varr) {
+	// Streaming buffers move their data around when invalidated; repoint the attributes if needed.
+	for(uint i = 0; i < varr->num_attachments; ++i) {
+		if(varr->attachments[i] == NULL) {
+			continue;
+		}
+
+		size_t origin = gl33_buffer_stream_origin(&varr->attachments[i]->cbuf);
+
+		if(origin == varr->attachment_origins[i]) {
+			continue;
+		}
+
+		varr->attachment_origins[i] = origin;
+
+		for(uint a = 0; a < varr->num_attributes; ++a) {
+			if(varr->attribute_layout[a].attachment == i) {
+				varr->layout_dirty_bits |= (1u << a);
+			}
+		}
+	}
+
 	if(varr->layout_dirty_bits) {
 		gl33_vertex_array_update_layout(varr);
 	}
@@ -19,6 +19,7 @@
 
 struct VertexArray {
 	VertexBuffer **attachments;
+	size_t *attachment_origins; // see gl33_buffer_stream_origin
 	VertexAttribFormat *attribute_layout;
 	IndexBuffer *index_attachment;
 	GLuint gl_handle;
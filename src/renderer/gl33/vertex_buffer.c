@@ -25,6 +25,14 @@ VertexBuffer* gl33_vertex_buffer_create(size_t capacity, void *data) {
 	return vbuf;
 }
 
+VertexBuffer* gl33_vertex_buffer_create_streaming(size_t capacity) {
+	VertexBuffer *vbuf = (VertexBuffer*)gl33_buffer_create_streaming(GL33_BUFFER_BINDING_ARRAY, capacity);
+
+	snprintf(vbuf->cbuf.debug_label, sizeof(vbuf->cbuf.debug_label), "VBO #%i", vbuf->cbuf.gl_handle);
+	log_debug("Created streaming VBO %u with %zukb of storage", vbuf->cbuf.gl_handle, vbuf->cbuf.size / 1024);
+	return vbuf;
+}
+
 void gl33_vertex_buffer_destroy(VertexBuffer *vbuf) {
 	log_debug("Deleted VBO %u with %zukb of storage", vbuf->cbuf.gl_handle, vbuf->cbuf.size / 1024);
 	gl33_buffer_destroy(&vbuf->cbuf);
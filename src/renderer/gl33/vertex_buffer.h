@@ -18,6 +18,7 @@ typedef struct VertexBuffer {
 } VertexBuffer;
 
 VertexBuffer* gl33_vertex_buffer_create(size_t capacity, void *data);
+VertexBuffer* gl33_vertex_buffer_create_streaming(size_t capacity);
 const char* gl33_vertex_buffer_get_debug_label(VertexBuffer *vbuf);
 void gl33_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *label);
 void gl33_vertex_buffer_destroy(VertexBuffer *vbuf);
@@ -169,6 +169,27 @@ static void glcommon_ext_base_instance(void) {
 	log_warn("Extension not supported");
 }
 
+static void glcommon_ext_buffer_storage(void) {
+	if(
+		GL_ATLEAST(4, 4)
+		&& (glext.BufferStorage = glad_glBufferStorage)
+	) {
+		glext.buffer_storage = TSGL_EXTFLAG_NATIVE;
+		log_info("Using core functionality");
+		return;
+	}
+
+	if((glext.buffer_storage = glcommon_check_extension("GL_ARB_buffer_storage"))
+		&& (glext.BufferStorage = glad_glBufferStorage)
+	) {
+		log_info("Using GL_ARB_buffer_storage");
+		return;
+	}
+
+	glext.buffer_storage = 0;
+	log_warn("Extension not supported");
+}
+
 static void glcommon_ext_pixel_buffer_object(void) {
 	// TODO: verify that these requirements are correct
 	if(GL_ATLEAST(2, 0) || GLES_ATLEAST(3, 0)) {
@@ -300,6 +321,17 @@ static void glcommon_ext_draw_buffers(void) {
 	log_warn("Extension not supported");
 }
 
+static void glcommon_ext_texture_array(void) {
+	if((GL_ATLEAST(3, 0) || GLES_ATLEAST(3, 0)) && glTexImage3D && glTexSubImage3D) {
+		glext.texture_array = TSGL_EXTFLAG_NATIVE;
+		log_info("Using core functionality");
+		return;
+	}
+
+	glext.texture_array = 0;
+	log_warn("Extension not supported");
+}
+
 static void glcommon_ext_texture_filter_anisotropic(void) {
 	if(GL_ATLEAST(4, 6)) {
 		glext.texture_filter_anisotropic = TSGL_EXTFLAG_NATIVE;
@@ -433,6 +465,53 @@ static void glcommon_ext_float_blend(void) {
 	log_warn("Extension not supported");
 }
 
+static void glcommon_ext_get_program_binary(void) {
+	GLint num_formats = 0;
+
+	if(GL_ATLEAST(4, 1) || GLES_ATLEAST(3, 0)) {
+		glext.get_program_binary = TSGL_EXTFLAG_NATIVE;
+	} else {
+		glext.get_program_binary = glcommon_check_extension("GL_ARB_get_program_binary");
+	}
+
+	if(!glext.get_program_binary || !glProgramBinary || !glGetProgramBinary) {
+		glext.get_program_binary = 0;
+		log_warn("Extension not supported");
+		return;
+	}
+
+	// Some drivers expose the functions, but don't support any binary formats.
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+	if(num_formats < 1) {
+		glext.get_program_binary = 0;
+		log_warn("Extension supported, but no binary formats are available");
+		return;
+	}
+
+	if(glext.get_program_binary == TSGL_EXTFLAG_NATIVE) {
+		log_info("Using core functionality");
+	} else {
+		log_info("Using GL_ARB_get_program_binary");
+	}
+}
+
+static void glcommon_ext_uniform_buffer_object(void) {
+	if(GL_ATLEAST(3, 1) || GLES_ATLEAST(3, 0)) {
+		glext.uniform_buffer_object = TSGL_EXTFLAG_NATIVE;
+		log_info("Using core functionality");
+		return;
+	}
+
+	if((glext.uniform_buffer_object = glcommon_check_extension("GL_ARB_uniform_buffer_object"))) {
+		log_info("Using GL_ARB_uniform_buffer_object");
+		return;
+	}
+
+	glext.uniform_buffer_object = 0;
+	log_warn("Extension not supported");
+}
+
 static void glcommon_ext_vertex_array_object(void) {
 	if((GL_ATLEAST(3, 0) || GLES_ATLEAST(3, 0))
 		&& (glext.BindVertexArray = glad_glBindVertexArray)
@@ -533,19 +612,23 @@ void glcommon_check_extensions(void) {
 	}
 
 	glcommon_ext_base_instance();
+	glcommon_ext_buffer_storage();
 	glcommon_ext_clear_texture();
 	glcommon_ext_color_buffer_float();
 	glcommon_ext_debug_output();
 	glcommon_ext_depth_texture();
 	glcommon_ext_draw_buffers();
 	glcommon_ext_float_blend();
+	glcommon_ext_get_program_binary();
 	glcommon_ext_instanced_arrays();
 	glcommon_ext_pixel_buffer_object();
+	glcommon_ext_texture_array();
 	glcommon_ext_texture_filter_anisotropic();
 	glcommon_ext_texture_float_linear();
 	glcommon_ext_texture_half_float_linear();
 	glcommon_ext_texture_norm16();
 	glcommon_ext_texture_rg();
+	glcommon_ext_uniform_buffer_object();
 	glcommon_ext_vertex_array_object();
 
 	// GLES has only glClearDepthf
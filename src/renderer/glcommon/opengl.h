@@ -73,19 +73,23 @@ struct glext_s {
 	} version;
 
 	ext_flag_t base_instance;
+	ext_flag_t buffer_storage;
 	ext_flag_t clear_texture;
 	ext_flag_t color_buffer_float;
 	ext_flag_t debug_output;
 	ext_flag_t depth_texture;
 	ext_flag_t draw_buffers;
 	ext_flag_t float_blend;
+	ext_flag_t get_program_binary;
 	ext_flag_t instanced_arrays;
 	ext_flag_t pixel_buffer_object;
+	ext_flag_t texture_array;
 	ext_flag_t texture_filter_anisotropic;
 	ext_flag_t texture_float_linear;
 	ext_flag_t texture_half_float_linear;
 	ext_flag_t texture_norm16;
 	ext_flag_t texture_rg;
+	ext_flag_t uniform_buffer_object;
 	ext_flag_t vertex_array_object;
 
 	//
@@ -130,6 +134,14 @@ struct glext_s {
 	#undef glDrawElementsInstancedBaseInstance
 	#define glDrawElementsInstancedBaseInstance (glext.DrawElementsInstancedBaseInstance)
 
+	//
+	// buffer_storage
+	//
+
+	PFNGLBUFFERSTORAGEPROC BufferStorage;
+	#undef glBufferStorage
+	#define glBufferStorage (glext.BufferStorage)
+
 	//
 	// draw_buffers
 	//
@@ -76,6 +76,10 @@ static void null_texture_get_size(Texture *tex, uint mipmap, uint *width, uint *
 	if(height) *height = 1;
 }
 
+static uint null_texture_get_layers(Texture *tex) {
+	return 0;
+}
+
 static void null_texture_get_params(Texture *tex, TextureParams *params) {
 	memset(params, 0, sizeof(*params));
 	params->width = 1;
@@ -89,6 +93,7 @@ static void null_texture_set_filter(Texture *tex, TextureFilterMode fmin, Textur
 static void null_texture_set_wrap(Texture *tex, TextureWrapMode fmin, TextureWrapMode fmag) { }
 static void null_texture_fill(Texture *tex, uint mipmap, const Pixmap *image_data) { }
 static void null_texture_fill_region(Texture *tex, uint mipmap, uint x, uint y, const Pixmap *image_data) { }
+static void null_texture_fill_layer(Texture *tex, uint mipmap, uint layer, uint x, uint y, const Pixmap *image_data) { }
 static void null_texture_invalidate(Texture *tex) { }
 static void null_texture_destroy(Texture *tex) { }
 static void null_texture_clear(Texture *tex, const Color *color) { }
@@ -131,6 +136,7 @@ static SDL_RWops* null_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 }
 
 static VertexBuffer* null_vertex_buffer_create(size_t capacity, void *data) { return (void*)&placeholder; }
+static VertexBuffer* null_vertex_buffer_create_streaming(size_t capacity) { return (void*)&placeholder; }
 static void null_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *label) { }
 static const char* null_vertex_buffer_get_debug_label(VertexBuffer *vbuf) { return "null vertex buffer"; }
 static void null_vertex_buffer_destroy(VertexBuffer *vbuf) { }
@@ -162,6 +168,8 @@ static void null_swap(SDL_Window *window) { }
 
 static bool null_screenshot(Pixmap *dest) { return false; }
 
+static void null_frame_stats(RendererStats *stats) { memset(stats, 0, sizeof(*stats)); }
+
 RendererBackend _r_backend_null = {
 	.name = "null",
 	.funcs = {
@@ -199,6 +207,7 @@ RendererBackend _r_backend_null = {
 		.texture_create = null_texture_create,
 		.texture_get_params = null_texture_get_params,
 		.texture_get_size = null_texture_get_size,
+		.texture_get_layers = null_texture_get_layers,
 		.texture_get_debug_label = null_texture_get_debug_label,
 		.texture_set_debug_label = null_texture_set_debug_label,
 		.texture_set_filter = null_texture_set_filter,
@@ -207,6 +216,7 @@ RendererBackend _r_backend_null = {
 		.texture_invalidate = null_texture_invalidate,
 		.texture_fill = null_texture_fill,
 		.texture_fill_region = null_texture_fill_region,
+		.texture_fill_layer = null_texture_fill_layer,
 		.texture_clear = null_texture_clear,
 		.framebuffer_create = null_framebuffer_create,
 		.framebuffer_get_debug_label = null_framebuffer_get_debug_label,
@@ -221,6 +231,7 @@ RendererBackend _r_backend_null = {
 		.framebuffer_current = null_framebuffer_current,
 		.framebuffer_clear = null_framebuffer_clear,
 		.vertex_buffer_create = null_vertex_buffer_create,
+		.vertex_buffer_create_streaming = null_vertex_buffer_create_streaming,
 		.vertex_buffer_get_debug_label = null_vertex_buffer_get_debug_label,
 		.vertex_buffer_set_debug_label = null_vertex_buffer_set_debug_label,
 		.vertex_buffer_destroy = null_vertex_buffer_destroy,
@@ -247,5 +258,6 @@ RendererBackend _r_backend_null = {
 		.vsync_current = null_vsync_current,
 		.swap = null_swap,
 		.screenshot = null_screenshot,
+		.frame_stats = null_frame_stats,
 	},
 };
@@ -16,6 +16,7 @@
 #include <time.h>
 
 #include "global.h"
+#include "replay_verify.h"
 
 static uint8_t replay_magic_header[] = REPLAY_MAGIC_HEADER;
 
@@ -722,8 +723,7 @@ void replay_stage_check_desync(ReplayStage *stg, int time, uint16_t check, Repla
 			stg->desynced = true;
 
 			if(global.is_replay_verification) {
-				// log_fatal("Replay verification failed");
-				exit(1);
+				replay_verify_desync(stg, time);
 			}
 		} else if(global.is_replay_verification) {
 			log_info("Frame %d: 0x%04x OK", time, check);
@@ -777,6 +777,10 @@ void replay_play(Replay *rpy, int firstidx) {
 		global.plr.mode = plrmode_find(rstg->plr_char, rstg->plr_shot);
 		stage_loop(gstg);
 
+		if(global.is_replay_verification) {
+			replay_verify_stage_done(global.frames);
+		}
+
 		if(global.game_over == GAMEOVER_ABORT) {
 			break;
 		}
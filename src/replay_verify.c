@@ -0,0 +1,50 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "replay_verify.h"
+#include "util.h"
+
+static struct {
+	Uint64 begin;
+	uint frames;
+} verify;
+
+static void replay_verify_report(const char *status, ReplayStage *desync_stg, int desync_frame) {
+	double time = (SDL_GetPerformanceCounter() - verify.begin) / (double)SDL_GetPerformanceFrequency();
+
+	tsfprintf(stdout, REPLAY_VERIFY_REPORT_PREFIX "%s %u %f %X %i\n",
+		status,
+		verify.frames,
+		time,
+		desync_stg ? desync_stg->stage : 0,
+		desync_frame
+	);
+
+	fflush(stdout);
+}
+
+void replay_verify_begin(void) {
+	verify.frames = 0;
+	verify.begin = SDL_GetPerformanceCounter();
+}
+
+void replay_verify_stage_done(int frames) {
+	verify.frames += frames;
+}
+
+void replay_verify_end(void) {
+	replay_verify_report("pass", NULL, -1);
+}
+
+noreturn void replay_verify_desync(ReplayStage *stg, int frame) {
+	verify.frames += frame;
+	replay_verify_report("desync", stg, frame);
+	exit(1);
+}
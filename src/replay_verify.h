@@ -0,0 +1,41 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_replay_verify_h
+#define IGUARD_replay_verify_h
+
+#include "taisei.h"
+
+#include "replay.h"
+
+/*
+ * Batch replay verification.
+ *
+ * The game simulation lives in global state, so every replay is verified in a separate
+ * `taisei --verify-replay` process, several of them at once. The child processes report back
+ * to the parent through a machine-readable line on stdout, see the replay_verify_* functions
+ * below. Spawning them needs SDL_RWpopen, so the batch mode is only available on POSIX systems.
+ */
+
+// Prefix of the report line; it's followed by the status ("pass" or "desync"), the number of
+// frames simulated, the time taken, and the stage and frame of the desync.
+#define REPLAY_VERIFY_REPORT_PREFIX "@replay-verify "
+
+// Verify every replay found in [path], which is either a directory (all *.tsr files inside are
+// checked), a single replay file, or a text file listing one replay path per line. [exe] is the
+// path to the game's executable. Up to [jobs] replays are checked at once; 0 means one per CPU core.
+// Prints a report to stdout. Returns 0 if all replays passed, 1 otherwise.
+int replay_verify_batch(const char *exe, const char *path, uint jobs) attr_nonnull(1, 2);
+
+// These are called by the game itself in --verify-replay mode.
+void replay_verify_begin(void);
+void replay_verify_stage_done(int frames);
+void replay_verify_end(void);
+noreturn void replay_verify_desync(ReplayStage *stg, int frame) attr_nonnull(1);
+
+#endif // IGUARD_replay_verify_h
@@ -0,0 +1,17 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "replay_verify.h"
+#include "util.h"
+
+int replay_verify_batch(const char *exe, const char *path, uint jobs) {
+	log_warn("Batch replay verification is not supported on this platform; use --verify-replay for each replay instead");
+	return 1;
+}
@@ -0,0 +1,312 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "replay_verify.h"
+#include "taskmanager.h"
+#include "rwops/rwops_pipe.h"
+#include "util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+typedef enum VerifyStatus {
+	VERIFY_ERROR,
+	VERIFY_PASS,
+	VERIFY_DESYNC,
+} VerifyStatus;
+
+typedef struct VerifyJob {
+	char *path;
+	char *command;
+
+	VerifyStatus status;
+	uint frames;
+	double time;
+	uint desync_stage;
+	int desync_frame;
+} VerifyJob;
+
+typedef struct JobList {
+	VerifyJob *jobs;
+	uint num;
+	uint capacity;
+} JobList;
+
+static void joblist_add(JobList *l, const char *path) {
+	if(l->num == l->capacity) {
+		l->capacity = l->capacity ? l->capacity * 2 : 16;
+		l->jobs = realloc(l->jobs, sizeof(*l->jobs) * l->capacity);
+	}
+
+	l->jobs[l->num++] = (VerifyJob) { .path = strdup(path) };
+}
+
+static int job_path_cmp(const void *a, const void *b) {
+	return strcmp(((const VerifyJob*)a)->path, ((const VerifyJob*)b)->path);
+}
+
+static bool joblist_add_dir(JobList *l, const char *dirpath) {
+	DIR *dir = opendir(dirpath);
+
+	if(dir == NULL) {
+		log_warn("Can't open directory %s: %s", dirpath, strerror(errno));
+		return false;
+	}
+
+	uint first = l->num;
+
+	for(struct dirent *e; (e = readdir(dir));) {
+		if(strendswith(e->d_name, "." REPLAY_EXTENSION)) {
+			char *path = strjoin(dirpath, "/", e->d_name, NULL);
+			joblist_add(l, path);
+			free(path);
+		}
+	}
+
+	closedir(dir);
+
+	// readdir order is arbitrary; keep the report stable between runs.
+	qsort(l->jobs + first, l->num - first, sizeof(*l->jobs), job_path_cmp);
+	return true;
+}
+
+static bool joblist_add_listfile(JobList *l, const char *listpath) {
+	SDL_RWops *rw = SDL_RWFromFile(listpath, "r");
+
+	if(rw == NULL) {
+		log_warn("Can't open %s: %s", listpath, SDL_GetError());
+		return false;
+	}
+
+	char line[4096];
+
+	while(SDL_RWgets(rw, line, sizeof(line))) {
+		line[strcspn(line, "\r\n")] = 0;
+
+		if(*line && *line != '#') {
+			joblist_add(l, line);
+		}
+	}
+
+	SDL_RWclose(rw);
+	return true;
+}
+
+static bool joblist_add_path(JobList *l, const char *path) {
+	struct stat st;
+
+	if(stat(path, &st) < 0) {
+		log_warn("Can't stat %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	if(S_ISDIR(st.st_mode)) {
+		return joblist_add_dir(l, path);
+	}
+
+	if(strendswith(path, "." REPLAY_EXTENSION)) {
+		joblist_add(l, path);
+		return true;
+	}
+
+	return joblist_add_listfile(l, path);
+}
+
+static void joblist_free(JobList *l) {
+	for(uint i = 0; i < l->num; ++i) {
+		free(l->jobs[i].path);
+		free(l->jobs[i].command);
+	}
+
+	free(l->jobs);
+}
+
+// Wraps [arg] in single quotes for the POSIX shell, which SDL_RWpopen goes through.
+static char* shell_quote(const char *arg) {
+	char *quoted = strdup("'");
+
+	for(const char *p = arg; *p; ++p) {
+		if(*p == '\'') {
+			strappend(&quoted, "'\\''");
+		} else {
+			char c[] = { *p, 0 };
+			strappend(&quoted, c);
+		}
+	}
+
+	strappend(&quoted, "'");
+	return quoted;
+}
+
+static char* build_command(const char *exe, const char *replay_path) {
+	char *qexe = shell_quote(exe);
+	char *qpath = shell_quote(replay_path);
+
+	// Keep the children quiet, so that their stdout only carries the report.
+	char *cmd = strfmt("TAISEI_LOGLVLS_CONSOLE=-a %s --verify-replay %s", qexe, qpath);
+
+	free(qexe);
+	free(qpath);
+	return cmd;
+}
+
+static void parse_report(VerifyJob *job, char *output) {
+	char *save = NULL;
+
+	for(char *line = strtok_r(output, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+		if(!strstartswith(line, REPLAY_VERIFY_REPORT_PREFIX)) {
+			continue;
+		}
+
+		char status[16];
+
+		if(sscanf(line + strlen(REPLAY_VERIFY_REPORT_PREFIX), "%15s %u %lf %X %i",
+			status, &job->frames, &job->time, &job->desync_stage, &job->desync_frame) != 5
+		) {
+			continue;
+		}
+
+		if(!strcmp(status, "pass")) {
+			job->status = VERIFY_PASS;
+		} else if(!strcmp(status, "desync")) {
+			job->status = VERIFY_DESYNC;
+		}
+	}
+}
+
+static void* verify_task(void *arg) {
+	VerifyJob *job = arg;
+	job->status = VERIFY_ERROR;
+
+	SDL_RWops *pipe = SDL_RWpopen(job->command, "r");
+
+	if(pipe == NULL) {
+		log_warn("%s: %s", job->path, SDL_GetError());
+		return NULL;
+	}
+
+	char *output = NULL;
+	size_t size = 0;
+	char buf[1024];
+
+	for(size_t n; (n = SDL_RWread(pipe, buf, 1, sizeof(buf)));) {
+		output = realloc(output, size + n + 1);
+		memcpy(output + size, buf, n);
+		size += n;
+	}
+
+	// A non-zero exit status is expected on desync, so the result of this doesn't matter by itself.
+	SDL_RWclose(pipe);
+
+	if(output != NULL) {
+		output[size] = 0;
+		parse_report(job, output);
+		free(output);
+	}
+
+	return NULL;
+}
+
+static void print_result(VerifyJob *job) {
+	double fps = job->time > 0 ? job->frames / job->time : 0;
+
+	switch(job->status) {
+		case VERIFY_PASS:
+			tsfprintf(stdout, "PASS   %s: %u frames, %.0f fps\n", job->path, job->frames, fps);
+			break;
+
+		case VERIFY_DESYNC:
+			tsfprintf(stdout, "DESYNC %s: stage %X, frame %i (%u frames, %.0f fps)\n",
+				job->path, job->desync_stage, job->desync_frame, job->frames, fps
+			);
+			break;
+
+		case VERIFY_ERROR:
+			tsfprintf(stdout, "ERROR  %s: verification did not complete\n", job->path);
+			break;
+
+		default: UNREACHABLE;
+	}
+
+	fflush(stdout);
+}
+
+int replay_verify_batch(const char *exe, const char *path, uint jobs) {
+	JobList list = { 0 };
+
+	if(!joblist_add_path(&list, path)) {
+		joblist_free(&list);
+		return 1;
+	}
+
+	if(list.num == 0) {
+		log_warn("No replays found in %s", path);
+		joblist_free(&list);
+		return 1;
+	}
+
+	if(jobs == 0) {
+		jobs = imax(1, SDL_GetCPUCount());
+	}
+
+	jobs = imin(jobs, list.num);
+
+	// The workers just sit waiting for their child processes.
+	TaskManager *mgr = taskmgr_create(jobs, SDL_THREAD_PRIORITY_LOW, "verify");
+
+	if(mgr == NULL) {
+		joblist_free(&list);
+		return 1;
+	}
+
+	Task *tasks[list.num];
+
+	for(uint i = 0; i < list.num; ++i) {
+		list.jobs[i].command = build_command(exe, list.jobs[i].path);
+		tasks[i] = taskmgr_submit(mgr, (TaskParams) { verify_task, list.jobs + i });
+	}
+
+	uint num_passed = 0;
+	uint total_frames = 0;
+	double total_time = 0;
+	Uint64 begin = SDL_GetPerformanceCounter();
+
+	// Results are printed in input order, as soon as they are known.
+	for(uint i = 0; i < list.num; ++i) {
+		VerifyJob *job = list.jobs + i;
+
+		if(tasks[i] == NULL) {
+			verify_task(job);
+		} else {
+			task_finish(tasks[i], NULL);
+		}
+
+		print_result(job);
+
+		num_passed += (job->status == VERIFY_PASS);
+		total_frames += job->frames;
+		total_time += job->time;
+	}
+
+	taskmgr_finish(mgr);
+
+	double wall_time = (SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency();
+
+	tsfprintf(stdout, "\n%u/%u replays passed; %u frames simulated in %.2f s (%.0f fps per replay, %.0f fps total)\n",
+		num_passed, list.num, total_frames, wall_time,
+		total_time > 0 ? total_frames / total_time : 0,
+		wall_time > 0 ? total_frames / wall_time : 0
+	);
+
+	int result = (num_passed == list.num) ? 0 : 1;
+	joblist_free(&list);
+	return result;
+}
@@ -31,6 +31,7 @@ ResourceHandler model_res_handler = {
 		.begin_load = load_model_begin,
 		.end_load = load_model_end,
 		.unload = unload_model,
+		.size = model_memory_size,
 	},
 };
 
@@ -138,6 +139,11 @@ void* load_model_end(void *opaque, const char *path, uint flags) {
 	return model;
 }
 
+size_t model_memory_size(void *model) {
+	// Vertex data only; the index size depends on the renderer backend.
+	return ((Model*)model)->num_vertices * sizeof(GenericModelVertex);
+}
+
 void unload_model(void *model) { // Does not delete elements from the VBO, so doing this at runtime is leaking VBO space
 	free(model);
 }
@@ -44,6 +44,7 @@ char* model_path(const char *name);
 bool check_model_path(const char *path);
 void* load_model_begin(const char *path, uint flags);
 void* load_model_end(void *opaque, const char *path, uint flags);
+size_t model_memory_size(void *model);
 void unload_model(void*); // Does not delete elements from the VBO, so doing this at runtime is leaking VBO space
 
 Model* get_model(const char *name);
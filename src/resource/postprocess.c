@@ -184,38 +184,6 @@ void postprocess_unload(PostprocessShader **list) {
 	list_foreach(list, delete_shader, NULL);
 }
 
-void postprocess(PostprocessShader *ppshaders, FBPair *fbos, PostprocessPrepareFuncPtr prepare, PostprocessDrawFuncPtr draw, double width, double height) {
-	if(!ppshaders) {
-		return;
-	}
-
-	ShaderProgram *shader_saved = r_shader_current();
-	BlendMode blend_saved = r_blend_current();
-
-	r_blend(BLEND_NONE);
-
-	for(PostprocessShader *pps = ppshaders; pps; pps = pps->next) {
-		ShaderProgram *s = pps->shader;
-
-		r_framebuffer(fbos->back);
-		r_shader_ptr(s);
-
-		if(prepare) {
-			prepare(fbos->back, s);
-		}
-
-		for(PostprocessShaderUniform *u = pps->uniforms; u; u = u->next) {
-			r_uniform_ptr_unsafe(u->uniform, 0, u->elements, u->values);
-		}
-
-		draw(fbos->front, width, height);
-		fbpair_swap(fbos);
-	}
-
-	r_shader_ptr(shader_saved);
-	r_blend(blend_saved);
-}
-
 /*
  *  Glue for resources api
  */
@@ -14,6 +14,8 @@
 #include "menu/mainmenu.h"
 #include "events.h"
 #include "taskmanager.h"
+#include "profiler.h"
+#include "hirestime.h"
 
 #include "texture.h"
 #include "animation.h"
@@ -53,6 +55,7 @@ typedef struct InternalResource {
 	SDL_mutex *mutex;
 	SDL_cond *cond;
 	Task *async_task;
+	VFSStats vfs_stats; // VFS work done so far to load this resource, on any thread
 } InternalResource;
 
 typedef struct ResourceAsyncLoadData {
@@ -63,6 +66,87 @@ typedef struct ResourceAsyncLoadData {
 	void *opaque;
 } ResourceAsyncLoadData;
 
+typedef struct ResourceHandleSlot {
+	ResourceType type;
+	ResourceFlags flags;
+	char *name;
+	void *data; // NULL if not resolved, or if the resource is missing
+} ResourceHandleSlot;
+
+// A handle is the slot number (starting at 1) in the lower bits, and the generation of the table
+// in the upper ones, so that handles interned before free_resources(true) can be told apart.
+#define HANDLE_INDEX_BITS 24
+#define HANDLE_INDEX_MASK ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK ((1u << (32 - HANDLE_INDEX_BITS)) - 1)
+
+static struct {
+	ResourceHandleSlot *slots;
+	uint num;
+	uint capacity;
+	uint generation;
+	ht_str2int_t ids[RES_NUMTYPES];
+} handles;
+
+static SDL_atomic_t num_lookups;
+
+static struct {
+	SDL_SpinLock lock;
+	uint num_loaded;
+	VFSStats totals;
+} vfs_work;
+
+typedef struct PendingLoad PendingLoad;
+
+struct PendingLoad {
+	LIST_INTERFACE(PendingLoad);
+	InternalResource *ires;
+};
+
+// Async loads are finished (see ResourceEndLoadProc) on the main thread as they come in, until
+// [budget] is used up for the frame. The rest are queued and finished in later frames, unless
+// something needs them earlier. Only touched on the main thread.
+static struct {
+	LIST_ANCHOR(PendingLoad) queue;
+	hrtime_t budget; // 0 means unlimited
+	hrtime_t spent;
+} finish_queue;
+
+// Number of async loads that have been submitted, but not finished yet.
+static SDL_atomic_t num_async_loads;
+
+typedef struct PrefetchItem PrefetchItem;
+
+struct PrefetchItem {
+	LIST_INTERFACE(PrefetchItem);
+	ResourceType type;
+	ResourceFlags flags;
+	char name[];
+};
+
+#define PREFETCH_MAX_IN_FLIGHT 4
+#define PREFETCH_TASK_PRIO 1
+
+// See resource_prefetch. Only touched on the main thread, except for num_in_flight.
+static struct {
+	LIST_ANCHOR(PrefetchItem) queue;
+	char *name;
+	size_t memory_limit;
+	size_t memory_used;
+	uint num_loaded;
+	SDL_atomic_t num_in_flight;
+	bool recording;
+} prefetch;
+
+// See resource_batch_begin. Only touched on the main thread.
+static struct {
+	char *name;
+	hrtime_t start_time;
+	hrtime_t end_load_time;
+	uint num_loaded;
+	uint num_frames;
+	bool ending;
+} load_batch;
+
 static inline ResourceHandler* get_handler(ResourceType type) {
 	return *(_handlers + type);
 }
@@ -104,13 +188,78 @@ static bool try_begin_load_resource(ResourceType type, const char *name, Interna
 
 static void load_resource_finish(InternalResource *ires, void *opaque, const char *path, const char *name, char *allocated_path, char *allocated_name, ResourceFlags flags);
 
+static void check_load_batch_done(void) {
+	if(!load_batch.ending || SDL_AtomicGet(&num_async_loads) > 0) {
+		return;
+	}
+
+	log_info(
+		"%s: %u resources loaded in %fs, spread over %u frames (%fs in end_load)",
+		load_batch.name,
+		load_batch.num_loaded,
+		(time_get() - load_batch.start_time) / (double)HRTIME_RESOLUTION,
+		load_batch.num_frames,
+		load_batch.end_load_time / (double)HRTIME_RESOLUTION
+	);
+
+	free(load_batch.name);
+	memset(&load_batch, 0, sizeof(load_batch));
+}
+
+static void prefetch_cancel(void) {
+	for(PrefetchItem *item; (item = alist_pop(&prefetch.queue));) {
+		free(item);
+	}
+
+	free(prefetch.name);
+	prefetch.name = NULL;
+}
+
+static void prefetch_pump(void) {
+	if(!prefetch.name) {
+		return;
+	}
+
+	while(prefetch.queue.first && SDL_AtomicGet(&prefetch.num_in_flight) < PREFETCH_MAX_IN_FLIGHT) {
+		if(prefetch.memory_used > prefetch.memory_limit) {
+			log_info(
+				"%s: prefetch memory limit reached after %u resources (%zu KiB), the rest will be loaded later",
+				prefetch.name, prefetch.num_loaded, prefetch.memory_used / 1024
+			);
+			prefetch_cancel();
+			return;
+		}
+
+		PrefetchItem *item = alist_pop(&prefetch.queue);
+		preload_resource(item->type, item->name, item->flags);
+		free(item);
+	}
+
+	if(!prefetch.queue.first && !SDL_AtomicGet(&prefetch.num_in_flight)) {
+		log_info(
+			"%s: prefetched %u resources (%zu KiB)",
+			prefetch.name, prefetch.num_loaded, prefetch.memory_used / 1024
+		);
+		prefetch_cancel();
+	}
+}
+
 static void finish_async_load(InternalResource *ires, ResourceAsyncLoadData *data) {
 	assert(ires == data->ires);
 	assert(ires->status == RES_STATUS_LOADING);
 	load_resource_finish(ires, data->opaque, data->path, data->name, data->path, data->name, data->flags);
 	SDL_CondBroadcast(data->ires->cond);
 	assert(ires->status != RES_STATUS_LOADING);
+	bool prefetched = data->flags & RESF_PREFETCH;
 	free(data);
+
+	SDL_AtomicDecRef(&num_async_loads);
+	check_load_batch_done();
+
+	if(prefetched) {
+		SDL_AtomicDecRef(&prefetch.num_in_flight);
+		prefetch_pump();
+	}
 }
 
 static ResourceStatus wait_for_resource_load(InternalResource *ires, uint32_t want_flags) {
@@ -162,6 +311,14 @@ static void unload_resource(InternalResource *ires) {
 		get_handler(ires->res.type)->procs.unload(ires->res.data);
 	}
 
+	for(PendingLoad *p = finish_queue.queue.first, *next; p; p = next) {
+		next = p->next;
+
+		if(p->ires == ires) {
+			free(alist_unlink(&finish_queue.queue, p));
+		}
+	}
+
 	SDL_DestroyCond(ires->cond);
 	SDL_DestroyMutex(ires->mutex);
 	free(ires);
@@ -175,22 +332,31 @@ static char* get_name(ResourceHandler *handler, const char *path) {
 	return resource_util_basename(handler->subdir, path);
 }
 
+// Adds the VFS work done by the current thread since [since] was taken to [stats].
+static void add_vfs_work(VFSStats *stats, const VFSStats *since) {
+	VFSStats now = vfs_get_thread_stats();
+	stats->lookups += now.lookups - since->lookups;
+	stats->cache_hits += now.cache_hits - since->cache_hits;
+	stats->nodes_allocated += now.nodes_allocated - since->nodes_allocated;
+	stats->syscalls += now.syscalls - since->syscalls;
+}
+
 static void* load_resource_async_task(void *vdata) {
 	ResourceAsyncLoadData *data = vdata;
 
 	SDL_LockMutex(data->ires->mutex);
+	profiler_zone_begin_detail("resource: begin_load", data->name);
+	VFSStats vfs_before = vfs_get_thread_stats();
 	data->opaque = get_ires_handler(data->ires)->procs.begin_load(data->path, data->flags);
+	add_vfs_work(&data->ires->vfs_stats, &vfs_before);
+	profiler_zone_end();
 	events_emit(TE_RESOURCE_ASYNC_LOADED, 0, data->ires, data);
 	SDL_UnlockMutex(data->ires->mutex);
 
 	return data;
 }
 
-static bool resource_asyncload_handler(SDL_Event *evt, void *arg) {
-	assert(is_main_thread());
-
-	InternalResource *ires = evt->user.data1;
-
+static void finish_pending_load(InternalResource *ires) {
 	SDL_LockMutex(ires->mutex);
 	Task *task = ires->async_task;
 	assert(!task || ires->status == RES_STATUS_LOADING);
@@ -198,28 +364,60 @@ static bool resource_asyncload_handler(SDL_Event *evt, void *arg) {
 	SDL_UnlockMutex(ires->mutex);
 
 	if(task == NULL) {
-		return true;
+		// already finished by wait_for_resource_load
+		return;
 	}
 
-	ResourceAsyncLoadData *data, *verify_data;
+	ResourceAsyncLoadData *data;
 
-	if(!task_finish(task, (void**)&verify_data)) {
+	if(!task_finish(task, (void**)&data)) {
 		log_fatal("Internal error: data->ires->async_task failed");
 	}
 
+	hrtime_t start_time = time_get();
 	SDL_LockMutex(ires->mutex);
 
 	if(ires->status == RES_STATUS_LOADING) {
-		data = evt->user.data2;
-		assert(data == verify_data);
 		finish_async_load(ires, data);
 	}
 
 	SDL_UnlockMutex(ires->mutex);
+	finish_queue.spent += time_get() - start_time;
+}
+
+static bool resource_asyncload_handler(SDL_Event *evt, void *arg) {
+	assert(is_main_thread());
+
+	InternalResource *ires = evt->user.data1;
+
+	if(finish_queue.budget && (finish_queue.queue.first || finish_queue.spent >= finish_queue.budget)) {
+		PendingLoad *p = calloc(1, sizeof(*p));
+		p->ires = ires;
+		alist_append(&finish_queue.queue, p);
+	} else {
+		finish_pending_load(ires);
+	}
 
 	return true;
 }
 
+static bool resource_frame_handler(SDL_Event *evt, void *arg) {
+	assert(is_main_thread());
+
+	finish_queue.spent = 0;
+
+	if(load_batch.name) {
+		load_batch.num_frames++;
+	}
+
+	for(PendingLoad *p; finish_queue.spent < finish_queue.budget && (p = alist_pop(&finish_queue.queue));) {
+		finish_pending_load(p->ires);
+		free(p);
+	}
+
+	return false;
+}
+
 static void load_resource_async(InternalResource *ires, char *path, char *name, ResourceFlags flags) {
 	ResourceAsyncLoadData *data = malloc(sizeof(ResourceAsyncLoadData));
 
@@ -229,7 +427,17 @@ static void load_resource_async(InternalResource *ires, char *path, char *name,
 	data->path = path;
 	data->name = name;
 	data->flags = flags;
-	ires->async_task = taskmgr_global_submit((TaskParams) { load_resource_async_task, data });
+	SDL_AtomicIncRef(&num_async_loads);
+
+	if(flags & RESF_PREFETCH) {
+		SDL_AtomicIncRef(&prefetch.num_in_flight);
+	}
+
+	ires->async_task = taskmgr_global_submit((TaskParams) {
+		.callback = load_resource_async_task,
+		.userdata = data,
+		.prio = (flags & RESF_PREFETCH) ? PREFETCH_TASK_PRIO : 0,
+	});
 }
 
 static void load_resource(InternalResource *ires, const char *path, const char *name, ResourceFlags flags, bool async) {
@@ -248,7 +456,9 @@ static void load_resource(InternalResource *ires, const char *path, const char *
 	}
 
 	if(!path) {
+		VFSStats vfs_before = vfs_get_thread_stats();
 		path = allocated_path = handler->procs.find(name);
+		add_vfs_work(&ires->vfs_stats, &vfs_before);
 
 		if(!path) {
 			if(!(flags & RESF_OPTIONAL)) {
@@ -278,7 +488,12 @@ static void load_resource(InternalResource *ires, const char *path, const char *
 		name = allocated_name ? allocated_name : strdup(name);
 		load_resource_async(ires, (char*)path, (char*)name, flags);
 	} else {
-		load_resource_finish(ires, handler->procs.begin_load(path, flags), path, name, allocated_path, allocated_name, flags);
+		profiler_zone_begin_detail("resource: begin_load", name);
+		VFSStats vfs_before = vfs_get_thread_stats();
+		void *opaque = handler->procs.begin_load(path, flags);
+		add_vfs_work(&ires->vfs_stats, &vfs_before);
+		profiler_zone_end();
+		load_resource_finish(ires, opaque, path, name, allocated_path, allocated_name, flags);
 	}
 }
 
@@ -300,7 +515,17 @@ static void finalize_resource(InternalResource *ires, const char *name, void *da
 		flags |= RESF_PERMANENT;
 	}
 
-	ires->res.flags = flags;
+	if(data && (flags & RESF_PREFETCH)) {
+		ResourceHandler *handler = get_ires_handler(ires);
+
+		if(handler->procs.size) {
+			prefetch.memory_used += handler->procs.size(data);
+		}
+
+		prefetch.num_loaded++;
+	}
+
+	ires->res.flags = flags & ~RESF_PREFETCH;
 	ires->res.data = data;
 
 	if(data) {
@@ -311,9 +536,35 @@ static void finalize_resource(InternalResource *ires, const char *name, void *da
 }
 
 static void load_resource_finish(InternalResource *ires, void *opaque, const char *path, const char *name, char *allocated_path, char *allocated_name, ResourceFlags flags) {
-	void *raw = (ires->status == RES_STATUS_FAILED) ? NULL : get_ires_handler(ires)->procs.end_load(opaque, path, flags);
-
 	name = name ? name : "<name unknown>";
+	void *raw = NULL;
+
+	if(ires->status != RES_STATUS_FAILED) {
+		profiler_zone_begin_detail("resource: end_load", name);
+		VFSStats vfs_before = vfs_get_thread_stats();
+		hrtime_t start_time = time_get();
+		raw = get_ires_handler(ires)->procs.end_load(opaque, path, flags);
+		load_batch.end_load_time += time_get() - start_time;
+		add_vfs_work(&ires->vfs_stats, &vfs_before);
+		profiler_zone_end();
+	}
+
+	load_batch.num_loaded++;
+
+	VFSStats *vs = &ires->vfs_stats;
+	log_debug(
+		"%s '%s': %u VFS lookups (%u cached), %u syscalls, %u nodes allocated",
+		type_name(ires->res.type), name, vs->lookups, vs->cache_hits, vs->syscalls, vs->nodes_allocated
+	);
+
+	SDL_AtomicLock(&vfs_work.lock);
+	vfs_work.num_loaded++;
+	vfs_work.totals.lookups += vs->lookups;
+	vfs_work.totals.cache_hits += vs->cache_hits;
+	vfs_work.totals.syscalls += vs->syscalls;
+	vfs_work.totals.nodes_allocated += vs->nodes_allocated;
+	SDL_AtomicUnlock(&vfs_work.lock);
+
 	path = path ? path : "<path unknown>";
 
 	char *sp = vfs_repr(path, true);
@@ -328,6 +579,8 @@ Resource* get_resource(ResourceType type, const char *name, ResourceFlags flags)
 	InternalResource *ires;
 	Resource *res;
 
+	SDL_AtomicIncRef(&num_lookups);
+
 	if(flags & RESF_UNSAFE) {
 		// FIXME: I'm not sure we actually need this functionality.
 
@@ -387,10 +640,29 @@ void* get_resource_data(ResourceType type, const char *name, ResourceFlags flags
 	return NULL;
 }
 
+static void prefetch_enqueue(ResourceType type, const char *name, ResourceFlags flags) {
+	if(ht_get(&get_handler(type)->private.mapping, name, NULL)) {
+		// already loaded or being loaded
+		return;
+	}
+
+	size_t name_size = strlen(name) + 1;
+	PrefetchItem *item = calloc(1, sizeof(*item) + name_size);
+	item->type = type;
+	item->flags = flags | RESF_PREFETCH;
+	memcpy(item->name, name, name_size);
+	alist_append(&prefetch.queue, item);
+}
+
 void preload_resource(ResourceType type, const char *name, ResourceFlags flags) {
 	if(env_get("TAISEI_NOPRELOAD", false))
 		return;
 
+	if(prefetch.recording && is_main_thread()) {
+		prefetch_enqueue(type, name, flags);
+		return;
+	}
+
 	InternalResource *ires;
 
 	if(try_begin_load_resource(type, name, &ires)) {
@@ -411,7 +683,173 @@ void preload_resources(ResourceType type, ResourceFlags flags, const char *first
 	va_end(args);
 }
 
+void resource_log_vfs_work(const char *when) {
+	SDL_AtomicLock(&vfs_work.lock);
+	uint num_loaded = vfs_work.num_loaded;
+	VFSStats t = vfs_work.totals;
+	vfs_work.num_loaded = 0;
+	memset(&vfs_work.totals, 0, sizeof(vfs_work.totals));
+	SDL_AtomicUnlock(&vfs_work.lock);
+
+	if(num_loaded) {
+		log_info(
+			"%u resources loaded %s: %u VFS lookups (%u cached), %u syscalls, %u nodes allocated",
+			num_loaded, when, t.lookups, t.cache_hits, t.syscalls, t.nodes_allocated
+		);
+	}
+}
+
+void resource_batch_begin(const char *name) {
+	assert(is_main_thread());
+
+	if(load_batch.name) {
+		log_warn("%s: the previous batch (%s) isn't done loading yet, merging", name, load_batch.name);
+		free(load_batch.name);
+	} else {
+		memset(&load_batch, 0, sizeof(load_batch));
+		load_batch.start_time = time_get();
+	}
+
+	load_batch.name = strdup(name);
+	load_batch.ending = false;
+}
+
+void resource_batch_end(void) {
+	assert(is_main_thread());
+	assert(load_batch.name != NULL);
+
+	load_batch.ending = true;
+	check_load_batch_done();
+}
+
+void resource_prefetch(const char *name, void (*preload)(void)) {
+	assert(is_main_thread());
+
+	if(prefetch.memory_limit == 0 || env_get("TAISEI_NOASYNC", false) || env_get("TAISEI_NOPRELOAD", false)) {
+		return;
+	}
+
+	if(prefetch.name) {
+		log_debug("%s: cancelling the prefetch for %s", name, prefetch.name);
+		prefetch_cancel();
+	}
+
+	prefetch.name = strdup(name);
+	prefetch.memory_used = 0;
+	prefetch.num_loaded = 0;
+
+	prefetch.recording = true;
+	preload();
+	prefetch.recording = false;
+
+	uint num_queued = 0;
+
+	for(PrefetchItem *item = prefetch.queue.first; item; item = item->next) {
+		++num_queued;
+	}
+
+	log_info("%s: prefetching %u resources", name, num_queued);
+	prefetch_pump();
+}
+
+uint resource_take_lookup_count(void) {
+	return SDL_AtomicSet(&num_lookups, 0);
+}
+
+// Call sites that intern the same name share a slot, so it gets the strictest of their flags:
+// RESF_PERMANENT if any of them asks for it, and each of the others (RESF_OPTIONAL in particular)
+// only if all of them do.
+static ResourceFlags merge_handle_flags(ResourceFlags a, ResourceFlags b) {
+	return ((a | b) & RESF_PERMANENT) | (a & b & ~RESF_PERMANENT);
+}
+
+ResourceHandle res_intern(ResourceType type, const char *name, ResourceFlags flags) {
+	assert(is_main_thread());
+	assert((uint)type < RES_NUMTYPES);
+
+	ResourceHandle handle = ht_get(handles.ids + type, name, 0);
+
+	if(handle) {
+		ResourceHandleSlot *slot = handles.slots + (handle & HANDLE_INDEX_MASK) - 1;
+		ResourceFlags merged = merge_handle_flags(slot->flags, flags);
+
+		if(merged != slot->flags) {
+			// Resolve again with the new flags, e.g. to make an already loaded resource permanent.
+			slot->flags = merged;
+			slot->data = NULL;
+		}
+
+		return handle;
+	}
+
+	if(handles.num == handles.capacity) {
+		handles.capacity = handles.capacity ? handles.capacity * 2 : 256;
+		handles.slots = realloc(handles.slots, sizeof(*handles.slots) * handles.capacity);
+	}
+
+	handles.slots[handles.num++] = (ResourceHandleSlot) {
+		.type = type,
+		.flags = flags,
+		.name = strdup(name),
+	};
+
+	assert(handles.num <= HANDLE_INDEX_MASK);
+
+	// Slots start at 1, so that 0 can mean "not interned yet".
+	handle = handles.num | (handles.generation << HANDLE_INDEX_BITS);
+	ht_set(handles.ids + type, name, handle);
+
+	return handle;
+}
+
+bool res_handle_valid(ResourceHandle handle) {
+	uint index = handle & HANDLE_INDEX_MASK;
+	return index > 0 && index <= handles.num && (handle >> HANDLE_INDEX_BITS) == handles.generation;
+}
+
+void* res_handle_data(ResourceHandle handle) {
+	assert(is_main_thread());
+	assert(res_handle_valid(handle));
+
+	ResourceHandleSlot *slot = handles.slots + (handle & HANDLE_INDEX_MASK) - 1;
+
+	// Missing resources are looked up again, since they may show up later (this is cheap: the
+	// failure is remembered until free_resources).
+	if(!slot->data) {
+		slot->data = get_resource_data(slot->type, slot->name, slot->flags);
+	}
+
+	return slot->data;
+}
+
+static void invalidate_handles(void) {
+	for(uint i = 0; i < handles.num; ++i) {
+		handles.slots[i].data = NULL;
+	}
+}
+
+static void free_handles(void) {
+	for(uint i = 0; i < handles.num; ++i) {
+		free(handles.slots[i].name);
+	}
+
+	for(uint i = 0; i < RES_NUMTYPES; ++i) {
+		ht_destroy(handles.ids + i);
+	}
+
+	free(handles.slots);
+
+	// Any handle still held by a call site is stale now; see res_handle_valid.
+	uint generation = (handles.generation + 1) & HANDLE_GENERATION_MASK;
+	memset(&handles, 0, sizeof(handles));
+	handles.generation = generation;
+}
+
 void init_resources(void) {
+	for(int i = 0; i < RES_NUMTYPES; ++i) {
+		ht_create(handles.ids + i);
+	}
+
 	for(int i = 0; i < RES_NUMTYPES; ++i) {
 		ResourceHandler *h = get_handler(i);
 		alloc_handler(h);
@@ -429,7 +867,17 @@ void init_resources(void) {
 		};
 
 		events_register_handler(&h);
+
+		events_register_handler(&(EventHandler) {
+			.proc = resource_frame_handler,
+			.priority = EPRIO_SYSTEM,
+			.event_type = MAKE_TAISEI_EVENT(TE_FRAME),
+		});
+
+		finish_queue.budget = env_get("TAISEI_FRAME_LOAD_BUDGET", 4) * HRTIME_RESOLUTION / 1000;
 	}
+
+	prefetch.memory_limit = (size_t)imax(0, env_get("TAISEI_PREFETCH_MEMORY_LIMIT", 256)) << 20;
 }
 
 void resource_util_strip_ext(char *path) {
@@ -513,6 +961,11 @@ void load_resources(void) {
 void free_resources(bool all) {
 	ht_str2ptr_ts_iter_t iter;
 
+	prefetch_cancel();
+
+	// Some of the cached pointers are about to dangle; just re-resolve all of them on demand.
+	invalidate_handles();
+
 	for(ResourceType type = 0; type < RES_NUMTYPES; ++type) {
 		ResourceHandler *handler = get_handler(type);
 		InternalResource *ires;
@@ -572,7 +1025,14 @@ void free_resources(bool all) {
 		return;
 	}
 
+	free_handles();
+
 	if(!env_get("TAISEI_NOASYNC", 0)) {
 		events_unregister_handler(resource_asyncload_handler);
+		events_unregister_handler(resource_frame_handler);
 	}
+
+	assert(finish_queue.queue.first == NULL);
+	free(load_batch.name);
+	memset(&load_batch, 0, sizeof(load_batch));
 }
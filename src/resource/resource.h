@@ -32,6 +32,7 @@ typedef enum ResourceFlags {
 	RESF_PERMANENT = 2,
 	RESF_PRELOAD = 4,
 	RESF_UNSAFE = 8,
+	RESF_PREFETCH = 16, // see resource_prefetch; passed on to the dependencies of a resource
 } ResourceFlags;
 
 #define RESF_DEFAULT 0
@@ -52,6 +53,8 @@ typedef bool (*ResourceCheckProc)(const char *path);
 
 // Begins loading a resource specified by path.
 // May be called asynchronously.
+// Other resources this one needs should be preloaded here (see preload_resource), so that they can
+// be loaded in parallel, and then fetched in the end_load proc.
 // The return value is not interpreted in any way, it's just passed to the corresponding ResourceEndLoadProc later.
 typedef void* (*ResourceBeginLoadProc)(const char *path, uint flags);
 
@@ -63,6 +66,10 @@ typedef void* (*ResourceEndLoadProc)(void *opaque, const char *path, uint flags)
 // Unloads a resource, freeing all allocated to it memory.
 typedef void (*ResourceUnloadProc)(void *res);
 
+// Returns roughly how much memory a loaded resource takes, in bytes.
+// Optional, only used to limit prefetching.
+typedef size_t (*ResourceSizeProc)(void *res);
+
 // Called during resource subsystem initialization
 typedef void (*ResourceInitProc)(void);
 
@@ -85,6 +92,7 @@ typedef struct ResourceHandler {
 		ResourceBeginLoadProc begin_load;
 		ResourceEndLoadProc end_load;
 		ResourceUnloadProc unload;
+		ResourceSizeProc size;
 		ResourceInitProc init;
 		ResourcePostInitProc post_init;
 		ResourceShutdownProc shutdown;
@@ -111,6 +119,60 @@ void preload_resource(ResourceType type, const char *name, ResourceFlags flags);
 void preload_resources(ResourceType type, ResourceFlags flags, const char *firstname, ...) attr_sentinel;
 void* resource_for_each(ResourceType type, void* (*callback)(const char *name, Resource *res, void *arg), void *arg);
 
+// Returns the number of string-keyed lookups (get_resource calls) made since the last call.
+uint resource_take_lookup_count(void);
+
+// Logs how much VFS work (see VFSStats) the resources loaded since the last call took in total,
+// then starts over. [when] completes the message, e.g. "during startup".
+void resource_log_vfs_work(const char *when) attr_nonnull(1);
+
+// Times a batch of loads, e.g. everything a stage preloads. Once resource_batch_end has been
+// called and every async load started since resource_batch_begin is finished, the time it took is
+// logged along with [name]. Must be called on the main thread.
+void resource_batch_begin(const char *name) attr_nonnull(1);
+void resource_batch_end(void);
+
+// Loads the resources that [preload] preloads (see preload_resource) in the background, at a lower
+// priority than other loads and only a few at a time, e.g. those of the next stage while the current
+// one is still being played. Prefetching stops early once the resources it loaded take more than
+// TAISEI_PREFETCH_MEMORY_LIMIT; the rest are loaded as usual when they're preloaded for real. Any
+// prefetch that is still going on is cancelled by free_resources. Must be called on the main thread.
+void resource_prefetch(const char *name, void (*preload)(void)) attr_nonnull(1, 2);
+
+/*
+ * Interned resource handles.
+ *
+ * A handle is a small integer that stands for a (type, name) pair. Resolving it is a plain array
+ * access, except for the first time after the resource cache was flushed by free_resources, when
+ * it takes a regular get_resource call. Handles are meant for names that are used over and over
+ * again, e.g. in per-frame code. Use RES_INTERNED (or one of the typed wrappers such as
+ * get_sprite_interned) with a string literal, and the name will only be interned once per call site.
+ *
+ * Handles must only be interned and resolved on the main thread. They stay valid until
+ * free_resources(true); RES_INTERNED interns the name again after that. A handle to a missing
+ * resource resolves to NULL, and is looked up again the next time. If several call sites intern
+ * the same name with different flags, the handle uses the strictest combination; see
+ * merge_handle_flags in resource.c.
+ */
+
+typedef uint32_t ResourceHandle;
+
+ResourceHandle res_intern(ResourceType type, const char *name, ResourceFlags flags) attr_nonnull(2);
+bool res_handle_valid(ResourceHandle handle);
+void* res_handle_data(ResourceHandle handle);
+
+#ifdef USE_GNU_EXTENSIONS
+	#define RES_INTERNED(type, name, flags) (__extension__({ \
+		static ResourceHandle _res_handle; \
+		if(!res_handle_valid(_res_handle)) { \
+			_res_handle = res_intern(type, name, flags); \
+		} \
+		res_handle_data(_res_handle); \
+	}))
+#else
+	#define RES_INTERNED(type, name, flags) res_handle_data(res_intern(type, name, flags))
+#endif
+
 void resource_util_strip_ext(char *path);
 char* resource_util_basename(const char *prefix, const char *path);
 const char* resource_util_filename(const char *path);
@@ -21,5 +21,6 @@ ResourceHandler sfx_res_handler = {
         .begin_load = load_sound_begin,
         .end_load = load_sound_end,
         .unload = unload_sound,
+        .size = sound_memory_size,
     },
 };
@@ -30,6 +30,7 @@ bool check_sound_path(const char *path);
 void* load_sound_begin(const char *path, uint flags);
 void* load_sound_end(void *opaque, const char *path, uint flags);
 void unload_sound(void *snd);
+size_t sound_memory_size(void *snd);
 
 extern ResourceHandler sfx_res_handler;
 
@@ -65,6 +65,11 @@ void* load_sound_end(void *opaque, const char *path, uint flags) {
 	return opaque;
 }
 
+size_t sound_memory_size(void *vsnd) {
+	// Chunks are fully decoded at load time.
+	return ((MixerInternalSound*)((Sound*)vsnd)->impl)->ch->alen;
+}
+
 void unload_sound(void *vsnd) {
 	Sound *snd = vsnd;
 	Mix_FreeChunk(((MixerInternalSound *)snd->impl)->ch);
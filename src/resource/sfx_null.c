@@ -16,3 +16,4 @@ bool check_sound_path(const char *path) { return NULL; }
 void* load_sound_begin(const char *path, uint flags) { return NULL; }
 void* load_sound_end(void *opaque, const char *path, uint flags) { return NULL; }
 void unload_sound(void *vmus) { }
+size_t sound_memory_size(void *snd) { return 0; }
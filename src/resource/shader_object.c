@@ -10,7 +10,9 @@
 
 #include "util.h"
 #include "shader_object.h"
+#include "texture.h"
 #include "renderer/api.h"
+#include "renderer/common/shader_cache.h"
 
 struct shobj_type {
 	const char *ext;
@@ -59,61 +61,128 @@ static bool check_shader_object_path(const char *path) {
 	return strstartswith(path, SHOBJ_PATH_PREFIX) && get_shobj_type(path);
 }
 
-static void* load_shader_object_begin(const char *path, uint flags) {
-	struct shobj_type *type = get_shobj_type(path);
-	struct shobj_load_data *ldata = calloc(1, sizeof(struct shobj_load_data));
+static bool translate_shader(const char *path, const ShaderSource *in, const ShaderLangInfo *lang, ShaderSource *out) {
+	const SPIRVOptimizationLevel optimization_level = SPIRV_OPTIMIZE_PERFORMANCE;
 
-	switch(type->lang) {
-		case SHLANG_GLSL: {
-			GLSLSourceOptions opts = {
-				.version = { 330, GLSL_PROFILE_CORE },
-				.stage = type->stage,
-			};
+	ShaderCacheKey key = shader_cache_key("spirv_transpile");
+	key = shader_cache_key_add_source(key, in);
+	key = shader_cache_key_add_lang(key, lang);
+	key = shader_cache_key_add(key, sizeof(optimization_level), &optimization_level);
 
-			if(!glsl_load_source(path, &ldata->source, &opts)) {
-				goto fail;
-			}
+	size_t size;
+	void *data;
 
-			break;
+	if(shader_cache_read(key, &size, &data)) {
+		out->content = data;
+		out->content_size = size;
+		out->lang = *lang;
+		out->stage = in->stage;
+		return true;
+	}
+
+	log_warn("%s: shading language not supported by backend, attempting to translate", path);
+
+	hrtime_t time_begin = time_get();
+	bool result = spirv_transpile(in, out, &(SPIRVTranspileOptions) {
+		.lang = lang,
+		.optimization_level = optimization_level,
+		.filename = path,
+	});
+
+	if(result) {
+		shader_cache_write(key, out->content_size, out->content, time_get() - time_begin);
+	}
+
+	return result;
+}
+
+bool shader_object_load_glsl(const char *path, ShaderStage stage, const GLSLMacro *macros, ShaderSource *out) {
+	GLSLSourceOptions opts = {
+		.version = { 330, GLSL_PROFILE_CORE },
+		.stage = stage,
+	};
+
+	uint num_macros = 0;
+
+	if(macros) {
+		while(macros[num_macros].name) {
+			++num_macros;
 		}
+	}
 
-		default: UNREACHABLE;
+	GLSLMacro all_macros[num_macros + 3];
+	GLSLMacro *macro = all_macros;
+
+	// Only when the source can be used as is; the block can't be translated for GLES 2.0.
+	if(
+		r_supports(RFEAT_UNIFORM_BUFFERS) &&
+		r_shader_language_supported(&(ShaderLangInfo) { .lang = SHLANG_GLSL, .glsl.version = opts.version }, NULL)
+	) {
+		*macro++ = (GLSLMacro) { "R_RENDER_CONTEXT_BLOCK", "1" };
+	}
+
+	if(texture_atlas_arrays_enabled()) {
+		*macro++ = (GLSLMacro) { "R_SPRITE_TEXTURE_ARRAYS", "1" };
+	}
+
+	for(uint i = 0; i < num_macros; ++i) {
+		*macro++ = macros[i];
+	}
+
+	*macro = (GLSLMacro) { NULL };
+	opts.macros = all_macros;
+
+	if(!glsl_load_source(path, out, &opts)) {
+		return false;
 	}
 
 	ShaderLangInfo altlang = { SHLANG_INVALID };
 
-	if(!r_shader_language_supported(&ldata->source.lang, &altlang)) {
+	if(!r_shader_language_supported(&out->lang, &altlang)) {
 		if(altlang.lang == SHLANG_INVALID) {
 			log_warn("%s: shading language not supported by backend", path);
 			goto fail;
 		}
 
-		log_warn("%s: shading language not supported by backend, attempting to translate", path);
-
 		assert(r_shader_language_supported(&altlang, NULL));
 
 		ShaderSource newsrc;
-		bool result = spirv_transpile(&ldata->source, &newsrc, &(SPIRVTranspileOptions) {
-			.lang = &altlang,
-			.optimization_level = SPIRV_OPTIMIZE_PERFORMANCE,
-			.filename = path,
-		});
 
-		if(!result) {
+		if(!translate_shader(path, out, &altlang, &newsrc)) {
 			log_warn("%s: translation failed", path);
 			goto fail;
 		}
 
-		free(ldata->source.content);
-		ldata->source = newsrc;
+		free(out->content);
+		*out = newsrc;
 	}
 
-	return ldata;
+	return true;
 
 fail:
-	free(ldata->source.content);
-	free(ldata);
-	return NULL;
+	free(out->content);
+	out->content = NULL;
+	return false;
+}
+
+static void* load_shader_object_begin(const char *path, uint flags) {
+	struct shobj_type *type = get_shobj_type(path);
+	struct shobj_load_data *ldata = calloc(1, sizeof(struct shobj_load_data));
+
+	switch(type->lang) {
+		case SHLANG_GLSL: {
+			if(!shader_object_load_glsl(path, type->stage, NULL, &ldata->source)) {
+				free(ldata);
+				return NULL;
+			}
+
+			break;
+		}
+
+		default: UNREACHABLE;
+	}
+
+	return ldata;
 }
 
 static void* load_shader_object_end(void *opaque, const char *path, uint flags) {
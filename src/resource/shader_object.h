@@ -12,6 +12,7 @@
 #include "taisei.h"
 
 #include "resource.h"
+#include "renderer/api.h"
 
 typedef struct ShaderObject ShaderObject;
 
@@ -19,4 +20,10 @@ extern ResourceHandler shader_object_res_handler;
 
 #define SHOBJ_PATH_PREFIX "res/shader/"
 
+// Loads the GLSL source of a shader object the way the resource loader does: with the macros
+// that describe the renderer's features defined, as well as [macros] (NULL-terminated, may be
+// NULL), and translated into another language if the backend needs it.
+bool shader_object_load_glsl(const char *path, ShaderStage stage, const GLSLMacro *macros, ShaderSource *out)
+	attr_nonnull(1, 4);
+
 #endif // IGUARD_resource_shader_object_h
@@ -57,6 +57,7 @@ void* load_sprite_begin(const char *path, uint flags) {
 
 	if(check_texture_path(path)) {
 		state->texture_name = resource_util_basename(TEX_PATH_PREFIX, path);
+		texture_preload(state->texture_name, flags);
 		return state;
 	}
 
@@ -82,6 +83,7 @@ void* load_sprite_begin(const char *path, uint flags) {
 		log_warn("%s: inferred texture name from sprite name", state->texture_name);
 	}
 
+	texture_preload(state->texture_name, flags);
 	return state;
 }
 
@@ -93,20 +95,25 @@ void* load_sprite_end(void *opaque, const char *path, uint flags) {
 	}
 
 	Sprite *spr = state->spr;
+	uint tw, th;
 
-	Resource *res = get_resource(RES_TEXTURE, state->texture_name, flags);
+	// The region is relative to the page, which is placed at the origin of its layer.
+	if(!texture_find_array_layer(state->texture_name, flags, &spr->tex, &spr->tex_layer, &tw, &th)) {
+		Resource *res = get_resource(RES_TEXTURE, state->texture_name, flags);
 
-	free(state->texture_name);
-	free(state);
+		if(res == NULL) {
+			free(state->texture_name);
+			free(state);
+			free(spr);
+			return NULL;
+		}
 
-	if(res == NULL) {
-		free(spr);
-		return NULL;
+		spr->tex = res->data;
+		r_texture_get_size(spr->tex, 0, &tw, &th);
 	}
 
-	spr->tex = res->data;
-	uint tw, th;
-	r_texture_get_size(spr->tex, 0, &tw, &th);
+	free(state->texture_name);
+	free(state);
 
 	float tex_w_flt = tw;
 	float tex_h_flt = th;
@@ -170,10 +177,16 @@ void draw_sprite_batched_p(float x, float y, Sprite *spr) {
 }
 
 void begin_draw_sprite(float x, float y, float scale_x, float scale_y, Sprite *spr) {
+	Texture *tex = spr->tex;
+
+	if(r_texture_get_layers(tex)) {
+		tex = texture_array_layer_as_texture(tex, spr->tex_layer);
+	}
+
 	begin_draw_texture(
 		(FloatRect){ x, y, spr->w * scale_x, spr->h * scale_y },
 		(FloatRect){ spr->tex_area.x, spr->tex_area.y, spr->tex_area.w, spr->tex_area.h },
-		spr->tex
+		tex
 	);
 }
 
@@ -19,6 +19,7 @@ typedef struct Sprite {
 	FloatRect tex_area;
 	float w;
 	float h;
+	uint tex_layer; // only meaningful if tex is an array texture
 } Sprite;
 
 char* sprite_path(const char *name);
@@ -38,6 +39,9 @@ void end_draw_sprite(void);
 Sprite* get_sprite(const char *name);
 Sprite* prefix_get_sprite(const char *name, const char *prefix);
 
+// Like get_sprite, but the name is only looked up once per call site. See RES_INTERNED.
+#define get_sprite_interned(name) ((Sprite*)RES_INTERNED(RES_SPRITE, name, RESF_DEFAULT))
+
 extern ResourceHandler sprite_res_handler;
 
 #define SPRITE_PATH_PREFIX "res/gfx/"
@@ -9,15 +9,20 @@
 #include "taisei.h"
 
 #include "texture.h"
+#include "texture_baked.h"
 #include "resource.h"
 #include "global.h"
 #include "video.h"
 #include "renderer/api.h"
 #include "util/pixmap.h"
+#include "list.h"
 
 static void* load_texture_begin(const char *path, uint flags);
 static void* load_texture_end(void *opaque, const char *path, uint flags);
 static void free_texture(Texture *tex);
+static size_t texture_memory_size(Texture *tex);
+static void init_textures(void);
+static void shutdown_textures(void);
 
 ResourceHandler texture_res_handler = {
 	.type = RES_TEXTURE,
@@ -30,9 +35,100 @@ ResourceHandler texture_res_handler = {
 		.begin_load = load_texture_begin,
 		.end_load = load_texture_end,
 		.unload = (ResourceUnloadProc)free_texture,
+		.size = (ResourceSizeProc)texture_memory_size,
+		.init = init_textures,
+		.shutdown = shutdown_textures,
 	},
 };
 
+/*
+ * Atlas pages can be grouped into 2D array textures, so that sprites from different pages can be
+ * drawn in the same batch. A group is a .tex file that lists its pages:
+ *
+ *     layers = atlas_common_0 atlas_common_1
+ *
+ * and each page names its group with an `array` key. Array textures are only used when
+ * TAISEI_ATLAS_ARRAYS is set; otherwise the pages are loaded as usual, and group files are never
+ * referenced.
+ *
+ * Every layer has the size of the largest page, with smaller pages placed at the origin, so
+ * grouping pages of very different sizes wastes memory.
+ */
+
+typedef struct TextureArrayLayer {
+	char *name;
+	uint width;
+	uint height;
+} TextureArrayLayer;
+
+typedef struct TextureArray TextureArray;
+
+struct TextureArray {
+	LIST_INTERFACE(TextureArray);
+	Texture *tex;
+	uint num_layers;
+	TextureArrayLayer *layers;
+};
+
+static struct {
+	bool enabled;
+	TextureArray *arrays;
+
+	// Page name -> group name (NULL if the page isn't in one).
+	ht_str2ptr_ts_t groups;
+} texture_arrays;
+
+static struct {
+	bool use_baked;
+
+	SDL_SpinLock stats_lock;
+	struct {
+		uint num;
+		hrtime_t load_time;   // reading and decoding, on any thread
+		hrtime_t upload_time; // creating the texture, on the main thread
+	} stats[2]; // decoded, baked
+} texture_images;
+
+static void init_textures(void) {
+	texture_arrays.enabled = r_supports(RFEAT_TEXTURE_ARRAYS) && env_get("TAISEI_ATLAS_ARRAYS", false);
+	ht_create(&texture_arrays.groups);
+
+	if(texture_arrays.enabled) {
+		log_info("Atlas pages will be loaded into array textures");
+	}
+
+	texture_images.use_baked = env_get("TAISEI_BAKED_TEXTURES", false);
+}
+
+static void shutdown_textures(void) {
+	for(int baked = 0; baked < 2; ++baked) {
+		if(texture_images.stats[baked].num) {
+			log_info("%u %s images loaded in %fs, uploaded in %fs",
+				texture_images.stats[baked].num,
+				baked ? "baked" : "decoded",
+				texture_images.stats[baked].load_time / (double)HRTIME_RESOLUTION,
+				texture_images.stats[baked].upload_time / (double)HRTIME_RESOLUTION
+			);
+		}
+	}
+
+	memset(&texture_images.stats, 0, sizeof(texture_images.stats));
+
+	ht_str2ptr_ts_iter_t iter;
+	ht_iter_begin(&texture_arrays.groups, &iter);
+
+	for(; iter.has_data; ht_iter_next(&iter)) {
+		free(iter.value);
+	}
+
+	ht_iter_end(&iter);
+	ht_destroy(&texture_arrays.groups);
+}
+
+bool texture_atlas_arrays_enabled(void) {
+	return texture_arrays.enabled;
+}
+
 char* texture_path(const char *name) {
 	char *p = NULL;
 
@@ -247,11 +343,249 @@ static bool parse_format(const char *val, PixmapFormat *out) {
 	return true;
 }
 
+typedef struct TextureImage {
+	Pixmap levels[TEXTURE_BAKED_MAX_LEVELS];
+	uint num_levels;
+
+	// Loaded from a baked copy: the alpha is premultiplied, and any levels past the first are
+	// its mipmaps. Otherwise, there is only one level.
+	bool baked;
+} TextureImage;
+
 typedef struct TextureLoadData {
-	Pixmap pixmap;
+	TextureImage image;
 	TextureParams params;
+
+	// Only for array textures, in which case the pixmap above is unused.
+	Pixmap *layer_pixmaps;
+	TextureArrayLayer *layers;
 } TextureLoadData;
 
+static bool capture_key(const char *key, const char *val, void *data) {
+	// Not a KVSpec, because that would complain about every other key.
+	struct { const char *key; char *val; } *capture = data;
+
+	if(!strcmp(key, capture->key)) {
+		stralloc(&capture->val, val);
+	}
+
+	return true;
+}
+
+// Returns the value of [key] in the .tex file of the texture [name], or NULL. Must be freed.
+static char* texture_read_key(const char *name, const char *key) {
+	char *path = texture_path(name);
+	struct { const char *key; char *val; } capture = { key };
+
+	if(path && strendswith(path, TEX_EXTENSION)) {
+		parse_keyvalue_file_cb(path, capture_key, &capture);
+	}
+
+	free(path);
+	return capture.val;
+}
+
+static void premultiply_alpha(Pixmap *px) {
+	if(PIXMAP_FORMAT_LAYOUT(px->format) != PIXMAP_LAYOUT_RGBA) {
+		return;
+	}
+
+	size_t num_pixels = px->width * px->height;
+
+	switch(px->format) {
+		case PIXMAP_FORMAT_RGBA8:
+			for(PixelRGBA8 *p = px->data.rgba8, *end = p + num_pixels; p < end; ++p) {
+				for(uint i = 0; i < 3; ++i) {
+					p->values[i] = (p->values[i] * p->a + UINT8_MAX / 2) / UINT8_MAX;
+				}
+			}
+			break;
+
+		case PIXMAP_FORMAT_RGBA16:
+			for(PixelRGBA16 *p = px->data.rgba16, *end = p + num_pixels; p < end; ++p) {
+				for(uint i = 0; i < 3; ++i) {
+					p->values[i] = (p->values[i] * (uint32_t)p->a + UINT16_MAX / 2) / UINT16_MAX;
+				}
+			}
+			break;
+
+		case PIXMAP_FORMAT_RGBA32F:
+			for(PixelRGBA32F *p = px->data.rgba32f, *end = p + num_pixels; p < end; ++p) {
+				for(uint i = 0; i < 3; ++i) {
+					p->values[i] *= p->a;
+				}
+			}
+			break;
+
+		default:
+			log_warn("Can't premultiply alpha of pixel format 0x%04x", px->format);
+			break;
+	}
+}
+
+static void free_texture_image(TextureImage *img) {
+	for(uint i = 0; i < img->num_levels; ++i) {
+		free(img->levels[i].data.untyped);
+	}
+
+	img->num_levels = 0;
+}
+
+static void count_texture_image(bool baked, uint num, hrtime_t load_time, hrtime_t upload_time) {
+	SDL_AtomicLock(&texture_images.stats_lock);
+	texture_images.stats[baked].num += num;
+	texture_images.stats[baked].load_time += load_time;
+	texture_images.stats[baked].upload_time += upload_time;
+	SDL_AtomicUnlock(&texture_images.stats_lock);
+}
+
+// Loads the image at [source], preferring a baked copy (see texture_baked.h), and flips it into
+// the origin the renderer wants.
+static bool load_texture_image(const char *source, TextureImage *img) {
+	hrtime_t time_begin = time_get();
+	img->num_levels = 0;
+
+	if(texture_images.use_baked) {
+		img->num_levels = texture_baked_load(source, TEXTURE_BAKED_MAX_LEVELS, img->levels);
+	}
+
+	img->baked = img->num_levels > 0;
+
+	if(!img->baked) {
+		if(!pixmap_load_file(source, img->levels)) {
+			return false;
+		}
+
+		img->num_levels = 1;
+	}
+
+	for(uint i = 0; i < img->num_levels; ++i) {
+		if(r_supports(RFEAT_TEXTURE_BOTTOMLEFT_ORIGIN)) {
+			pixmap_flip_to_origin_inplace(img->levels + i, PIXMAP_ORIGIN_BOTTOMLEFT);
+		} else {
+			pixmap_flip_to_origin_inplace(img->levels + i, PIXMAP_ORIGIN_TOPLEFT);
+		}
+	}
+
+	count_texture_image(img->baked, 1, time_get() - time_begin, 0);
+	return true;
+}
+
+// Copies [px] into the origin of a zero-filled pixmap of the given size.
+static void pad_pixmap(Pixmap *px, uint width, uint height) {
+	if(px->width == width && px->height == height) {
+		return;
+	}
+
+	size_t pixel_size = PIXMAP_FORMAT_PIXEL_SIZE(px->format);
+	size_t src_stride = px->width * pixel_size;
+	size_t dst_stride = width * pixel_size;
+	char *src = px->data.untyped;
+	char *dst = calloc(height, dst_stride);
+
+	// Rows are stored in origin order, so the page ends up at the origin either way.
+	for(size_t row = 0; row < px->height; ++row) {
+		memcpy(dst + row * dst_stride, src + row * src_stride, src_stride);
+	}
+
+	free(src);
+	px->data.untyped = dst;
+	px->width = width;
+	px->height = height;
+}
+
+static void free_layers(uint num_layers, Pixmap *pixmaps, TextureArrayLayer *layers) {
+	for(uint i = 0; i < num_layers; ++i) {
+		if(pixmaps) {
+			free(pixmaps[i].data.untyped);
+		}
+
+		free(layers[i].name);
+	}
+
+	free(pixmaps);
+	free(layers);
+}
+
+static void* load_texture_array_begin(const char *path, const char *layer_names, TextureLoadData *ld, PixmapFormat format) {
+	char buf[strlen(layer_names) + 1];
+	strcpy(buf, layer_names);
+
+	uint num_layers = 0;
+	Pixmap *pixmaps = NULL;
+	TextureArrayLayer *layers = NULL;
+	uint width = 0, height = 0;
+	char *ignore;
+
+	for(char *name = strtok_r(buf, " \t", &ignore); name; name = strtok_r(NULL, " \t", &ignore)) {
+		char *source = texture_read_key(name, "source");
+
+		if(!source) {
+			source = pixmap_source_path(TEX_PATH_PREFIX, name);
+		}
+
+		TextureImage img;
+
+		if(!source || !load_texture_image(source, &img)) {
+			log_warn("%s: couldn't load layer %s", path, name);
+			free(source);
+			free_layers(num_layers, pixmaps, layers);
+			return NULL;
+		}
+
+		free(source);
+
+		// Mipmaps of array textures are always generated from the padded layers.
+		Pixmap px = img.levels[0];
+		img.levels[0].data.untyped = NULL;
+		free_texture_image(&img);
+
+		// All layers share one format, so convert everything to that of the first one.
+		format = format ? format : px.format;
+		pixmap_convert_inplace_realloc(&px, format);
+
+		// The post-load shader can't render into a layer, so this has to be done here.
+		if(!img.baked) {
+			premultiply_alpha(&px);
+		}
+
+		pixmaps = realloc(pixmaps, sizeof(*pixmaps) * (num_layers + 1));
+		layers = realloc(layers, sizeof(*layers) * (num_layers + 1));
+		pixmaps[num_layers] = px;
+		layers[num_layers].name = strdup(name);
+		layers[num_layers].width = px.width;
+		layers[num_layers].height = px.height;
+		width = imax(width, px.width);
+		height = imax(height, px.height);
+		++num_layers;
+	}
+
+	if(num_layers == 0) {
+		log_warn("%s: no layers specified", path);
+		return NULL;
+	}
+
+	for(uint i = 0; i < num_layers; ++i) {
+		pad_pixmap(pixmaps + i, width, height);
+	}
+
+	log_debug("%s: %u layers of %ux%u", path, num_layers, width, height);
+
+	ld->params.type = pixmap_format_to_texture_type(format);
+	ld->params.width = width;
+	ld->params.height = height;
+	ld->params.layers = num_layers;
+	ld->params.mipmap_mode = TEX_MIPMAP_AUTO;
+	ld->layer_pixmaps = pixmaps;
+	ld->layers = layers;
+
+	if(ld->params.mipmaps == 0) {
+		ld->params.mipmaps = TEX_MIPMAPS_MAX;
+	}
+
+	return memdup(ld, sizeof(*ld));
+}
+
 static void* load_texture_begin(const char *path, uint flags) {
 	const char *source = path;
 	char *source_allocated = NULL;
@@ -284,6 +618,7 @@ static void* load_texture_begin(const char *path, uint flags) {
 		char *str_wrap_s = NULL;
 		char *str_wrap_t = NULL;
 		char *str_format = NULL;
+		char *str_layers = NULL;
 
 		if(!parse_keyvalue_file_with_spec(path, (KVSpec[]) {
 			{ "source",     .out_str  = &source_allocated },
@@ -294,13 +629,16 @@ static void* load_texture_begin(const char *path, uint flags) {
 			{ "format",     .out_str  = &str_format },
 			{ "mipmaps",    .out_int  = (int*)&ld.params.mipmaps },
 			{ "anisotropy", .out_int  = (int*)&ld.params.anisotropy },
+			{ "layers",     .out_str  = &str_layers },
+			{ "array" }, // only read by texture_find_array_layer
 			{ NULL }
 		})) {
 			free(source_allocated);
+			free(str_layers);
 			return NULL;
 		}
 
-		if(!source_allocated) {
+		if(!source_allocated && !str_layers) {
 			char *basename = resource_util_basename(TEX_PATH_PREFIX, path);
 			source_allocated = pixmap_source_path(TEX_PATH_PREFIX, basename);
 
@@ -336,12 +674,31 @@ static void* load_texture_begin(const char *path, uint flags) {
 
 		if(!format_ok) {
 			free(source_allocated);
+			free(str_layers);
 			log_warn("%s: bad or unsupported pixel format specification", path);
 			return NULL;
 		}
+
+		if(str_layers) {
+			if(source_allocated) {
+				log_warn("%s: source is ignored for array textures", path);
+				free(source_allocated);
+			}
+
+			void *result = NULL;
+
+			if(texture_arrays.enabled) {
+				result = load_texture_array_begin(path, str_layers, &ld, override_format);
+			} else {
+				log_warn("%s: array textures are disabled", path);
+			}
+
+			free(str_layers);
+			return result;
+		}
 	}
 
-	if(!pixmap_load_file(source, &ld.pixmap)) {
+	if(!load_texture_image(source, &ld.image)) {
 		log_warn("%s: couldn't load texture image", source);
 		free(source_allocated);
 		return NULL;
@@ -349,13 +706,8 @@ static void* load_texture_begin(const char *path, uint flags) {
 
 	free(source_allocated);
 
-	if(r_supports(RFEAT_TEXTURE_BOTTOMLEFT_ORIGIN)) {
-		pixmap_flip_to_origin_inplace(&ld.pixmap, PIXMAP_ORIGIN_BOTTOMLEFT);
-	} else {
-		pixmap_flip_to_origin_inplace(&ld.pixmap, PIXMAP_ORIGIN_TOPLEFT);
-	}
-
-	override_format = override_format ? override_format : ld.pixmap.format;
+	Pixmap *pixmap = ld.image.levels;
+	override_format = override_format ? override_format : pixmap->format;
 	ld.params.type = pixmap_format_to_texture_type(override_format);
 	log_debug("%s: %d channels, %d bits per channel, %s",
 		path,
@@ -368,8 +720,25 @@ static void* load_texture_begin(const char *path, uint flags) {
 		ld.params.mipmaps = TEX_MIPMAPS_MAX;
 	}
 
-	ld.params.width = ld.pixmap.width;
-	ld.params.height = ld.pixmap.height;
+	ld.params.width = pixmap->width;
+	ld.params.height = pixmap->height;
+
+	if(ld.image.baked) {
+		uint full_chain = 1;
+
+		for(uint size = imax(pixmap->width, pixmap->height); size > 1; size >>= 1) {
+			++full_chain;
+		}
+
+		uint wanted = ld.params.mipmaps == TEX_MIPMAPS_MAX ? full_chain : ld.params.mipmaps;
+
+		if(ld.image.num_levels >= wanted) {
+			ld.params.mipmaps = wanted;
+		} else {
+			// Not enough of them were baked; the premultiplied image is good to generate them from.
+			ld.params.mipmap_mode = TEX_MIPMAP_AUTO;
+		}
+	}
 
 	return memdup(&ld, sizeof(ld));
 }
@@ -433,13 +802,50 @@ static void* load_texture_end(void *opaque, const char *path, uint flags) {
 	char *basename = resource_util_basename(TEX_PATH_PREFIX, path);
 	Texture *texture = r_texture_create(&ld->params);
 	r_texture_set_debug_label(texture, basename);
-	r_texture_fill(texture, 0, &ld->pixmap);
-	free(ld->pixmap.data.untyped);
+
+	if(ld->layers) {
+		TextureArray *array = calloc(1, sizeof(*array));
+		array->tex = texture;
+		array->num_layers = ld->params.layers;
+		array->layers = ld->layers;
+
+		for(uint i = 0; i < array->num_layers; ++i) {
+			r_texture_fill_layer(texture, 0, i, 0, 0, ld->layer_pixmaps + i);
+			free(ld->layer_pixmaps[i].data.untyped);
+		}
+
+		list_push(&texture_arrays.arrays, array);
+		free(ld->layer_pixmaps);
+		free(ld);
+		free(basename);
+
+		// Already premultiplied, and mipmaps are generated automatically.
+		return texture;
+	}
+
+	hrtime_t time_begin = time_get();
+	bool baked = ld->image.baked;
+	r_texture_fill(texture, 0, ld->image.levels);
+
+	if(baked && ld->params.mipmap_mode == TEX_MIPMAP_MANUAL) {
+		TextureParams params;
+		r_texture_get_params(texture, &params);
+
+		for(uint i = 1; i < ld->image.num_levels && i < params.mipmaps; ++i) {
+			r_texture_fill(texture, i, ld->image.levels + i);
+		}
+	}
+
+	free_texture_image(&ld->image);
 	free(ld);
 
-	texture = texture_post_load(texture);
-	r_texture_set_debug_label(texture, basename);
+	if(!baked) {
+		texture = texture_post_load(texture);
+		r_texture_set_debug_label(texture, basename);
+	}
+
 	free(basename);
+	count_texture_image(baked, 0, 0, time_get() - time_begin);
 
 	return texture;
 }
@@ -455,10 +861,115 @@ Texture* prefix_get_tex(const char *name, const char *prefix) {
 	return tex;
 }
 
+static TextureArray* texture_array_info(Texture *tex) {
+	for(TextureArray *a = texture_arrays.arrays; a; a = a->next) {
+		if(a->tex == tex) {
+			return a;
+		}
+	}
+
+	return NULL;
+}
+
+static void* read_array_group(void *name) {
+	return texture_read_key(name, "array");
+}
+
+// Returns the array texture the page [name] belongs to, or NULL. Safe to call from any thread.
+static const char* texture_array_group(const char *name) {
+	if(!texture_arrays.enabled) {
+		return NULL;
+	}
+
+	char *group;
+	attr_unused bool added = ht_try_set(&texture_arrays.groups, name, (void*)name, read_array_group, (void**)&group);
+	return group;
+}
+
+void texture_preload(const char *name, uint flags) {
+	const char *group = texture_array_group(name);
+	preload_resource(RES_TEXTURE, group ? group : name, flags);
+}
+
+bool texture_find_array_layer(const char *name, uint flags, Texture **out_tex, uint *out_layer, uint *out_width, uint *out_height) {
+	const char *group = texture_array_group(name);
+
+	if(!group) {
+		return false;
+	}
+
+	Resource *res = get_resource(RES_TEXTURE, group, flags);
+	TextureArray *array = res ? texture_array_info(res->data) : NULL;
+
+	if(!array) {
+		log_warn("%s: couldn't load array texture %s, the page will be loaded on its own", name, group);
+		return false;
+	}
+
+	for(uint i = 0; i < array->num_layers; ++i) {
+		if(!strcmp(array->layers[i].name, name)) {
+			*out_tex = array->tex;
+			*out_layer = i;
+			*out_width = array->layers[i].width;
+			*out_height = array->layers[i].height;
+			return true;
+		}
+	}
+
+	log_warn("%s: not listed in array texture %s, the page will be loaded on its own", name, group);
+	return false;
+}
+
+Texture* texture_array_layer_as_texture(Texture *tex, uint layer) {
+	TextureArray *array = texture_array_info(tex);
+	assert(array != NULL);
+	assert(layer < array->num_layers);
+
+	// The page is loaded once more as an ordinary texture. Costs memory, but only for the few
+	// pages that are drawn this way.
+	return get_tex(array->layers[layer].name);
+}
+
 static void free_texture(Texture *tex) {
+	TextureArray *array = texture_array_info(tex);
+
+	if(array) {
+		free_layers(array->num_layers, NULL, array->layers);
+		free(list_unlink(&texture_arrays.arrays, array));
+	}
+
 	r_texture_destroy(tex);
 }
 
+static size_t texture_memory_size(Texture *tex) {
+	static const uint8_t texel_sizes[] = {
+		[TEX_TYPE_RGBA_8] = 4,
+		[TEX_TYPE_RGB_8] = 3,
+		[TEX_TYPE_RG_8] = 2,
+		[TEX_TYPE_R_8] = 1,
+		[TEX_TYPE_DEPTH_8] = 1,
+		[TEX_TYPE_RGBA_16] = 8,
+		[TEX_TYPE_RGB_16] = 6,
+		[TEX_TYPE_RG_16] = 4,
+		[TEX_TYPE_R_16] = 2,
+		[TEX_TYPE_DEPTH_16] = 2,
+		[TEX_TYPE_RGBA_32_FLOAT] = 16,
+		[TEX_TYPE_RGB_32_FLOAT] = 12,
+		[TEX_TYPE_RG_32_FLOAT] = 8,
+		[TEX_TYPE_R_32_FLOAT] = 4,
+		[TEX_TYPE_DEPTH_32_FLOAT] = 4,
+	};
+
+	TextureParams p;
+	r_texture_get_params(tex, &p);
+	assert((uint)p.type < sizeof(texel_sizes) / sizeof(*texel_sizes));
+
+	size_t size = (size_t)p.width * p.height * imax(1, p.layers) * texel_sizes[p.type];
+
+	// a full mipmap chain adds about a third
+	return p.mipmaps > 1 ? size + size / 3 : size;
+}
+
 static struct draw_texture_state {
 	bool drawing;
 	bool texture_matrix_tainted;
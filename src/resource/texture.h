@@ -35,6 +35,19 @@ void loop_tex_line(complex a, complex b, float w, float t, const char *texture);
 Texture* get_tex(const char *name);
 Texture* prefix_get_tex(const char *name, const char *prefix);
 
+// Whether atlas pages are grouped into array textures; see TAISEI_ATLAS_ARRAYS.
+bool texture_atlas_arrays_enabled(void);
+
+// Preloads the texture [name], or the array texture it's a page of. May be called from any thread.
+void texture_preload(const char *name, uint flags) attr_nonnull(1);
+
+// If the texture [name] is a page of an array texture, loads the array and returns true, along with
+// the layer and the size of the page (the array may be larger).
+bool texture_find_array_layer(const char *name, uint flags, Texture **out_tex, uint *out_layer, uint *out_width, uint *out_height) attr_nonnull(1, 3, 4, 5, 6);
+
+// Returns a page of an array texture as an ordinary texture, for code that can't sample arrays.
+Texture* texture_array_layer_as_texture(Texture *tex, uint layer) attr_nonnull(1);
+
 extern ResourceHandler texture_res_handler;
 
 #define TEX_PATH_PREFIX "res/gfx/"
@@ -0,0 +1,191 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include <zlib.h>
+
+#include "texture_baked.h"
+#include "util.h"
+
+#define BAKED_MAGIC "TBPX"
+#define BAKED_FLAG_PREMULTIPLIED 1
+#define BAKED_SOURCE_PREFIX "res/"
+#define BAKED_PATH_PREFIX "res/baked/"
+#define BAKED_EXTENSION ".bpx"
+
+// Anything larger than this is assumed to be garbage.
+#define BAKED_MAX_DIMENSION 32768
+
+static char* texture_baked_path(const char *source) {
+	if(!strstartswith(source, BAKED_SOURCE_PREFIX)) {
+		return NULL;
+	}
+
+	return strjoin(BAKED_PATH_PREFIX, source + strlen(BAKED_SOURCE_PREFIX), BAKED_EXTENSION, NULL);
+}
+
+static bool source_fingerprint(const char *source, uint32_t *out_size, uint32_t *out_crc) {
+	uint64_t size;
+	uint32_t stored_crc;
+
+	// Packaged sources: the zip central directory already has it.
+	if(vfs_query_checksum(source, &size, &stored_crc)) {
+		*out_size = size;
+		*out_crc = stored_crc;
+		return size <= UINT32_MAX;
+	}
+
+	SDL_RWops *rw = vfs_open(source, VFS_MODE_READ);
+
+	if(!rw) {
+		return false;
+	}
+
+	// Loose files (e.g. unpackaged data, or custom images in the storage directory) have to be
+	// read in full. Still much cheaper than decoding the image.
+	uint8_t buf[1 << 14];
+	uLong crc = crc32(0, NULL, 0);
+	size_t n;
+	size = 0;
+
+	while((n = SDL_RWread(rw, buf, 1, sizeof(buf))) > 0) {
+		crc = crc32(crc, buf, n);
+		size += n;
+	}
+
+	SDL_RWclose(rw);
+
+	*out_size = size;
+	*out_crc = crc;
+	return size <= UINT32_MAX;
+}
+
+static bool read_level(SDL_RWops *rw, Pixmap *px) {
+	uint32_t width = SDL_ReadLE32(rw);
+	uint32_t height = SDL_ReadLE32(rw);
+	uint32_t stored_size = SDL_ReadLE32(rw);
+
+	if(!width || !height || width > BAKED_MAX_DIMENSION || height > BAKED_MAX_DIMENSION) {
+		return false;
+	}
+
+	px->width = width;
+	px->height = height;
+	size_t size = pixmap_data_size(px);
+
+	if(stored_size > size) {
+		return false;
+	}
+
+	px->data.untyped = pixmap_alloc_buffer(px->format, width, height);
+
+	if(stored_size == size) {
+		if(SDL_RWread(rw, px->data.untyped, size, 1) == 1) {
+			return true;
+		}
+	} else {
+		void *compressed = malloc(stored_size);
+		uLongf out_size = size;
+
+		bool ok = (
+			SDL_RWread(rw, compressed, stored_size, 1) == 1 &&
+			uncompress(px->data.untyped, &out_size, compressed, stored_size) == Z_OK &&
+			out_size == size
+		);
+
+		free(compressed);
+
+		if(ok) {
+			return true;
+		}
+	}
+
+	free(px->data.untyped);
+	px->data.untyped = NULL;
+	return false;
+}
+
+uint texture_baked_load(const char *source, uint max_levels, Pixmap levels[max_levels]) {
+	char *path = texture_baked_path(source);
+
+	if(!path) {
+		return 0;
+	}
+
+	SDL_RWops *rw = vfs_open(path, VFS_MODE_READ);
+
+	if(!rw) {
+		free(path);
+		return 0;
+	}
+
+	char magic[4];
+	uint num_levels = 0;
+
+	if(
+		SDL_RWread(rw, magic, sizeof(magic), 1) != 1 ||
+		memcmp(magic, BAKED_MAGIC, sizeof(magic)) ||
+		SDL_ReadLE32(rw) != TEXTURE_BAKED_FORMAT
+	) {
+		log_warn("%s: not a baked texture, or made for a different version of the game", path);
+		goto done;
+	}
+
+	uint32_t baked_size = SDL_ReadLE32(rw);
+	uint32_t baked_crc = SDL_ReadLE32(rw);
+	uint32_t source_size, source_crc;
+
+	if(
+		!source_fingerprint(source, &source_size, &source_crc) ||
+		source_size != baked_size ||
+		source_crc != baked_crc
+	) {
+		log_debug("%s: made from a different %s, ignoring", path, source);
+		goto done;
+	}
+
+	PixmapFormat format = SDL_ReadLE16(rw);
+	PixmapOrigin origin = SDL_ReadU8(rw);
+	uint8_t flags = SDL_ReadU8(rw);
+	uint32_t total_levels = SDL_ReadLE32(rw);
+
+	if(
+		(format != PIXMAP_FORMAT_RGB8 && format != PIXMAP_FORMAT_RGBA8) ||
+		(origin != PIXMAP_ORIGIN_TOPLEFT && origin != PIXMAP_ORIGIN_BOTTOMLEFT) ||
+		!(flags & BAKED_FLAG_PREMULTIPLIED) ||
+		total_levels == 0 ||
+		total_levels > max_levels
+	) {
+		log_warn("%s: bad header", path);
+		goto done;
+	}
+
+	for(; num_levels < total_levels; ++num_levels) {
+		Pixmap *px = levels + num_levels;
+		memset(px, 0, sizeof(*px));
+		px->format = format;
+		px->origin = origin;
+
+		if(!read_level(rw, px)) {
+			log_warn("%s: level %u is corrupted", path, num_levels);
+
+			for(uint i = 0; i < num_levels; ++i) {
+				free(levels[i].data.untyped);
+			}
+
+			num_levels = 0;
+			break;
+		}
+	}
+
+done:
+	SDL_RWclose(rw);
+	free(path);
+	return num_levels;
+}
@@ -0,0 +1,60 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_resource_texture_baked_h
+#define IGUARD_resource_texture_baked_h
+
+#include "taisei.h"
+
+#include "util/pixmap.h"
+
+/*
+ * Baked textures.
+ *
+ * scripts/bake-textures.py converts the images in res/gfx into pixmaps that need no decoding or
+ * post-processing: the alpha is already premultiplied, and all mipmaps are included. They are
+ * packaged in a separate archive and live under res/baked, e.g. the baked copy of
+ * res/gfx/foo.webp is res/baked/gfx/foo.webp.bpx.
+ *
+ * This is experimental and not part of the build: the pack size and load times haven't been
+ * compared against the regular packages yet. Run the script by hand and put its output in the
+ * data directory to try it, with TAISEI_BAKED_TEXTURES=1.
+ *
+ * A .bpx file has this layout (all integers little-endian):
+ *
+ *     char[4]  magic ("TBPX")
+ *     u32      format version (TEXTURE_BAKED_FORMAT)
+ *     u32      size of the source image file
+ *     u32      CRC-32 of the source image file
+ *     u16      PixmapFormat (RGB8 or RGBA8)
+ *     u8       PixmapOrigin
+ *     u8       flags (bit 0: premultiplied alpha, always set)
+ *     u32      number of levels
+ *
+ * followed by every level, starting with the full image:
+ *
+ *     u32      width
+ *     u32      height
+ *     u32      stored size; if smaller than width * height * pixel size, the data is compressed
+ *              with zlib
+ *     u8[]     data
+ *
+ * A baked copy is only used if it was made from the exact same source file, so that replacing a
+ * source image (e.g. with a custom one in the storage directory) still works as expected. For
+ * packaged sources, the size and CRC-32 are taken from the zip central directory; only loose
+ * files are read to compute them.
+ */
+
+#define TEXTURE_BAKED_FORMAT 1
+#define TEXTURE_BAKED_MAX_LEVELS 16
+
+// Loads the baked copy of the image at [source] into [levels]: the full image, followed by its
+// mipmaps. Returns the number of levels, or 0 if there's no usable baked copy.
+uint texture_baked_load(const char *source, uint max_levels, Pixmap levels[max_levels]) attr_nonnull(1, 3);
+
+#endif // IGUARD_resource_texture_baked_h
@@ -25,15 +25,37 @@
 #include "stagetext.h"
 #include "stagedraw.h"
 #include "stageobjects.h"
+#include "enemygrid.h"
+#include "stagesnapshot.h"
+#include "profiler.h"
+#include "benchmark.h"
 
 #ifdef DEBUG
 	#define DPSTEST
 	#include "stages/dpstest.h"
 #endif
 
+#include "stages/benchmark_scenes.h"
+
 static size_t numstages = 0;
 StageInfo *stages = NULL;
 
+static TaskManager *logic_taskmgr;
+
+enum {
+	REPLAY_SEEK_STEP = 10 * FPS,
+};
+
+static struct {
+	StageSnapshotList snapshots;
+	int interval;
+	int target;
+	bool fast_forward;
+	bool verify;
+} replay_seek;
+
+static void stage_replay_request_seek(int delta);
+
 static void add_stage(uint16_t id, StageProcs *procs, StageType type, const char *title, const char *subtitle, AttackInfo *spell, Difficulty diff) {
 	++numstages;
 	stages = realloc(stages, numstages * sizeof(StageInfo));
@@ -138,6 +160,19 @@ void stage_init_array(void) {
 #endif
 }
 
+void stage_init_benchmark_array(void) {
+	assert(numstages > 0);
+
+	// replace the terminator
+	--numstages;
+
+	add_stage(STAGE_BENCHMARK_BULLETS, &stage_benchmark_bullets_procs, STAGE_SPECIAL, "Benchmark", "Bullets", NULL, D_Normal);
+	add_stage(STAGE_BENCHMARK_SWARM,   &stage_benchmark_swarm_procs,   STAGE_SPECIAL, "Benchmark", "Swarm",   NULL, D_Normal);
+	add_stage(STAGE_BENCHMARK_LASERS,  &stage_benchmark_lasers_procs,  STAGE_SPECIAL, "Benchmark", "Lasers",  NULL, D_Normal);
+
+	end_stages();
+}
+
 void stage_free_array(void) {
 	for(StageInfo *stg = stages; stg->procs; ++stg) {
 		free(stg->title);
@@ -363,7 +398,22 @@ static bool stage_input_handler_gameplay(SDL_Event *event, void *arg) {
 }
 
 static bool stage_input_handler_replay(SDL_Event *event, void *arg) {
-	stage_input_common(event, arg);
+	if(stage_input_common(event, arg)) {
+		return false;
+	}
+
+	if(TAISEI_EVENT(event->type) == TE_GAME_KEY_DOWN) {
+		switch(event->user.code) {
+			case KEY_REPLAY_REWIND:
+				stage_replay_request_seek(-REPLAY_SEEK_STEP);
+				break;
+
+			case KEY_REPLAY_FORWARD:
+				stage_replay_request_seek(REPLAY_SEEK_STEP);
+				break;
+		}
+	}
+
 	return false;
 }
 
@@ -371,10 +421,12 @@ static void replay_input(void) {
 	ReplayStage *s = global.replay_stage;
 	int i;
 
-	events_poll((EventHandler[]){
-		{ .proc = stage_input_handler_replay },
-		{NULL}
-	}, EFLAG_GAME);
+	if(!replay_seek.fast_forward) {
+		events_poll((EventHandler[]){
+			{ .proc = stage_input_handler_replay },
+			{NULL}
+		}, EFLAG_GAME);
+	}
 
 	for(i = s->playpos; i < s->numevents; ++i) {
 		ReplayEvent *e = s->events + i;
@@ -415,10 +467,31 @@ static void stage_input(void) {
 	player_applymovement(&global.plr);
 }
 
+static void stage_logic_threads_init(void) {
+	int numcores = SDL_GetCPUCount();
+	int numthreads = env_get("TAISEI_LOGIC_THREADS", numcores - 1);
+
+	if(numthreads > 0) {
+		logic_taskmgr = taskmgr_create(numthreads, SDL_THREAD_PRIORITY_HIGH, "logic");
+	}
+}
+
+static void stage_logic_threads_shutdown(void) {
+	if(logic_taskmgr != NULL) {
+		taskmgr_finish(logic_taskmgr);
+		logic_taskmgr = NULL;
+	}
+}
+
+void stage_parallel_for(uint count, uint grain, task_range_func_t func, void *userdata) {
+	taskmgr_parallel_for(logic_taskmgr, count, grain, func, userdata);
+}
+
 static void stage_logic(void) {
 	player_logic(&global.plr);
 
 	process_boss(&global.boss);
+	enemygrid_invalidate();  // boss rules may reposition familiars
 	process_enemies(&global.enemies);
 	process_projectiles(&global.projs, true);
 	process_items();
@@ -583,8 +656,33 @@ typedef struct StageFrameState {
 	StageInfo *stage;
 	int transition_delay;
 	uint16_t last_replay_fps;
+	bool next_stage_prefetched;
 } StageFrameState;
 
+static StageInfo* stage_get_next(StageInfo *stage) {
+	if(global.replaymode == REPLAY_PLAY) {
+		int next = global.replay_stage - global.replay.stages + 1;
+		return next < global.replay.numstages ? stage_get(global.replay.stages[next].stage) : NULL;
+	}
+
+	if(stage->type != STAGE_STORY || global.is_practice_mode) {
+		return NULL;
+	}
+
+	// story stages are played in the order they are listed in
+	StageInfo *next = stage + 1;
+	return next->type == STAGE_STORY ? next : NULL;
+}
+
+static void stage_prefetch_next(StageFrameState *fstate) {
+	fstate->next_stage_prefetched = true;
+	StageInfo *next = stage_get_next(fstate->stage);
+
+	if(next) {
+		resource_prefetch(next->title, next->procs->preload);
+	}
+}
+
 static void stage_update_fps(StageFrameState *fstate) {
 	if(global.replaymode == REPLAY_RECORD) {
 		uint16_t replay_fps = (uint16_t)rint(global.fps.logic.fps);
@@ -596,8 +694,8 @@ static void stage_update_fps(StageFrameState *fstate) {
 	}
 }
 
-static FrameAction stage_logic_frame(void *arg) {
-	StageFrameState *fstate = arg;
+static FrameAction stage_advance_frame(StageFrameState *fstate) {
+	PROFILE_SCOPE("logic frame");
 	StageInfo *stage = fstate->stage;
 
 	stage_update_fps(fstate);
@@ -654,7 +752,178 @@ static FrameAction stage_logic_frame(void *arg) {
 	return LFRAME_WAIT;
 }
 
+static void stage_replay_seek_init(void) {
+	replay_seek.target = -1;
+
+	// Seeking is pointless when nobody is watching, unless the snapshots themselves are being tested.
+	replay_seek.verify = env_get("TAISEI_REPLAY_SNAPSHOT_VERIFY", 0);
+
+	if(global.is_headless && !replay_seek.verify) {
+		replay_seek.interval = 0;
+	} else {
+		replay_seek.interval = imax(0, env_get("TAISEI_REPLAY_SNAPSHOT_INTERVAL", 10 * FPS));
+	}
+
+	replay_seek.snapshots.size_limit = (size_t)imax(0, env_get("TAISEI_REPLAY_SNAPSHOT_MEMORY_LIMIT", 64)) << 20;
+}
+
+static void stage_replay_seek_shutdown(void) {
+	stage_snapshots_free(&replay_seek.snapshots);
+	stage_snapshot_untrack_all();
+	replay_seek.target = -1;
+}
+
+static void stage_replay_request_seek(int delta) {
+	if(replay_seek.interval == 0) {
+		return;
+	}
+
+	// Repeated presses within a frame add up.
+	int base = replay_seek.target >= 0 ? replay_seek.target : global.frames;
+	replay_seek.target = imax(0, base + delta);
+}
+
+static void stage_replay_restore(StageFrameState *fstate, StageSnapshot *snap) {
+	stage_snapshot_restore(snap);
+	fstate->transition_delay = 0;
+
+	// Texts spawned after the snapshot would show up twice.
+	stagetext_free();
+
+	// The background is cached by frame number, which has just gone back.
+	stage_draw_invalidate();
+}
+
+static void stage_replay_take_snapshot(StageFrameState *fstate);
+
+static void stage_replay_fast_forward(StageFrameState *fstate, int target) {
+	// Sound effects are muted while frameskip is set.
+	int frameskip = global.frameskip;
+	global.frameskip = 1;
+	replay_seek.fast_forward = true;
+
+	while(global.frames < target && !global.game_over) {
+		stage_replay_take_snapshot(fstate);
+		stage_advance_frame(fstate);
+	}
+
+	replay_seek.fast_forward = false;
+	global.frameskip = frameskip;
+}
+
+static void stage_replay_verify_snapshot(StageFrameState *fstate, StageSnapshot *snap) {
+	StageSnapshot *prev = stage_snapshots_find(&replay_seek.snapshots, global.frames);
+
+	if(prev == NULL) {
+		return;
+	}
+
+	// Re-simulate from the previous snapshot, then make sure we ended up where we started.
+	int frame = global.frames;
+	uint32_t expected = stage_state_digest();
+
+	stage_replay_restore(fstate, prev);
+	stage_replay_fast_forward(fstate, frame);
+	uint32_t actual = stage_state_digest();
+
+	if(actual != expected) {
+		log_warn("Re-simulation from the snapshot at frame %i diverged at frame %i (%08x != %08x)",
+			stage_snapshot_frame(prev), frame, actual, expected
+		);
+	} else {
+		log_debug("Snapshot at frame %i verified", stage_snapshot_frame(prev));
+	}
+
+	stage_replay_restore(fstate, snap);
+}
+
+static void stage_replay_take_snapshot(StageFrameState *fstate) {
+	if(
+		replay_seek.interval == 0 ||
+		fstate->transition_delay ||
+		global.frames % replay_seek.interval ||
+		global.frames <= stage_snapshots_last_frame(&replay_seek.snapshots)
+	) {
+		return;
+	}
+
+	StageSnapshot *snap = stage_snapshot_create();
+
+	if(snap == NULL) {
+		return;
+	}
+
+	if(replay_seek.verify) {
+		stage_replay_verify_snapshot(fstate, snap);
+	}
+
+	stage_snapshots_add(&replay_seek.snapshots, snap);
+}
+
+static void stage_replay_seek(StageFrameState *fstate) {
+	int target = replay_seek.target;
+	replay_seek.target = -1;
+
+	if(target < global.frames) {
+		StageSnapshot *snap = stage_snapshots_find(&replay_seek.snapshots, target);
+
+		if(snap == NULL) {
+			return;
+		}
+
+		log_debug("Seeking back to frame %i from snapshot at frame %i", target, stage_snapshot_frame(snap));
+		stage_replay_restore(fstate, snap);
+	} else {
+		log_debug("Seeking forward to frame %i", target);
+	}
+
+	Uint64 begin = SDL_GetPerformanceCounter();
+	int start = global.frames;
+	stage_replay_fast_forward(fstate, target);
+	reset_sounds();
+
+	log_debug("Simulated %i frames in %f seconds",
+		global.frames - start,
+		(SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency()
+	);
+}
+
+static FrameAction stage_logic_frame(void *arg) {
+	StageFrameState *fstate = arg;
+
+	if(global.replaymode == REPLAY_PLAY) {
+		if(replay_seek.target >= 0) {
+			stage_replay_seek(fstate);
+
+			if(global.game_over > 0) {
+				return LFRAME_STOP;
+			}
+		}
+
+		stage_replay_take_snapshot(fstate);
+	}
+
+	if(global.is_benchmark) {
+		benchmark_logic_frame_begin();
+	}
+
+	FrameAction action = stage_advance_frame(fstate);
+
+	if(global.is_benchmark) {
+		benchmark_logic_frame_end();
+	}
+
+	if(global.boss && !fstate->next_stage_prefetched) {
+		// Load the next stage in the background while the boss is being fought, so that there's
+		// little left to do when it starts.
+		stage_prefetch_next(fstate);
+	}
+
+	return action;
+}
+
 static FrameAction stage_render_frame(void *arg) {
+	PROFILE_SCOPE("render frame");
 	StageFrameState *fstate = arg;
 	StageInfo *stage = fstate->stage;
 
@@ -691,9 +960,15 @@ void stage_loop(StageInfo *stage) {
 	global.stage = stage;
 
 	ent_init();
+	enemygrid_init();
+	stage_logic_threads_init();
 	stage_objpools_alloc();
+	resource_log_vfs_work("before the stage");
+	resource_batch_begin(stage->title);
 	stage_preload();
 	stage_draw_init();
+	resource_batch_end();
+	resource_log_vfs_work("while preloading the stage");
 
 	uint32_t seed = (uint32_t)time(0);
 	tsrand_switch(&global.rand_game);
@@ -734,6 +1009,8 @@ void stage_loop(StageInfo *stage) {
 		player_init(&global.plr);
 		replay_stage_sync_player_state(stg, &global.plr);
 		stg->playpos = 0;
+
+		stage_replay_seek_init();
 	}
 
 	stage->procs->begin();
@@ -754,6 +1031,8 @@ void stage_loop(StageInfo *stage) {
 		}
 	}
 
+	resource_log_vfs_work("while the stage was running");
+	stage_replay_seek_shutdown();
 	stage->procs->end();
 	stage_draw_shutdown();
 	stage_free();
@@ -761,6 +1040,8 @@ void stage_loop(StageInfo *stage) {
 	tsrand_switch(&global.rand_visual);
 	free_all_refs();
 	ent_shutdown();
+	enemygrid_shutdown();
+	stage_logic_threads_shutdown();
 	stage_objpools_free();
 	stop_sounds();
 
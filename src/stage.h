@@ -16,6 +16,7 @@
 #include "progress.h"
 #include "difficulty.h"
 #include "util/graphics.h"
+#include "taskmanager.h"
 
 /* taisei's strange macro language.
  *
@@ -108,6 +109,7 @@ StageProgress* stage_get_progress(uint16_t id, Difficulty diff, bool allocate);
 StageProgress* stage_get_progress_from_info(StageInfo *stage, Difficulty diff, bool allocate);
 
 void stage_init_array(void);
+void stage_init_benchmark_array(void); // adds the --benchmark scenes to the array
 void stage_free_array(void);
 
 void stage_loop(StageInfo *stage);
@@ -118,6 +120,10 @@ void stage_gameover(void);
 
 void stage_start_bgm(const char *bgm);
 
+// Fork-join helper for the side-effect-free parts of the stage logic.
+// See taskmgr_parallel_for for the rules [func] has to follow.
+void stage_parallel_for(uint count, uint grain, task_range_func_t func, void *userdata);
+
 typedef enum ClearHazardsFlags {
 	CLEAR_HAZARDS_BULLETS = (1 << 0),
 	CLEAR_HAZARDS_LASERS = (1 << 1),
@@ -10,10 +10,16 @@
 
 #include "global.h"
 #include "stagedraw.h"
+#include "stageglow.h"
 #include "stagetext.h"
+#include "ppgraph.h"
 #include "video.h"
 #include "resource/postprocess.h"
 #include "entity.h"
+#include "profiler.h"
+
+// Pooled framebuffers that haven't been used for this long are freed.
+#define FBPOOL_MAX_IDLE_FRAMES 120
 
 #ifdef DEBUG
 	#define GRAPHS_DEFAULT 1
@@ -57,10 +63,24 @@ static struct {
 	PostprocessShader *viewport_pp;
 	FBPair fb_pairs[NUM_FBPAIRS];
 	CustomFramebuffer *custom_fbs;
+	FBPool fb_pool;
+
+	PPGraph bg_graph;
+	PPGraph fg_graph;
+
+	struct {
+		bool draw_bg;
+		bool key_nobg;
+	} scene;
 
 	bool framerate_graphs;
 	bool objpool_stats;
 
+	struct {
+		int last_frame;
+		float per_frame;
+	} res_lookups;
+
 	#ifdef DEBUG
 		Sprite dummy;
 	#endif
@@ -151,10 +171,13 @@ static bool stage_draw_event(SDL_Event *e, void *arg) {
 				update_fb_size(i);
 			}
 
+			ppgraph_invalidate(&stagedraw.bg_graph);
 			break;
 		}
 
 		case TE_CONFIG_UPDATED: {
+			ppgraph_invalidate(&stagedraw.bg_graph);
+
 			switch(e->user.code) {
 				case CONFIG_POSTPROCESS:
 				case CONFIG_BG_QUALITY:
@@ -229,6 +252,8 @@ static void stage_draw_setup_framebuffers(void) {
 	fbpair_viewport(stagedraw.fb_pairs + FBPAIR_BG, 0, 0, bg_width, bg_height);
 	r_framebuffer_set_debug_label(stagedraw.fb_pairs[FBPAIR_BG].front, "Stage BG FB 1");
 	r_framebuffer_set_debug_label(stagedraw.fb_pairs[FBPAIR_BG].back, "Stage BG FB 2");
+
+	fbpool_init(&stagedraw.fb_pool);
 }
 
 static Framebuffer* add_custom_framebuffer(const char *label, StageFBPair fbtype, float scale_worst, float scale_best, uint num_attachments, FBAttachmentConfig attachments[num_attachments]) {
@@ -277,6 +302,8 @@ static void stage_draw_destroy_framebuffers(void) {
 		r_framebuffer_destroy(cfb->fb);
 		free(list_unlink(&stagedraw.custom_fbs, cfb));
 	}
+
+	fbpool_destroy(&stagedraw.fb_pool);
 }
 
 void stage_draw_init(void) {
@@ -323,6 +350,8 @@ void stage_draw_init(void) {
 
 	stagedraw.framerate_graphs = env_get("TAISEI_FRAMERATE_GRAPHS", GRAPHS_DEFAULT);
 	stagedraw.objpool_stats = env_get("TAISEI_OBJPOOL_STATS", OBJPOOLSTATS_DEFAULT);
+	stagedraw.res_lookups.last_frame = 0;
+	stagedraw.res_lookups.per_frame = 0;
 
 	if(stagedraw.framerate_graphs) {
 		preload_resources(RES_SHADER_PROGRAM, RESF_PERMANENT,
@@ -346,11 +375,15 @@ void stage_draw_init(void) {
 
 	#ifdef DEBUG
 	stagedraw.dummy.tex = get_sprite("star")->tex;
+	stagedraw.dummy.tex_layer = get_sprite("star")->tex_layer;
 	stagedraw.dummy.w = 1;
 	stagedraw.dummy.h = 1;
 	#endif
 
 	stage_draw_setup_framebuffers();
+	ppgraph_init(&stagedraw.bg_graph);
+	ppgraph_init(&stagedraw.fg_graph);
+	stage_glow_init();
 
 	events_register_handler(&(EventHandler) {
 		stage_draw_event, NULL, EPRIO_SYSTEM,
@@ -359,14 +392,25 @@ void stage_draw_init(void) {
 
 void stage_draw_shutdown(void) {
 	events_unregister_handler(stage_draw_event);
+	stage_glow_shutdown();
+	ppgraph_destroy(&stagedraw.bg_graph);
+	ppgraph_destroy(&stagedraw.fg_graph);
 	stage_draw_destroy_framebuffers();
 }
 
+void stage_draw_invalidate(void) {
+	ppgraph_invalidate(&stagedraw.bg_graph);
+}
+
 FBPair* stage_get_fbpair(StageFBPair id) {
 	assert(id >= 0 && id < NUM_FBPAIRS);
 	return stagedraw.fb_pairs + id;
 }
 
+FBPool* stage_get_fbpool(void) {
+	return &stagedraw.fb_pool;
+}
+
 static void stage_draw_collision_areas(void) {
 #ifdef DEBUG
 	static bool enabled, keystate_saved;
@@ -429,20 +473,6 @@ static void stage_draw_collision_areas(void) {
 #endif
 }
 
-static void apply_shader_rules(ShaderRule *shaderrules, FBPair *fbos) {
-	if(!shaderrules) {
-		return;
-	}
-
-	for(ShaderRule *rule = shaderrules; *rule; ++rule) {
-		r_framebuffer(fbos->back);
-		(*rule)(fbos->front);
-		fbpair_swap(fbos);
-	}
-
-	return;
-}
-
 static void draw_wall_of_text(float f, const char *txt) {
 	Sprite spr;
 	BBox bbox;
@@ -562,7 +592,7 @@ static void copydepth_rule(Framebuffer *fb) {
 	r_state_pop();
 }
 
-static void finish_3d_scene(FBPair *fbpair) {
+static void finish_3d_scene(PPGraph *g) {
 	// Here we synchronize the depth buffers of both framebuffers in the pair.
 	// The FXAA shader has this built-in, so we don't need to do the copy_depth
 	// pass in that case.
@@ -583,75 +613,83 @@ static void finish_3d_scene(FBPair *fbpair) {
 	// as far as I can tell.
 
 	if(config_get_int(CONFIG_FXAA)) {
-		apply_shader_rules((ShaderRule[]) { fxaa_rule, NULL }, fbpair);
+		ppgraph_add_rule(g, fxaa_rule);
 	} else {
-		apply_shader_rules((ShaderRule[]) { copydepth_rule, NULL }, fbpair);
-		// Swap because we didn't touch the color buffer.
-		fbpair_swap(fbpair);
+		ppgraph_add_depth_pass(g, copydepth_rule);
 	}
 }
 
-static void apply_bg_shaders(ShaderRule *shaderrules, FBPair *fbos) {
-	Boss *b = global.boss;
-	if(b && b->current && b->current->draw_rule) {
-		int t = global.frames - b->current->starttime;
+static void stage_bg_draw(Framebuffer *fb) {
+	r_clear(CLEAR_ALL, RGBA(0, 0, 0, 1), 1);
+	r_mat_push();
+	r_mat_translate(-(VIEWPORT_X+VIEWPORT_W/2), -(VIEWPORT_Y+VIEWPORT_H/2),0);
+	r_enable(RCAP_DEPTH_TEST);
+	global.stage->procs->draw();
+	r_mat_pop();
+
+	// The stage sets up its own projection.
+	set_ortho(VIEWPORT_W, VIEWPORT_H);
+}
 
-		set_ortho(VIEWPORT_W, VIEWPORT_H);
+static void spellbg_overlay(Framebuffer *fb) {
+	draw_spellbg(global.frames - global.boss->current->starttime);
+}
 
-		if(should_draw_stage_bg()) {
-			finish_3d_scene(fbos);
-			apply_shader_rules(shaderrules, fbos);
-		}
+static void spellcard_transition_rule(Framebuffer *fb) {
+	Boss *b = global.boss;
+	int t = global.frames - b->current->starttime;
+	complex pos = b->pos;
+	float ratio = (float)VIEWPORT_H/VIEWPORT_W;
 
-		r_framebuffer(fbos->back);
-		draw_framebuffer_tex(fbos->front, VIEWPORT_W, VIEWPORT_H);
-		draw_spellbg(t);
-		fbpair_swap(fbos);
-		r_framebuffer(fbos->back);
+	if(t<ATTACK_START_DELAY) {
+		r_shader("spellcard_intro");
 
-		complex pos = b->pos;
-		float ratio = (float)VIEWPORT_H/VIEWPORT_W;
+		r_uniform_float("ratio", ratio);
+		r_uniform_vec2("origin", creal(pos)/VIEWPORT_W, 1-cimag(pos)/VIEWPORT_H);
 
-		if(t<ATTACK_START_DELAY) {
-			r_shader("spellcard_intro");
+		float delay = ATTACK_START_DELAY;
+		if(b->current->type == AT_ExtraSpell)
+			delay = ATTACK_START_DELAY_EXTRA;
+		float duration = ATTACK_START_DELAY_EXTRA;
 
-			r_uniform_float("ratio", ratio);
-			r_uniform_vec2("origin", creal(pos)/VIEWPORT_W, 1-cimag(pos)/VIEWPORT_H);
+		r_uniform_float("t", (t+delay)/duration);
+	} else if(b->current->endtime) {
+		int tn = global.frames - b->current->endtime;
+		ShaderProgram *shader = r_shader_get("spellcard_outro");
+		r_shader_ptr(shader);
 
-			float delay = ATTACK_START_DELAY;
-			if(b->current->type == AT_ExtraSpell)
-				delay = ATTACK_START_DELAY_EXTRA;
-			float duration = ATTACK_START_DELAY_EXTRA;
+		float delay = ATTACK_END_DELAY;
 
-			r_uniform_float("t", (t+delay)/duration);
-		} else if(b->current->endtime) {
-			int tn = global.frames - b->current->endtime;
-			ShaderProgram *shader = r_shader_get("spellcard_outro");
-			r_shader_ptr(shader);
+		if(boss_is_dying(b)) {
+			delay = BOSS_DEATH_DELAY;
+		} else if(b->current->type == AT_ExtraSpell) {
+			delay = ATTACK_END_DELAY_EXTRA;
+		}
 
-			float delay = ATTACK_END_DELAY;
+		r_uniform_float("ratio", ratio);
+		r_uniform_vec2("origin", creal(pos)/VIEWPORT_W, 1-cimag(pos)/VIEWPORT_H);
+		r_uniform_float("t", max(0,tn/delay+1));
+	} else {
+		ppgraph_skip_pass();
+		return;
+	}
 
-			if(boss_is_dying(b)) {
-				delay = BOSS_DEATH_DELAY;
-			} else if(b->current->type == AT_ExtraSpell) {
-				delay = ATTACK_END_DELAY_EXTRA;
-			}
+	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
+	r_shader_standard();
+}
 
-			r_uniform_float("ratio", ratio);
-			r_uniform_vec2("origin", creal(pos)/VIEWPORT_W, 1-cimag(pos)/VIEWPORT_H);
-			r_uniform_float("t", max(0,tn/delay+1));
-		} else {
-			r_shader_standard();
-		}
+static void add_bg_passes(PPGraph *g, ShaderRule *shaderrules) {
+	if(should_draw_stage_bg()) {
+		ppgraph_add_source(g, stage_bg_draw);
+		finish_3d_scene(g);
+		ppgraph_add_rules(g, shaderrules);
+	}
 
-		draw_framebuffer_tex(fbos->front, VIEWPORT_W, VIEWPORT_H);
-		fbpair_swap(fbos);
-		r_framebuffer(NULL);
-		r_shader_standard();
-	} else if(should_draw_stage_bg()) {
-		set_ortho(VIEWPORT_W, VIEWPORT_H);
-		finish_3d_scene(fbos);
-		apply_shader_rules(shaderrules, fbos);
+	Boss *b = global.boss;
+
+	if(b && b->current && b->current->draw_rule) {
+		ppgraph_add_overlay(g, spellbg_overlay);
+		ppgraph_add_rule(g, spellcard_transition_rule);
 	}
 }
 
@@ -685,23 +723,22 @@ static void apply_zoom_shader(void) {
 }
 
 static void stage_render_bg(StageInfo *stage) {
-	FBPair *background = stage_get_fbpair(FBPAIR_BG);
+	PROFILE_SCOPE("stage_render_bg");
 
-	r_framebuffer(background->back);
-	r_clear(CLEAR_ALL, RGBA(0, 0, 0, 1), 1);
+	PPGraph *g = &stagedraw.bg_graph;
 
-	if(should_draw_stage_bg()) {
-		r_mat_push();
-		r_mat_translate(-(VIEWPORT_X+VIEWPORT_W/2), -(VIEWPORT_Y+VIEWPORT_H/2),0);
-		r_enable(RCAP_DEPTH_TEST);
-		stage->procs->draw();
-		r_mat_pop();
-		fbpair_swap(background);
+	// Nothing in the background depends on anything but the game state, so if no logic frame has
+	// passed since it was last drawn (e.g. with TAISEI_FRAMELIMITER_LOGIC_ONLY), it can be reused.
+	if(!ppgraph_begin(g, (uint64_t)global.frames)) {
+		return;
 	}
 
-	apply_bg_shaders(stage->procs->shader_rules, background);
+	add_bg_passes(g, stage->procs->shader_rules);
 
-	return;
+	set_ortho(VIEWPORT_W, VIEWPORT_H);
+	ppgraph_run(g, stage_get_fbpair(FBPAIR_BG), VIEWPORT_W, VIEWPORT_H);
+	r_framebuffer(NULL);
+	r_shader_standard();
 }
 
 bool stage_should_draw_particle(Projectile *p) {
@@ -779,36 +816,19 @@ void stage_draw_foreground(void) {
 	r_mat_pop();
 }
 
-void stage_draw_scene(StageInfo *stage) {
-#ifdef DEBUG
-	bool key_nobg = gamekeypressed(KEY_NOBACKGROUND);
-#else
-	bool key_nobg = false;
-#endif
-
-	FBPair *background = stage_get_fbpair(FBPAIR_BG);
-	FBPair *foreground = stage_get_fbpair(FBPAIR_FG);
-
-	bool draw_bg = !config_get_int(CONFIG_NO_STAGEBG) && !key_nobg;
-
-	if(draw_bg) {
-		// render the 3D background
-		stage_render_bg(stage);
-	}
-
+static void stage_draw_viewport_scene(Framebuffer *fb) {
 	// prepare for 2D rendering into the game viewport framebuffer
-	r_framebuffer(foreground->back);
 	set_ortho(VIEWPORT_W, VIEWPORT_H);
 	r_disable(RCAP_DEPTH_TEST);
 
-	if(draw_bg) {
+	if(stagedraw.scene.draw_bg) {
 		// enable boss background distortion
 		if(global.boss) {
 			apply_zoom_shader();
 		}
 
 		// draw the 3D background
-		draw_framebuffer_tex(background->front, VIEWPORT_W, VIEWPORT_H);
+		draw_framebuffer_tex(stage_get_fbpair(FBPAIR_BG)->front, VIEWPORT_W, VIEWPORT_H);
 
 		// disable boss background distortion
 		r_shader_standard();
@@ -819,34 +839,47 @@ void stage_draw_scene(StageInfo *stage) {
 		if(global.plr.mode->procs.bombbg /*&& player_is_bomb_active(&global.plr)*/) {
 			global.plr.mode->procs.bombbg(&global.plr);
 		}
-	} else if(!key_nobg) {
+	} else if(!stagedraw.scene.key_nobg) {
 		r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 1), 1);
 	}
 
 	// draw the 2D objects
 	stage_draw_objects();
+}
+
+void stage_draw_scene(StageInfo *stage) {
+#ifdef DEBUG
+	bool key_nobg = gamekeypressed(KEY_NOBACKGROUND);
+#else
+	bool key_nobg = false;
+#endif
+
+	stagedraw.scene.key_nobg = key_nobg;
+	stagedraw.scene.draw_bg = !config_get_int(CONFIG_NO_STAGEBG) && !key_nobg;
 
-	// everything drawn, now apply postprocessing
-	fbpair_swap(foreground);
+	if(stagedraw.scene.draw_bg) {
+		// render the 3D background
+		stage_render_bg(stage);
+	}
+
+	PPGraph *g = &stagedraw.fg_graph;
+	ppgraph_begin(g, PPGRAPH_ALWAYS);
+
+	// the game viewport, with everything in it
+	ppgraph_add_source(g, stage_draw_viewport_scene);
 
 	// stage postprocessing
-	apply_shader_rules(global.stage->procs->postprocess_rules, foreground);
+	ppgraph_add_rules(g, global.stage->procs->postprocess_rules);
 
 	// bomb effects shader if present and player bombing
 	if(global.plr.mode->procs.bomb_shader && player_is_bomb_active(&global.plr)) {
-		ShaderRule rules[] = { global.plr.mode->procs.bomb_shader, NULL };
-		apply_shader_rules(rules, foreground);
+		ppgraph_add_rule(g, global.plr.mode->procs.bomb_shader);
 	}
 
 	// custom postprocessing
-	postprocess(
-		stagedraw.viewport_pp,
-		foreground,
-		postprocess_prepare,
-		draw_framebuffer_tex,
-		VIEWPORT_W,
-		VIEWPORT_H
-	);
+	ppgraph_add_postprocess(g, stagedraw.viewport_pp, postprocess_prepare);
+
+	ppgraph_run(g, stage_get_fbpair(FBPAIR_FG), VIEWPORT_W, VIEWPORT_H);
 
 	// prepare for 2D rendering into the main framebuffer (actual screen)
 	r_framebuffer(NULL);
@@ -855,6 +888,8 @@ void stage_draw_scene(StageInfo *stage) {
 	// draw the game viewport and HUD
 	stage_draw_foreground();
 	stage_draw_hud();
+
+	fbpool_trim(&stagedraw.fb_pool, FBPOOL_MAX_IDLE_FRAMES);
 }
 
 struct glyphcb_state {
@@ -933,36 +968,72 @@ static void stage_draw_hud_scores(float ypos_hiscore, float ypos_score, char *bu
 	stage_draw_hud_score(ALIGN_RIGHT, 170, ypos_score,   buf, bufsize, global.plr.points);
 }
 
+static float stage_draw_hud_stats_row(const char *label, const char *value, float x, float y, float width, Font *font) {
+	text_draw(label, &(TextParams) {
+		.pos = { x, y },
+		.font_ptr = font,
+		.align = ALIGN_LEFT,
+	});
+
+	text_draw(value, &(TextParams) {
+		.pos = { x + width, y },
+		.font_ptr = font,
+		.align = ALIGN_RIGHT,
+	});
+
+	return y + font_get_lineskip(font);
+}
+
 static void stage_draw_hud_objpool_stats(float x, float y, float width) {
 	ObjectPool **last = &stage_object_pools.first + (sizeof(StageObjectPools)/sizeof(ObjectPool*) - 1);
-	Font *font = get_font("monotiny");
+	Font *font = RES_INTERNED(RES_FONT, "monotiny", RESF_DEFAULT);
 
 	ShaderProgram *sh_prev = r_shader_current();
-	r_shader("text_default");
+	r_shader_ptr(r_shader_interned("text_default"));
 	for(ObjectPool **pool = &stage_object_pools.first; pool <= last; ++pool) {
 		ObjectPoolStats stats;
 		char buf[32];
 		objpool_get_stats(*pool, &stats);
 
 		snprintf(buf, sizeof(buf), "%zu | %5zu", stats.usage, stats.peak_usage);
-		// draw_text(ALIGN_LEFT  | AL_Flag_NoAdjust, (int)x,           (int)y, stats.tag, font);
-		// draw_text(ALIGN_RIGHT | AL_Flag_NoAdjust, (int)(x + width), (int)y, buf,       font);
-		// y += stringheight(buf, font) * 1.1;
+		y = stage_draw_hud_stats_row(stats.tag, buf, x, y, width, font);
+	}
 
-		text_draw(stats.tag, &(TextParams) {
-			.pos = { x, y },
-			.font_ptr = font,
-			.align = ALIGN_LEFT,
-		});
+	// Resource lookups by name, averaged over the logic frames since the last update
+	int frames = global.frames - stagedraw.res_lookups.last_frame;
 
-		text_draw(buf, &(TextParams) {
-			.pos = { x + width, y },
-			.font_ptr = font,
-			.align = ALIGN_RIGHT,
-		});
+	if(frames < 0) {
+		// Replay seeking can turn back time.
+		stagedraw.res_lookups.last_frame = global.frames;
+	} else if(frames > 0) {
+		stagedraw.res_lookups.per_frame = resource_take_lookup_count() / (float)frames;
+		stagedraw.res_lookups.last_frame = global.frames;
+	}
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.1f", stagedraw.res_lookups.per_frame);
+	y = stage_draw_hud_stats_row("Lookups/frame", buf, x, y, width, font);
 
-		y += font_get_lineskip(font);
+	// Driver calls of the previous rendered frame
+	RendererStats rstats;
+	r_frame_stats(&rstats);
+
+	struct {
+		const char *label;
+		uint value;
+	} rows[] = {
+		{ "Draw calls",      rstats.draw_calls },
+		{ "Shader switches", rstats.shader_switches },
+		{ "Uniform uploads", rstats.uniform_uploads },
+		{ "Buffer uploads",  rstats.buffer_uploads },
+		{ "Texture binds",   rstats.texture_binds },
+	};
+
+	for(uint i = 0; i < sizeof(rows)/sizeof(*rows); ++i) {
+		snprintf(buf, sizeof(buf), "%u", rows[i].value);
+		y = stage_draw_hud_stats_row(rows[i].label, buf, x, y, width, font);
 	}
+
 	r_shader_ptr(sh_prev);
 }
 
@@ -1230,6 +1301,8 @@ static void stage_draw_framerate_graphs(void) {
 }
 
 void stage_draw_hud(void) {
+	PROFILE_SCOPE("stage_draw_hud");
+
 	// Background
 	r_mat_push();
 	r_mat_translate(SCREEN_W*0.5, SCREEN_H*0.5, 0);
@@ -28,7 +28,12 @@ void stage_draw_foreground(void);
 void stage_draw_scene(StageInfo *stage);
 bool stage_should_draw_particle(Projectile *p);
 
+// Makes the next stage_draw_scene redraw the background, even if no logic frame has run since the
+// last one. Needed when the game state jumps, e.g. when a replay is rewound.
+void stage_draw_invalidate(void);
+
 FBPair* stage_get_fbpair(StageFBPair id) attr_returns_nonnull;
+FBPool* stage_get_fbpool(void) attr_returns_nonnull;
 Framebuffer* stage_add_foreground_framebuffer(const char *label, float scale_worst, float scale_best, uint num_attachments, FBAttachmentConfig attachments[num_attachments]);
 Framebuffer* stage_add_background_framebuffer(const char *label, float scale_worst, float scale_best, uint num_attachments, FBAttachmentConfig attachments[num_attachments]);
 
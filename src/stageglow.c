@@ -0,0 +1,151 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "stageglow.h"
+#include "stagedraw.h"
+#include "global.h"
+#include "profiler.h"
+
+static const char *const kernel_shaders[NUM_GLOW_KERNELS] = {
+	[GLOW_KERNEL_5]  = "blur5",
+	[GLOW_KERNEL_9]  = "blur9",
+	[GLOW_KERNEL_13] = "blur13",
+	[GLOW_KERNEL_25] = "blur25",
+};
+
+static struct {
+	Framebuffer *source;
+
+	struct {
+		Framebuffer *fb;    // the downsampled image; unused for level 0
+		Framebuffer *blur;  // result of the last blur, taken from the pool
+		bool valid;
+	} levels[GLOW_LEVELS];
+
+	ShaderProgram *shaders[NUM_GLOW_KERNELS];
+} glow;
+
+void stage_glow_init(void) {
+	memset(&glow, 0, sizeof(glow));
+
+	for(uint i = 0; i < NUM_GLOW_KERNELS; ++i) {
+		preload_resource(RES_SHADER_PROGRAM, kernel_shaders[i], RESF_DEFAULT);
+	}
+
+	for(uint i = 0; i < NUM_GLOW_KERNELS; ++i) {
+		glow.shaders[i] = r_shader_get(kernel_shaders[i]);
+	}
+}
+
+static Framebuffer *stage_glow_create_level(uint level) {
+	FBAttachmentConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.attachment = FRAMEBUFFER_ATTACH_COLOR0;
+	cfg.tex_params.type = TEX_TYPE_RGBA;
+	cfg.tex_params.filter.min = TEX_FILTER_LINEAR;
+	cfg.tex_params.filter.mag = TEX_FILTER_LINEAR;
+	cfg.tex_params.wrap.s = TEX_WRAP_MIRROR;
+	cfg.tex_params.wrap.t = TEX_WRAP_MIRROR;
+
+	char label[64];
+	float scale = 1.0f / (1 << level);
+	snprintf(label, sizeof(label), "Glow level %u FB", level);
+	return stage_add_foreground_framebuffer(label, scale * 0.5f, scale, 1, &cfg);
+}
+
+void stage_glow_shutdown(void) {
+	// The framebuffers are owned by stagedraw.
+	for(uint i = 0; i < GLOW_LEVELS; ++i) {
+		if(glow.levels[i].blur) {
+			fbpool_release(stage_get_fbpool(), glow.levels[i].blur);
+		}
+	}
+
+	memset(&glow, 0, sizeof(glow));
+}
+
+void stage_glow_set_source(Framebuffer *fb) {
+	glow.source = fb;
+
+	for(uint i = 0; i < GLOW_LEVELS; ++i) {
+		glow.levels[i].valid = false;
+	}
+
+	glow.levels[0].valid = true;
+}
+
+Framebuffer *stage_glow_level(uint level) {
+	assert(glow.source != NULL);
+	assert(level < GLOW_LEVELS);
+
+	if(level == 0) {
+		return glow.source;
+	}
+
+	if(!glow.levels[level].fb) {
+		// Only allocated once something actually blurs at this level.
+		glow.levels[level].fb = stage_glow_create_level(level);
+	}
+
+	if(!glow.levels[level].valid) {
+		Framebuffer *src = stage_glow_level(level - 1);
+
+		PROFILE_SCOPE("stage_glow_downsample");
+
+		// Halving the size each time, a single bilinear fetch averages 2x2 texels.
+		r_state_push();
+		r_framebuffer(glow.levels[level].fb);
+		r_blend(BLEND_NONE);
+		r_color4(1, 1, 1, 1);
+		r_shader_standard();
+		draw_framebuffer_tex(src, VIEWPORT_W, VIEWPORT_H);
+		r_state_pop();
+
+		glow.levels[level].valid = true;
+	}
+
+	return glow.levels[level].fb;
+}
+
+Framebuffer *stage_glow_blur(uint level, GlowKernel kernel, float spread) {
+	assert(kernel >= 0 && kernel < NUM_GLOW_KERNELS);
+
+	Framebuffer *src = stage_glow_level(level);
+	FBPool *pool = stage_get_fbpool();
+
+	PROFILE_SCOPE("stage_glow_blur");
+
+	if(glow.levels[level].blur) {
+		fbpool_release(pool, glow.levels[level].blur);
+	}
+
+	Framebuffer *tmp = fbpool_acquire_like(pool, src);
+	Framebuffer *result = fbpool_acquire_like(pool, src);
+
+	r_state_push();
+	r_blend(BLEND_NONE);
+	r_shader_ptr(glow.shaders[kernel]);
+	r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
+
+	r_framebuffer(tmp);
+	r_uniform_vec2("blur_direction", spread, 0);
+	draw_framebuffer_tex(src, VIEWPORT_W, VIEWPORT_H);
+
+	r_framebuffer(result);
+	r_uniform_vec2("blur_direction", 0, spread);
+	draw_framebuffer_tex(tmp, VIEWPORT_W, VIEWPORT_H);
+
+	r_state_pop();
+
+	fbpool_release(pool, tmp);
+	glow.levels[level].blur = result;
+
+	return result;
+}
@@ -0,0 +1,54 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_stageglow_h
+#define IGUARD_stageglow_h
+
+#include "taisei.h"
+
+#include "renderer/api.h"
+
+/*
+ * Shared blur/glow passes for the stage foreground.
+ *
+ * A source framebuffer is downsampled into a chain of progressively smaller framebuffers (each
+ * level halves the resolution of the previous one; level 0 is the source itself). A level is only
+ * built the first time it's needed after the source was set, so any number of blurs of the same
+ * source share the downsampling work. Wide blurs are best done on a downsampled level: the
+ * kernel then covers the same area with a fraction of the fill rate.
+ *
+ * All levels scale with the foreground framebuffers, and are half as large when
+ * CONFIG_POSTPROCESS is below 2. They are only allocated when first used. The blur passes render
+ * into framebuffers taken from the stage framebuffer pool.
+ */
+
+#define GLOW_LEVELS 3
+
+typedef enum GlowKernel {
+	GLOW_KERNEL_5,
+	GLOW_KERNEL_9,
+	GLOW_KERNEL_13,
+	GLOW_KERNEL_25,
+	NUM_GLOW_KERNELS,
+} GlowKernel;
+
+void stage_glow_init(void);
+void stage_glow_shutdown(void);
+
+// Makes [fb] level 0 of the chain, and discards all other levels.
+void stage_glow_set_source(Framebuffer *fb) attr_nonnull(1);
+
+// Returns the given level of the chain, building it if necessary.
+Framebuffer *stage_glow_level(uint level) attr_returns_nonnull;
+
+// Blurs a level of the chain with a separable gaussian kernel, and returns the framebuffer with
+// the result, which stays valid until the next blur of the same level. [spread] scales the
+// distance between taps, in viewport pixels.
+Framebuffer *stage_glow_blur(uint level, GlowKernel kernel, float spread) attr_returns_nonnull;
+
+#endif // IGUARD_stageglow_h
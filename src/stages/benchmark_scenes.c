@@ -0,0 +1,137 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "benchmark_scenes.h"
+#include "global.h"
+#include "enemy.h"
+#include "laser.h"
+
+#define BENCHMARK_ENEMY_HP 1500
+
+static void benchmark_stub_proc(void) { }
+
+static void benchmark_begin(void) {
+	// The scenes are about load, not about survival.
+	global.plr.iddqd = true;
+}
+
+/*
+ * Bullets: a few thousand plain projectiles on screen at all times, in rotating rings of
+ * mixed shapes and speeds, plus the player's own shots.
+ */
+
+static void stage_benchmark_bullets_events(void) {
+	TIMER(&global.timer);
+
+	static const char *const sprites[] = { "ball", "rice", "bigball", "card", "crystal", "plainball", "wave" };
+	const int num_sprites = sizeof(sprites) / sizeof(*sprites);
+	const int ring = 24;
+
+	FROM_TO(30, INT_MAX, 2) {
+		for(int i = 0; i < ring; ++i) {
+			complex dir = cexp(I*(2*M_PI/ring*i + 0.05*_i));
+			complex origin = VIEWPORT_W/2 + VIEWPORT_H/3*I + 60*cexp(I*0.02*_i);
+
+			PROJECTILE(sprites[(i + _i / 30) % num_sprites], origin + 10*dir, RGB(0.2 + 0.1*(i%4), 0.3, 0.8),
+				(i & 1) ? linear : asymptotic,
+				{ (1.2 + 0.4*(i%3))*dir, 3 }
+			);
+		}
+	}
+}
+
+/*
+ * Swarm: waves of fairies that fire aimed spreads, get shot down by the player and drop items,
+ * which then get collected.
+ */
+
+static int benchmark_fairy(Enemy *e, int t) {
+	TIMER(&t);
+
+	AT(EVENT_KILLED) {
+		spawn_items(e->pos, Point, 3, Power, 1, NULL);
+		return ACTION_ACK;
+	}
+
+	AT(EVENT_BIRTH) {
+		return ACTION_ACK;
+	}
+
+	if(t < 60) {
+		e->pos += e->args[0];
+	} else if(t > 300) {
+		e->pos -= e->args[0];
+	}
+
+	FROM_TO(40, 300, 20) {
+		complex aim = cexp(I*carg(global.plr.pos - e->pos));
+
+		for(int i = -3; i <= 3; ++i) {
+			PROJECTILE("rice", e->pos, RGB(0.8, 0.2, 0.3), asymptotic, {
+				2.5*aim*cexp(0.15*I*i),
+				4
+			});
+		}
+	}
+
+	return ACTION_NONE;
+}
+
+static void stage_benchmark_swarm_events(void) {
+	TIMER(&global.timer);
+
+	FROM_TO(30, INT_MAX, 15) {
+		double x = VIEWPORT_W * (0.1 + 0.8 * frand());
+		create_enemy1c(x - 32*I, BENCHMARK_ENEMY_HP, (_i % 4) ? Fairy : BigFairy, benchmark_fairy, 2.0*I);
+	}
+}
+
+/*
+ * Lasers: curved lasers from a few emitters, mostly sine waves, which are the most expensive
+ * ones to collide with, and a bullet ring now and then.
+ */
+
+static void stage_benchmark_lasers_events(void) {
+	TIMER(&global.timer);
+
+	FROM_TO(30, INT_MAX, 10) {
+		for(int i = 0; i < 4; ++i) {
+			complex origin = VIEWPORT_W * (0.2 + 0.2*i) + 40*I;
+			complex vel = 3*cexp(I*(M_PI/2 + 0.6*sin(0.1*_i + i)));
+
+			if((_i + i) % 3) {
+				create_laser(origin, 80, 200, RGBA(0.3, 0.6, 1.0, 0.0), las_sine, 0, vel, 8, 0.1, i);
+			} else {
+				create_lasercurve2c(origin, 60, 200, RGBA(1.0, 0.4, 0.6, 0.0), las_accel, vel, 0.02*vel);
+			}
+		}
+	}
+
+	FROM_TO(30, INT_MAX, 60) {
+		for(int i = 0; i < 32; ++i) {
+			PROJECTILE("bigball", VIEWPORT_W/2 + 100*I, RGB(0.5, 0.2, 0.9), linear, { 2*cexp(I*(2*M_PI/32*i)) });
+		}
+	}
+}
+
+#define BENCHMARK_PROCS(scene) \
+	StageProcs stage_benchmark_##scene##_procs = { \
+		.begin = benchmark_begin, \
+		.preload = benchmark_stub_proc, \
+		.end = benchmark_stub_proc, \
+		.draw = benchmark_stub_proc, \
+		.update = benchmark_stub_proc, \
+		.event = stage_benchmark_##scene##_events, \
+		.shader_rules = (ShaderRule[]) { NULL }, \
+	};
+
+BENCHMARK_PROCS(bullets)
+BENCHMARK_PROCS(swarm)
+BENCHMARK_PROCS(lasers)
@@ -0,0 +1,29 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_stages_benchmark_scenes_h
+#define IGUARD_stages_benchmark_scenes_h
+
+#include "taisei.h"
+
+#include "stage.h"
+
+// Synthetic scenes for the --benchmark mode. They never end by themselves, and make the player
+// invulnerable; the benchmark stops them after a fixed number of frames.
+
+enum {
+	STAGE_BENCHMARK_BULLETS = 0x50|0,
+	STAGE_BENCHMARK_SWARM = 0x50|1,
+	STAGE_BENCHMARK_LASERS = 0x50|2,
+};
+
+extern StageProcs stage_benchmark_bullets_procs;
+extern StageProcs stage_benchmark_swarm_procs;
+extern StageProcs stage_benchmark_lasers_procs;
+
+#endif // IGUARD_stages_benchmark_scenes_h
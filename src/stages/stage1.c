@@ -14,6 +14,7 @@
 #include "global.h"
 #include "stage.h"
 #include "stageutils.h"
+#include "ppgraph.h"
 #include "stagedraw.h"
 #include "resource/model.h"
 
@@ -239,16 +240,17 @@ static vec3 **stage1_smoke_pos(vec3 p, float maxrange) {
 	return linear3dpos(p, maxrange/2.0, q, r);
 }
 
-static void stage1_fog(Framebuffer *fb) {
-	r_shader("zbuf_fog");
+static void stage1_fog_setup(Framebuffer *fb) {
 	r_uniform_sampler("depth", r_framebuffer_get_attachment(fb, FRAMEBUFFER_ATTACH_DEPTH));
 	r_uniform_vec4("fog_color", 0.8, 0.8, 0.8, 1.0);
 	r_uniform_float("start", 0.0);
 	r_uniform_float("end", 0.8);
 	r_uniform_float("exponent", 3.0);
 	r_uniform_float("sphereness", 0.2);
-	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
-	r_shader_standard();
+}
+
+static void stage1_fog(Framebuffer *fb) {
+	ppgraph_filter(fb, "zbuf_fog", stage1_fog_setup);
 }
 
 static void stage1_draw(void) {
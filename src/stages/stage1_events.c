@@ -50,7 +50,7 @@ static int cirno_snowflake_proj(Projectile *p, int time) {
 			spawn_projectile_highlight_effect(p);
 
 			PARTICLE(
-				.sprite = "stain",
+				.sprite_ptr = get_sprite_interned("part/stain"),
 				.pos = p->pos,
 				.color = RGBA_MUL_ALPHA(0.45, 0.45, 0.5, 0.0),
 				.timeout = 10 + 2 * creal(p->args[1]),
@@ -133,7 +133,7 @@ static void cirno_icy(Boss *b, int time) {
 
 static Projectile* spawn_stain(complex pos, float angle, int to) {
 	return PARTICLE(
-		.sprite = "stain",
+		.sprite_ptr = get_sprite_interned("part/stain"),
 		.pos = pos,
 		.draw_rule = ScaleFade,
 		.timeout = to,
@@ -739,7 +739,7 @@ void cirno_crystal_blizzard(Boss *c, int time) {
 		int i, cnt = 14 + global.diff * 3;
 		for(i = 0; i < cnt; ++i) {
 			PROJECTILE(
-				.sprite = "crystal",
+				.proto = pp_crystal,
 				.pos = i*VIEWPORT_W/cnt,
 				.color = i % 2? RGB(0.2,0.2,0.4) : RGB(0.5,0.5,0.5),
 				.rule = accelerated,
@@ -760,7 +760,7 @@ void cirno_crystal_blizzard(Boss *c, int time) {
 		if(!(time % (1 + D_Lunatic - global.diff))) {
 			tsrand_fill(2);
 			PROJECTILE(
-				.sprite = "wave",
+				.proto = pp_wave,
 				.pos = c->pos,
 				.color = RGBA(0.2, 0.2, 0.4, 0.0),
 				.rule = cirno_crystal_blizzard_proj,
@@ -776,7 +776,7 @@ void cirno_crystal_blizzard(Boss *c, int time) {
 			int i, cnt = global.diff - 1;
 			for(i = 0; i < cnt; ++i) {
 				PROJECTILE(
-					.sprite = "ball",
+					.proto = pp_ball,
 					.pos = c->pos,
 					.color = RGBA(0.1, 0.1, 0.5, 0.0),
 					.rule = accelerated,
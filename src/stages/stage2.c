@@ -14,6 +14,7 @@
 #include "global.h"
 #include "stage.h"
 #include "stageutils.h"
+#include "ppgraph.h"
 
 /*
  *  See the definition of AttackInfo in boss.h for information on how to set up the idmaps.
@@ -149,16 +150,17 @@ static vec3 **stage2_bg_grass_pos2(vec3 pos, float maxrange) {
 	return linear3dpos(pos, maxrange, p, r);
 }
 
-static void stage2_fog(Framebuffer *fb) {
-	r_shader("zbuf_fog");
+static void stage2_fog_setup(Framebuffer *fb) {
 	r_uniform_sampler("depth", r_framebuffer_get_attachment(fb, FRAMEBUFFER_ATTACH_DEPTH));
 	r_uniform_vec4("fog_color", 0.05, 0.0, 0.03, 1.0);
 	r_uniform_float("start", 0.2);
 	r_uniform_float("end", 0.8);
 	r_uniform_float("exponent", 3.0);
 	r_uniform_float("sphereness", 0);
-	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
-	r_shader_standard();
+}
+
+static void stage2_fog(Framebuffer *fb) {
+	ppgraph_filter(fb, "zbuf_fog", stage2_fog_setup);
 }
 
 static void stage2_bloom(Framebuffer *fb) {
@@ -559,7 +559,7 @@ static void hina_monty_slave_visual(Enemy *s, int time, bool render) {
 		return;
 	}
 
-	Sprite *soul = get_sprite("proj/soul");
+	Sprite *soul = get_sprite_interned("proj/soul");
 	double scale = fabs(swing(clamp(time / 60.0, 0, 1), 3)) * 1.25;
 
 	Color *clr1 = RGBA(1.0, 0.0, 0.0, 0.0);
@@ -568,7 +568,7 @@ static void hina_monty_slave_visual(Enemy *s, int time, bool render) {
 
 	r_mat_push();
 	r_mat_translate(creal(s->pos), cimag(s->pos), 0);
-	r_shader("sprite_bullet");
+	r_shader_ptr(r_shader_interned("sprite_bullet"));
 
 	r_draw_sprite(&(SpriteParams) {
 		.sprite_ptr = soul,
@@ -594,7 +594,7 @@ static void hina_monty_slave_visual(Enemy *s, int time, bool render) {
 	});
 
 	r_mat_pop();
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 }
 
 void hina_monty(Boss *h, int time) {
@@ -728,11 +728,11 @@ void hina_spell_bg(Boss *h, int time) {
 	r_mat_translate(VIEWPORT_W/2, VIEWPORT_H/2,0);
 	r_mat_push();
 	r_mat_scale(0.6,0.6,1);
-	draw_sprite(0, 0, "stage2/spellbg1");
+	draw_sprite_p(0, 0, get_sprite_interned("stage2/spellbg1"));
 	r_mat_pop();
 	r_blend(BLEND_MOD);
 	r_mat_rotate_deg(time*5, 0,0,1);
-	draw_sprite(0, 0, "stage2/spellbg2");
+	draw_sprite_p(0, 0, get_sprite_interned("stage2/spellbg2"));
 	r_mat_pop();
 	r_blend(BLEND_PREMUL_ALPHA);
 	r_color4(1, 1, 1, 0);
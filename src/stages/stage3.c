@@ -14,6 +14,8 @@
 #include "global.h"
 #include "stage.h"
 #include "stageutils.h"
+#include "stagesnapshot.h"
+#include "ppgraph.h"
 
 /*
  *  See the definition of AttackInfo in boss.h for information on how to set up the idmaps.
@@ -98,24 +100,26 @@ static void stage3_bg_tunnel_draw(vec3 pos) {
 	r_mat_pop();
 }
 
-static void stage3_tunnel(Framebuffer *fb) {
-	r_shader("tunnel");
+static void stage3_tunnel_setup(Framebuffer *fb) {
 	r_uniform_vec3("color", stgstate.clr_r, stgstate.clr_g, stgstate.clr_b);
 	r_uniform_float("mixfactor", stgstate.clr_mixfactor);
-	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
-	r_shader_standard();
 }
 
-static void stage3_fog(Framebuffer *fb) {
-	r_shader("zbuf_fog");
+static void stage3_tunnel(Framebuffer *fb) {
+	ppgraph_filter(fb, "tunnel", stage3_tunnel_setup);
+}
+
+static void stage3_fog_setup(Framebuffer *fb) {
 	r_uniform_sampler("depth", r_framebuffer_get_attachment(fb, FRAMEBUFFER_ATTACH_DEPTH));
 	r_uniform_vec4("fog_color", stgstate.fog_brightness, stgstate.fog_brightness, stgstate.fog_brightness, 1.0);
 	r_uniform_float("start", 0.2);
 	r_uniform_float("end", 0.8);
 	r_uniform_float("exponent", stgstate.fog_exp/2);
 	r_uniform_float("sphereness", 0);
-	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
-	r_shader_standard();
+}
+
+static void stage3_fog(Framebuffer *fb) {
+	ppgraph_filter(fb, "zbuf_fog", stage3_fog_setup);
 }
 
 static void stage3_glitch(Framebuffer *fb) {
@@ -127,15 +131,14 @@ static void stage3_glitch(Framebuffer *fb) {
 		strength = 0.0;
 	}
 
-	if(strength > 0) {
-		r_shader("glitch");
-		r_uniform_float("strength", strength);
-		r_uniform_int("frames", global.frames + tsrand() % 30);
-	} else {
-		r_shader_standard();
-		r_color4(1, 1, 1, 1);
+	if(strength <= 0) {
+		ppgraph_skip_pass();
+		return;
 	}
 
+	r_shader("glitch");
+	r_uniform_float("strength", strength);
+	r_uniform_int("frames", global.frames + tsrand() % 30);
 	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
 	r_shader_standard();
 }
@@ -155,6 +158,7 @@ static void stage3_start(void) {
 	stgstate.clr_b = 0.5;
 	stgstate.clr_mixfactor = 1.0;
 	stgstate.fog_brightness = 0.5;
+	stage_snapshot_track(&stgstate, sizeof(stgstate));
 }
 
 static void stage3_preload(void) {
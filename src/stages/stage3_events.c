@@ -158,7 +158,7 @@ static void charge_effect(Enemy *e, int t, int chargetime) {
 		float s = 4+_i*0.01;
 
 		PARTICLE(
-			.sprite = "flare",
+			.sprite_ptr = get_sprite_interned("part/flare"),
 			.pos = e->pos+l*n,
 			.color = RGBA(0.5, 0.5, 0.25, 0),
 			.draw_rule = Fade,
@@ -502,7 +502,7 @@ static int scuttle_lethbite_proj(Projectile *p, int time) {
 			tsrand_fill(2);
 
 			PARTICLE(
-				.sprite = "smoothdot",
+				.sprite_ptr = get_sprite_interned("part/smoothdot"),
 				.color = RGBA(0.8, 0.6, 0.6, 0),
 				.draw_rule = Shrink,
 				.rule = enemy_flare,
@@ -545,7 +545,7 @@ static void scuttle_lethbite(Boss *boss, int time) {
 		for(i = 0; i < cnt; ++i) {
 			complex v = (2 - psin((max(3, global.diff+1)*2*M_PI*i/(float)cnt) + time)) * cexp(I*2*M_PI/cnt*i);
 			PROJECTILE(
-				.sprite = "wave",
+				.proto = pp_wave,
 				.pos = boss->pos - v * 50,
 				.color = _i % 2? RGB(0.7, 0.3, 0.0) : RGB(0.3, .7, 0.0),
 				.rule = scuttle_lethbite_proj,
@@ -584,7 +584,7 @@ void scuttle_deadly_dance(Boss *boss, int time) {
 			for(i = 0; i < 15; ++i) {
 				double a = M_PI/(5 + global.diff) * i * 2;
 				PROJECTILE(
-					.sprite = "wave",
+					.proto = pp_wave,
 					.pos = boss->pos,
 					.color = RGB(0.3, 0.3 + 0.7 * psin(a*3 + time/50.0), 0.3),
 					.rule = scuttle_poison,
@@ -617,7 +617,7 @@ void scuttle_deadly_dance(Boss *boss, int time) {
 		for(i = -1; i < 2; i += 2) {
 			double c = psin(time/10.0);
 			PROJECTILE(
-				.sprite = "crystal",
+				.proto = pp_crystal,
 				.pos = boss->pos,
 				.color = RGBA_MUL_ALPHA(0.3 + c * 0.7, 0.6 - c * 0.3, 0.3, 0.7),
 				.rule = linear,
@@ -637,11 +637,11 @@ void scuttle_spellbg(Boss *h, int time) {
 	float s = 0.3 + 0.7 * a;
 
 	r_color4(0.1*a, 0.1*a, 0.1*a, a);
-	draw_sprite(VIEWPORT_W/2, VIEWPORT_H/2, "stage3/spellbg2");
+	draw_sprite_p(VIEWPORT_W/2, VIEWPORT_H/2, get_sprite_interned("stage3/spellbg2"));
 	fill_viewport(-time/200.0 + 0.5, time/400.0+0.5, s, "stage3/spellbg1");
 	r_color4(0.1, 0.1, 0.1, 0);
 	fill_viewport(time/300.0 + 0.5, -time/340.0+0.5, s*0.5, "stage3/spellbg1");
-	r_shader("maristar_bombbg");
+	r_shader_ptr(r_shader_interned("maristar_bombbg"));
 	r_uniform_float("t", time/400.);
 	r_uniform_float("decay", 0.);
 	r_uniform_vec2("plrpos", 0.5,0.5);
@@ -701,7 +701,7 @@ static void wriggle_slave_visual(Enemy *e, int time, bool render) {
 
 	if(render) {
 		r_draw_sprite(&(SpriteParams) {
-			.sprite = "fairy_circle",
+			.sprite_ptr = get_sprite_interned("fairy_circle"),
 			.rotation.angle = DEG2RAD * 7 * time,
 			.scale.both = 0.7,
 			.color = RGBA(0.8, 1.0, 0.4, 0),
@@ -710,7 +710,7 @@ static void wriggle_slave_visual(Enemy *e, int time, bool render) {
 	} else if(time % 5 == 0) {
 		tsrand_fill(2);
 		PARTICLE(
-			.sprite = "smoothdot",
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.pos = 5*cexp(2*I*M_PI*afrand(0)),
 			.color = RGBA(0.6, 0.6, 0.5, 0),
 			.draw_rule = Shrink,
@@ -764,7 +764,7 @@ static int wriggle_rocket_laserbullet(Projectile *p, int time) {
 				float f = (float)i/cnt;
 
 				PROJECTILE(
-					.sprite = "thickrice",
+					.proto = pp_thickrice,
 					.pos = p->pos,
 					.color = c,
 					.rule = asymptotic,
@@ -776,7 +776,7 @@ static int wriggle_rocket_laserbullet(Projectile *p, int time) {
 			}
 
 			PARTICLE(
-				.sprite = "blast",
+				.proto = pp_blast,
 				.pos = p->pos,
 				.color = c,
 				.timeout = 35 - 5 * frand(),
@@ -840,7 +840,7 @@ static int wriggle_spell_slave(Enemy *e, int time) {
 		PROJECTILE(
 			// FIXME: add prototype, or shove it into the basic ones somehow,
 			// or just replace this with some thing else
-			.sprite_ptr = get_sprite("part/smoothdot"),
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.size = 16 + 16*I,
 			.collision_size = 7.2 + 7.2*I,
 
@@ -848,7 +848,7 @@ static int wriggle_spell_slave(Enemy *e, int time) {
 			.color = RGBA(1.0 - c, 0.5, 0.5 + c, 0),
 			.draw_rule = wriggle_slave_part_draw,
 			.timeout = 60,
-			.shader = "sprite_default",
+			.shader_ptr = r_shader_interned("sprite_default"),
 			.flags = PFLAG_NOCLEAR | PFLAG_NOCLEAREFFECT | PFLAG_NOCOLLISIONEFFECT | PFLAG_NOSPAWNEFFECTS,
 		);
 	}
@@ -1136,7 +1136,7 @@ static void wriggle_fstorm_proj_draw(Projectile *p, int time) {
 		Sprite *s = p->sprite;
 		Color c = p->color;
 		c.a = 0;
-		p->sprite = get_sprite("proj/ball");
+		p->sprite = get_sprite_interned("proj/ball");
 		r_mat_scale(f,f,f);
 		ProjDrawCore(p, &c);
 		r_mat_scale(1/f,1/f,1/f);
@@ -1179,7 +1179,7 @@ static int wriggle_fstorm_proj(Projectile *p, int time) {
 		for(int i = 0; i < 3; ++i) {
 			tsrand_fill(2);
 			PARTICLE(
-				.sprite = "flare",
+				.sprite_ptr = get_sprite_interned("part/flare"),
 				.pos = p->pos,
 				.rule = linear,
 				.timeout = 60,
@@ -14,6 +14,7 @@
 #include "global.h"
 #include "stage.h"
 #include "stageutils.h"
+#include "ppgraph.h"
 #include "util/glm.h"
 #include "resource/model.h"
 
@@ -63,7 +64,7 @@ struct stage4_spells_s stage4_spells = {
 	},
 };
 
-static void stage4_fog(Framebuffer *fb) {
+static void stage4_fog_setup(Framebuffer *fb) {
 	float f = 0;
 	int redtime = 5100 + STAGE4_MIDBOSS_MUSIC_TIME;
 
@@ -72,15 +73,16 @@ static void stage4_fog(Framebuffer *fb) {
 		f =  v < 0.1 ? v : 0.1;
 	}
 
-	r_shader("zbuf_fog");
 	r_uniform_sampler("depth", r_framebuffer_get_attachment(fb, FRAMEBUFFER_ATTACH_DEPTH));
 	r_uniform_vec4("fog_color", 10.0*f, 0.0, 0.1-f, 1.0);
 	r_uniform_float("start", 0.4);
 	r_uniform_float("end", 0.8);
 	r_uniform_float("exponent", 4.0);
 	r_uniform_float("sphereness", 0);
-	draw_framebuffer_tex(fb, VIEWPORT_W, VIEWPORT_H);
-	r_shader_standard();
+}
+
+static void stage4_fog(Framebuffer *fb) {
+	ppgraph_filter(fb, "zbuf_fog", stage4_fog_setup);
 }
 
 static vec3 **stage4_fountain_pos(vec3 pos, float maxrange) {
@@ -205,7 +205,7 @@ static int stage4_bigcircle(Enemy *e, int t) {
 		int n = 10+3*global.diff;
 		for(i = 0; i < n; i++) {
 			PROJECTILE(
-				.sprite = "bigball",
+				.proto = pp_bigball,
 				.pos = e->pos,
 				.color = RGBA(0, 0.8 - 0.4 * _i, 0, 0),
 				.rule = asymptotic,
@@ -217,7 +217,7 @@ static int stage4_bigcircle(Enemy *e, int t) {
 
 			if(global.diff > D_Easy) {
 				PROJECTILE(
-					.sprite = "ball",
+					.proto = pp_ball,
 					.pos = e->pos,
 					.color = RGBA(0, 0.3 * _i, 0.4, 0),
 					.rule = asymptotic,
@@ -246,7 +246,7 @@ static int stage4_explosive(Enemy *e, int t) {
 		for(i = 0; i < n; i++) {
 			double angle = 2*M_PI*i/n+carg(phase);
 			PROJECTILE(
-				.sprite = "ball",
+				.proto = pp_ball,
 				.pos = e->pos,
 				.color = RGB(0.1+0.6*(i&1), 0.2, 1-0.6*(i&1)),
 				.rule = accelerated,
@@ -275,7 +275,7 @@ static void KurumiSlave(Enemy *e, int t, bool render) {
 		complex offset = (frand()-0.5)*30;
 		offset += (frand()-0.5)*20.0*I;
 		PARTICLE(
-			.sprite = "smoothdot",
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.pos = offset,
 			.color = RGBA(0.3, 0.0, 0.0, 0.0),
 			.draw_rule = Shrink,
@@ -387,7 +387,7 @@ void kurumi_redspike(Boss *b, int time) {
 			int n = global.diff*8;
 			for(i = 0; i < n; i++) {
 				PROJECTILE(
-					.sprite = "bigball",
+					.proto = pp_bigball,
 					.pos = b->pos,
 					.color = RGBA(1.0, 0.0, 0.0, 0.0),
 					.rule = asymptotic,
@@ -428,7 +428,7 @@ void kurumi_spell_bg(Boss *b, int time) {
 	r_mat_translate(VIEWPORT_W/2, VIEWPORT_H/2,0);
 	r_mat_scale(0.6, 0.6, 1);
 	r_color3(f, 1 - f, 1 - f);
-	draw_sprite(0, 0, "stage4/kurumibg1");
+	draw_sprite_p(0, 0, get_sprite_interned("stage4/kurumibg1"));
 	r_mat_pop();
 	r_color4(1, 1, 1, 0);
 	fill_viewport(time/300.0, time/300.0, 0.5, "stage4/kurumibg2");
@@ -667,7 +667,7 @@ static void KurumiAniWallSlave(Enemy *e, int t, bool render) {
 
 	if(e->args[1]) {
 		PARTICLE(
-			.sprite = "smoothdot",
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.pos = e->pos,
 			.color = RGBA(1, 1, 1, 0),
 			.draw_rule = Fade,
@@ -831,7 +831,7 @@ void kurumi_blowwall(Boss *b, int time) {
 
 static Projectile* vapor_particle(complex pos, const Color *clr) {
 	return PARTICLE(
-		.sprite = "stain",
+		.sprite_ptr = get_sprite_interned("part/stain"),
 		.color = clr,
 		.timeout = 60,
 		.draw_rule = ScaleFade,
@@ -862,7 +862,7 @@ static int kdanmaku_proj(Projectile *p, int t) {
 		}
 
 		PARTICLE(
-			.sprite = "flare",
+			.sprite_ptr = get_sprite_interned("part/flare"),
 			.color = RGB(1, 1, 1),
 			.timeout = 30,
 			.draw_rule = ScaleFade,
@@ -1128,7 +1128,7 @@ static void kurumi_extra_create_drainer(Enemy *e) {
 		.draw_rule = kurumi_extra_drainer_draw,
 		.args = { add_ref(e) },
 		.type = FakeProj,
-		.shader = "sprite_default",
+		.shader_ptr = r_shader_interned("sprite_default"),
 		.flags = PFLAG_NOCLEAR,
 	);
 }
@@ -1153,9 +1153,9 @@ static void kurumi_extra_fairy_visual(Enemy *e, int time, bool render) {
 	}
 
 	// r_blend(BLEND_ADD);
-	r_shader("sprite_negative");
+	r_shader_ptr(r_shader_interned("sprite_negative"));
 	Fairy(e, time, render);
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 	// r_blend(BLEND_ALPHA);
 }
 
@@ -1166,9 +1166,9 @@ static void kurumi_extra_bigfairy_visual(Enemy *e, int time, bool render) {
 	}
 
 	// r_blend(BLEND_ADD);
-	r_shader("sprite_negative");
+	r_shader_ptr(r_shader_interned("sprite_negative"));
 	BigFairy(e, time, render);
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 	// r_blend(BLEND_ALPHA);
 }
 
@@ -250,7 +250,7 @@ static int stage5_explosion(Enemy *e, int t) {
 		spawn_items(e->pos, Point, 5, Power, 5, Life, (int)creal(e->args[1]), NULL);
 
 		PARTICLE(
-			.sprite = "blast_huge_rays",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_rays"),
 			.color = color_add(RGBA(0, 0.2 + 0.5 * frand(), 0.5 + 0.5 * frand(), 0.0), RGBA(1, 1, 1, 0)),
 			.pos = e->pos,
 			.timeout = 60 + 10 * frand(),
@@ -262,7 +262,7 @@ static int stage5_explosion(Enemy *e, int t) {
 		);
 
 		PARTICLE(
-			.sprite = "blast_huge_halo",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_halo"),
 			.pos = e->pos,
 			.color = RGBA(0.3 * frand(), 0.3 * frand(), 1.0, 0),
 			.timeout = 200 + 24 * frand(),
@@ -322,7 +322,7 @@ static void iku_slave_visual(Enemy *e, int t, bool render) {
 		clr->a = 0;
 
 		PARTICLE(
-			.sprite = "lightningball",
+			.sprite_ptr = get_sprite_interned("part/lightningball"),
 			.pos = 0,
 			.color = clr,
 			.draw_rule = Fade,
@@ -383,7 +383,7 @@ static int stage5_lightburst2(Enemy *e, int t) {
 			tsrand_fill(2);
 			complex n = cexp(I*carg(global.plr.pos-e->pos) + 2.0*I*M_PI/c*i);
 			PROJECTILE(
-				.sprite = "bigball",
+				.proto = pp_bigball,
 				.pos = e->pos + 50*n*cexp(-1.0*I*_i*global.diff),
 				.color = RGB(0.3, 0, 0.7+0.3*(_i&1)),
 				.rule = asymptotic,
@@ -436,7 +436,7 @@ static void cloud_common(void) {
 	PROJECTILE(
 		// FIXME: add prototype, or shove it into the basic ones somehow,
 		// or just replace this with some thing else
-		.sprite_ptr = get_sprite("part/lightningball"),
+		.sprite_ptr = get_sprite_interned("part/lightningball"),
 		.size = 48 * (1+I),
 		.collision_size = 21.6 * (1+I),
 
@@ -447,7 +447,7 @@ static void cloud_common(void) {
 			1-2*afrand(1)+v*I,
 			-0.01*I
 		},
-		.shader = "sprite_default",
+		.shader_ptr = r_shader_interned("sprite_default"),
 	);
 }
 
@@ -510,7 +510,7 @@ void iku_atmospheric(Boss *b, int time) {
 
 		for(i = -c*0.5; i <= c*0.5; i++) {
 			PROJECTILE(
-				.sprite = "ball",
+				.proto = pp_ball,
 				.pos = p1+(p2-p1)/c*i,
 				.color = RGBA(1-1/(1+fabs(0.1*i)), 0.5-0.1*abs(i), 1, 0),
 				.rule = accelerated,
@@ -625,7 +625,7 @@ static int zigzag_bullet(Projectile *p, int t) {
 
 	if(t%2 == 0) {
 		PARTICLE(
-			.sprite = "lightningball",
+			.sprite_ptr = get_sprite_interned("part/lightningball"),
 			.pos = p->pos,
 			.color = RGBA(0.1, 0.1, 0.6, 0.0),
 			.timeout = 15,
@@ -664,7 +664,7 @@ void iku_lightning(Boss *b, int time) {
 		float alpha = 0.5;
 
 		PARTICLE(
-			.sprite = "lightningball",
+			.sprite_ptr = get_sprite_interned("part/lightningball"),
 			.pos = b->pos+l*n,
 			.color = RGBA(0.1*alpha, 0.1*alpha, 0.6*alpha, 0),
 			.draw_rule = Fade,
@@ -696,7 +696,7 @@ void iku_lightning(Boss *b, int time) {
 		for(int i=0; i < c; i++) {
 			complex n = cexp(2.0*I*M_PI*frand());
 			PARTICLE(
-				.sprite = "smoke",
+				.sprite_ptr = get_sprite_interned("part/smoke"),
 				.pos = b->pos,
 				.color = RGBA(0.4, 0.4, 1.0, 0.0),
 				.draw_rule = Fade,
@@ -901,7 +901,7 @@ static void iku_extra_slave_visual(Enemy *e, int t, bool render) {
 	if(e->args[2] && !(t % 5)) {
 		complex offset = (frand()-0.5)*30 + (frand()-0.5)*20.0*I;
 		PARTICLE(
-			.sprite = "smoothdot",
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.pos = offset,
 			.color = e->args[1] ? RGBA(1.0, 0.5, 0.0, 0.0) : RGBA(0.0, 0.5, 0.5, 0.0),
 			.draw_rule = Shrink,
@@ -13,6 +13,7 @@
 
 #include "stage.h"
 #include "stageutils.h"
+#include "stagesnapshot.h"
 #include "global.h"
 #include "resource/model.h"
 #include "stagedraw.h"
@@ -217,6 +218,7 @@ void start_fall_over(void) { //troll
 static void stage6_start(void) {
 	init_stage3d(&stage_3d_context);
 	fall_over = 0;
+	stage_snapshot_track(&fall_over, sizeof(fall_over));
 
 	add_model(&stage_3d_context, stage6_skysphere_draw, stage6_skysphere_pos);
 	add_model(&stage_3d_context, stage6_towertop_draw, stage6_towertop_pos);
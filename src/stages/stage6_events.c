@@ -118,7 +118,7 @@ static int stage6_flowermine(Enemy *e, int t) {
 
 	FROM_TO(0, 1000, 7-global.diff) {
 		PROJECTILE(
-			.sprite = "rice",
+			.proto = pp_rice,
 			.pos = e->pos + 40*cexp(I*0.6*_i+I*carg(e->args[0])),
 			.color = RGB(1-psin(_i), 0.3, psin(_i)),
 			.rule = wait_proj,
@@ -156,7 +156,7 @@ static int scythe_mid(Enemy *e, int t) {
 	n = cexp(cimag(e->args[1])*I*t);
 	FROM_TO_SND("shot1_loop",0,300,1) {}
 	PROJECTILE(
-		.sprite = "bigball",
+		.proto = pp_bigball,
 		.pos = e->pos + 80*n,
 		.color = RGBA(0.2, 0.5-0.5*cimag(n), 0.5+0.5*creal(n), 0.0),
 		.rule = wait_proj,
@@ -200,7 +200,7 @@ void Scythe(Enemy *e, int t, bool render) {
 	}
 
 	PARTICLE(
-		.sprite_ptr = get_sprite("stage6/scythe"),
+		.sprite_ptr = get_sprite_interned("stage6/scythe"),
 		.pos = e->pos+I*6*sin(global.frames/25.0),
 		.draw_rule = ScytheTrail,
 		.timeout = 8,
@@ -210,7 +210,7 @@ void Scythe(Enemy *e, int t, bool render) {
 	);
 
 	PARTICLE(
-		.sprite = "smoothdot",
+		.sprite_ptr = get_sprite_interned("part/smoothdot"),
 		.pos = e->pos+100*creal(e->args[2])*frand()*cexp(2.0*I*M_PI*frand()),
 		.color = RGBA(1.0, 0.1, 1.0, 0.0),
 		.draw_rule = GrowFade,
@@ -282,7 +282,7 @@ static int scythe_infinity(Enemy *e, int t) {
 		e->pos = VIEWPORT_W/2 + 200.0*I + 200*cos(w*(t-40)+M_PI/2.0) + I*80*sin(creal(e->args[0])*w*(t-40));
 
 		PROJECTILE(
-			.sprite = "ball",
+			.proto = pp_ball,
 			.pos = e->pos+80*cexp(I*creal(e->args[1])),
 			.color = RGB(cos(creal(e->args[1])), sin(creal(e->args[1])), cos(creal(e->args[1])+2.1)),
 			.rule = asymptotic,
@@ -381,7 +381,7 @@ static int scythe_newton(Enemy *e, int t) {
 				cabs(p->pos-e->pos) < 50 &&
 				cabs(global.plr.pos-e->pos) > 50 &&
 				p->args[2] == 0 &&
-				p->sprite != get_sprite("proj/apple")
+				p->sprite != get_sprite_interned("proj/apple")
 			) {
 				e->args[3] += 1;
 				//p->args[0] /= 2;
@@ -434,7 +434,7 @@ void elly_newton(Boss *b, int t) {
 	}
 
 	FROM_TO(30 + 60 * (D_Lunatic - global.diff), 10000000, 30 - 6 * global.diff) {
-		Sprite *apple = get_sprite("proj/apple");
+		Sprite *apple = get_sprite_interned("proj/apple");
 		Color *c = NULL;
 
 		switch(tsrand() % 3) {
@@ -662,7 +662,7 @@ void elly_maxwell(Boss *b, int t) {
 }
 
 static void draw_baryon_connector(complex a, complex b) {
-	Sprite *spr = get_sprite("stage6/baryon_connector");
+	Sprite *spr = get_sprite_interned("stage6/baryon_connector");
 	r_mat_push();
 	r_mat_translate(creal(a+b)/2.0, cimag(a+b)/2.0, 0);
 	r_mat_rotate_deg(180/M_PI*carg(a-b), 0, 0, 1);
@@ -680,7 +680,7 @@ static void Baryon(Enemy *e, int t, bool render) {
 	/*
 	if(!(t % 10) && global.boss && cabs(e->pos - global.boss->pos) > 2) {
 		PARTICLE(
-			.sprite = "stain",
+			.sprite_ptr = get_sprite_interned("part/stain"),
 			.size = 100*(1+I),
 			.pos = e->pos+10*frand()*cexp(2.0*I*M_PI*frand()),
 			.color = RGBA(0, 0.4, 0.3, 0.0),
@@ -750,7 +750,7 @@ static void BaryonCenter(Enemy *bcenter, int t, bool render) {
 	}
 
 	r_state_push();
-	r_shader("baryon_feedback");
+	r_shader_ptr(r_shader_interned("baryon_feedback"));
 	r_uniform_vec2("blur_resolution", 0.5*VIEWPORT_W, 0.5*VIEWPORT_H);
 	r_uniform_float("hue_shift", 0);
 	r_uniform_float("time", t/60.0);
@@ -775,7 +775,7 @@ static void BaryonCenter(Enemy *bcenter, int t, bool render) {
 	// draw_baryons(e, t);
 	r_state_pop();
 
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 	draw_baryons(bcenter, t);
 
 	r_shader_standard();
@@ -785,7 +785,7 @@ static void BaryonCenter(Enemy *bcenter, int t, bool render) {
 
 	r_color4(1, 1, 1, 1);
 	r_framebuffer(baryon_fbpair.front);
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 	draw_baryons(bcenter, t);
 
 	for(Enemy *e = global.enemies.first; e; e = e->next) {
@@ -793,7 +793,7 @@ static void BaryonCenter(Enemy *bcenter, int t, bool render) {
 			complex p = e->pos;//+10*frand()*cexp(2.0*I*M_PI*frand());
 
 			r_draw_sprite(&(SpriteParams) {
-				.sprite = "part/myon",
+				.sprite_ptr = get_sprite_interned("part/myon"),
 				.color = RGBA(1, 0.2, 1.0, 0.7),
 				.pos = { creal(p), cimag(p) },
 				.rotation.angle = (creal(e->args[0]) - t) / 16.0, // frand()*M_PI*2,
@@ -972,7 +972,7 @@ static int baryon_eigenstate(Enemy *e, int t) {
 		for(i = 0; i < c; i++) {
 			complex n = cexp(2.0*I*_i+I*M_PI/2+I*creal(e->args[2]));
 			for(j = 0; j < 3; j++) {
-				PROJECTILE(.sprite = "plainball",
+				PROJECTILE(.proto = pp_plainball,
 					.pos = e->pos + 60*cexp(2.0*I*M_PI/c*i),
 					.color = RGBA(j == 0, j == 1, j == 2, 0.0),
 					.rule = eigenstate_proj,
@@ -1114,7 +1114,7 @@ static int broglie_charge(Projectile *p, int t) {
 		clr.a = 0;
 
 		PARTICLE(
-			.sprite = "blast",
+			.sprite_ptr = get_sprite_interned("part/blast"),
 			.size = 16*(1+I), // HACK: thwart prototype (see TODO in projectile.c)
 			.pos = p->pos,
 			.color = &clr,
@@ -1183,7 +1183,7 @@ static int broglie_charge(Projectile *p, int t) {
 			clr->a = 0;
 
 			PARTICLE(
-				.sprite = "flare",
+				.sprite_ptr = get_sprite_interned("part/flare"),
 				.pos = p->pos+l*n,
 				.color = clr,
 				.draw_rule = Fade,
@@ -1251,7 +1251,7 @@ static int baryon_broglie(Enemy *e, int t) {
 		double hue = (attack_num * M_PI + a + M_PI/6) / (M_PI*2);
 
 		PROJECTILE(
-			.sprite = "ball",
+			.proto = pp_ball,
 			.pos = e->pos + 15*n,
 			.color = HSLA(hue, 1.0, 0.55, 0.0),
 			.rule = broglie_charge,
@@ -1318,7 +1318,7 @@ static int baryon_nattack(Enemy *e, int t) {
 		float a = 0.2*_i + creal(e->args[2]) + 0.006*t;
 		float ca = a + t/60.0f;
 		PROJECTILE(
-			.sprite = "ball",
+			.proto = pp_ball,
 			.pos = e->pos+40*cexp(I*a),
 			.color = RGB(cos(ca), sin(ca), cos(ca+2.1)),
 			.rule = asymptotic,
@@ -1455,7 +1455,7 @@ static int baryon_ricci(Enemy *e, int t) {
 				int c = 3;
 				complex n = cexp(2*M_PI*I * (0.25 + 1.0/c*_i));
 				PROJECTILE(
-					.sprite = "ball",
+					.proto = pp_ball,
 					.pos = 15*n,
 					.color = RGBA(0.0, 0.5, 0.1, 0.0),
 					.rule = ricci_proj2,
@@ -1702,7 +1702,7 @@ void elly_lhc(Boss *b, int t) {
 
 			if(i < 5) {
 				PARTICLE(
-					.sprite = "stain",
+					.sprite_ptr = get_sprite_interned("part/stain"),
 					.pos = pos,
 					.color = RGBA(0.3, 0.3, 1.0, 0.0),
 					.timeout = 60,
@@ -1737,7 +1737,7 @@ static int baryon_explode(Enemy *e, int t) {
 
 		for(uint i = 0; i < 3; ++i) {
 			PARTICLE(
-				.sprite = "smoke",
+				.sprite_ptr = get_sprite_interned("part/smoke"),
 				.pos = e->pos+10*frand()*cexp(2.0*I*M_PI*frand()),
 				.color = RGBA(0.2 * frand(), 0.5, 0.4 * frand(), 1.0),
 				.rule = asymptotic,
@@ -1749,7 +1749,7 @@ static int baryon_explode(Enemy *e, int t) {
 		}
 
 		PARTICLE(
-			.sprite = "blast_huge_halo",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_halo"),
 			.pos = e->pos + cexp(4*frand() + I*M_PI*frand()*2),
 			.color = RGBA(0.2 + frand() * 0.1, 0.6 + 0.4 * frand(), 0.5 + 0.5 * frand(), 0),
 			.timeout = 500 + 24 * frand() + 5,
@@ -1761,7 +1761,7 @@ static int baryon_explode(Enemy *e, int t) {
 		);
 
 		PARTICLE(
-			.sprite = "blast_huge_rays",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_rays"),
 			.color = color_add(RGBA(0.2 + frand() * 0.3, 0.5 + 0.5 * frand(), frand(), 0.0), RGBA(1, 1, 1, 0)),
 			.pos = e->pos,
 			.timeout = 300 + 38 * frand(),
@@ -1773,7 +1773,7 @@ static int baryon_explode(Enemy *e, int t) {
 		);
 
 		PARTICLE(
-			.sprite = "blast_huge_halo",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_halo"),
 			.pos = e->pos,
 			.color = RGBA(3.0, 1.0, 2.0, 1.0),
 			.timeout = 60 + 5 * nfrand(),
@@ -1790,7 +1790,7 @@ static int baryon_explode(Enemy *e, int t) {
 
 	if(!(t % 6)) {
 		PARTICLE(
-			.sprite = "blast_huge_halo",
+			.sprite_ptr = get_sprite_interned("part/blast_huge_halo"),
 			.pos = e->pos,
 			.color = RGBA(3.0, 1.0, 2.0, 1.0),
 			.timeout = 10,
@@ -1802,7 +1802,7 @@ static int baryon_explode(Enemy *e, int t) {
 		);
 	}/* else {
 		PARTICLE(
-			.sprite = "smoke",
+			.sprite_ptr = get_sprite_interned("part/smoke"),
 			.pos = e->pos+10*frand()*cexp(2.0*I*M_PI*frand()),
 			.color = RGBA(0.2 * frand(), 0.5, 0.4 * frand(), 0.1 * frand()),
 			.rule = asymptotic,
@@ -1905,7 +1905,7 @@ static int curvature_slave(Enemy *e, int t) {
 			float speed = 0.5/(1+(global.diff < D_Hard));
 
 			PROJECTILE(
-				.sprite = "flea",
+				.proto = pp_flea,
 				.pos = pos,
 				.color = RGB(0.1*afrand(0), 0.6,1),
 				.rule = curvature_bullet,
@@ -1920,7 +1920,7 @@ static int curvature_slave(Enemy *e, int t) {
 	if(global.diff >= D_Hard && !(t%20)) {
 		play_sound_ex("shot2",10,false);
 		Projectile *p =PROJECTILE(
-			.sprite = "bigball",
+			.proto = pp_bigball,
 			.pos = global.boss->pos,
 			.color = RGBA(0.5, 0.4, 1.0, 0.0),
 			.rule = linear,
@@ -1929,7 +1929,7 @@ static int curvature_slave(Enemy *e, int t) {
 
 		if(global.diff == D_Lunatic) {
 			PROJECTILE(
-				.sprite = "plainball",
+				.proto = pp_plainball,
 				.pos = global.boss->pos,
 				.color = RGBA(0.2, 0.4, 1.0, 0.0),
 				.rule = curvature_orbiter,
@@ -2079,7 +2079,7 @@ static int elly_toe_boson(Projectile *p, int t) {
 
 		if(t % 3 == 0) {
 			PARTICLE(
-				.sprite = "smoothdot",
+				.sprite_ptr = get_sprite_interned("part/smoothdot"),
 				.pos = p->pos,
 				.color = &thiscolor_additive,
 				.rule = linear,
@@ -2097,7 +2097,7 @@ static int elly_toe_boson(Projectile *p, int t) {
 		play_sound("redirect");
 
 			PARTICLE(
-				.sprite_ptr = get_sprite("part/blast"),
+				.sprite_ptr = get_sprite_interned("part/blast"),
 				.pos = p->pos,
 				.color = HSLA(carg(p->args[0]),0.5,0.5,0),
 				.rule = elly_toe_boson_effect,
@@ -2135,7 +2135,7 @@ static int elly_toe_boson(Projectile *p, int t) {
 		}
 
 		PARTICLE(
-			.sprite = "myon",
+			.sprite_ptr = get_sprite_interned("part/myon"),
 			.pos = prev_pos,
 			.color = &thiscolor_additive,
 			.timeout = 50,
@@ -2145,7 +2145,7 @@ static int elly_toe_boson(Projectile *p, int t) {
 		);
 
 		PARTICLE(
-			.sprite = "stardust",
+			.sprite_ptr = get_sprite_interned("part/stardust"),
 			.pos = prev_pos,
 			.color = &thiscolor_additive,
 			.timeout = 60,
@@ -2182,7 +2182,7 @@ static int elly_toe_boson(Projectile *p, int t) {
 		clr->a = 0;
 
 		PARTICLE(
-			.sprite = "smoothdot",
+			.sprite_ptr = get_sprite_interned("part/smoothdot"),
 			.pos = posLookahead,
 			.color = clr,
 			.timeout = 10,
@@ -2258,7 +2258,7 @@ static int elly_toe_fermion(Projectile *p, int t) {
 		double particle_scale = min(1.0, 0.5 * p->sprite->w / 28.0);
 
 		PARTICLE(
-			.sprite = "stardust",
+			.sprite_ptr = get_sprite_interned("part/stardust"),
 			.pos = p->pos,
 			.color = &thiscolor_additive,
 			.timeout = min(t / 6.0, 10),
@@ -2278,7 +2278,7 @@ static int elly_toe_fermion(Projectile *p, int t) {
 			play_sound_ex("shot_special1", 5, false);
 
 			PARTICLE(
-				.sprite_ptr = get_sprite("part/blast"),
+				.sprite_ptr = get_sprite_interned("part/blast"),
 				.pos = p->pos,
 				.color = &thiscolor_additive,
 				.rule = elly_toe_fermion_yukawa_effect,
@@ -2635,7 +2635,7 @@ void elly_theory(Boss *b, int time) {
 		global.shake_view_fade=1;
 
 		PARTICLE(
-			.sprite_ptr = get_sprite("part/blast"),
+			.sprite_ptr = get_sprite_interned("part/blast"),
 			.pos = b->pos,
 			.color = RGBA(1.0, 0.3, 0.3, 0.0),
 			.timeout = 60,
@@ -2646,7 +2646,7 @@ void elly_theory(Boss *b, int time) {
 
 		for(int i = 0; i < 5; ++i) {
 			PARTICLE(
-				.sprite = "stain",
+				.sprite_ptr = get_sprite_interned("part/stain"),
 				.pos = b->pos,
 				.color = RGBA(0.3, 0.3, 1.0, 0.0),
 				.timeout = 100 + 20 * nfrand(),
@@ -2740,13 +2740,13 @@ void elly_theory(Boss *b, int time) {
 }
 
 void elly_spellbg_toe(Boss *b, int t) {
-	r_shader("sprite_default");
+	r_shader_ptr(r_shader_interned("sprite_default"));
 
 	r_draw_sprite(&(SpriteParams) {
 		.pos = { VIEWPORT_W/2, VIEWPORT_H/2 },
 		.scale.both = 0.75 + 0.0005 * t,
 		.rotation.angle = t * 0.1 * DEG2RAD,
-		.sprite = "stage6/spellbg_toe",
+		.sprite_ptr = get_sprite_interned("stage6/spellbg_toe"),
 		.color = RGB(0.6, 0.6, 0.6),
 	});
 
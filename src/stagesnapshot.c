@@ -0,0 +1,376 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "stagesnapshot.h"
+#include "global.h"
+#include "stageobjects.h"
+#include "stageutils.h"
+#include "entity.h"
+#include "enemygrid.h"
+
+#include <zlib.h>
+
+#define NUM_POOLS (sizeof(StageObjectPools)/sizeof(ObjectPool*))
+#define MAX_TRACKED 8
+
+typedef struct TrackedData {
+	void *data;
+	size_t size;
+} TrackedData;
+
+static struct {
+	TrackedData blocks[MAX_TRACKED];
+	uint num;
+	size_t total_size;
+} tracked;
+
+typedef struct SnapshotGlobals {
+	Player plr;
+
+	ProjectileList projs;
+	ProjectileList particles;
+	EnemyList enemies;
+	ItemList items;
+	LaserList lasers;
+
+	int frames;
+	int timer;
+	int stage_start_frame;
+	int game_over;
+
+	float shake_view;
+	float shake_view_fade;
+
+	RandomState rand_game;
+	RandomState rand_visual;
+} SnapshotGlobals;
+
+struct StageSnapshot {
+	int frame;
+	size_t size;
+
+	SnapshotGlobals globals;
+	AniPlayer plr_ani;
+
+	Reference *refs;
+	int num_refs;
+
+	struct {
+		vec3 cx;
+		vec3 cv;
+		vec3 crot;
+		float projangle;
+	} camera;
+
+	struct {
+		int playpos;
+		int fps;
+		uint16_t desync_check;
+	} replay;
+
+	char *pools[NUM_POOLS];
+	char *entities;
+	char *tracked;
+};
+
+static ObjectPool **pool_ptr(uint idx) {
+	assert(idx < NUM_POOLS);
+	return &stage_object_pools.first + idx;
+}
+
+StageSnapshot *stage_snapshot_create(void) {
+	if(global.boss || global.dialog || global.game_over) {
+		return NULL;
+	}
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		if(objpool_snapshot_size(*pool_ptr(i)) == 0) {
+			return NULL;
+		}
+	}
+
+	StageSnapshot *snap = calloc(1, sizeof(*snap));
+	snap->frame = global.frames;
+	snap->size = sizeof(*snap);
+
+	snap->globals = (SnapshotGlobals) {
+		.plr = global.plr,
+		.projs = global.projs,
+		.particles = global.particles,
+		.enemies = global.enemies,
+		.items = global.items,
+		.lasers = global.lasers,
+		.frames = global.frames,
+		.timer = global.timer,
+		.stage_start_frame = global.stage_start_frame,
+		.game_over = global.game_over,
+		.shake_view = global.shake_view,
+		.shake_view_fade = global.shake_view_fade,
+		.rand_game = global.rand_game,
+		.rand_visual = global.rand_visual,
+	};
+
+	aniplayer_copy(&snap->plr_ani, &global.plr.ani);
+
+	snap->num_refs = global.refs.count;
+	snap->refs = malloc(sizeof(*snap->refs) * snap->num_refs);
+	memcpy(snap->refs, global.refs.ptrs, sizeof(*snap->refs) * snap->num_refs);
+	snap->size += sizeof(*snap->refs) * snap->num_refs;
+
+	memcpy(snap->camera.cx, stage_3d_context.cx, sizeof(vec3));
+	memcpy(snap->camera.cv, stage_3d_context.cv, sizeof(vec3));
+	memcpy(snap->camera.crot, stage_3d_context.crot, sizeof(vec3));
+	snap->camera.projangle = stage_3d_context.projangle;
+
+	if(global.replay_stage) {
+		snap->replay.playpos = global.replay_stage->playpos;
+		snap->replay.fps = global.replay_stage->fps;
+		snap->replay.desync_check = global.replay_stage->desync_check;
+	}
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		ObjectPool *pool = *pool_ptr(i);
+		size_t size = objpool_snapshot_size(pool);
+		snap->pools[i] = malloc(size);
+		objpool_snapshot(pool, snap->pools[i]);
+		snap->size += size;
+	}
+
+	snap->entities = malloc(ent_snapshot_size());
+	ent_snapshot(snap->entities);
+	snap->size += ent_snapshot_size();
+
+	if(tracked.total_size) {
+		char *p = snap->tracked = malloc(tracked.total_size);
+		snap->size += tracked.total_size;
+
+		for(uint i = 0; i < tracked.num; ++i) {
+			memcpy(p, tracked.blocks[i].data, tracked.blocks[i].size);
+			p += tracked.blocks[i].size;
+		}
+	}
+
+	return snap;
+}
+
+void stage_snapshot_restore(StageSnapshot *snap) {
+	// These aren't part of the snapshot, and never exist at the time one is taken.
+	if(global.dialog) {
+		delete_dialog(global.dialog);
+		global.dialog = NULL;
+	}
+
+	if(global.boss) {
+		free_boss(global.boss);
+		global.boss = NULL;
+	}
+
+	aniplayer_free(&global.plr.ani);
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		objpool_restore(*pool_ptr(i), snap->pools[i]);
+	}
+
+	ent_restore(snap->entities);
+
+	global.refs.count = snap->num_refs;
+	global.refs.ptrs = realloc(global.refs.ptrs, sizeof(*global.refs.ptrs) * snap->num_refs);
+	memcpy(global.refs.ptrs, snap->refs, sizeof(*global.refs.ptrs) * snap->num_refs);
+
+	SnapshotGlobals *g = &snap->globals;
+	global.plr = g->plr;
+	global.projs = g->projs;
+	global.particles = g->particles;
+	global.enemies = g->enemies;
+	global.items = g->items;
+	global.lasers = g->lasers;
+	global.frames = g->frames;
+	global.timer = g->timer;
+	global.stage_start_frame = g->stage_start_frame;
+	global.game_over = g->game_over;
+	global.shake_view = g->shake_view;
+	global.shake_view_fade = g->shake_view_fade;
+	global.rand_game = g->rand_game;
+	global.rand_visual = g->rand_visual;
+
+	aniplayer_copy(&global.plr.ani, &snap->plr_ani);
+
+	memcpy(stage_3d_context.cx, snap->camera.cx, sizeof(vec3));
+	memcpy(stage_3d_context.cv, snap->camera.cv, sizeof(vec3));
+	memcpy(stage_3d_context.crot, snap->camera.crot, sizeof(vec3));
+	stage_3d_context.projangle = snap->camera.projangle;
+
+	if(global.replay_stage) {
+		global.replay_stage->playpos = snap->replay.playpos;
+		global.replay_stage->fps = snap->replay.fps;
+		global.replay_stage->desync_check = snap->replay.desync_check;
+	}
+
+	if(snap->tracked) {
+		const char *p = snap->tracked;
+
+		for(uint i = 0; i < tracked.num; ++i) {
+			memcpy(tracked.blocks[i].data, p, tracked.blocks[i].size);
+			p += tracked.blocks[i].size;
+		}
+	}
+
+	enemygrid_invalidate();
+}
+
+void stage_snapshot_free(StageSnapshot *snap) {
+	if(snap == NULL) {
+		return;
+	}
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		free(snap->pools[i]);
+	}
+
+	aniplayer_free(&snap->plr_ani);
+	free(snap->refs);
+	free(snap->entities);
+	free(snap->tracked);
+	free(snap);
+}
+
+int stage_snapshot_frame(StageSnapshot *snap) {
+	return snap->frame;
+}
+
+size_t stage_snapshot_size(StageSnapshot *snap) {
+	return snap->size;
+}
+
+void stage_snapshot_track(void *data, size_t size) {
+	for(uint i = 0; i < tracked.num; ++i) {
+		if(tracked.blocks[i].data == data) {
+			assert(tracked.blocks[i].size == size);
+			return;
+		}
+	}
+
+	if(tracked.num == MAX_TRACKED) {
+		log_fatal("Too many tracked state blocks");
+	}
+
+	tracked.blocks[tracked.num++] = (TrackedData) { data, size };
+	tracked.total_size += size;
+}
+
+void stage_snapshot_untrack_all(void) {
+	memset(&tracked, 0, sizeof(tracked));
+}
+
+static uint32_t digest_bytes(uint32_t crc, const void *data, size_t size) {
+	return crc32(crc, data, size);
+}
+
+#define DIGEST(crc, val) digest_bytes(crc, &(val), sizeof(val))
+
+uint32_t stage_state_digest(void) {
+	uint32_t crc = crc32(0L, Z_NULL, 0);
+
+	crc = DIGEST(crc, global.frames);
+	crc = DIGEST(crc, global.timer);
+	crc = digest_bytes(crc, global.rand_game.Q, sizeof(global.rand_game.Q));
+	crc = DIGEST(crc, global.rand_game.c);
+	crc = DIGEST(crc, global.rand_game.i);
+
+	crc = DIGEST(crc, global.plr.pos);
+	crc = DIGEST(crc, global.plr.points);
+	crc = DIGEST(crc, global.plr.graze);
+	crc = DIGEST(crc, global.plr.power);
+	crc = DIGEST(crc, global.plr.lives);
+	crc = DIGEST(crc, global.plr.bombs);
+	crc = DIGEST(crc, global.plr.inputflags);
+
+	for(Projectile *p = global.projs.first; p; p = p->next) {
+		crc = DIGEST(crc, p->pos);
+	}
+
+	for(Enemy *e = global.enemies.first; e; e = e->next) {
+		crc = DIGEST(crc, e->pos);
+		crc = DIGEST(crc, e->hp);
+	}
+
+	for(Item *i = global.items.first; i; i = i->next) {
+		crc = DIGEST(crc, i->pos);
+	}
+
+	for(Laser *l = global.lasers.first; l; l = l->next) {
+		crc = DIGEST(crc, l->pos);
+	}
+
+	return crc;
+}
+
+void stage_snapshots_add(StageSnapshotList *list, StageSnapshot *snap) {
+	assert(list->num == 0 || stage_snapshot_frame(list->array[list->num - 1]) < snap->frame);
+
+	if(list->num == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 16;
+		list->array = realloc(list->array, sizeof(*list->array) * list->capacity);
+	}
+
+	list->array[list->num++] = snap;
+	list->total_size += snap->size;
+
+	if(list->size_limit == 0) {
+		return;
+	}
+
+	// Always keep the newest one, even if it alone is over the limit.
+	uint drop = 0;
+
+	while(list->total_size > list->size_limit && drop < list->num - 1) {
+		list->total_size -= list->array[drop]->size;
+		stage_snapshot_free(list->array[drop]);
+		++drop;
+	}
+
+	if(drop) {
+		log_debug("Dropped %u old snapshots, %u remain (%zu bytes)", drop, list->num - drop, list->total_size);
+		list->num -= drop;
+		memmove(list->array, list->array + drop, sizeof(*list->array) * list->num);
+	}
+}
+
+StageSnapshot *stage_snapshots_find(StageSnapshotList *list, int frame) {
+	// Binary search for the last snapshot with snap->frame <= frame
+	uint lo = 0, hi = list->num;
+
+	while(lo < hi) {
+		uint mid = lo + (hi - lo) / 2;
+
+		if(list->array[mid]->frame <= frame) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo ? list->array[lo - 1] : NULL;
+}
+
+int stage_snapshots_last_frame(StageSnapshotList *list) {
+	return list->num ? list->array[list->num - 1]->frame : -1;
+}
+
+void stage_snapshots_free(StageSnapshotList *list) {
+	for(uint i = 0; i < list->num; ++i) {
+		stage_snapshot_free(list->array[i]);
+	}
+
+	free(list->array);
+	list->array = NULL;
+	list->num = list->capacity = 0;
+	list->total_size = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_stagesnapshot_h
+#define IGUARD_stagesnapshot_h
+
+#include "taisei.h"
+
+/*
+ * Snapshots of the stage simulation, used to seek within replays.
+ *
+ * A snapshot captures everything the game logic depends on: the object pools (and thus every
+ * projectile, item, enemy and laser, at their original addresses), the entity registry, the
+ * references, the player, the RNG state and the frame counters. Restoring a snapshot and
+ * simulating forward with the same input must produce exactly the same frames as the original run.
+ *
+ * Bosses and dialogs live outside of the pools, so no snapshot can be taken while either is
+ * active. Seeking into a boss fight restores an earlier snapshot and simulates through its start.
+ * This is also why the static variables inside boss attacks need no tracking: every attack sets
+ * them up again when it starts.
+ *
+ * Code that keeps any other per-stage state in static variables (player modes, stage backgrounds)
+ * must register it with stage_snapshot_track from its init or begin function, or it won't be
+ * rewound along with everything else.
+ */
+
+typedef struct StageSnapshot StageSnapshot;
+
+// Returns NULL if the current state can't be captured; see above.
+StageSnapshot *stage_snapshot_create(void);
+void stage_snapshot_restore(StageSnapshot *snap) attr_nonnull(1);
+void stage_snapshot_free(StageSnapshot *snap);
+int stage_snapshot_frame(StageSnapshot *snap) attr_nonnull(1);
+
+// Approximate number of bytes held by [snap].
+size_t stage_snapshot_size(StageSnapshot *snap) attr_nonnull(1);
+
+// Includes [size] bytes at [data] into all snapshots taken until the end of the current stage.
+// Must be called before the first frame of the stage.
+void stage_snapshot_track(void *data, size_t size) attr_nonnull(1);
+void stage_snapshot_untrack_all(void);
+
+// A checksum of the simulation state, for checking that a restored snapshot re-simulates correctly.
+uint32_t stage_state_digest(void);
+
+// A list of snapshots, ordered by frame.
+typedef struct StageSnapshotList {
+	StageSnapshot **array;
+	uint num;
+	uint capacity;
+	size_t total_size;
+	size_t size_limit; // 0 means unlimited
+} StageSnapshotList;
+
+// Takes ownership of [snap]. Snapshots must be added in increasing frame order.
+// If the list grows past its size limit, the oldest snapshots are dropped.
+void stage_snapshots_add(StageSnapshotList *list, StageSnapshot *snap) attr_nonnull(1, 2);
+
+// Returns the latest snapshot taken at or before [frame], or NULL if there is none.
+StageSnapshot *stage_snapshots_find(StageSnapshotList *list, int frame) attr_nonnull(1);
+
+// Returns the frame of the latest snapshot in the list, or -1 if it's empty.
+int stage_snapshots_last_frame(StageSnapshotList *list) attr_nonnull(1);
+
+void stage_snapshots_free(StageSnapshotList *list) attr_nonnull(1);
+
+#endif // IGUARD_stagesnapshot_h
@@ -12,148 +12,358 @@
 #include "list.h"
 #include "util.h"
 
-struct TaskManager {
-	LIST_ANCHOR(Task) queue;
+/*
+ * Every worker thread owns a queue of pending tasks, sorted by priority. Tasks submitted from one
+ * of the workers go to its own queue; others are spread over the queues round-robin. A worker
+ * takes the best pending task among the heads of all queues, so idle workers steal from busy ones
+ * and the order holds across the whole manager: by priority first, then topmost tasks (newest
+ * first), then the rest in the order they were submitted. Every task gets a sequence number on
+ * submission to tell which queue head came first.
+ *
+ * The queues are guarded by spinlocks held just for a list insertion or removal, which are almost
+ * always uncontended. Nothing else takes a lock in the common case: task state is an atomic, and
+ * threads only block on a mutex when they actually have to sleep (a worker with nothing to do, or
+ * task_wait on a task that's still running), futex-style. Task structures are recycled.
+ */
+
+enum {
+	TASK_POOL_MAX = 256,
+	TASK_WAIT_SPINS = 256,
+	NUM_WAIT_BUCKETS = 16,
+};
+
+enum {
+	TASKMGR_RUNNING,
+	TASKMGR_FINISHING,
+	TASKMGR_ABORTING,
+};
+
+typedef struct TaskQueue {
+	SDL_SpinLock lock;
+	LIST_ANCHOR(Task) tasks;
+	SDL_atomic_t num_tasks;
+	SDL_atomic_t head_prio;
+	SDL_atomic_t head_seq;
+} TaskQueue;
+
+typedef struct TaskWorker {
+	TaskManager *mgr;
+	SDL_Thread *thread;
+	SDL_threadID thread_id;
+	TaskQueue queue;
+} TaskWorker;
+
+typedef struct WaitBucket {
 	SDL_mutex *mutex;
 	SDL_cond *cond;
-	uint numthreads;
-	uint running : 1;
-	uint aborted : 1;
+} WaitBucket;
+
+struct TaskManager {
+	SDL_atomic_t state;
 	SDL_atomic_t numtasks;
+	SDL_atomic_t num_sleeping;
+	SDL_atomic_t next_queue;
+	SDL_atomic_t next_seq;
+	SDL_atomic_t next_topmost_seq;
+	SDL_sem *wakeup;
+	WaitBucket wait_buckets[NUM_WAIT_BUCKETS];
 	SDL_ThreadPriority thread_prio;
-	SDL_Thread *threads[];
+	uint numthreads;
+	TaskWorker workers[];
 };
 
 struct Task {
 	LIST_INTERFACE(Task);
+	TaskManager *mgr;
 	task_func_t callback;
 	task_free_func_t userdata_free_callback;
 	void *userdata;
-	int prio;
-	SDL_mutex *mutex;
-	SDL_cond *cond;
-	TaskStatus status;
 	void *result;
-	uint disowned : 1;
-	uint in_queue : 1;
+	int prio;
+	int seq;
+	SDL_atomic_t status;
+	SDL_atomic_t refs;
+	SDL_atomic_t num_waiters;
 };
 
 static TaskManager *g_taskmgr;
 
-static void taskmgr_free(TaskManager *mgr) {
-	if(mgr->mutex != NULL) {
-		SDL_DestroyMutex(mgr->mutex);
+static struct {
+	SDL_SpinLock lock;
+	Task *free_tasks;
+	uint num_free;
+} task_pool;
+
+static Task* task_alloc(void) {
+	Task *task = NULL;
+
+	SDL_AtomicLock(&task_pool.lock);
+
+	if((task = task_pool.free_tasks)) {
+		task_pool.free_tasks = task->next;
+		--task_pool.num_free;
 	}
 
-	if(mgr->cond != NULL) {
-		SDL_DestroyCond(mgr->cond);
+	SDL_AtomicUnlock(&task_pool.lock);
+
+	if(task == NULL) {
+		task = malloc(sizeof(Task));
 	}
 
-	free(mgr);
+	memset(task, 0, sizeof(*task));
+	return task;
+}
+
+static void task_release(Task *task) {
+	SDL_AtomicLock(&task_pool.lock);
+
+	if(task_pool.num_free < TASK_POOL_MAX) {
+		task->next = task_pool.free_tasks;
+		task_pool.free_tasks = task;
+		++task_pool.num_free;
+		task = NULL;
+	}
+
+	SDL_AtomicUnlock(&task_pool.lock);
+	free(task);
 }
 
-static void task_free(Task *task) {
-	assert(!task->in_queue);
-	assert(task->disowned);
+static void task_pool_free(void) {
+	SDL_AtomicLock(&task_pool.lock);
+
+	for(Task *task = task_pool.free_tasks, *next; task; task = next) {
+		next = task->next;
+		free(task);
+	}
+
+	task_pool.free_tasks = NULL;
+	task_pool.num_free = 0;
+
+	SDL_AtomicUnlock(&task_pool.lock);
+}
+
+static void task_unref(Task *task) {
+	if(!SDL_AtomicDecRef(&task->refs)) {
+		return;
+	}
 
 	if(task->userdata_free_callback != NULL) {
 		task->userdata_free_callback(task->userdata);
 	}
 
-	if(task->mutex != NULL) {
-		SDL_DestroyMutex(task->mutex);
+	task_release(task);
+}
+
+static inline bool task_status_is_final(TaskStatus status) {
+	return status == TASK_FINISHED || status == TASK_CANCELLED;
+}
+
+static WaitBucket* task_wait_bucket(Task *task) {
+	return task->mgr->wait_buckets + ((uintptr_t)task / sizeof(Task)) % NUM_WAIT_BUCKETS;
+}
+
+static void task_set_final_status(Task *task, TaskStatus status) {
+	// NOTE: SDL atomics are sequentially consistent. Either the waiter sees the final status,
+	// or we see the waiter, in which case it's either already sleeping or holds the bucket lock.
+	SDL_AtomicSet(&task->status, status);
+
+	if(task->mgr != NULL && SDL_AtomicGet(&task->num_waiters) > 0) {
+		WaitBucket *b = task_wait_bucket(task);
+		SDL_LockMutex(b->mutex);
+		SDL_CondBroadcast(b->cond);
+		SDL_UnlockMutex(b->mutex);
+	}
+}
+
+static void taskmgr_free(TaskManager *mgr) {
+	if(mgr->wakeup != NULL) {
+		SDL_DestroySemaphore(mgr->wakeup);
 	}
 
-	if(task->cond != NULL) {
-		SDL_DestroyCond(task->cond);
+	for(uint i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+		if(mgr->wait_buckets[i].mutex != NULL) {
+			SDL_DestroyMutex(mgr->wait_buckets[i].mutex);
+		}
+
+		if(mgr->wait_buckets[i].cond != NULL) {
+			SDL_DestroyCond(mgr->wait_buckets[i].cond);
+		}
 	}
 
-	free(task);
+	free(mgr);
 }
 
-static int taskmgr_thread(void *arg) {
-	TaskManager *mgr = arg;
-	attr_unused SDL_threadID tid = SDL_ThreadID();
+static int task_prio_func(List *ltask) {
+	return ((Task*)ltask)->prio;
+}
 
-	if(SDL_SetThreadPriority(mgr->thread_prio) < 0) {
-		log_sdl_error("SDL_SetThreadPriority");
+static void taskqueue_update_head(TaskQueue *q) {
+	SDL_AtomicSet(&q->head_prio, q->tasks.first ? q->tasks.first->prio : INT_MAX);
+	SDL_AtomicSet(&q->head_seq, q->tasks.first ? q->tasks.first->seq : INT_MAX);
+}
+
+static void taskqueue_push(TaskQueue *q, Task *task, bool topmost) {
+	SDL_AtomicLock(&q->lock);
+
+	if(topmost) {
+		alist_insert_at_priority_head(&q->tasks, task, task->prio, task_prio_func);
+	} else {
+		alist_insert_at_priority_tail(&q->tasks, task, task->prio, task_prio_func);
 	}
 
-	bool running;
-	bool aborted;
+	taskqueue_update_head(q);
+	SDL_AtomicIncRef(&q->num_tasks);
+	SDL_AtomicUnlock(&q->lock);
+}
+
+static Task* taskqueue_pop(TaskQueue *q) {
+	SDL_AtomicLock(&q->lock);
+	Task *task = alist_pop(&q->tasks);
 
-	do {
-		SDL_LockMutex(mgr->mutex);
+	if(task != NULL) {
+		taskqueue_update_head(q);
+		(void)SDL_AtomicDecRef(&q->num_tasks);
+	}
 
-		running = mgr->running;
-		aborted = mgr->aborted;
+	SDL_AtomicUnlock(&q->lock);
+	return task;
+}
 
-		if(!running && !aborted) {
-			SDL_CondWait(mgr->cond, mgr->mutex);
-		}
+static Task* taskmgr_pop(TaskManager *mgr, TaskWorker *worker) {
+	uint self = worker - mgr->workers;
 
-		SDL_UnlockMutex(mgr->mutex);
-	} while(!running && !aborted);
+	for(;;) {
+		TaskQueue *best = NULL;
+		int best_prio = INT_MAX;
+		int best_seq = INT_MAX;
 
-	while(running && !aborted) {
-		SDL_LockMutex(mgr->mutex);
-		Task *task = alist_pop(&mgr->queue);
+		// The heads may change while we look, in which case the order is only approximate.
+		for(uint i = 0; i < mgr->numthreads; ++i) {
+			TaskQueue *q = &mgr->workers[(self + i) % mgr->numthreads].queue;
 
-		running = mgr->running;
-		aborted = mgr->aborted;
+			if(SDL_AtomicGet(&q->num_tasks) > 0) {
+				int prio = SDL_AtomicGet(&q->head_prio);
+				int seq = SDL_AtomicGet(&q->head_seq);
 
-		if(running && task == NULL && !aborted) {
-			SDL_CondWait(mgr->cond, mgr->mutex);
+				if(best == NULL || prio < best_prio || (prio == best_prio && seq < best_seq)) {
+					best = q;
+					best_prio = prio;
+					best_seq = seq;
+				}
+			}
 		}
 
-		SDL_UnlockMutex(mgr->mutex);
+		if(best == NULL) {
+			return NULL;
+		}
+
+		Task *task = taskqueue_pop(best);
 
 		if(task != NULL) {
-			SDL_LockMutex(task->mutex);
+			return task;
+		}
 
-			bool task_disowned = task->disowned;
+		// Someone else got there first; look again.
+	}
+}
 
-			if(aborted && task->status == TASK_PENDING) {
-				task->status = TASK_CANCELLED;
-			}
+static bool taskmgr_has_work(TaskManager *mgr) {
+	for(uint i = 0; i < mgr->numthreads; ++i) {
+		if(SDL_AtomicGet(&mgr->workers[i].queue.num_tasks) > 0) {
+			return true;
+		}
+	}
 
-			if(task->status == TASK_PENDING) {
-				task->status = TASK_RUNNING;
+	return false;
+}
 
-				SDL_UnlockMutex(task->mutex);
-				task->result = task->callback(task->userdata);
-				SDL_LockMutex(task->mutex);
+static bool taskmgr_claim_sleeper(TaskManager *mgr) {
+	int num;
 
-				assert(task->in_queue);
-				task->in_queue = false;
-				(void)SDL_AtomicDecRef(&mgr->numtasks);
+	while((num = SDL_AtomicGet(&mgr->num_sleeping)) > 0) {
+		if(SDL_AtomicCAS(&mgr->num_sleeping, num, num - 1)) {
+			return true;
+		}
+	}
 
-				if((task_disowned = task->disowned)) {
-					SDL_UnlockMutex(task->mutex);
-					task_free(task);
-				} else {
-					task->status = TASK_FINISHED;
-					SDL_CondBroadcast(task->cond);
-					SDL_UnlockMutex(task->mutex);
-				}
-			} else if(task->status == TASK_CANCELLED) {
-				assert(task->in_queue);
-				task->in_queue = false;
-				(void)SDL_AtomicDecRef(&mgr->numtasks);
-				SDL_UnlockMutex(task->mutex);
-
-				if(task_disowned) {
-					task_free(task);
-				}
-			} else {
-				UNREACHABLE;
-			}
+	return false;
+}
+
+static void taskmgr_wake_one(TaskManager *mgr) {
+	if(taskmgr_claim_sleeper(mgr)) {
+		SDL_SemPost(mgr->wakeup);
+	}
+}
+
+static void taskmgr_sleep(TaskManager *mgr) {
+	SDL_AtomicIncRef(&mgr->num_sleeping);
+
+	// Re-check after announcing ourselves, or we could miss a wakeup from a concurrent submit.
+	if(taskmgr_has_work(mgr) || SDL_AtomicGet(&mgr->state) != TASKMGR_RUNNING) {
+		if(taskmgr_claim_sleeper(mgr)) {
+			return;
 		}
+
+		// Someone has already posted the wakeup on our behalf; consume it.
+	}
+
+	SDL_SemWait(mgr->wakeup);
+}
+
+static void taskmgr_run_task(TaskManager *mgr, Task *task, bool aborted) {
+	if(aborted) {
+		if(SDL_AtomicCAS(&task->status, TASK_PENDING, TASK_CANCELLED)) {
+			task_set_final_status(task, TASK_CANCELLED);
+		}
+	} else if(SDL_AtomicCAS(&task->status, TASK_PENDING, TASK_RUNNING)) {
+		task->result = task->callback(task->userdata);
+		task_set_final_status(task, TASK_FINISHED);
+	}
+
+	assert(task_status_is_final(SDL_AtomicGet(&task->status)));
+	(void)SDL_AtomicDecRef(&mgr->numtasks);
+	task_unref(task);
+}
+
+static int taskmgr_thread(void *arg) {
+	TaskWorker *worker = arg;
+	TaskManager *mgr = worker->mgr;
+
+	if(SDL_SetThreadPriority(mgr->thread_prio) < 0) {
+		log_sdl_error("SDL_SetThreadPriority");
+	}
+
+	for(;;) {
+		Task *task = taskmgr_pop(mgr, worker);
+
+		if(task != NULL) {
+			taskmgr_run_task(mgr, task, SDL_AtomicGet(&mgr->state) == TASKMGR_ABORTING);
+			continue;
+		}
+
+		if(SDL_AtomicGet(&mgr->state) != TASKMGR_RUNNING) {
+			// Nothing left to do.
+			break;
+		}
+
+		taskmgr_sleep(mgr);
 	}
 
 	return 0;
 }
 
+static void taskmgr_stop_threads(TaskManager *mgr, uint numthreads, int state) {
+	SDL_AtomicSet(&mgr->state, state);
+
+	for(uint i = 0; i < numthreads; ++i) {
+		SDL_SemPost(mgr->wakeup);
+	}
+
+	for(uint i = 0; i < numthreads; ++i) {
+		SDL_WaitThread(mgr->workers[i].thread, NULL);
+	}
+}
+
 TaskManager* taskmgr_create(uint numthreads, SDL_ThreadPriority prio, const char *name) {
 	int numcores = SDL_GetCPUCount();
 	uint maxthreads = numcores * 8;
@@ -170,47 +380,52 @@ TaskManager* taskmgr_create(uint numthreads, SDL_ThreadPriority prio, const char
 		numthreads = maxthreads;
 	}
 
-	TaskManager *mgr = calloc(1, sizeof(TaskManager) + numthreads * sizeof(SDL_Thread*));
+	TaskManager *mgr = calloc(1, sizeof(TaskManager) + numthreads * sizeof(TaskWorker));
 
-	if(!(mgr->mutex = SDL_CreateMutex())) {
-		log_sdl_error("SDL_CreateMutex");
+	if(!(mgr->wakeup = SDL_CreateSemaphore(0))) {
+		log_sdl_error("SDL_CreateSemaphore");
 		goto fail;
 	}
 
-	if(!(mgr->cond = SDL_CreateCond())) {
-		log_sdl_error("SDL_CreateCond");
-		goto fail;
+	for(uint i = 0; i < NUM_WAIT_BUCKETS; ++i) {
+		if(!(mgr->wait_buckets[i].mutex = SDL_CreateMutex())) {
+			log_sdl_error("SDL_CreateMutex");
+			goto fail;
+		}
+
+		if(!(mgr->wait_buckets[i].cond = SDL_CreateCond())) {
+			log_sdl_error("SDL_CreateCond");
+			goto fail;
+		}
 	}
 
+	SDL_AtomicSet(&mgr->state, TASKMGR_RUNNING);
 	mgr->numthreads = numthreads;
 	mgr->thread_prio = prio;
 
 	for(uint i = 0; i < numthreads; ++i) {
+		TaskWorker *worker = mgr->workers + i;
+		worker->mgr = mgr;
+		SDL_AtomicSet(&worker->queue.head_prio, INT_MAX);
+		SDL_AtomicSet(&worker->queue.head_seq, INT_MAX);
+	}
+
+	for(uint i = 0; i < numthreads; ++i) {
+		TaskWorker *worker = mgr->workers + i;
+
 		int digits = i ? log10(i) + 1 : 0;
 		static const char *const prefix = "taskmgr";
 		char threadname[sizeof(prefix) + strlen(name) + digits + 2];
 		snprintf(threadname, sizeof(threadname), "%s:%s/%i", prefix, name, i);
 
-		if(!(mgr->threads[i] = SDL_CreateThread(taskmgr_thread, threadname, mgr))) {
+		if(!(worker->thread = SDL_CreateThread(taskmgr_thread, threadname, worker))) {
 			log_sdl_error("SDL_CreateThread");
-
-			for(uint j = 0; j < i; ++j) {
-				SDL_DetachThread(mgr->threads[j]);
-				mgr->threads[j] = NULL;
-			}
-
-			SDL_LockMutex(mgr->mutex);
-			mgr->aborted = true;
-			SDL_CondBroadcast(mgr->cond);
-			SDL_UnlockMutex(mgr->mutex);
+			taskmgr_stop_threads(mgr, i, TASKMGR_ABORTING);
 			goto fail;
 		}
-	}
 
-	SDL_LockMutex(mgr->mutex);
-	mgr->running = true;
-	SDL_CondBroadcast(mgr->cond);
-	SDL_UnlockMutex(mgr->mutex);
+		worker->thread_id = SDL_GetThreadID(worker->thread);
+	}
 
 	log_debug(
 		"Created task manager %s (%p) with %u threads at priority %i",
@@ -227,48 +442,48 @@ fail:
 	return NULL;
 }
 
-static int task_prio_func(List *ltask) {
-	return ((Task*)ltask)->prio;
+static TaskQueue* taskmgr_select_queue(TaskManager *mgr) {
+	SDL_threadID tid = SDL_ThreadID();
+
+	for(uint i = 0; i < mgr->numthreads; ++i) {
+		if(mgr->workers[i].thread_id == tid) {
+			return &mgr->workers[i].queue;
+		}
+	}
+
+	uint i = (uint)SDL_AtomicAdd(&mgr->next_queue, 1) % mgr->numthreads;
+	return &mgr->workers[i].queue;
 }
 
 Task* taskmgr_submit(TaskManager *mgr, TaskParams params) {
 	assert(params.callback != NULL);
+	assert(SDL_AtomicGet(&mgr->state) != TASKMGR_ABORTING);
 
-	Task *task = calloc(1, sizeof(Task));
+	Task *task = task_alloc();
+	task->mgr = mgr;
 	task->callback = params.callback;
 	task->userdata_free_callback = params.userdata_free_callback;
 	task->userdata = params.userdata;
 	task->prio = params.prio;
-	task->status = TASK_PENDING;
-
-	if(!(task->mutex = SDL_CreateMutex())) {
-		log_sdl_error("SDL_CreateMutex");
-		goto fail;
-	}
-
-	if(!(task->cond = SDL_CreateCond())) {
-		log_sdl_error("SDL_CreateCond");
-		goto fail;
-	}
-
-	SDL_LockMutex(mgr->mutex);
 
+	// Topmost tasks count down from 0, the others count up, so that sorting by the sequence
+	// number puts them in the same order as the queues do.
 	if(params.topmost) {
-		alist_insert_at_priority_head(&mgr->queue, task, task->prio, task_prio_func);
+		task->seq = SDL_AtomicAdd(&mgr->next_topmost_seq, -1) - 1;
 	} else {
-		alist_insert_at_priority_tail(&mgr->queue, task, task->prio, task_prio_func);
+		task->seq = SDL_AtomicAdd(&mgr->next_seq, 1);
 	}
 
-	task->in_queue = true;
+	SDL_AtomicSet(&task->status, TASK_PENDING);
+
+	// One reference for the queue, one for the caller.
+	SDL_AtomicSet(&task->refs, 2);
+
 	SDL_AtomicIncRef(&mgr->numtasks);
-	SDL_CondSignal(mgr->cond);
-	SDL_UnlockMutex(mgr->mutex);
+	taskqueue_push(taskmgr_select_queue(mgr), task, params.topmost);
+	taskmgr_wake_one(mgr);
 
 	return task;
-
-fail:
-	task_free(task);
-	return NULL;
 }
 
 uint taskmgr_remaining(TaskManager *mgr) {
@@ -284,19 +499,10 @@ static void taskmgr_finalize_and_wait(TaskManager *mgr, bool abort) {
 		abort
 	);
 
-	assert(mgr->running);
-	assert(!mgr->aborted);
-
-	SDL_LockMutex(mgr->mutex);
-	mgr->running = false;
-	mgr->aborted = abort;
-	SDL_CondBroadcast(mgr->cond);
-	SDL_UnlockMutex(mgr->mutex);
-
-	for(uint i = 0; i < mgr->numthreads; ++i) {
-		SDL_WaitThread(mgr->threads[i], NULL);
-	}
+	assert(SDL_AtomicGet(&mgr->state) == TASKMGR_RUNNING);
 
+	taskmgr_stop_threads(mgr, mgr->numthreads, abort ? TASKMGR_ABORTING : TASKMGR_FINISHING);
+	assert(taskmgr_remaining(mgr) == 0);
 	taskmgr_free(mgr);
 }
 
@@ -309,87 +515,72 @@ void taskmgr_abort(TaskManager *mgr) {
 }
 
 TaskStatus task_status(Task *task) {
-	TaskStatus result = TASK_INVALID;
-
-	if(task != NULL) {
-		SDL_LockMutex(task->mutex);
-		result = task->status;
-		SDL_UnlockMutex(task->mutex);
+	if(task == NULL) {
+		return TASK_INVALID;
 	}
 
-	return result;
+	return SDL_AtomicGet(&task->status);
 }
 
 bool task_wait(Task *task, void **result) {
-	bool success = false;
-
 	if(task == NULL) {
-		return success;
+		return false;
+	}
+
+	TaskStatus status = SDL_AtomicGet(&task->status);
+
+	// Most tasks we wait for are short; don't go to sleep right away.
+	for(uint i = 0; i < TASK_WAIT_SPINS && !task_status_is_final(status); ++i) {
+		status = SDL_AtomicGet(&task->status);
 	}
 
-	void *_result = NULL;
+	if(!task_status_is_final(status)) {
+		WaitBucket *b = task_wait_bucket(task);
 
-	SDL_LockMutex(task->mutex);
+		SDL_LockMutex(b->mutex);
+		SDL_AtomicIncRef(&task->num_waiters);
 
-	if(task->status == TASK_CANCELLED) {
-		success = false;
-	} else if(task->status == TASK_FINISHED) {
-		success = true;
-		_result = task->result;
-	} else {
-		SDL_CondWait(task->cond, task->mutex);
-		_result = task->result;
-		success = (task->status == TASK_FINISHED);
+		// The bucket is shared with other tasks, so the wakeup might not be ours.
+		while(!task_status_is_final(status = SDL_AtomicGet(&task->status))) {
+			SDL_CondWait(b->cond, b->mutex);
+		}
+
+		(void)SDL_AtomicDecRef(&task->num_waiters);
+		SDL_UnlockMutex(b->mutex);
 	}
 
-	SDL_UnlockMutex(task->mutex);
+	if(status != TASK_FINISHED) {
+		return false;
+	}
 
-	if(success && result != NULL) {
-		*result = _result;
+	if(result != NULL) {
+		*result = task->result;
 	}
 
-	return success;
+	return true;
 }
 
 bool task_cancel(Task *task) {
-	bool success = false;
-
 	if(task == NULL) {
-		return success;
+		return false;
 	}
 
-	SDL_LockMutex(task->mutex);
-
-	if(task->status == TASK_PENDING) {
-		task->status = TASK_CANCELLED;
-		success = true;
+	if(SDL_AtomicCAS(&task->status, TASK_PENDING, TASK_CANCELLED)) {
+		// It stays in the queue until a worker gets to it.
+		task_set_final_status(task, TASK_CANCELLED);
+		return true;
 	}
 
-	SDL_UnlockMutex(task->mutex);
-
-	return success;
+	return false;
 }
 
 bool task_detach(Task *task) {
-	bool success = false;
-	bool task_in_queue;
-
 	if(task == NULL) {
-		return success;
-	}
-
-	SDL_LockMutex(task->mutex);
-	assert(!task->disowned);
-	task->disowned = true;
-	task_in_queue = task->in_queue;
-	success = true;
-	SDL_UnlockMutex(task->mutex);
-
-	if(!task_in_queue) {
-		task_free(task);
+		return false;
 	}
 
-	return success;
+	task_unref(task);
+	return true;
 }
 
 bool task_finish(Task *task, void **result) {
@@ -404,6 +595,72 @@ bool task_abort(Task *task) {
 	return success;
 }
 
+typedef struct ParallelForChunk {
+	task_range_func_t func;
+	void *userdata;
+	uint begin;
+	uint end;
+} ParallelForChunk;
+
+static void* parallel_for_task(void *arg) {
+	ParallelForChunk *chunk = arg;
+	chunk->func(chunk->begin, chunk->end, chunk->userdata);
+	return NULL;
+}
+
+void taskmgr_parallel_for(TaskManager *mgr, uint count, uint grain, task_range_func_t func, void *userdata) {
+	if(count == 0) {
+		return;
+	}
+
+	if(grain == 0) {
+		grain = 1;
+	}
+
+	uint numchunks = mgr ? mgr->numthreads + 1 : 1;
+	numchunks = imin(numchunks, (count + grain - 1) / grain);
+
+	if(numchunks < 2) {
+		func(0, count, userdata);
+		return;
+	}
+
+	ParallelForChunk chunks[numchunks];
+	Task *tasks[numchunks];
+	uint chunksize = count / numchunks;
+	uint remainder = count % numchunks;
+
+	for(uint i = 0, begin = 0; i < numchunks; ++i) {
+		uint end = begin + chunksize + (i < remainder);
+		chunks[i] = (ParallelForChunk) { func, userdata, begin, end };
+		begin = end;
+	}
+
+	// Chunk 0 is reserved for the calling thread.
+	for(uint i = 1; i < numchunks; ++i) {
+		tasks[i] = taskmgr_submit(mgr, (TaskParams) {
+			.callback = parallel_for_task,
+			.userdata = chunks + i,
+			.topmost = true,
+		});
+	}
+
+	parallel_for_task(chunks);
+
+	for(uint i = 1; i < numchunks; ++i) {
+		if(tasks[i] == NULL) {
+			// Submission failed; do it here.
+			parallel_for_task(chunks + i);
+		} else {
+			task_finish(tasks[i], NULL);
+		}
+	}
+}
+
+uint taskmgr_numthreads(TaskManager *mgr) {
+	return mgr->numthreads;
+}
+
 void taskmgr_global_init(void) {
 	assert(g_taskmgr == NULL);
 	g_taskmgr = taskmgr_create(0, SDL_THREAD_PRIORITY_LOW, "global");
@@ -414,15 +671,19 @@ void taskmgr_global_shutdown(void) {
 		taskmgr_finish(g_taskmgr);
 		g_taskmgr = NULL;
 	}
+
+	task_pool_free();
 }
 
 Task* taskmgr_global_submit(TaskParams params) {
 	if(g_taskmgr == NULL) {
-		Task *t = calloc(1, sizeof(Task));
+		Task *t = task_alloc();
 		t->callback = params.callback;
 		t->userdata = params.userdata;
 		t->userdata_free_callback = params.userdata_free_callback;
 		t->result = params.callback(params.userdata);
+		SDL_AtomicSet(&t->status, TASK_FINISHED);
+		SDL_AtomicSet(&t->refs, 1);
 		return t;
 	}
 
@@ -26,6 +26,7 @@ typedef enum TaskStatus {
 
 typedef void* (*task_func_t)(void *userdata);
 typedef void (*task_free_func_t)(void *userdata);
+typedef void (*task_range_func_t)(uint begin, uint end, void *userdata);
 
 /**
  * Parameters for `taskmgr_submit`. See its documentation below.
@@ -162,6 +163,31 @@ bool task_finish(Task *task, void **result);
  */
 bool task_abort(Task *task);
 
+/**
+ * Split the index range [0, count) into contiguous chunks of at least [grain] elements, and call
+ * [func] once for every chunk, spreading the calls over [mgr]'s worker threads. The calling thread
+ * processes one of the chunks itself. Returns once all of the chunks are done.
+ *
+ * [func] must not depend on the order in which chunks are processed, nor touch anything outside
+ * of its own chunk that another chunk may modify. As long as that holds, the result is the same
+ * as with a single call of func(0, count, userdata), which is also what happens if [mgr] is NULL,
+ * or if [count] is too small to be worth splitting.
+ */
+void taskmgr_parallel_for(TaskManager *mgr, uint count, uint grain, task_range_func_t func, void *userdata)
+	attr_nonnull(4);
+
+/**
+ * Returns the number of worker threads in [mgr].
+ */
+uint taskmgr_numthreads(TaskManager *mgr)
+	attr_nonnull(1);
+
+/**
+ * Measure the throughput of submitting and completing trivial tasks at a few different thread
+ * counts, and print the results to stdout. Returns 0 on success, non-zero on failure.
+ */
+int taskmgr_benchmark(void);
+
 /**
  * Initialize the global task manager with default parameters.
  */
@@ -0,0 +1,95 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "taskmanager.h"
+#include "util.h"
+
+// Micro-benchmark of TaskManager's own overhead: the tasks themselves do next to nothing.
+
+enum {
+	BENCH_NUM_TASKS = 200000,
+	BENCH_BATCH_SIZE = 64,
+};
+
+static SDL_atomic_t bench_counter;
+
+static void* bench_task(void *arg) {
+	SDL_AtomicIncRef(&bench_counter);
+	return arg;
+}
+
+static double bench_seconds(Uint64 begin) {
+	return (SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency();
+}
+
+// Submit tasks in small batches and wait for each one, like taskmgr_parallel_for does.
+static double bench_submit_finish(TaskManager *mgr) {
+	Task *tasks[BENCH_BATCH_SIZE];
+	Uint64 begin = SDL_GetPerformanceCounter();
+
+	for(uint i = 0; i < BENCH_NUM_TASKS; i += BENCH_BATCH_SIZE) {
+		for(uint j = 0; j < BENCH_BATCH_SIZE; ++j) {
+			tasks[j] = taskmgr_submit(mgr, (TaskParams) { bench_task });
+		}
+
+		for(uint j = 0; j < BENCH_BATCH_SIZE; ++j) {
+			task_finish(tasks[j], NULL);
+		}
+	}
+
+	return bench_seconds(begin);
+}
+
+// Fire and forget, then wait for the queue to drain.
+static double bench_submit_detach(TaskManager *mgr) {
+	Uint64 begin = SDL_GetPerformanceCounter();
+
+	for(uint i = 0; i < BENCH_NUM_TASKS; ++i) {
+		task_detach(taskmgr_submit(mgr, (TaskParams) { bench_task }));
+	}
+
+	while(taskmgr_remaining(mgr) > 0) {
+		SDL_Delay(0);
+	}
+
+	return bench_seconds(begin);
+}
+
+static void bench_report(const char *name, uint numthreads, double seconds) {
+	tsfprintf(stdout, "%-16s %3u workers: %8.3f ms, %10.0f tasks/s\n",
+		name, numthreads, seconds * 1000, BENCH_NUM_TASKS / seconds
+	);
+}
+
+int taskmgr_benchmark(void) {
+	static const uint worker_counts[] = { 1, 4, 16 };
+
+	for(uint i = 0; i < sizeof(worker_counts)/sizeof(*worker_counts); ++i) {
+		uint numthreads = worker_counts[i];
+		TaskManager *mgr = taskmgr_create(numthreads, SDL_THREAD_PRIORITY_NORMAL, "bench");
+
+		if(mgr == NULL) {
+			log_warn("Failed to create a task manager with %u threads", numthreads);
+			return 1;
+		}
+
+		SDL_AtomicSet(&bench_counter, 0);
+		bench_report("submit+finish", taskmgr_numthreads(mgr), bench_submit_finish(mgr));
+		bench_report("submit+detach", taskmgr_numthreads(mgr), bench_submit_detach(mgr));
+		taskmgr_finish(mgr);
+
+		if(SDL_AtomicGet(&bench_counter) != 2 * BENCH_NUM_TASKS) {
+			log_warn("Expected %u tasks to run, got %i", 2 * BENCH_NUM_TASKS, SDL_AtomicGet(&bench_counter));
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "fbpool.h"
+#include "list.h"
+#include "util.h"
+#include "util/graphics.h"
+
+typedef struct FBPoolKey {
+	uint num_attachments;
+
+	struct {
+		FramebufferAttachment attachment;
+		TextureType type;
+		uint width;
+		uint height;
+		TextureFilterMode filter_min;
+		TextureFilterMode filter_mag;
+		TextureWrapMode wrap_s;
+		TextureWrapMode wrap_t;
+	} attachments[FRAMEBUFFER_MAX_ATTACHMENTS];
+} FBPoolKey;
+
+struct FBPoolEntry {
+	LIST_INTERFACE(FBPoolEntry);
+	Framebuffer *fb;
+	FBPoolKey key;
+	uint last_used;
+	bool in_use;
+};
+
+static void fbpool_make_key(FBPoolKey *key, uint num_attachments, FBAttachmentConfig attachments[num_attachments]) {
+	assert(num_attachments > 0 && num_attachments <= FRAMEBUFFER_MAX_ATTACHMENTS);
+
+	// Zeroed first, so that the keys can be compared with memcmp.
+	memset(key, 0, sizeof(*key));
+	key->num_attachments = num_attachments;
+
+	for(uint i = 0; i < num_attachments; ++i) {
+		TextureParams *p = &attachments[i].tex_params;
+		key->attachments[i].attachment = attachments[i].attachment;
+		key->attachments[i].type = p->type;
+		key->attachments[i].width = p->width;
+		key->attachments[i].height = p->height;
+		key->attachments[i].filter_min = p->filter.min;
+		key->attachments[i].filter_mag = p->filter.mag;
+		key->attachments[i].wrap_s = p->wrap.s;
+		key->attachments[i].wrap_t = p->wrap.t;
+	}
+}
+
+static void fbpool_destroy_entry(FBPool *pool, FBPoolEntry *e) {
+	fbutil_destroy_attachments(e->fb);
+	r_framebuffer_destroy(e->fb);
+	free(list_unlink(&pool->entries, e));
+}
+
+void fbpool_init(FBPool *pool) {
+	memset(pool, 0, sizeof(*pool));
+}
+
+void fbpool_destroy(FBPool *pool) {
+	for(FBPoolEntry *e = pool->entries, *next; e; e = next) {
+		next = e->next;
+
+		if(e->in_use) {
+			log_warn("Framebuffer %p is still in use", (void*)e->fb);
+		}
+
+		fbpool_destroy_entry(pool, e);
+	}
+}
+
+Framebuffer* fbpool_acquire(FBPool *pool, uint num_attachments, FBAttachmentConfig attachments[num_attachments]) {
+	FBPoolKey key;
+	fbpool_make_key(&key, num_attachments, attachments);
+
+	for(FBPoolEntry *e = pool->entries; e; e = e->next) {
+		if(!e->in_use && !memcmp(&e->key, &key, sizeof(key))) {
+			e->in_use = true;
+			e->last_used = pool->frame;
+			return e->fb;
+		}
+	}
+
+	FBPoolEntry *e = calloc(1, sizeof(*e));
+	e->fb = r_framebuffer_create();
+	e->key = key;
+	e->in_use = true;
+	e->last_used = pool->frame;
+
+	fbutil_create_attachments(e->fb, num_attachments, attachments);
+	r_framebuffer_viewport(e->fb, 0, 0, attachments[0].tex_params.width, attachments[0].tex_params.height);
+	r_framebuffer_set_debug_label(e->fb, "Pooled FB");
+	list_push(&pool->entries, e);
+
+	log_debug("New %ux%u framebuffer with %u attachments",
+		attachments[0].tex_params.width,
+		attachments[0].tex_params.height,
+		num_attachments
+	);
+
+	return e->fb;
+}
+
+Framebuffer* fbpool_acquire_like(FBPool *pool, Framebuffer *fb) {
+	FBAttachmentConfig cfg[FRAMEBUFFER_MAX_ATTACHMENTS];
+	uint num_attachments = 0;
+
+	for(uint i = 0; i < FRAMEBUFFER_MAX_ATTACHMENTS; ++i) {
+		Texture *tex = r_framebuffer_get_attachment(fb, i);
+
+		if(tex == NULL) {
+			continue;
+		}
+
+		FBAttachmentConfig *c = cfg + num_attachments++;
+		memset(c, 0, sizeof(*c));
+		c->attachment = i;
+		r_texture_get_params(tex, &c->tex_params);
+		c->tex_params.mipmaps = 0;
+	}
+
+	return fbpool_acquire(pool, num_attachments, cfg);
+}
+
+void fbpool_release(FBPool *pool, Framebuffer *fb) {
+	for(FBPoolEntry *e = pool->entries; e; e = e->next) {
+		if(e->fb == fb) {
+			assert(e->in_use);
+			e->in_use = false;
+			e->last_used = pool->frame;
+			return;
+		}
+	}
+
+	UNREACHABLE;
+}
+
+void fbpool_trim(FBPool *pool, uint max_idle_frames) {
+	for(FBPoolEntry *e = pool->entries, *next; e; e = next) {
+		next = e->next;
+
+		if(!e->in_use && pool->frame - e->last_used > max_idle_frames) {
+			fbpool_destroy_entry(pool, e);
+		}
+	}
+
+	++pool->frame;
+}
@@ -0,0 +1,46 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_util_fbpool_h
+#define IGUARD_util_fbpool_h
+
+#include "taisei.h"
+
+#include "fbpair.h"
+
+/*
+ * A pool of framebuffers for short-lived intermediate results.
+ *
+ * Requests are matched by the size and format of the attachments, so users that need the same
+ * kind of scratch target at different times end up sharing it. The contents of an acquired
+ * framebuffer are undefined. Free framebuffers that haven't been asked for in a while are
+ * destroyed by fbpool_trim, which also takes care of the ones left over from before a resize.
+ */
+
+typedef struct FBPoolEntry FBPoolEntry;
+
+typedef struct FBPool {
+	FBPoolEntry *entries;
+	uint frame;
+} FBPool;
+
+void fbpool_init(FBPool *pool) attr_nonnull(1);
+void fbpool_destroy(FBPool *pool) attr_nonnull(1);
+
+Framebuffer* fbpool_acquire(FBPool *pool, uint num_attachments, FBAttachmentConfig attachments[num_attachments]) attr_nonnull(1, 3) attr_returns_nonnull;
+
+// Acquires a framebuffer with attachments of the same size and format as those of [fb].
+Framebuffer* fbpool_acquire_like(FBPool *pool, Framebuffer *fb) attr_nonnull(1, 2) attr_returns_nonnull;
+
+void fbpool_release(FBPool *pool, Framebuffer *fb) attr_nonnull(1, 2);
+
+// Should be called once per frame. Destroys free framebuffers that were last used more than
+// [max_idle_frames] calls ago.
+void fbpool_trim(FBPool *pool, uint max_idle_frames) attr_nonnull(1);
+
+#endif // IGUARD_util_fbpool_h
@@ -12,6 +12,7 @@
 #include "taisei.h"
 
 #include "fbpair.h"
+#include "fbpool.h"
 #include "resource/font.h"
 
 void set_ortho(float w, float h);
@@ -74,6 +74,21 @@ size_t SDL_RWprintf(SDL_RWops *rwops, const char* fmt, ...) {
 	return ret;
 }
 
+void SDL_RWwrite_json_string(SDL_RWops *rwops, const char *str) {
+	SDL_RWwrite(rwops, "\"", 1, 1);
+
+	for(const char *p = str; *p; ++p) {
+		if(*p == '"' || *p == '\\') {
+			SDL_RWwrite(rwops, "\\", 1, 1);
+			SDL_RWwrite(rwops, p, 1, 1);
+		} else if((uchar)*p >= 0x20) {
+			SDL_RWwrite(rwops, p, 1, 1);
+		}
+	}
+
+	SDL_RWwrite(rwops, "\"", 1, 1);
+}
+
 void tsfprintf(FILE *out, const char *restrict fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
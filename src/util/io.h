@@ -18,6 +18,9 @@ char* read_all(const char *filename, int *size);
 char* SDL_RWgets(SDL_RWops *rwops, char *buf, size_t bufsize);
 size_t SDL_RWprintf(SDL_RWops *rwops, const char* fmt, ...) attr_printf(2, 3);
 
+// Writes [str] as a quoted JSON string. Control characters are dropped rather than escaped.
+void SDL_RWwrite_json_string(SDL_RWops *rwops, const char *str);
+
 // This is for the very few legitimate uses for printf/fprintf that shouldn't be replaced with log_*
 void tsfprintf(FILE *out, const char *restrict fmt, ...) attr_printf(2, 3);
 
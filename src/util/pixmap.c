@@ -384,7 +384,7 @@ bool pixmap_load_stream(SDL_RWops *stream, Pixmap *dst) {
 
 bool pixmap_load_file(const char *path, Pixmap *dst) {
 	// TODO: Make this work without having to read the whole file into memory
-	// (that is what the VFS_MODE_SEEKABLE bit currently does with zip archives).
+	// (that is what the VFS_MODE_SEEKABLE bit does with zip archives that can't be mapped).
 	SDL_RWops *stream = vfs_open(path, VFS_MODE_READ | VFS_MODE_SEEKABLE);
 
 	if(!stream) {
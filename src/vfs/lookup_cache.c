@@ -0,0 +1,134 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include "lookup_cache.h"
+
+static struct {
+	bool enabled;
+	SDL_mutex *mutex;
+
+	// Normalized path -> node (referenced by the cache), or NULL if the path doesn't exist.
+	ht_str2ptr_t nodes;
+	uint generation;
+
+	struct {
+		uint hits;
+		uint negative_hits;
+		uint misses;
+		uint invalidations;
+	} stats;
+} cache;
+
+void vfs_lookup_cache_init(void) {
+	cache.enabled = env_get("TAISEI_VFS_CACHE", true);
+
+	if(!cache.enabled) {
+		return;
+	}
+
+	if(!(cache.mutex = SDL_CreateMutex())) {
+		log_warn("SDL_CreateMutex() failed: %s", SDL_GetError());
+		cache.enabled = false;
+		return;
+	}
+
+	ht_create(&cache.nodes);
+}
+
+static void vfs_lookup_cache_clear(void) {
+	ht_str2ptr_iter_t iter;
+	ht_iter_begin(&cache.nodes, &iter);
+
+	for(; iter.has_data; ht_iter_next(&iter)) {
+		vfs_decref(iter.value);
+	}
+
+	ht_iter_end(&iter);
+	ht_unset_all(&cache.nodes);
+}
+
+void vfs_lookup_cache_shutdown(void) {
+	if(!cache.enabled) {
+		return;
+	}
+
+	log_debug(
+		"%u hits (%u negative), %u misses, %u invalidations",
+		cache.stats.hits + cache.stats.negative_hits,
+		cache.stats.negative_hits,
+		cache.stats.misses,
+		cache.stats.invalidations
+	);
+
+	vfs_lookup_cache_clear();
+	ht_destroy(&cache.nodes);
+	SDL_DestroyMutex(cache.mutex);
+	memset(&cache, 0, sizeof(cache));
+}
+
+VFSNode* vfs_lookup_cache_locate(const char *path) {
+	vfs_thread_stats()->lookups++;
+
+	if(!cache.enabled) {
+		return vfs_locate(vfs_root, path);
+	}
+
+	SDL_LockMutex(cache.mutex);
+
+	VFSNode *node;
+
+	if(ht_lookup(&cache.nodes, path, (void**)&node)) {
+		vfs_thread_stats()->cache_hits++;
+
+		if(node) {
+			vfs_incref(node);
+			cache.stats.hits++;
+		} else {
+			cache.stats.negative_hits++;
+			vfs_set_error("Node '%s' does not exist", path);
+		}
+
+		SDL_UnlockMutex(cache.mutex);
+		return node;
+	}
+
+	uint generation = cache.generation;
+	cache.stats.misses++;
+	SDL_UnlockMutex(cache.mutex);
+
+	node = vfs_locate(vfs_root, path);
+
+	SDL_LockMutex(cache.mutex);
+
+	// If the cache was invalidated in the meantime, the result may already be stale.
+	if(generation == cache.generation && !ht_lookup(&cache.nodes, path, NULL)) {
+		if(node) {
+			vfs_incref(node);
+		}
+
+		ht_set(&cache.nodes, path, node);
+	}
+
+	SDL_UnlockMutex(cache.mutex);
+
+	return node;
+}
+
+void vfs_lookup_cache_invalidate(void) {
+	if(!cache.enabled) {
+		return;
+	}
+
+	SDL_LockMutex(cache.mutex);
+	vfs_lookup_cache_clear();
+	cache.generation++;
+	cache.stats.invalidations++;
+	SDL_UnlockMutex(cache.mutex);
+}
@@ -0,0 +1,39 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#ifndef IGUARD_vfs_lookup_cache_h
+#define IGUARD_vfs_lookup_cache_h
+
+#include "taisei.h"
+
+#include "private.h"
+
+/*
+ * Remembers what paths looked up from the root resolved to, including paths that don't exist.
+ *
+ * Looking up a path in a union queries every member, and wraps the results in a temporary union
+ * node; on a real filesystem each query is a stat call. Resource lookups probe several candidate
+ * paths per resource, so most of that work used to be repeated, and most of it was for misses.
+ *
+ * The cache is cleared on mounts and unmounts, and whenever a directory is created or a file is
+ * opened for writing. Dropping just the entry for the written path isn't enough: the same file
+ * can also be reachable through a union or another mountpoint (e.g. res/ includes
+ * storage/resources), and entries for those paths would stay stale. Writes are rare enough for
+ * this not to matter. Changes made from outside of the game aren't noticed; set
+ * TAISEI_VFS_CACHE=0 to disable the cache.
+ */
+
+void vfs_lookup_cache_init(void);
+void vfs_lookup_cache_shutdown(void);
+
+// Like vfs_locate(vfs_root, path); [path] must be normalized. The result must be decref'd.
+VFSNode* vfs_lookup_cache_locate(const char *path) attr_nonnull(1) attr_nodiscard;
+
+void vfs_lookup_cache_invalidate(void);
+
+#endif // IGUARD_vfs_lookup_cache_h
@@ -133,3 +133,14 @@ SDL_RWops* vfs_node_open(VFSNode *filenode, VFSOpenMode mode) {
 	// TODO: Ensure the stream is read-only if write mode wasn't requested.
 	return filenode->funcs->open(filenode, mode);
 }
+
+bool vfs_node_checksum(VFSNode *filenode, uint64_t *size, uint32_t *crc) {
+	assert(filenode->funcs != NULL);
+
+	if(filenode->funcs->checksum == NULL) {
+		vfs_set_error("Node doesn't have a stored checksum");
+		return false;
+	}
+
+	return filenode->funcs->checksum(filenode, size, crc);
+}
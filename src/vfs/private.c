@@ -10,11 +10,13 @@
 
 #include "private.h"
 #include "vdir.h"
+#include "lookup_cache.h"
 
 VFSNode *vfs_root;
 
 typedef struct vfs_tls_s {
 	char *error_str;
+	VFSStats stats;
 } vfs_tls_t;
 
 typedef struct vfs_shutdownhook_t {
@@ -55,9 +57,6 @@ static vfs_tls_t* vfs_tls_get(void) {
 }
 
 void vfs_init(void) {
-	vfs_root = vfs_alloc();
-	vfs_vdir_init(vfs_root);
-
 	vfs_tls_id = SDL_TLSCreate();
 
 	if(vfs_tls_id) {
@@ -66,6 +65,12 @@ void vfs_init(void) {
 		log_warn("SDL_TLSCreate(): failed: %s", SDL_GetError());
 		vfs_tls_fallback = calloc(1, sizeof(vfs_tls_t));
 	}
+
+	// after the TLS, since allocating nodes updates the thread's stats
+	vfs_root = vfs_alloc();
+	vfs_vdir_init(vfs_root);
+
+	vfs_lookup_cache_init();
 }
 
 static void* call_shutdown_hook(List **vlist, List *vhook, void *arg) {
@@ -78,6 +83,7 @@ static void* call_shutdown_hook(List **vlist, List *vhook, void *arg) {
 void vfs_shutdown(void) {
 	list_foreach(&shutdown_hooks, call_shutdown_hook, NULL);
 
+	vfs_lookup_cache_shutdown();
 	vfs_decref(vfs_root);
 	vfs_tls_free(vfs_tls_fallback);
 
@@ -96,6 +102,7 @@ void vfs_hook_on_shutdown(VFSShutdownHandler func, void *arg) {
 VFSNode* vfs_alloc(void) {
 	VFSNode *node = calloc(1, sizeof(VFSNode));
 	vfs_incref(node);
+	vfs_thread_stats()->nodes_allocated++;
 	return node;
 }
 
@@ -147,6 +154,9 @@ bool vfs_mount(VFSNode *root, const char *mountpoint, VFSNode *subtree) {
 	strcpy(buf[1], buf[0]);
 	vfs_path_split_right(buf[1], &mpbase, &mpname);
 
+	// whatever happens, lookups may resolve differently now
+	vfs_lookup_cache_invalidate();
+
 	if((mpnode = vfs_locate(root, mountpoint))) {
 		// mountpoint already exists - try to merge with the target node
 
@@ -228,6 +238,14 @@ void vfs_set_error(char *fmt, ...) {
 	log_debug("%s", tls->error_str);
 }
 
+VFSStats* vfs_thread_stats(void) {
+	return &vfs_tls_get()->stats;
+}
+
+VFSStats vfs_get_thread_stats(void) {
+	return *vfs_thread_stats();
+}
+
 void vfs_set_error_from_sdl(void) {
 	vfs_set_error("SDL error: %s", SDL_GetError());
 }
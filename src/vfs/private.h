@@ -37,6 +37,7 @@ struct VFSNodeFuncs {
 	void        (*iter_stop)(VFSNode *dirnode, void **opaque) attr_nonnull(1);
 	bool        (*mkdir)(VFSNode *parent, const char *subdir) attr_nonnull(1);
 	SDL_RWops*  (*open)(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1);
+	bool        (*checksum)(VFSNode *filenode, uint64_t *size, uint32_t *crc) attr_nonnull(1, 2, 3);
 };
 
 struct VFSNode {
@@ -68,8 +69,12 @@ const char* vfs_node_iter(VFSNode *node, void **opaque) attr_nonnull(1);
 void vfs_node_iter_stop(VFSNode *node, void **opaque) attr_nonnull(1);
 bool vfs_node_mkdir(VFSNode *parent, const char *subdir) attr_nonnull(1);
 SDL_RWops* vfs_node_open(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1);
+bool vfs_node_checksum(VFSNode *filenode, uint64_t *size, uint32_t *crc) attr_nonnull(1, 2, 3);
 
 void vfs_hook_on_shutdown(VFSShutdownHandler, void *arg);
+
+// Counters of the calling thread, for vfs_get_thread_stats.
+VFSStats* vfs_thread_stats(void) attr_returns_nonnull;
 void vfs_print_tree_recurse(SDL_RWops *dest, VFSNode *root, char *prefix, const char *name) attr_nonnull(1, 2, 3, 4);
 
 #endif // IGUARD_vfs_private_h
@@ -9,6 +9,7 @@
 #include "taisei.h"
 
 #include "private.h"
+#include "lookup_cache.h"
 
 typedef struct VFSDir {
 	VFSNode *node;
@@ -41,6 +42,7 @@ bool vfs_unmount(const char *path) {
 	if(node) {
 		bool result = vfs_node_unmount(node, subdir);
 		vfs_decref(node);
+		vfs_lookup_cache_invalidate();
 		return result;
 	}
 
@@ -52,13 +54,22 @@ SDL_RWops* vfs_open(const char *path, VFSOpenMode mode) {
 	SDL_RWops *rwops = NULL;
 	char p[strlen(path)+1];
 	path = vfs_path_normalize(path, p);
-	VFSNode *node = vfs_locate(vfs_root, path);
+	VFSNode *node;
+
+	if(mode & VFS_MODE_WRITE) {
+		// the file may not exist yet, and a miss must not be cached
+		node = vfs_locate(vfs_root, path);
+	} else {
+		node = vfs_lookup_cache_locate(path);
+	}
 
 	if(node) {
 		assert(node->funcs != NULL);
 
 		if(!(rwops = vfs_node_open(node, mode))) {
 			vfs_set_error("Can't open '%s': %s", path, vfs_get_error());
+		} else if(mode & VFS_MODE_WRITE) {
+			vfs_lookup_cache_invalidate();
 		}
 
 		vfs_decref(node);
@@ -72,7 +83,7 @@ SDL_RWops* vfs_open(const char *path, VFSOpenMode mode) {
 VFSInfo vfs_query(const char *path) {
 	char p[strlen(path)+1];
 	path = vfs_path_normalize(path, p);
-	VFSNode *node = vfs_locate(vfs_root, path);
+	VFSNode *node = vfs_lookup_cache_locate(path);
 
 	if(node) {
 		// expected to set error on failure
@@ -89,6 +100,21 @@ VFSInfo vfs_query(const char *path) {
 	return VFSINFO_ERROR;
 }
 
+bool vfs_query_checksum(const char *path, uint64_t *out_size, uint32_t *out_crc) {
+	char p[strlen(path)+1];
+	path = vfs_path_normalize(path, p);
+	VFSNode *node = vfs_lookup_cache_locate(path);
+
+	if(node) {
+		bool result = vfs_node_checksum(node, out_size, out_crc);
+		vfs_decref(node);
+		return result;
+	}
+
+	vfs_set_error("Node '%s' does not exist", path);
+	return false;
+}
+
 bool vfs_mkdir(const char *path) {
 	char p[strlen(path)+1];
 	path = vfs_path_normalize(path, p);
@@ -100,17 +126,25 @@ bool vfs_mkdir(const char *path) {
 		vfs_decref(node);
 
 		if(ok) {
+			vfs_lookup_cache_invalidate();
 			return ok;
 		}
 	}
 
 	char *parent, *subdir;
-	vfs_path_split_right(p, &parent, &subdir);
+	char split[strlen(p)+1];
+	strcpy(split, p);
+	vfs_path_split_right(split, &parent, &subdir);
 	node = vfs_locate(vfs_root, parent);
 
 	if(node) {
 		ok = vfs_node_mkdir(node, subdir);
 		vfs_decref(node);
+
+		if(ok) {
+			vfs_lookup_cache_invalidate();
+		}
+
 		return ok;
 	} else {
 		vfs_set_error("Node '%s' does not exist", parent);
@@ -128,7 +162,7 @@ void vfs_mkdir_required(const char *path) {
 char* vfs_repr(const char *path, bool try_syspath) {
 	char buf[strlen(path)+1];
 	path = vfs_path_normalize(path, buf);
-	VFSNode *node = vfs_locate(vfs_root, path);
+	VFSNode *node = vfs_lookup_cache_locate(path);
 
 	if(node) {
 		char *p = vfs_node_repr(node, try_syspath);
@@ -167,7 +201,7 @@ bool vfs_print_tree(SDL_RWops *dest, const char *path) {
 VFSDir* vfs_dir_open(const char *path) {
 	char p[strlen(path)+1];
 	path = vfs_path_normalize(path, p);
-	VFSNode *node = vfs_locate(vfs_root, path);
+	VFSNode *node = vfs_lookup_cache_locate(path);
 
 	if(node) {
 		if(node->funcs->iter && vfs_node_query(node).is_dir) {
@@ -37,9 +37,20 @@ typedef enum VFSOpenMode {
 
 typedef struct VFSDir VFSDir;
 
+typedef struct VFSStats {
+	uint lookups;          // paths looked up through the public API
+	uint cache_hits;       // lookups answered by the lookup cache
+	uint nodes_allocated;
+	uint syscalls;         // filesystem calls made by system path nodes
+} VFSStats;
+
 SDL_RWops* vfs_open(const char *path, VFSOpenMode mode);
 VFSInfo vfs_query(const char *path);
 
+// Gets the size and CRC-32 of a file without reading it, if they are stored alongside it, i.e.
+// if it's in a zip archive. Returns false otherwise.
+bool vfs_query_checksum(const char *path, uint64_t *out_size, uint32_t *out_crc) attr_nonnull(1, 2, 3);
+
 bool vfs_mkdir(const char *path);
 void vfs_mkdir_required(const char *path);
 
@@ -66,4 +77,7 @@ void vfs_init(void);
 void vfs_shutdown(void);
 const char* vfs_get_error(void) attr_returns_nonnull;
 
+// Counters of the work done by the VFS on the calling thread, since it started.
+VFSStats vfs_get_thread_stats(void);
+
 #endif // IGUARD_vfs_public_h
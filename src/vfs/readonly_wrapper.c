@@ -79,6 +79,10 @@ static SDL_RWops* vfs_ro_open(VFSNode *filenode, VFSOpenMode mode) {
 	return vfs_node_open(WRAPPED(filenode), mode);
 }
 
+static bool vfs_ro_checksum(VFSNode *filenode, uint64_t *size, uint32_t *crc) {
+	return vfs_node_checksum(WRAPPED(filenode), size, crc);
+}
+
 static VFSNodeFuncs vfs_funcs_ro = {
 	.repr = vfs_ro_repr,
 	.query = vfs_ro_query,
@@ -89,6 +93,7 @@ static VFSNodeFuncs vfs_funcs_ro = {
 	.iter_stop = vfs_ro_iter_stop,
 	.mkdir = vfs_ro_mkdir,
 	.open = vfs_ro_open,
+	.checksum = vfs_ro_checksum,
 	.mount = vfs_ro_mount,
 	.unmount = vfs_ro_unmount,
 };
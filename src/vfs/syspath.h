@@ -18,4 +18,10 @@ extern char vfs_syspath_preferred_separator;
 bool vfs_syspath_init(VFSNode *node, const char *path);
 void vfs_syspath_normalize(char *buf, size_t bufsize, const char *path);
 
+// Maps the whole file behind a syspath node into memory, read-only. Returns NULL if [node] is not
+// a syspath node, or on failure. The mapping doesn't depend on the node, and must be released with
+// vfs_syspath_unmap_file.
+void* vfs_syspath_map_file(VFSNode *node, size_t *out_size) attr_nonnull(1, 2);
+void vfs_syspath_unmap_file(void *data, size_t size);
+
 #endif // IGUARD_vfs_syspath_h
@@ -11,8 +11,10 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #include "syspath.h"
 
@@ -30,6 +32,8 @@ static VFSInfo vfs_syspath_query(VFSNode *node) {
 	struct stat fstat;
 	VFSInfo i = {0};
 
+	vfs_thread_stats()->syscalls++;
+
 	if(stat(node->_path_, &fstat) >= 0) {
 		i.exists = true;
 		i.is_dir = S_ISDIR(fstat.st_mode);
@@ -40,6 +44,7 @@ static VFSInfo vfs_syspath_query(VFSNode *node) {
 
 static SDL_RWops* vfs_syspath_open(VFSNode *node, VFSOpenMode mode) {
 	mode &= VFS_MODE_RWMASK;
+	vfs_thread_stats()->syscalls++;
 	SDL_RWops *rwops = SDL_RWFromFile(node->_path_, mode == VFS_MODE_WRITE ? "w" : "r");
 
 	if(!rwops) {
@@ -60,6 +65,7 @@ static const char* vfs_syspath_iter(VFSNode *node, void **opaque) {
 	struct dirent *e;
 
 	if(!*opaque) {
+		vfs_thread_stats()->syscalls++;
 		*opaque = opendir(node->_path_);
 	}
 
@@ -103,6 +109,7 @@ static bool vfs_syspath_mkdir(VFSNode *node, const char *subdir) {
 	}
 
 	char *p = strfmt("%s%c%s", (char*)node->_path_, VFS_PATH_SEP, subdir);
+	vfs_thread_stats()->syscalls++;
 	bool ok = !mkdir(p, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
 
 	if(!ok && errno == EEXIST) {
@@ -164,3 +171,43 @@ bool vfs_syspath_init(VFSNode *node, const char *path) {
 	vfs_syspath_init_internal(node, strdup(path));
 	return true;
 }
+
+void* vfs_syspath_map_file(VFSNode *node, size_t *out_size) {
+	if(node->funcs != &vfs_funcs_syspath) {
+		return NULL;
+	}
+
+	vfs_thread_stats()->syscalls++;
+	int fd = open(node->_path_, O_RDONLY);
+
+	if(fd < 0) {
+		vfs_set_error("Can't open %s (errno: %i)", (char*)node->_path_, errno);
+		return NULL;
+	}
+
+	struct stat st;
+	void *data = NULL;
+
+	vfs_thread_stats()->syscalls++;
+
+	if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		vfs_set_error("%s is not a regular file, or is empty", (char*)node->_path_);
+	} else {
+		vfs_thread_stats()->syscalls++;
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(data == MAP_FAILED) {
+			vfs_set_error("Can't map %s (errno: %i)", (char*)node->_path_, errno);
+			data = NULL;
+		} else {
+			*out_size = st.st_size;
+		}
+	}
+
+	close(fd);
+	return data;
+}
+
+void vfs_syspath_unmap_file(void *data, size_t size) {
+	munmap(data, size);
+}
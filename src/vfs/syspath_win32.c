@@ -56,11 +56,14 @@ static void _vfs_set_error_win32(const char *file, int line) {
 static VFSInfo vfs_syspath_query(VFSNode *node) {
 	VFSInfo i = {0};
 
+	vfs_thread_stats()->syscalls++;
+
 	if(!PathFileExists(node->_wpath_)) {
 		i.exists = false;
 		return i;
 	}
 
+	vfs_thread_stats()->syscalls++;
 	DWORD attrib = GetFileAttributes(node->_wpath_);
 
 	if(attrib == INVALID_FILE_ATTRIBUTES) {
@@ -76,6 +79,7 @@ static VFSInfo vfs_syspath_query(VFSNode *node) {
 
 static SDL_RWops* vfs_syspath_open(VFSNode *node, VFSOpenMode mode) {
 	mode &= VFS_MODE_RWMASK;
+	vfs_thread_stats()->syscalls++;
 	SDL_RWops *rwops = SDL_RWFromFile(node->_path_, mode == VFS_MODE_WRITE ? "w" : "r");
 
 	if(!rwops) {
@@ -113,6 +117,7 @@ static const char* vfs_syspath_iter(VFSNode *node, void **opaque) {
 		char *pattern = strjoin(node->_path_, "\\*.*", NULL);
 		wchar_t *wpattern = WIN_UTF8ToString(pattern);
 		free(pattern);
+		vfs_thread_stats()->syscalls++;
 		search_handle = FindFirstFile(wpattern, &fdata);
 		free(wpattern);
 
@@ -184,6 +189,7 @@ static bool vfs_syspath_mkdir(VFSNode *node, const char *subdir) {
 
 	char *p = strfmt("%s%c%s", (char*)node->_path_, '\\', subdir);
 	wchar_t *wp = WIN_UTF8ToString(p);
+	vfs_thread_stats()->syscalls++;
 	bool ok = CreateDirectory(wp, NULL);
 	DWORD err = GetLastError();
 
@@ -281,3 +287,46 @@ static bool vfs_syspath_init_internal(VFSNode *node, char *path) {
 bool vfs_syspath_init(VFSNode *node, const char *path) {
 	return vfs_syspath_init_internal(node, strdup(path));
 }
+
+void* vfs_syspath_map_file(VFSNode *node, size_t *out_size) {
+	if(node->funcs != &vfs_funcs_syspath) {
+		return NULL;
+	}
+
+	vfs_thread_stats()->syscalls++;
+	HANDLE file = CreateFile(node->_wpath_, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if(file == INVALID_HANDLE_VALUE) {
+		vfs_set_error_win32();
+		return NULL;
+	}
+
+	LARGE_INTEGER size;
+	void *data = NULL;
+
+	vfs_thread_stats()->syscalls++;
+
+	if(GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= SIZE_MAX) {
+		vfs_thread_stats()->syscalls++;
+		HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if(mapping) {
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// the view keeps the mapping object alive
+			CloseHandle(mapping);
+		}
+	}
+
+	if(data) {
+		*out_size = size.QuadPart;
+	} else {
+		vfs_set_error_win32();
+	}
+
+	CloseHandle(file);
+	return data;
+}
+
+void vfs_syspath_unmap_file(void *data, size_t size) {
+	UnmapViewOfFile(data);
+}
@@ -28,55 +28,48 @@ static void vfs_union_free(VFSNode *node) {
 }
 
 static VFSNode* vfs_union_locate(VFSNode *node, const char *path) {
-	VFSNode *u = vfs_alloc();
-	vfs_union_init(u); // uniception!
+	VFSNode *u = NULL;
+	VFSNode *primary = NULL;
 
-	VFSInfo prim_info = VFSINFO_ERROR;
-	ListContainer *first = node->_members_;
-	ListContainer *last = first;
-	ListContainer *c;
-
-	for(c = first; c; c = c->next) {
-		last = c;
-	}
+	// members are ordered from the most recently mounted one, which takes priority
+	for(ListContainer *c = node->_members_; c; c = c->next) {
+		VFSNode *o = vfs_locate(c->data, path);
 
-	for(c = last; c; c = c->prev) {
-		VFSNode *n = c->data;
-		VFSNode *o = vfs_locate(n, path);
+		if(!o) {
+			continue;
+		}
 
-		if(o) {
-			VFSInfo i = vfs_node_query(o);
+		VFSInfo i = vfs_node_query(o);
 
-			if(vfs_union_mount_internal(u, NULL, o, i, false)) {
-				prim_info = i;
-			} else {
-				vfs_decref(o);
-			}
+		if(!i.exists) {
+			vfs_decref(o);
+			continue;
 		}
-	}
 
-	if(u->_primary_member_) {
-		if(!((List*)(u->_members_))->next || !prim_info.is_dir) {
-			// the temporary union contains just one member, or doesn't represent a directory
-			// in those cases it's just a useless wrapper, so let's just return the primary member directly
-			VFSNode *n = u->_primary_member_;
+		if(!primary) {
+			primary = o;
 
-			// incref primary member to keep it alive
-			vfs_incref(n);
+			if(!i.is_dir) {
+				// nothing in the other members can show through a file, don't even look
+				return primary;
+			}
 
-			// destroy the wrapper, also decrefs n
-			vfs_decref(u);
+			continue;
+		}
 
-			// no need to incref n, vfs_locate did that for us earlier
-			return n;
+		// a directory that exists in several members; only now is a temporary union needed
+		if(!u) {
+			u = vfs_alloc();
+			vfs_union_init(u); // uniception!
+			list_append((ListContainer**)&u->_members_, list_wrap_container(primary));
+			u->_primary_member_ = primary;
 		}
-	} else {
-		// all in vain...
-		vfs_decref(u);
-		u = NULL;
+
+		list_append((ListContainer**)&u->_members_, list_wrap_container(o));
 	}
 
-	return u;
+	// no need to incref, vfs_locate did that for us earlier
+	return u ? u : primary;
 }
 
 typedef struct VFSUnionIterData {
@@ -11,8 +11,6 @@
 #include "zipfile.h"
 #include "zipfile_impl.h"
 
-static VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create);
-
 #define LOG_SDL_ERROR log_debug("SDL error: %s", SDL_GetError())
 
 static zip_int64_t vfs_zipfile_srcfunc(void *userdata, void *data, zip_uint64_t len, zip_source_cmd_t cmd) {
@@ -147,6 +145,15 @@ static void vfs_zipfile_free(VFSNode *node) {
 				vfs_decref(zdata->source);
 			}
 
+			if(zdata->map) {
+				vfs_zipmap_decref(zdata->map);
+			}
+
+			for(zip_int64_t i = 0; i < zdata->num_entries; ++i) {
+				free(zdata->entries[i].name);
+			}
+
+			free(zdata->entries);
 			ht_destroy(&zdata->pathmap);
 			free(zdata);
 		}
@@ -175,28 +182,23 @@ static char* vfs_zipfile_repr(VFSNode *node) {
 }
 
 static VFSNode* vfs_zipfile_locate(VFSNode *node, const char *path) {
-	VFSZipFileTLS *tls = vfs_zipfile_get_tls(node, true);
 	VFSZipFileData *zdata = node->data1;
 	int64_t idx;
 
 	if(!ht_lookup(&zdata->pathmap, path, &idx)) {
-		idx = zip_name_locate(tls->zip, path, 0);
-	}
-
-	if(idx < 0) {
 		return NULL;
 	}
 
 	VFSNode *n = vfs_alloc();
-	vfs_zippath_init(n, node, tls, idx);
+	vfs_zippath_init(n, node, idx);
 	return n;
 }
 
-const char* vfs_zipfile_iter_shared(VFSNode *node, VFSZipFileData *zdata, VFSZipFileIterData *idata, VFSZipFileTLS *tls) {
+const char* vfs_zipfile_iter_shared(VFSNode *node, VFSZipFileData *zdata, VFSZipFileIterData *idata) {
 	const char *r = NULL;
 
 	for(; !r && idata->idx < idata->num; ++idata->idx) {
-		const char *p = zip_get_name(tls->zip, idata->idx, 0);
+		const char *p = zdata->entries[idata->idx].name;
 		const char *p_original = p;
 
 		if(idata->prefix) {
@@ -249,14 +251,13 @@ const char* vfs_zipfile_iter_shared(VFSNode *node, VFSZipFileData *zdata, VFSZip
 static const char* vfs_zipfile_iter(VFSNode *node, void **opaque) {
 	VFSZipFileData *zdata = node->data1;
 	VFSZipFileIterData *idata = *opaque;
-	VFSZipFileTLS *tls = vfs_zipfile_get_tls(node, true);
 
 	if(!idata) {
 		*opaque = idata = calloc(1, sizeof(VFSZipFileIterData));
-		idata->num = zip_get_num_entries(tls->zip, 0);
+		idata->num = zdata->num_entries;
 	}
 
-	return vfs_zipfile_iter_shared(node, zdata, idata, tls);
+	return vfs_zipfile_iter_shared(node, zdata, idata);
 }
 
 void vfs_zipfile_iter_stop(VFSNode *node, void **opaque) {
@@ -282,15 +283,44 @@ static VFSNodeFuncs vfs_funcs_zipfile = {
 	//.open = vfs_zipfile_open,
 };
 
-static void vfs_zipfile_init_pathmap(VFSNode *node) {
+static void vfs_zipfile_init_entries(VFSNode *node, VFSZipFileTLS *tls) {
 	VFSZipFileData *zdata = node->data1;
-	VFSZipFileTLS *tls = vfs_zipfile_get_tls(node, true);
 	zip_int64_t num = zip_get_num_entries(tls->zip, 0);
 
+	// Everything needed to look up and list the entries is copied out of libzip here, so that
+	// threads that only read mapped entries never have to open the archive themselves.
+	zdata->num_entries = num;
+	zdata->entries = calloc(num, sizeof(*zdata->entries));
 	ht_create(&zdata->pathmap);
 
 	for(zip_int64_t i = 0; i < num; ++i) {
-		const char *original = zip_get_name(tls->zip, i, 0);
+		VFSZipFileEntry *e = zdata->entries + i;
+		zip_stat_t st;
+
+		e->name = strdup(zip_get_name(tls->zip, i, 0));
+		ht_set(&zdata->pathmap, e->name, i);
+
+		if(
+			!zip_stat_index(tls->zip, i, 0, &st) &&
+			(st.valid & ZIP_STAT_SIZE) &&
+			(st.valid & ZIP_STAT_COMP_SIZE) &&
+			(st.valid & ZIP_STAT_COMP_METHOD) &&
+			(!(st.valid & ZIP_STAT_ENCRYPTION_METHOD) || st.encryption_method == ZIP_EM_NONE)
+		) {
+			e->size = st.size;
+			e->comp_size = st.comp_size;
+			e->comp_method = st.comp_method;
+			e->crc = st.crc;
+			e->has_crc = st.valid & ZIP_STAT_CRC;
+		} else {
+			// not a real method; such entries are always read through libzip
+			e->comp_method = UINT16_MAX;
+		}
+	}
+
+	// normalized names take priority over the original ones
+	for(zip_int64_t i = 0; i < num; ++i) {
+		const char *original = zdata->entries[i].name;
 		char normalized[strlen(original) + 1];
 
 		vfs_path_normalize(original, normalized);
@@ -308,7 +338,28 @@ static void vfs_zipfile_init_pathmap(VFSNode *node) {
 	}
 }
 
-static VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create) {
+static void vfs_zipfile_init_map(VFSNode *node) {
+	VFSZipFileData *zdata = node->data1;
+	VFSZipFileMap *map = vfs_zipmap_create(zdata->source);
+
+	if(!map) {
+		return;
+	}
+
+	uint num_mapped = vfs_zipmap_find_entries(map, zdata->num_entries, zdata->entries);
+	char *r = vfs_node_repr(zdata->source, true);
+
+	if(num_mapped) {
+		log_debug("%s: %u of %"PRIi64" entries can be read from memory", r, num_mapped, (int64_t)zdata->num_entries);
+		zdata->map = map;
+	} else {
+		vfs_zipmap_decref(map);
+	}
+
+	free(r);
+}
+
+VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create) {
 	VFSZipFileData *zdata = node->data1;
 	VFSZipFileTLS *tls = SDL_TLSGet(zdata->tls_id);
 
@@ -353,11 +404,14 @@ bool vfs_zipfile_init(VFSNode *node, VFSNode *source) {
 		goto error;
 	}
 
-	if(!vfs_zipfile_get_tls(node, true)) {
+	VFSZipFileTLS *tls = vfs_zipfile_get_tls(node, true);
+
+	if(!tls) {
 		goto error;
 	}
 
-	vfs_zipfile_init_pathmap(node);
+	vfs_zipfile_init_entries(node, tls);
+	vfs_zipfile_init_map(node);
 	return true;
 
 error:
@@ -23,10 +23,26 @@ typedef struct VFSZipFileTLS {
 	zip_error_t error;
 } VFSZipFileTLS;
 
+typedef struct VFSZipFileMap VFSZipFileMap;
+
+typedef struct VFSZipFileEntry {
+	char *name;
+	uint64_t size;
+	uint64_t comp_size;
+	uint64_t header_offset; // of the local file header, only if mapped
+	uint32_t crc;
+	uint16_t comp_method;
+	bool has_crc;
+	bool mapped; // can be read straight from VFSZipFileData.map
+} VFSZipFileEntry;
+
 typedef struct VFSZipFileData {
 	VFSNode *source;
 	ht_str2int_t pathmap;
 	SDL_TLSID tls_id;
+	VFSZipFileEntry *entries;
+	zip_int64_t num_entries;
+	VFSZipFileMap *map; // NULL if the archive couldn't be mapped into memory
 } VFSZipFileData;
 
 typedef struct VFSZipFileIterData {
@@ -37,18 +53,39 @@ typedef struct VFSZipFileIterData {
 	char *allocated;
 } VFSZipFileIterData;
 
-const char* vfs_zipfile_iter_shared(VFSNode *node, VFSZipFileData *zdata, VFSZipFileIterData *idata, VFSZipFileTLS *tls);
+// Every thread that reads entries through libzip needs its own zip_t; this opens it on first use.
+VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create);
+
+const char* vfs_zipfile_iter_shared(VFSNode *node, VFSZipFileData *zdata, VFSZipFileIterData *idata);
 void vfs_zipfile_iter_stop(VFSNode *node, void **opaque);
 
+/* zipmap */
+
+/*
+ * Reads entries of an archive that sits in the filesystem from a read-only memory mapping of the
+ * whole file, shared by all threads. Stored entries are read from the mapping in place; deflated
+ * ones are inflated in blocks, and the most recent blocks are kept, so that they can be seeked in.
+ * Anything else (e.g. ZIP64 or encrypted entries) is left to libzip.
+ */
+
+VFSZipFileMap* vfs_zipmap_create(VFSNode *source) attr_nonnull(1);
+void vfs_zipmap_decref(VFSZipFileMap *map) attr_nonnull(1);
+
+// Finds the entries in the mapped archive, and marks those it can read as mapped.
+// Returns the number of such entries.
+uint vfs_zipmap_find_entries(VFSZipFileMap *map, zip_int64_t num_entries, VFSZipFileEntry entries[num_entries]) attr_nonnull(1);
+
+// The stream holds a reference to [map]. Returns NULL and sets the SDL error on failure.
+SDL_RWops* vfs_zipmap_open(VFSZipFileMap *map, VFSZipFileEntry *entry, bool seekable) attr_nonnull(1, 2);
+
 /* zippath */
 
 typedef struct VFSZipPathData {
 	VFSNode *zipnode;
-	VFSZipFileTLS *tls;
 	uint64_t index;
 	VFSInfo info;
 } VFSZipPathData;
 
-void vfs_zippath_init(VFSNode *node, VFSNode *zipnode, VFSZipFileTLS *tls, zip_int64_t idx);
+void vfs_zippath_init(VFSNode *node, VFSNode *zipnode, zip_int64_t idx);
 
 #endif // IGUARD_vfs_zipfile_impl_h
@@ -0,0 +1,375 @@
+/*
+ * This software is licensed under the terms of the MIT-License
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@alienslab.net>.
+ */
+
+#include "taisei.h"
+
+#include <zlib.h>
+
+#include "zipfile_impl.h"
+#include "syspath.h"
+#include "util.h"
+
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_CDIR_ENTRY_SIG 0x02014b50
+#define ZIP_CDIR_ENTRY_SIZE 46
+#define ZIP_EOCD_SIG 0x06054b50
+#define ZIP_EOCD_SIZE 22
+
+#define ZIP_FLAG_ENCRYPTED 1
+
+#define BLOCK_SIZE (64 << 10)
+
+// How much of a deflated entry a seekable stream may keep around. Entries up to this size are
+// never inflated twice; bigger ones have to be inflated again from the start when seeking back
+// past the cached blocks. Non-seekable streams only keep the current block.
+#define MAX_CACHED_BLOCKS 256
+
+struct VFSZipFileMap {
+	SDL_atomic_t refs;
+	uint8_t *data;
+	size_t size;
+};
+
+typedef struct ZipMapBlock {
+	uint8_t *data;
+	int64_t index;
+	uint64_t last_used;
+} ZipMapBlock;
+
+typedef struct ZipMapStream {
+	VFSZipFileMap *map;
+	const uint8_t *src;
+	size_t src_size;
+	size_t size;
+	size_t pos;
+
+	// deflated entries only
+	z_stream zs;
+	int64_t next_block; // the one the inflater will produce next
+	uint64_t use_counter;
+	uint num_blocks;
+	ZipMapBlock *blocks;
+} ZipMapStream;
+
+#define STREAM(rw) ((ZipMapStream*)((rw)->hidden.unknown.data1))
+
+static inline uint16_t read16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+	return read16(p) | ((uint32_t)read16(p + 2) << 16);
+}
+
+VFSZipFileMap* vfs_zipmap_create(VFSNode *source) {
+	size_t size;
+	void *data = vfs_syspath_map_file(source, &size);
+
+	if(!data) {
+		return NULL;
+	}
+
+	VFSZipFileMap *map = calloc(1, sizeof(*map));
+	map->data = data;
+	map->size = size;
+	SDL_AtomicSet(&map->refs, 1);
+
+	return map;
+}
+
+static void vfs_zipmap_incref(VFSZipFileMap *map) {
+	SDL_AtomicIncRef(&map->refs);
+}
+
+void vfs_zipmap_decref(VFSZipFileMap *map) {
+	if(SDL_AtomicDecRef(&map->refs)) {
+		vfs_syspath_unmap_file(map->data, map->size);
+		free(map);
+	}
+}
+
+static const uint8_t* vfs_zipmap_find_eocd(VFSZipFileMap *map) {
+	if(map->size < ZIP_EOCD_SIZE) {
+		return NULL;
+	}
+
+	// the end of central directory record may be followed by a comment of up to 64 KiB
+	size_t last = map->size - ZIP_EOCD_SIZE;
+	size_t first = last > UINT16_MAX ? last - UINT16_MAX : 0;
+
+	for(size_t i = last + 1; i-- > first;) {
+		const uint8_t *p = map->data + i;
+
+		if(read32(p) == ZIP_EOCD_SIG && i + ZIP_EOCD_SIZE + read16(p + 20) == map->size) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+uint vfs_zipmap_find_entries(VFSZipFileMap *map, zip_int64_t num_entries, VFSZipFileEntry entries[num_entries]) {
+	const uint8_t *eocd = vfs_zipmap_find_eocd(map);
+
+	if(!eocd) {
+		return 0;
+	}
+
+	uint64_t cdir_num = read16(eocd + 10);
+	uint64_t cdir_size = read32(eocd + 12);
+	uint64_t cdir_offset = read32(eocd + 16);
+
+	if(cdir_num != num_entries || cdir_offset + cdir_size > map->size) {
+		// most likely ZIP64, which libzip can deal with
+		return 0;
+	}
+
+	const uint8_t *p = map->data + cdir_offset;
+	const uint8_t *end = p + cdir_size;
+	uint num_mapped = 0;
+
+	// libzip numbers the entries in the order of the central directory
+	for(zip_int64_t i = 0; i < num_entries; ++i) {
+		if(end - p < ZIP_CDIR_ENTRY_SIZE || read32(p) != ZIP_CDIR_ENTRY_SIG) {
+			break;
+		}
+
+		VFSZipFileEntry *e = entries + i;
+		uint16_t flags = read16(p + 8);
+		uint16_t method = read16(p + 10);
+
+		// sizes that don't match what libzip says are ZIP64 placeholders
+		if(
+			!(flags & ZIP_FLAG_ENCRYPTED) &&
+			(method == ZIP_CM_STORE || method == ZIP_CM_DEFLATE) &&
+			method == e->comp_method &&
+			read32(p + 20) == e->comp_size &&
+			read32(p + 24) == e->size
+		) {
+			e->header_offset = read32(p + 42);
+			e->mapped = true;
+			++num_mapped;
+		}
+
+		p += ZIP_CDIR_ENTRY_SIZE + read16(p + 28) + read16(p + 30) + read16(p + 32);
+	}
+
+	return num_mapped;
+}
+
+static size_t zipmap_block_size(ZipMapStream *s, int64_t index) {
+	return imin(BLOCK_SIZE, s->size - index * BLOCK_SIZE);
+}
+
+static ZipMapBlock* zipmap_lru_block(ZipMapStream *s) {
+	// unused blocks have last_used == 0, so they're picked first
+	ZipMapBlock *lru = s->blocks;
+
+	for(uint i = 1; i < s->num_blocks; ++i) {
+		if(s->blocks[i].last_used < lru->last_used) {
+			lru = s->blocks + i;
+		}
+	}
+
+	return lru;
+}
+
+static ZipMapBlock* zipmap_get_block(ZipMapStream *s, int64_t index) {
+	for(uint i = 0; i < s->num_blocks; ++i) {
+		if(s->blocks[i].index == index) {
+			s->blocks[i].last_used = ++s->use_counter;
+			return s->blocks + i;
+		}
+	}
+
+	if(index < s->next_block) {
+		// already inflated, but no longer cached; start over
+		inflateReset(&s->zs);
+		s->zs.next_in = (Bytef*)s->src;
+		s->zs.avail_in = s->src_size;
+		s->next_block = 0;
+	}
+
+	for(;;) {
+		ZipMapBlock *b = zipmap_lru_block(s);
+		size_t size = zipmap_block_size(s, s->next_block);
+
+		if(!b->data) {
+			b->data = malloc(BLOCK_SIZE);
+		}
+
+		s->zs.next_out = b->data;
+		s->zs.avail_out = size;
+		int ret = inflate(&s->zs, Z_NO_FLUSH);
+
+		if(s->zs.avail_out) {
+			SDL_SetError("inflate error: %i", ret);
+			b->index = -1;
+			b->last_used = 0;
+			return NULL;
+		}
+
+		b->index = s->next_block++;
+		b->last_used = ++s->use_counter;
+
+		if(b->index == index) {
+			return b;
+		}
+	}
+}
+
+static int64_t zipmap_seek(SDL_RWops *rw, int64_t offset, int whence) {
+	ZipMapStream *s = STREAM(rw);
+	int64_t pos;
+
+	switch(whence) {
+		case RW_SEEK_SET: pos = offset; break;
+		case RW_SEEK_CUR: pos = s->pos + offset; break;
+		case RW_SEEK_END: pos = s->size + offset; break;
+		default: return SDL_SetError("Bad whence value %i", whence);
+	}
+
+	if(pos < 0) {
+		return SDL_SetError("Can't seek before the start of the stream");
+	}
+
+	// nothing is inflated until the next read
+	s->pos = imin(pos, s->size);
+	return s->pos;
+}
+
+static int64_t zipmap_size(SDL_RWops *rw) {
+	return STREAM(rw)->size;
+}
+
+static size_t zipmap_read(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum) {
+	ZipMapStream *s = STREAM(rw);
+
+	if(!size) {
+		return 0;
+	}
+
+	size_t total = imin(maxnum, (s->size - s->pos) / size) * size;
+
+	if(!s->blocks) {
+		memcpy(ptr, s->src + s->pos, total);
+		s->pos += total;
+		return total / size;
+	}
+
+	uint8_t *out = ptr;
+	size_t done = 0;
+
+	while(done < total) {
+		ZipMapBlock *b = zipmap_get_block(s, s->pos / BLOCK_SIZE);
+
+		if(!b) {
+			break;
+		}
+
+		size_t offset = s->pos % BLOCK_SIZE;
+		size_t n = imin(total - done, zipmap_block_size(s, b->index) - offset);
+		memcpy(out + done, b->data + offset, n);
+		done += n;
+		s->pos += n;
+	}
+
+	return done / size;
+}
+
+static size_t zipmap_write(SDL_RWops *rw, const void *ptr, size_t size, size_t maxnum) {
+	SDL_SetError("ZIP archives are read-only");
+	return 0;
+}
+
+static int zipmap_close(SDL_RWops *rw) {
+	if(rw) {
+		ZipMapStream *s = STREAM(rw);
+
+		if(s->blocks) {
+			for(uint i = 0; i < s->num_blocks; ++i) {
+				free(s->blocks[i].data);
+			}
+
+			free(s->blocks);
+			inflateEnd(&s->zs);
+		}
+
+		vfs_zipmap_decref(s->map);
+		free(s);
+		SDL_FreeRW(rw);
+	}
+
+	return 0;
+}
+
+SDL_RWops* vfs_zipmap_open(VFSZipFileMap *map, VFSZipFileEntry *entry, bool seekable) {
+	assert(entry->mapped);
+
+	const uint8_t *h = map->data + entry->header_offset;
+
+	if(
+		map->size < ZIP_LOCAL_HEADER_SIZE ||
+		entry->header_offset > map->size - ZIP_LOCAL_HEADER_SIZE ||
+		read32(h) != ZIP_LOCAL_HEADER_SIG
+	) {
+		SDL_SetError("Bad local header for '%s'", entry->name);
+		return NULL;
+	}
+
+	uint64_t data_offset = entry->header_offset + ZIP_LOCAL_HEADER_SIZE + read16(h + 26) + read16(h + 28);
+
+	if(data_offset > map->size || entry->comp_size > map->size - data_offset) {
+		SDL_SetError("Data of '%s' is out of bounds", entry->name);
+		return NULL;
+	}
+
+	ZipMapStream *s = calloc(1, sizeof(*s));
+	s->src = map->data + data_offset;
+	s->src_size = entry->comp_size;
+	s->size = entry->size;
+
+	if(entry->comp_method == ZIP_CM_DEFLATE) {
+		if(inflateInit2(&s->zs, -MAX_WBITS) != Z_OK) {
+			SDL_SetError("inflateInit2() failed: %s", s->zs.msg ? s->zs.msg : "unknown error");
+			free(s);
+			return NULL;
+		}
+
+		s->zs.next_in = (Bytef*)s->src;
+		s->zs.avail_in = s->src_size;
+
+		if(seekable) {
+			s->num_blocks = imin(MAX_CACHED_BLOCKS, (s->size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+		}
+
+		s->num_blocks = imax(1, s->num_blocks);
+		s->blocks = calloc(s->num_blocks, sizeof(*s->blocks));
+
+		for(uint i = 0; i < s->num_blocks; ++i) {
+			s->blocks[i].index = -1;
+		}
+	}
+
+	SDL_RWops *rw = SDL_AllocRW();
+	memset(rw, 0, sizeof(SDL_RWops));
+
+	rw->hidden.unknown.data1 = s;
+	rw->type = SDL_RWOPS_UNKNOWN;
+	rw->size = zipmap_size;
+	rw->seek = zipmap_seek;
+	rw->read = zipmap_read;
+	rw->write = zipmap_write;
+	rw->close = zipmap_close;
+
+	s->map = map;
+	vfs_zipmap_incref(map);
+
+	return rw;
+}
@@ -15,7 +15,8 @@
 
 static const char* vfs_zippath_name(VFSNode *node) {
 	VFSZipPathData *zdata = node->data1;
-	return zip_get_name(zdata->tls->zip, zdata->index, 0);
+	VFSZipFileData *zfdata = zdata->zipnode->data1;
+	return zfdata->entries[zdata->index].name;
 }
 
 static void vfs_zippath_free(VFSNode *node) {
@@ -65,14 +66,14 @@ static const char* vfs_zippath_iter(VFSNode *node, void **opaque) {
 
 	if(!idata) {
 		idata = calloc(1, sizeof(VFSZipFileIterData));
-		idata->num = zip_get_num_entries(zdata->tls->zip, 0);
+		idata->num = ((VFSZipFileData*)zdata->zipnode->data1)->num_entries;
 		idata->idx = zdata->index;
 		idata->prefix = vfs_zippath_name(node);
 		idata->prefix_len = strlen(idata->prefix);
 		*opaque = idata;
 	}
 
-	return vfs_zipfile_iter_shared(node, zdata->zipnode->data1, idata, zdata->tls);
+	return vfs_zipfile_iter_shared(node, zdata->zipnode->data1, idata);
 }
 
 #define vfs_zippath_iter_stop vfs_zipfile_iter_stop
@@ -84,10 +85,29 @@ static SDL_RWops* vfs_zippath_open(VFSNode *node, VFSOpenMode mode) {
 	}
 
 	VFSZipPathData *zdata = node->data1;
-	zip_file_t *zipfile = zip_fopen_index(zdata->tls->zip, zdata->index, 0);
+	VFSZipFileData *zfdata = zdata->zipnode->data1;
+	VFSZipFileEntry *entry = zfdata->entries + zdata->index;
+
+	if(entry->mapped) {
+		SDL_RWops *rw = vfs_zipmap_open(zfdata->map, entry, mode & VFS_MODE_SEEKABLE);
+
+		if(rw) {
+			return rw;
+		}
+
+		log_debug("Falling back to libzip: %s", SDL_GetError());
+	}
+
+	VFSZipFileTLS *tls = vfs_zipfile_get_tls(zdata->zipnode, true);
+
+	if(!tls) {
+		return NULL;
+	}
+
+	zip_file_t *zipfile = zip_fopen_index(tls->zip, zdata->index, 0);
 
 	if(!zipfile) {
-		vfs_set_error("ZIP error: %s", zip_error_strerror(&zdata->tls->error));
+		vfs_set_error("ZIP error: %s", zip_error_strerror(zip_get_error(tls->zip)));
 		return NULL;
 	}
 
@@ -103,6 +123,22 @@ static SDL_RWops* vfs_zippath_open(VFSNode *node, VFSOpenMode mode) {
 	return bufrw;
 }
 
+static bool vfs_zippath_checksum(VFSNode *node, uint64_t *size, uint32_t *crc) {
+	VFSZipPathData *zdata = node->data1;
+	VFSZipFileData *zfdata = zdata->zipnode->data1;
+	VFSZipFileEntry *entry = zfdata->entries + zdata->index;
+
+	if(zdata->info.is_dir || !entry->has_crc) {
+		vfs_set_error("No checksum stored for this entry");
+		return false;
+	}
+
+	// straight from the central directory
+	*size = entry->size;
+	*crc = entry->crc;
+	return true;
+}
+
 static VFSNodeFuncs vfs_funcs_zippath = {
 	.repr = vfs_zippath_repr,
 	.query = vfs_zippath_query,
@@ -114,12 +150,12 @@ static VFSNodeFuncs vfs_funcs_zippath = {
 	.iter_stop = vfs_zippath_iter_stop,
 	//.mkdir = vfs_zippath_mkdir,
 	.open = vfs_zippath_open,
+	.checksum = vfs_zippath_checksum,
 };
 
-void vfs_zippath_init(VFSNode *node, VFSNode *zipnode, VFSZipFileTLS *tls, zip_int64_t idx) {
+void vfs_zippath_init(VFSNode *node, VFSNode *zipnode, zip_int64_t idx) {
 	VFSZipPathData *zdata = calloc(1, sizeof(VFSZipPathData));
 	zdata->zipnode = zipnode;
-	zdata->tls = tls;
 	zdata->index = idx;
 	node->data1 = zdata;
 